@@ -0,0 +1,176 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ElfUtils/BuildIdReader.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <system_error>
+#include <vector>
+
+#include "OrbitBase/UniqueResource.h"
+#include "absl/strings/str_cat.h"
+#include "llvm/BinaryFormat/ELF.h"
+#include "llvm/Object/ELFTypes.h"
+
+namespace ElfUtils {
+
+namespace {
+
+// Note sections larger than this are not read, build id notes are tiny.
+constexpr uint64_t kMaxNotesSize = 64 * 1024;
+
+outcome::result<void> ReadExactly(int fd, void* buffer, size_t size,
+                                  uint64_t offset) {
+  ssize_t read_size = pread(fd, buffer, size, offset);
+  if (read_size == -1) {
+    return outcome::failure(static_cast<std::errc>(errno));
+  }
+  // A truncated file.
+  if (static_cast<size_t>(read_size) != size) {
+    return outcome::failure(std::errc::executable_format_error);
+  }
+  return outcome::success();
+}
+
+uint64_t AlignNoteField(uint64_t size) { return (size + 3) & ~uint64_t{3}; }
+
+// Returns an empty string if none of the notes in the size bytes at offset is
+// a build id.
+template <typename ElfT>
+outcome::result<std::string> ReadBuildIdFromNotes(int fd, uint64_t offset,
+                                                  uint64_t size) {
+  if (size > kMaxNotesSize) return std::string{};
+  std::vector<char> notes(size);
+  OUTCOME_TRY(ReadExactly(fd, notes.data(), size, offset));
+
+  using Nhdr = typename ElfT::Nhdr;
+  uint64_t note_offset = 0;
+  while (note_offset + sizeof(Nhdr) <= size) {
+    Nhdr header;
+    memcpy(&header, notes.data() + note_offset, sizeof(header));
+    uint64_t name_offset = note_offset + sizeof(header);
+    uint64_t desc_offset = name_offset + AlignNoteField(header.n_namesz);
+    uint64_t desc_end = desc_offset + header.n_descsz;
+    if (desc_end > size) break;
+
+    constexpr char kGnuName[] = "GNU";
+    if (header.n_type == llvm::ELF::NT_GNU_BUILD_ID &&
+        header.n_namesz == sizeof(kGnuName) &&
+        memcmp(notes.data() + name_offset, kGnuName, sizeof(kGnuName)) == 0) {
+      std::string build_id;
+      for (uint64_t i = desc_offset; i < desc_end; ++i) {
+        absl::StrAppend(&build_id, absl::Hex(static_cast<uint8_t>(notes[i]),
+                                             absl::kZeroPad2));
+      }
+      return build_id;
+    }
+    note_offset = desc_offset + AlignNoteField(header.n_descsz);
+  }
+  return std::string{};
+}
+
+// Looks in the note sections, or in the note segments for files without
+// section headers.
+template <typename ElfT>
+outcome::result<std::string> ReadBuildIdFromElf(int fd) {
+  typename ElfT::Ehdr header;
+  OUTCOME_TRY(ReadExactly(fd, &header, sizeof(header), 0));
+
+  using Shdr = typename ElfT::Shdr;
+  if (header.e_shnum > 0 && header.e_shentsize == sizeof(Shdr)) {
+    std::vector<Shdr> sections(header.e_shnum);
+    OUTCOME_TRY(ReadExactly(fd, sections.data(),
+                            sections.size() * sizeof(Shdr), header.e_shoff));
+    for (const Shdr& section : sections) {
+      if (section.sh_type != llvm::ELF::SHT_NOTE) continue;
+      OUTCOME_TRY(build_id, ReadBuildIdFromNotes<ElfT>(fd, section.sh_offset,
+                                                       section.sh_size));
+      if (!build_id.empty()) return build_id;
+    }
+    return std::string{};
+  }
+
+  using Phdr = typename ElfT::Phdr;
+  if (header.e_phnum > 0 && header.e_phentsize == sizeof(Phdr)) {
+    std::vector<Phdr> segments(header.e_phnum);
+    OUTCOME_TRY(ReadExactly(fd, segments.data(),
+                            segments.size() * sizeof(Phdr), header.e_phoff));
+    for (const Phdr& segment : segments) {
+      if (segment.p_type != llvm::ELF::PT_NOTE) continue;
+      OUTCOME_TRY(build_id, ReadBuildIdFromNotes<ElfT>(fd, segment.p_offset,
+                                                       segment.p_filesz));
+      if (!build_id.empty()) return build_id;
+    }
+  }
+  return std::string{};
+}
+
+outcome::result<std::string> ReadBuildIdFromFd(int fd) {
+  unsigned char ident[llvm::ELF::EI_NIDENT];
+  OUTCOME_TRY(ReadExactly(fd, ident, sizeof(ident), 0));
+  if (memcmp(ident, llvm::ELF::ElfMagic, strlen(llvm::ELF::ElfMagic)) != 0) {
+    return outcome::failure(std::errc::executable_format_error);
+  }
+  if (ident[llvm::ELF::EI_DATA] != llvm::ELF::ELFDATA2LSB) {
+    return outcome::failure(std::errc::not_supported);
+  }
+  switch (ident[llvm::ELF::EI_CLASS]) {
+    case llvm::ELF::ELFCLASS32:
+      return ReadBuildIdFromElf<llvm::object::ELF32LE>(fd);
+    case llvm::ELF::ELFCLASS64:
+      return ReadBuildIdFromElf<llvm::object::ELF64LE>(fd);
+    default:
+      return outcome::failure(std::errc::executable_format_error);
+  }
+}
+
+using FileDescriptor = OrbitBase::unique_resource<int, int (*)(int)>;
+
+outcome::result<FileDescriptor> OpenFile(const std::string& file_path) {
+  int fd = open(file_path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd == -1) {
+    return outcome::failure(static_cast<std::errc>(errno));
+  }
+  return FileDescriptor{fd, close};
+}
+
+}  // namespace
+
+outcome::result<std::string> ReadBuildId(const std::string& file_path) {
+  OUTCOME_TRY(fd, OpenFile(file_path));
+  return ReadBuildIdFromFd(fd);
+}
+
+outcome::result<std::string> BuildIdCache::GetBuildId(
+    const std::string& file_path) {
+  OUTCOME_TRY(fd, OpenFile(file_path));
+  // The key is taken from the opened file, so that it is the one read even if
+  // the path is replaced in the meantime.
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) == -1) {
+    return outcome::failure(static_cast<std::errc>(errno));
+  }
+  FileKey key{file_stat.st_dev, file_stat.st_ino, file_stat.st_mtim.tv_sec,
+              file_stat.st_mtim.tv_nsec};
+
+  {
+    absl::MutexLock lock(&mutex_);
+    auto it = build_ids_.find(key);
+    if (it != build_ids_.end()) return it->second;
+  }
+
+  OUTCOME_TRY(build_id, ReadBuildIdFromFd(fd));
+  absl::MutexLock lock(&mutex_);
+  if (build_ids_.size() >= kMaxSize) {
+    build_ids_.clear();
+  }
+  build_ids_.emplace(key, build_id);
+  return build_id;
+}
+
+}  // namespace ElfUtils
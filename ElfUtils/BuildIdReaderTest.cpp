@@ -0,0 +1,59 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "ElfUtils/BuildIdReader.h"
+#include "ElfUtils/ElfFile.h"
+#include "Path.h"
+
+using ElfUtils::BuildIdCache;
+using ElfUtils::ElfFile;
+using ElfUtils::ReadBuildId;
+
+TEST(BuildIdReader, ReadBuildId) {
+  std::string executable_path = Path::GetExecutablePath();
+
+  const auto hello_world =
+      ReadBuildId(executable_path + "testdata/hello_world_elf");
+  ASSERT_TRUE(hello_world) << hello_world.error().message();
+  EXPECT_EQ(hello_world.value(), "d12d54bc5b72ccce54a408bdeda65e2530740ac8");
+
+  const auto elf_without_build_id =
+      ReadBuildId(executable_path + "testdata/hello_world_elf_no_build_id");
+  ASSERT_TRUE(elf_without_build_id) << elf_without_build_id.error().message();
+  EXPECT_EQ(elf_without_build_id.value(), "");
+
+  EXPECT_FALSE(ReadBuildId(executable_path + "testdata/does_not_exist"));
+}
+
+TEST(BuildIdReader, SameBuildIdAsElfFile) {
+  std::string executable_path = Path::GetExecutablePath();
+  for (const char* file_name :
+       {"hello_world_elf", "hello_world_elf_no_build_id",
+        "hello_world_elf_no_program_headers", "hello_world_static_elf",
+        "no_symbols_elf", "no_symbols_elf.debug"}) {
+    std::string file_path = executable_path + "testdata/" + file_name;
+    auto elf_file = ElfFile::Create(file_path);
+    ASSERT_NE(elf_file, nullptr);
+    const auto build_id = ReadBuildId(file_path);
+    ASSERT_TRUE(build_id) << build_id.error().message();
+    EXPECT_EQ(build_id.value(), elf_file->GetBuildId()) << file_name;
+  }
+}
+
+TEST(BuildIdReader, Cache) {
+  std::string executable_path = Path::GetExecutablePath();
+  std::string file_path = executable_path + "testdata/hello_world_elf";
+
+  BuildIdCache cache;
+  for (int i = 0; i < 2; ++i) {
+    const auto build_id = cache.GetBuildId(file_path);
+    ASSERT_TRUE(build_id) << build_id.error().message();
+    EXPECT_EQ(build_id.value(), "d12d54bc5b72ccce54a408bdeda65e2530740ac8");
+  }
+  EXPECT_FALSE(cache.GetBuildId(executable_path + "testdata/does_not_exist"));
+}
@@ -0,0 +1,48 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ELF_UTILS_BUILD_ID_READER_H_
+#define ELF_UTILS_BUILD_ID_READER_H_
+
+#include <sys/types.h>
+
+#include <cstdint>
+#include <string>
+#include <tuple>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+#include "outcome.hpp"
+
+namespace ElfUtils {
+
+// Reads the GNU build id of an ELF file with a few preads of its header and
+// its note sections, instead of loading the whole file like ElfFile does.
+// Returns the build id in the format of ElfFile::GetBuildId, which is empty if
+// the file has none. Like ElfFile, only supports little-endian files, and
+// fails with std::errc::executable_format_error for files that are not ELF.
+outcome::result<std::string> ReadBuildId(const std::string& file_path);
+
+// Caches the build ids read with ReadBuildId by device, inode and modification
+// time of the files, so that a file is only read again when it changes.
+// Thread safe.
+class BuildIdCache {
+ public:
+  outcome::result<std::string> GetBuildId(const std::string& file_path);
+
+ private:
+  // The cache is cleared when it reaches this size, which a system with
+  // unchanged files doesn't.
+  static constexpr size_t kMaxSize = 16 * 1024;
+
+  // Device, inode, and modification time in seconds and nanoseconds.
+  using FileKey = std::tuple<dev_t, ino_t, int64_t, int64_t>;
+
+  absl::Mutex mutex_;
+  absl::flat_hash_map<FileKey, std::string> build_ids_;
+};
+
+}  // namespace ElfUtils
+
+#endif  // ELF_UTILS_BUILD_ID_READER_H_
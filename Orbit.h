@@ -12,10 +12,19 @@
 // While the main feature of Orbit is its ability to dynamically instrument
 // functions, manual instrumentation is still possible using the macros below.
 // These macros call empty functions that Orbit dynamically instruments.
+//
+// Alternatively, define ORBIT_API_LINKED as 1 and link the OrbitApi library:
+// the macros then write their events (with scope names and tracked values) to
+// shared memory that OrbitService reads, which is much cheaper than the two
+// kernel traps per call of dynamic instrumentation.
 
 // To disable manual instrumentation macros, define ORBIT_API_ENABLED as 0.
 #define ORBIT_API_ENABLED 1
 
+#ifndef ORBIT_API_LINKED
+#define ORBIT_API_LINKED 0
+#endif
+
 #if ORBIT_API_ENABLED
 
 // ORBIT_SCOPE: profile current scope.
@@ -75,6 +84,22 @@
 
 namespace orbit_api {
 
+#if ORBIT_API_LINKED
+
+// NOTE: Do not use these directly, use corresponding macros instead.
+void Start(const char* name);
+void Stop();
+void StartAsync(const char* name, uint64_t id);
+void StopAsync(uint64_t id);
+void TrackInt(const char* name, int32_t value);
+void TrackInt64(const char* name, int64_t value);
+void TrackUint(const char* name, uint32_t value);
+void TrackUint64(const char* name, uint64_t value);
+void TrackFloatAsInt(const char* name, int32_t value);
+void TrackDoubleAsInt64(const char* name, int64_t value);
+
+#else
+
 // NOTE: Do not use these directly, use corresponding macros instead.
 ORBIT_STUB void Start(const char*) { ORBIT_NOOP(); }
 ORBIT_STUB void Stop() { ORBIT_NOOP(); }
@@ -87,6 +112,8 @@ ORBIT_STUB void TrackUint64(const char*, uint64_t) { ORBIT_NOOP(); }
 ORBIT_STUB void TrackFloatAsInt(const char*, int32_t) { ORBIT_NOOP(); }
 ORBIT_STUB void TrackDoubleAsInt64(const char*, int64_t) { ORBIT_NOOP(); }
 
+#endif
+
 // Convert floating point arguments to integer arguments as we can't access
 // XMM registers with our current dynamic instrumentation on Linux (uprobes).
 inline void TrackFloat(const char* name, float value) {
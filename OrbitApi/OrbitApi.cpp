@@ -0,0 +1,133 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Linked implementation of the functions of Orbit.h (ORBIT_API_LINKED). Each
+// thread writes its events to its own shared-memory ring buffer, so that
+// recording an event is a few stores and a clock_gettime, with no lock and no
+// system call. Events are dropped when no OrbitService reads them.
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <optional>
+#include <string>
+
+#include "../Orbit.h"
+#include "OrbitApi/ApiEvent.h"
+#include "OrbitBase/SharedMemoryRingBuffer.h"
+
+static_assert(ORBIT_API_LINKED, "OrbitApi must be built with ORBIT_API_LINKED");
+
+namespace orbit_api {
+
+namespace {
+
+using ApiRingBuffer = OrbitBase::SharedMemoryRingBuffer<ApiEvent>;
+
+class ThreadRingBuffer {
+ public:
+  ThreadRingBuffer() : tid_{static_cast<int32_t>(syscall(SYS_gettid))} {
+    std::string name = kApiRingBufferMemfdPrefix + std::to_string(tid_);
+    int fd = memfd_create(name.c_str(), MFD_CLOEXEC);
+    if (fd < 0) {
+      return;
+    }
+    size_ = ApiRingBuffer::ComputeSize(kApiRingBufferCapacity);
+    if (ftruncate(fd, size_) != 0) {
+      close(fd);
+      return;
+    }
+    void* memory =
+        mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (memory == MAP_FAILED) {
+      close(fd);
+      return;
+    }
+    // Keep the file descriptor open: OrbitService finds the ring buffer
+    // through it.
+    fd_ = fd;
+    memory_ = memory;
+    ring_buffer_ =
+        ApiRingBuffer::Create(memory_, size_, kApiRingBufferCapacity);
+  }
+
+  ~ThreadRingBuffer() {
+    if (memory_ != nullptr) {
+      munmap(memory_, size_);
+    }
+    if (fd_ >= 0) {
+      close(fd_);
+    }
+  }
+
+  ThreadRingBuffer(const ThreadRingBuffer&) = delete;
+  ThreadRingBuffer& operator=(const ThreadRingBuffer&) = delete;
+
+  void Write(ApiEventType type, const char* name, uint64_t value) {
+    if (!ring_buffer_.has_value()) {
+      return;
+    }
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    ring_buffer_->TryWrite(
+        {1'000'000'000llu * ts.tv_sec + ts.tv_nsec,
+         reinterpret_cast<uint64_t>(name), value, tid_, type});
+  }
+
+ private:
+  int32_t tid_;
+  int fd_ = -1;
+  void* memory_ = nullptr;
+  size_t size_ = 0;
+  std::optional<ApiRingBuffer> ring_buffer_;
+};
+
+void WriteEvent(ApiEventType type, const char* name, uint64_t value) {
+  thread_local ThreadRingBuffer ring_buffer;
+  ring_buffer.Write(type, name, value);
+}
+
+}  // namespace
+
+void Start(const char* name) { WriteEvent(ApiEventType::kStart, name, 0); }
+
+void Stop() { WriteEvent(ApiEventType::kStop, nullptr, 0); }
+
+void StartAsync(const char* name, uint64_t id) {
+  WriteEvent(ApiEventType::kStartAsync, name, id);
+}
+
+void StopAsync(uint64_t id) {
+  WriteEvent(ApiEventType::kStopAsync, nullptr, id);
+}
+
+void TrackInt(const char* name, int32_t value) {
+  WriteEvent(ApiEventType::kTrackInt, name, static_cast<uint32_t>(value));
+}
+
+void TrackInt64(const char* name, int64_t value) {
+  WriteEvent(ApiEventType::kTrackInt64, name, static_cast<uint64_t>(value));
+}
+
+void TrackUint(const char* name, uint32_t value) {
+  WriteEvent(ApiEventType::kTrackUint, name, value);
+}
+
+void TrackUint64(const char* name, uint64_t value) {
+  WriteEvent(ApiEventType::kTrackUint64, name, value);
+}
+
+void TrackFloatAsInt(const char* name, int32_t value) {
+  WriteEvent(ApiEventType::kTrackFloatAsInt, name,
+             static_cast<uint32_t>(value));
+}
+
+void TrackDoubleAsInt64(const char* name, int64_t value) {
+  WriteEvent(ApiEventType::kTrackDoubleAsInt64, name,
+             static_cast<uint64_t>(value));
+}
+
+}  // namespace orbit_api
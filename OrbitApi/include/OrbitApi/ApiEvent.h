@@ -0,0 +1,46 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_API_API_EVENT_H_
+#define ORBIT_API_API_EVENT_H_
+
+#include <cstdint>
+
+namespace orbit_api {
+
+enum class ApiEventType : uint32_t {
+  kStart = 1,
+  kStop,
+  kStartAsync,
+  kStopAsync,
+  kTrackInt,
+  kTrackInt64,
+  kTrackUint,
+  kTrackUint64,
+  kTrackFloatAsInt,
+  kTrackDoubleAsInt64,
+};
+
+// A call to one of the functions of Orbit.h, as written by the OrbitApi
+// library to the shared-memory ring buffer of the calling thread.
+struct ApiEvent {
+  // CLOCK_MONOTONIC, as for perf_event_open records.
+  uint64_t timestamp_ns;
+  // Address of the name in the target process, 0 if the function has none.
+  // Names are string literals, so the address identifies the name.
+  uint64_t name_address;
+  // The async id or the tracked value, as raw bits.
+  uint64_t value;
+  int32_t tid;
+  ApiEventType type;
+};
+
+// Each thread that uses the API creates a memfd with this prefix followed by
+// its tid, which OrbitService finds in /proc/<pid>/fd.
+constexpr const char* kApiRingBufferMemfdPrefix = "orbit_api_";
+constexpr uint64_t kApiRingBufferCapacity = 16 * 1024;
+
+}  // namespace orbit_api
+
+#endif  // ORBIT_API_API_EVENT_H_
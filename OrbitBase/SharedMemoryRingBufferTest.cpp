@@ -0,0 +1,110 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <array>
+#include <thread>
+
+#include "OrbitBase/SharedMemoryRingBuffer.h"
+
+namespace {
+struct TestRecord {
+  uint64_t timestamp_ns;
+  int32_t tid;
+};
+
+using TestRingBuffer = OrbitBase::SharedMemoryRingBuffer<TestRecord>;
+}  // namespace
+
+TEST(SharedMemoryRingBuffer, CreateValidatesArguments) {
+  alignas(64) std::array<char, TestRingBuffer::ComputeSize(8)> memory{};
+  size_t size = memory.size();
+  EXPECT_FALSE(TestRingBuffer::Create(nullptr, size, 8).has_value());
+  EXPECT_FALSE(TestRingBuffer::Create(memory.data(), size, 0).has_value());
+  EXPECT_FALSE(TestRingBuffer::Create(memory.data(), size, 6).has_value());
+  EXPECT_FALSE(TestRingBuffer::Create(memory.data(), size, 16).has_value());
+  EXPECT_FALSE(TestRingBuffer::Attach(memory.data(), size).has_value());
+
+  ASSERT_TRUE(TestRingBuffer::Create(memory.data(), size, 8).has_value());
+  EXPECT_FALSE(TestRingBuffer::Attach(memory.data(), size - 1).has_value());
+  std::optional<TestRingBuffer> attached =
+      TestRingBuffer::Attach(memory.data(), size);
+  ASSERT_TRUE(attached.has_value());
+  EXPECT_EQ(attached->GetCapacity(), 8);
+}
+
+TEST(SharedMemoryRingBuffer, WriteAndReadInOrderAndDropWhenFull) {
+  constexpr uint64_t kCapacity = 4;
+  alignas(64) std::array<char, TestRingBuffer::ComputeSize(kCapacity)> memory{};
+  std::optional<TestRingBuffer> buffer =
+      TestRingBuffer::Create(memory.data(), memory.size(), kCapacity);
+  ASSERT_TRUE(buffer.has_value());
+
+  TestRecord record{};
+  EXPECT_FALSE(buffer->TryRead(&record));
+
+  for (uint64_t round = 0; round < 3; ++round) {
+    for (uint64_t i = 0; i < kCapacity; ++i) {
+      EXPECT_TRUE(buffer->TryWrite({round * 10 + i, 42}));
+    }
+    EXPECT_FALSE(buffer->TryWrite({100, 42}));
+    EXPECT_EQ(buffer->GetDroppedCount(), round + 1);
+
+    for (uint64_t i = 0; i < kCapacity; ++i) {
+      ASSERT_TRUE(buffer->TryRead(&record));
+      EXPECT_EQ(record.timestamp_ns, round * 10 + i);
+      EXPECT_EQ(record.tid, 42);
+    }
+    EXPECT_FALSE(buffer->TryRead(&record));
+  }
+}
+
+TEST(SharedMemoryRingBuffer, ProducerInChildProcess) {
+  constexpr uint64_t kCapacity = 64;
+  constexpr uint64_t kRecordCount = 100'000;
+  size_t size = TestRingBuffer::ComputeSize(kCapacity);
+  void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  ASSERT_NE(memory, MAP_FAILED);
+  ASSERT_TRUE(TestRingBuffer::Create(memory, size, kCapacity).has_value());
+
+  pid_t child_pid = fork();
+  ASSERT_NE(child_pid, -1);
+  if (child_pid == 0) {
+    std::optional<TestRingBuffer> producer =
+        TestRingBuffer::Attach(memory, size);
+    if (!producer.has_value()) {
+      _exit(1);
+    }
+    for (uint64_t i = 0; i < kRecordCount; ++i) {
+      while (!producer->TryWrite({i, 0})) {
+        std::this_thread::yield();
+      }
+    }
+    _exit(0);
+  }
+
+  std::optional<TestRingBuffer> consumer = TestRingBuffer::Attach(memory, size);
+  ASSERT_TRUE(consumer.has_value());
+  uint64_t expected_timestamp_ns = 0;
+  TestRecord record{};
+  while (expected_timestamp_ns < kRecordCount) {
+    if (!consumer->TryRead(&record)) {
+      std::this_thread::yield();
+      continue;
+    }
+    ASSERT_EQ(record.timestamp_ns, expected_timestamp_ns);
+    ++expected_timestamp_ns;
+  }
+
+  int status = 0;
+  ASSERT_EQ(waitpid(child_pid, &status, 0), child_pid);
+  EXPECT_TRUE(WIFEXITED(status));
+  EXPECT_EQ(WEXITSTATUS(status), 0);
+  munmap(memory, size);
+}
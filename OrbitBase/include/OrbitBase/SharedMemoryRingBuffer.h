@@ -0,0 +1,133 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_BASE_SHARED_MEMORY_RING_BUFFER_H_
+#define ORBIT_BASE_SHARED_MEMORY_RING_BUFFER_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <optional>
+#include <type_traits>
+
+namespace OrbitBase {
+
+/* SharedMemoryRingBuffer is a single-producer single-consumer queue of
+   fixed-size records that lives entirely in a caller-provided memory region,
+   so that the producer and the consumer can be in different processes that
+   map the same memory (e.g., a memfd). It does not own the memory.
+
+   The producer never blocks: when the buffer is full, the record is dropped
+   and counted. Record must be trivially copyable, as it is copied byte by
+   byte between processes.
+
+   There is no synchronization between producers. A target with several
+   producing threads uses one buffer per thread, as the Orbit API does with
+   thread_local buffers, and the consumer polls all of them.
+*/
+template <typename Record>
+class SharedMemoryRingBuffer {
+  static_assert(std::is_trivially_copyable_v<Record>);
+  static_assert(std::atomic<uint64_t>::is_always_lock_free,
+                "Atomics in shared memory need to be lock-free");
+
+ public:
+  // The number of bytes needed for a buffer of capacity records. capacity
+  // must be a power of two.
+  static constexpr size_t ComputeSize(uint64_t capacity) {
+    return sizeof(Header) + capacity * sizeof(Record);
+  }
+
+  // Initializes a new buffer in memory, which must be at least
+  // ComputeSize(capacity) bytes and suitably aligned.
+  static std::optional<SharedMemoryRingBuffer> Create(void* memory,
+                                                      size_t size,
+                                                      uint64_t capacity) {
+    if (memory == nullptr || capacity == 0 ||
+        (capacity & (capacity - 1)) != 0 || size < ComputeSize(capacity)) {
+      return std::nullopt;
+    }
+    auto* header = new (memory) Header{};
+    header->record_size = sizeof(Record);
+    header->capacity = capacity;
+    // Publish the header last, for a consumer that attaches concurrently.
+    header->magic.store(kMagic, std::memory_order_release);
+    return SharedMemoryRingBuffer{header};
+  }
+
+  // Uses a buffer initialized by Create, possibly in another process.
+  static std::optional<SharedMemoryRingBuffer> Attach(void* memory,
+                                                      size_t size) {
+    if (memory == nullptr || size < sizeof(Header)) {
+      return std::nullopt;
+    }
+    auto* header = static_cast<Header*>(memory);
+    if (header->magic.load(std::memory_order_acquire) != kMagic ||
+        header->record_size != sizeof(Record) || header->capacity == 0 ||
+        (header->capacity & (header->capacity - 1)) != 0 ||
+        size < ComputeSize(header->capacity)) {
+      return std::nullopt;
+    }
+    return SharedMemoryRingBuffer{header};
+  }
+
+  // Producer side. Returns false, and counts the record as dropped, if the
+  // buffer is full.
+  bool TryWrite(const Record& record) {
+    uint64_t write_index =
+        header_->write_index.load(std::memory_order_relaxed);
+    uint64_t read_index = header_->read_index.load(std::memory_order_acquire);
+    if (write_index - read_index == header_->capacity) {
+      header_->dropped_count.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    GetRecords()[write_index & (header_->capacity - 1)] = record;
+    header_->write_index.store(write_index + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side. Returns false if the buffer is empty.
+  bool TryRead(Record* record) {
+    uint64_t read_index = header_->read_index.load(std::memory_order_relaxed);
+    uint64_t write_index =
+        header_->write_index.load(std::memory_order_acquire);
+    if (read_index == write_index) {
+      return false;
+    }
+    *record = GetRecords()[read_index & (header_->capacity - 1)];
+    header_->read_index.store(read_index + 1, std::memory_order_release);
+    return true;
+  }
+
+  uint64_t GetCapacity() const { return header_->capacity; }
+  uint64_t GetDroppedCount() const {
+    return header_->dropped_count.load(std::memory_order_relaxed);
+  }
+
+ private:
+  static constexpr uint64_t kMagic = 0x4f52424954524231;  // "ORBITRB1"
+
+  // The indices only increase, and are reduced modulo capacity on access.
+  // They are on separate cache lines, as they are written by different cores.
+  // The records follow the header.
+  struct Header {
+    std::atomic<uint64_t> magic;
+    uint64_t record_size;
+    uint64_t capacity;
+    std::atomic<uint64_t> dropped_count;
+    alignas(64) std::atomic<uint64_t> write_index;
+    alignas(64) std::atomic<uint64_t> read_index;
+  };
+
+  explicit SharedMemoryRingBuffer(Header* header) : header_{header} {}
+
+  Record* GetRecords() { return reinterpret_cast<Record*>(header_ + 1); }
+
+  Header* header_;
+};
+
+}  // namespace OrbitBase
+
+#endif  // ORBIT_BASE_SHARED_MEMORY_RING_BUFFER_H_
@@ -26,6 +26,7 @@ void CallStack::Print() {
   PRINT_VAR(m_Hash);
   PRINT_VAR(m_Depth);
   PRINT_VAR(m_ThreadId);
+  PRINT_VAR(m_ProcessId);
 
   for (uint32_t i = 0; i < m_Depth; ++i) {
     std::string address = VAR_TO_STR(reinterpret_cast<void*>(m_Data[i]));
@@ -160,9 +161,10 @@ __declspec(noinline) CallStackPOD CallStackPOD::Walk(uint64_t a_Rip,
 #endif
 
 //-----------------------------------------------------------------------------
-ORBIT_SERIALIZE(CallStack, 0) {
+ORBIT_SERIALIZE(CallStack, 1) {
   ORBIT_NVP_VAL(0, m_Data);
   ORBIT_NVP_VAL(0, m_Hash);
   ORBIT_NVP_VAL(0, m_Depth);
   ORBIT_NVP_VAL(0, m_ThreadId);
+  ORBIT_NVP_VAL(1, m_ProcessId);
 }
@@ -46,18 +46,24 @@ struct CallStack {
   inline CallstackID Hash() {
     if (m_Hash != 0) return m_Hash;
     m_Hash = XXH64(m_Data.data(), m_Depth * sizeof(uint64_t), 0xca1157ac);
+    // The same addresses are a different callstack in another process.
+    if (m_ProcessId != 0) {
+      m_Hash = XXH64(&m_ProcessId, sizeof(m_ProcessId), m_Hash);
+    }
     return m_Hash;
   }
   void Print();
   std::string GetString();
   void Clear() {
     m_Data.clear();
-    m_Hash = m_Depth = m_ThreadId = 0;
+    m_Hash = m_Depth = m_ThreadId = m_ProcessId = 0;
   }
 
   CallstackID m_Hash = 0;
   uint32_t m_Depth = 0;
   ThreadID m_ThreadId = 0;
+  // The process the addresses belong to, if known.
+  int32_t m_ProcessId = 0;
   std::vector<uint64_t> m_Data;
 
   ORBIT_SERIALIZABLE;
@@ -49,15 +49,22 @@ std::string Capture::GFunctionFilter;
 
 std::vector<std::shared_ptr<Function>> Capture::GSelectedFunctions;
 std::map<uint64_t, Function*> Capture::GSelectedFunctionsMap;
+std::set<uint64_t> Capture::GEntryCallstackFunctions;
 std::map<uint64_t, Function*> Capture::GVisibleFunctionsMap;
 std::unordered_map<uint64_t, uint64_t> Capture::GFunctionCountMap;
 std::shared_ptr<CallStack> Capture::GSelectedCallstack;
 std::vector<uint64_t> Capture::GSelectedAddressesByType[Function::NUM_TYPES];
 std::unordered_map<uint64_t, std::shared_ptr<CallStack>> Capture::GCallstacks;
-std::unordered_map<uint64_t, LinuxAddressInfo> Capture::GAddressInfos;
+std::unordered_map<int32_t, std::unordered_map<uint64_t, LinuxAddressInfo>>
+    Capture::GAddressInfos;
 std::unordered_map<uint64_t, std::string> Capture::GAddressToFunctionName;
 Mutex Capture::GCallstackMutex;
 std::unordered_map<uint64_t, std::string> Capture::GZoneNames;
+std::unordered_map<int64_t, FunctionStats> Capture::GSyscallStats;
+Mutex Capture::GSyscallStatsMutex;
+LockContentionStats Capture::GLockContentionStats;
+EntryCallstackStats Capture::GEntryCallstackStats;
+TracerHealth Capture::GTracerHealth;
 TextBox* Capture::GSelectedTextBox;
 ThreadID Capture::GSelectedThreadId;
 Timer Capture::GCaptureTimer;
@@ -129,6 +136,7 @@ void Capture::SetTargetProcess(const std::shared_ptr<Process>& a_Process) {
     GTargetProcess = a_Process;
     GSamplingProfiler = std::make_shared<SamplingProfiler>(a_Process);
     GSelectedFunctionsMap.clear();
+    GEntryCallstackFunctions.clear();
     GFunctionCountMap.clear();
     GOrbitUnreal.Clear();
     GTargetProcess->LoadDebugInfo();
@@ -206,6 +214,13 @@ void Capture::ClearCaptureData() {
   GAddressInfos.clear();
   GAddressToFunctionName.clear();
   GZoneNames.clear();
+  {
+    ScopeLock lock(GSyscallStatsMutex);
+    GSyscallStats.clear();
+  }
+  GLockContentionStats.Clear();
+  GEntryCallstackStats.Clear();
+  GTracerHealth.Clear();
   GSelectedTextBox = nullptr;
   GSelectedThreadId = 0;
   GNumProfileEvents = 0;
@@ -402,9 +417,14 @@ std::shared_ptr<CallStack> Capture::GetCallstack(CallstackID a_ID) {
 }
 
 //-----------------------------------------------------------------------------
-LinuxAddressInfo* Capture::GetAddressInfo(uint64_t address) {
-  auto address_info_it = GAddressInfos.find(address);
-  if (address_info_it == GAddressInfos.end()) {
+LinuxAddressInfo* Capture::GetAddressInfo(int32_t process_id,
+                                          uint64_t address) {
+  auto process_it = GAddressInfos.find(process_id);
+  if (process_it == GAddressInfos.end()) {
+    return nullptr;
+  }
+  auto address_info_it = process_it->second.find(address);
+  if (address_info_it == process_it->second.end()) {
     return nullptr;
   }
   return &address_info_it->second;
@@ -420,6 +440,6 @@ void Capture::CheckForUnrealSupport() {
 void Capture::PreSave() {
   // Add selected functions' exact address to sampling profiler
   for (auto& pair : GSelectedFunctionsMap) {
-    GSamplingProfiler->UpdateAddressInfo(pair.first);
+    GSamplingProfiler->UpdateAddressInfo(GTargetProcess->GetID(), pair.first);
   }
 }
@@ -6,13 +6,18 @@
 
 #include <chrono>
 #include <outcome.hpp>
+#include <set>
 #include <string>
 
 #include "CallstackTypes.h"
+#include "EntryCallstackStats.h"
+#include "FunctionStats.h"
 #include "LinuxAddressInfo.h"
+#include "LockContentionStats.h"
 #include "OrbitProcess.h"
 #include "OrbitType.h"
 #include "Threading.h"
+#include "TracerHealth.h"
 #include "absl/container/flat_hash_map.h"
 
 class Process;
@@ -50,7 +55,8 @@ class Capture {
   static void RegisterZoneName(uint64_t a_ID, const char* a_Name);
   static void AddCallstack(CallStack& a_CallStack);
   static std::shared_ptr<CallStack> GetCallstack(CallstackID a_ID);
-  static LinuxAddressInfo* GetAddressInfo(uint64_t address);
+  static LinuxAddressInfo* GetAddressInfo(int32_t process_id,
+                                          uint64_t address);
   static void CheckForUnrealSupport();
   static void PreSave();
 
@@ -79,13 +85,24 @@ class Capture {
   static void (*GClearCaptureDataFunc)();
   static std::vector<std::shared_ptr<Function>> GSelectedFunctions;
   static std::map<uint64_t, Function*> GSelectedFunctionsMap;
+  // Addresses of the selected functions for which to also record the
+  // callstack at every call.
+  static std::set<uint64_t> GEntryCallstackFunctions;
   static std::map<uint64_t, Function*> GVisibleFunctionsMap;
   static std::unordered_map<uint64_t, uint64_t> GFunctionCountMap;
   static std::vector<uint64_t> GSelectedAddressesByType[Function::NUM_TYPES];
   static std::unordered_map<uint64_t, std::shared_ptr<CallStack>> GCallstacks;
-  static std::unordered_map<uint64_t, LinuxAddressInfo> GAddressInfos;
+  // Keyed by process id, then by absolute address.
+  static std::unordered_map<int32_t,
+                            std::unordered_map<uint64_t, LinuxAddressInfo>>
+      GAddressInfos;
   static std::unordered_map<uint64_t, std::string> GAddressToFunctionName;
   static std::unordered_map<uint64_t, std::string> GZoneNames;
+  static std::unordered_map<int64_t, FunctionStats> GSyscallStats;
+  static Mutex GSyscallStatsMutex;
+  static LockContentionStats GLockContentionStats;
+  static EntryCallstackStats GEntryCallstackStats;
+  static TracerHealth GTracerHealth;
   static class TextBox* GSelectedTextBox;
   static ThreadID GSelectedThreadId;
   static Timer GCaptureTimer;
@@ -0,0 +1,227 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "CaptureEventPipeline.h"
+
+#include <OrbitBase/Logging.h>
+
+#include <variant>
+
+// Records the calls of a CaptureEventProcessor, to replay them later on the
+// actual listener.
+class CaptureEventPipeline::RecordingListener : public CaptureListener {
+ public:
+  struct ThreadNameCall {
+    int32_t process_id;
+    int32_t thread_id;
+    std::string thread_name;
+  };
+  struct AggregatedCallstackEventsCall {
+    CallstackEvent callstack_event;
+    uint64_t count;
+  };
+  using Call = std::variant<Timer, KeyAndString, CallStack, CallstackEvent,
+                            AggregatedCallstackEventsCall, ThreadNameCall,
+                            LinuxAddressInfo, TracerStats,
+                            FunctionInstrumentationDisabled>;
+
+  void OnTimer(Timer timer) override { calls_.emplace_back(std::move(timer)); }
+  void OnKeyAndString(uint64_t key, std::string str) override {
+    calls_.emplace_back(KeyAndString{key, std::move(str)});
+  }
+  void OnCallstack(CallStack callstack) override {
+    calls_.emplace_back(std::move(callstack));
+  }
+  void OnCallstackEvent(CallstackEvent callstack_event) override {
+    calls_.emplace_back(std::move(callstack_event));
+  }
+  void OnAggregatedCallstackEvents(CallstackEvent callstack_event,
+                                   uint64_t count) override {
+    calls_.emplace_back(
+        AggregatedCallstackEventsCall{std::move(callstack_event), count});
+  }
+  void OnThreadName(int32_t process_id, int32_t thread_id,
+                    std::string thread_name) override {
+    calls_.emplace_back(
+        ThreadNameCall{process_id, thread_id, std::move(thread_name)});
+  }
+  void OnAddressInfo(LinuxAddressInfo address_info) override {
+    calls_.emplace_back(std::move(address_info));
+  }
+  void OnTracerStats(TracerStats tracer_stats) override {
+    calls_.emplace_back(std::move(tracer_stats));
+  }
+  void OnFunctionInstrumentationDisabled(
+      FunctionInstrumentationDisabled function_instrumentation_disabled)
+      override {
+    calls_.emplace_back(std::move(function_instrumentation_disabled));
+  }
+
+  [[nodiscard]] const std::vector<Call>& GetCalls() const { return calls_; }
+
+ private:
+  std::vector<Call> calls_;
+};
+
+CaptureEventPipeline::CaptureEventPipeline(CaptureListener* capture_listener,
+                                           size_t worker_count)
+    : capture_listener_{capture_listener},
+      inline_processor_{&intern_pools_, capture_listener} {
+  CHECK(capture_listener_ != nullptr);
+  if (worker_count == 0) {
+    return;
+  }
+  for (size_t i = 0; i < worker_count; ++i) {
+    worker_threads_.emplace_back([this] { WorkerThread(); });
+  }
+  output_thread_ = std::thread{[this] { OutputThread(); }};
+}
+
+CaptureEventPipeline::~CaptureEventPipeline() { Finish(); }
+
+void CaptureEventPipeline::AddResponse(CaptureResponse&& response) {
+  intern_pools_.AddInternedValues(response);
+  if (worker_threads_.empty()) {
+    for (const CaptureEvent& event : response.capture_events()) {
+      inline_processor_.ProcessEvent(event);
+    }
+    return;
+  }
+
+  absl::MutexLock lock{&mutex_};
+  CHECK(!finished_);
+  mutex_.Await(absl::Condition(
+      +[](CaptureEventPipeline* self) {
+        return self->added_count_ - self->output_count_ <
+               kMaxBatchesInFlightPerWorker * self->worker_threads_.size();
+      },
+      this));
+  pending_responses_.emplace_back(added_count_++, std::move(response));
+}
+
+void CaptureEventPipeline::Finish() {
+  {
+    absl::MutexLock lock{&mutex_};
+    if (finished_) {
+      return;
+    }
+    finished_ = true;
+  }
+  for (std::thread& worker_thread : worker_threads_) {
+    worker_thread.join();
+  }
+  if (output_thread_.joinable()) {
+    output_thread_.join();
+  }
+}
+
+void CaptureEventPipeline::WorkerThread() {
+  while (true) {
+    uint64_t sequence_number;
+    CaptureResponse response;
+    {
+      absl::MutexLock lock{&mutex_};
+      mutex_.Await(absl::Condition(
+          +[](CaptureEventPipeline* self) {
+            return !self->pending_responses_.empty() || self->finished_;
+          },
+          this));
+      if (pending_responses_.empty()) {
+        return;
+      }
+      sequence_number = pending_responses_.front().first;
+      response = std::move(pending_responses_.front().second);
+      pending_responses_.pop_front();
+    }
+
+    auto batch = std::make_unique<RecordingListener>();
+    CaptureEventProcessor processor{&intern_pools_, batch.get()};
+    for (const CaptureEvent& event : response.capture_events()) {
+      processor.ProcessEvent(event);
+    }
+
+    absl::MutexLock lock{&mutex_};
+    processed_batches_.emplace(sequence_number, std::move(batch));
+  }
+}
+
+void CaptureEventPipeline::OutputThread() {
+  while (true) {
+    std::unique_ptr<RecordingListener> batch;
+    {
+      absl::MutexLock lock{&mutex_};
+      mutex_.Await(absl::Condition(
+          +[](CaptureEventPipeline* self) {
+            return self->processed_batches_.contains(self->output_count_) ||
+                   (self->finished_ &&
+                    self->output_count_ == self->added_count_);
+          },
+          this));
+      auto batch_it = processed_batches_.find(output_count_);
+      if (batch_it == processed_batches_.end()) {
+        return;
+      }
+      batch = std::move(batch_it->second);
+      processed_batches_.erase(batch_it);
+    }
+
+    ReplayBatch(*batch);
+
+    // Only counted once replayed, so that AddResponse waits for the output
+    // thread too.
+    absl::MutexLock lock{&mutex_};
+    ++output_count_;
+  }
+}
+
+void CaptureEventPipeline::ReplayBatch(const RecordingListener& batch) {
+  struct ReplayVisitor {
+    CaptureListener* capture_listener;
+    absl::flat_hash_set<uint64_t>* callstack_hashes_seen;
+    absl::flat_hash_set<uint64_t>* string_hashes_seen;
+
+    void operator()(const Timer& timer) { capture_listener->OnTimer(timer); }
+    void operator()(const KeyAndString& key_and_string) {
+      if (string_hashes_seen->insert(key_and_string.key).second) {
+        capture_listener->OnKeyAndString(key_and_string.key,
+                                         key_and_string.str);
+      }
+    }
+    void operator()(const CallStack& callstack) {
+      // The processor computed the hash before passing the callstack.
+      if (callstack_hashes_seen->insert(callstack.m_Hash).second) {
+        capture_listener->OnCallstack(callstack);
+      }
+    }
+    void operator()(const CallstackEvent& callstack_event) {
+      capture_listener->OnCallstackEvent(callstack_event);
+    }
+    void operator()(
+        const RecordingListener::AggregatedCallstackEventsCall& call) {
+      capture_listener->OnAggregatedCallstackEvents(call.callstack_event,
+                                                    call.count);
+    }
+    void operator()(const RecordingListener::ThreadNameCall& call) {
+      capture_listener->OnThreadName(call.process_id, call.thread_id,
+                                     call.thread_name);
+    }
+    void operator()(const LinuxAddressInfo& address_info) {
+      capture_listener->OnAddressInfo(address_info);
+    }
+    void operator()(const TracerStats& tracer_stats) {
+      capture_listener->OnTracerStats(tracer_stats);
+    }
+    void operator()(const FunctionInstrumentationDisabled&
+                        function_instrumentation_disabled) {
+      capture_listener->OnFunctionInstrumentationDisabled(
+          function_instrumentation_disabled);
+    }
+  };
+
+  ReplayVisitor visitor{capture_listener_, &callstack_hashes_seen_,
+                        &string_hashes_seen_};
+  for (const RecordingListener::Call& call : batch.GetCalls()) {
+    std::visit(visitor, call);
+  }
+}
@@ -0,0 +1,77 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_CORE_CAPTURE_EVENT_PIPELINE_H_
+#define ORBIT_CORE_CAPTURE_EVENT_PIPELINE_H_
+
+#include <deque>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "CaptureEventProcessor.h"
+#include "CaptureListener.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/synchronization/mutex.h"
+#include "services.pb.h"
+
+// Processes the CaptureResponses of a capture, so that the thread reading them
+// doesn't also convert every event. With worker threads, each response is
+// converted by one of them to a batch of recorded calls to a CaptureListener,
+// and the batches are passed to the actual listener on an output thread, in
+// the order of the responses. Interned values are added to the shared
+// CaptureInternPools on the thread adding the response, before any worker
+// sees it, so that the events of this and of any later response find them.
+// Without worker threads, responses are processed on the thread adding them.
+class CaptureEventPipeline {
+ public:
+  CaptureEventPipeline(CaptureListener* capture_listener, size_t worker_count);
+  ~CaptureEventPipeline();
+
+  CaptureEventPipeline(const CaptureEventPipeline&) = delete;
+  CaptureEventPipeline& operator=(const CaptureEventPipeline&) = delete;
+
+  // Must always be called from the same thread, in the order the responses
+  // were received. Waits while too many responses are being processed.
+  void AddResponse(CaptureResponse&& response);
+  // Waits until the events of all the responses were passed to the listener.
+  // No response can be added after this.
+  void Finish();
+
+ private:
+  class RecordingListener;
+
+  void WorkerThread();
+  void OutputThread();
+  // Passes the calls of batch to capture_listener_, each callstack and string
+  // only once in the capture.
+  void ReplayBatch(const RecordingListener& batch);
+
+  static constexpr uint64_t kMaxBatchesInFlightPerWorker = 4;
+
+  CaptureListener* capture_listener_;
+  CaptureInternPools intern_pools_;
+  // Only used without worker threads.
+  CaptureEventProcessor inline_processor_;
+
+  absl::Mutex mutex_;
+  // Responses not yet taken by a worker, with their sequence number.
+  std::deque<std::pair<uint64_t, CaptureResponse>> pending_responses_;
+  // Batches not yet passed to the listener, by sequence number.
+  absl::flat_hash_map<uint64_t, std::unique_ptr<RecordingListener>>
+      processed_batches_;
+  uint64_t added_count_ = 0;
+  uint64_t output_count_ = 0;
+  bool finished_ = false;
+
+  std::vector<std::thread> worker_threads_;
+  std::thread output_thread_;
+  // Only used by the output thread.
+  absl::flat_hash_set<uint64_t> callstack_hashes_seen_;
+  absl::flat_hash_set<uint64_t> string_hashes_seen_;
+};
+
+#endif  // ORBIT_CORE_CAPTURE_EVENT_PIPELINE_H_
@@ -0,0 +1,278 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "CaptureEventPipeline.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+
+namespace {
+
+// Records the calls that matter to these tests, in order. Only the output
+// thread of the pipeline calls it, but the tests read it from their own.
+class RecordingCaptureListener : public CaptureListener {
+ public:
+  enum class CallType { kTimer, kKeyAndString, kCallstack, kCallstackEvent };
+  // The start of timers, the key of strings, the hash of callstacks.
+  using Call = std::pair<CallType, uint64_t>;
+
+  void OnTimer(Timer timer) override {
+    absl::MutexLock lock{&mutex_};
+    mutex_.Await(absl::Condition(
+        +[](bool* blocked) { return !*blocked; }, &timers_blocked_));
+    calls_.emplace_back(CallType::kTimer, timer.m_Start);
+    if (timer.m_Type == Timer::COUNTER) {
+      counter_name_keys_.push_back(timer.m_UserData[1]);
+    }
+  }
+  void OnKeyAndString(uint64_t key, std::string /*str*/) override {
+    absl::MutexLock lock{&mutex_};
+    calls_.emplace_back(CallType::kKeyAndString, key);
+  }
+  void OnCallstack(CallStack callstack) override {
+    absl::MutexLock lock{&mutex_};
+    calls_.emplace_back(CallType::kCallstack, callstack.m_Hash);
+  }
+  void OnCallstackEvent(CallstackEvent callstack_event) override {
+    absl::MutexLock lock{&mutex_};
+    calls_.emplace_back(CallType::kCallstackEvent, callstack_event.m_Id);
+  }
+  void OnAggregatedCallstackEvents(CallstackEvent /*callstack_event*/,
+                                   uint64_t /*count*/) override {}
+  void OnThreadName(int32_t /*process_id*/, int32_t /*thread_id*/,
+                    std::string /*thread_name*/) override {}
+  void OnAddressInfo(LinuxAddressInfo /*address_info*/) override {}
+  void OnTracerStats(TracerStats /*tracer_stats*/) override {}
+  void OnFunctionInstrumentationDisabled(
+      FunctionInstrumentationDisabled /*function_instrumentation_disabled*/)
+      override {}
+
+  // While blocked, OnTimer waits, which stalls the output of the pipeline.
+  void SetTimersBlocked(bool blocked) {
+    absl::MutexLock lock{&mutex_};
+    timers_blocked_ = blocked;
+  }
+
+  std::vector<Call> GetCalls() {
+    absl::MutexLock lock{&mutex_};
+    return calls_;
+  }
+  std::vector<uint64_t> GetTimerStarts() {
+    absl::MutexLock lock{&mutex_};
+    std::vector<uint64_t> timer_starts;
+    for (const Call& call : calls_) {
+      if (call.first == CallType::kTimer) {
+        timer_starts.push_back(call.second);
+      }
+    }
+    return timer_starts;
+  }
+  std::vector<uint64_t> GetCounterNameKeys() {
+    absl::MutexLock lock{&mutex_};
+    return counter_name_keys_;
+  }
+
+ private:
+  absl::Mutex mutex_;
+  bool timers_blocked_ = false;
+  std::vector<Call> calls_;
+  std::vector<uint64_t> counter_name_keys_;
+};
+
+// A response with event_count SchedulingSlices, starting at first_timestamp_ns
+// and then every nanosecond.
+CaptureResponse CreateSchedulingSlicesResponse(uint64_t first_timestamp_ns,
+                                               size_t event_count) {
+  CaptureResponse response;
+  for (size_t i = 0; i < event_count; ++i) {
+    SchedulingSlice* scheduling_slice =
+        response.add_capture_events()->mutable_scheduling_slice();
+    scheduling_slice->set_in_timestamp_ns(first_timestamp_ns + i);
+    scheduling_slice->set_out_timestamp_ns(first_timestamp_ns + i + 1);
+  }
+  return response;
+}
+
+void AddInternedCallstack(CaptureResponse* response, uint64_t key,
+                          uint64_t pc) {
+  InternedCallstack* interned_callstack =
+      response->add_capture_events()->mutable_interned_callstack();
+  interned_callstack->set_key(key);
+  interned_callstack->mutable_intern()->add_pcs(pc);
+}
+
+void AddInternedString(CaptureResponse* response, uint64_t key,
+                       std::string str) {
+  InternedString* interned_string =
+      response->add_capture_events()->mutable_interned_string();
+  interned_string->set_key(key);
+  interned_string->set_intern(std::move(str));
+}
+
+void AddCallstackSample(CaptureResponse* response, uint64_t timestamp_ns,
+                        uint64_t callstack_key) {
+  CallstackSample* callstack_sample =
+      response->add_capture_events()->mutable_callstack_sample();
+  callstack_sample->set_timestamp_ns(timestamp_ns);
+  callstack_sample->set_callstack_key(callstack_key);
+}
+
+void AddCounterSample(CaptureResponse* response, uint64_t timestamp_ns,
+                      uint64_t name_key) {
+  CounterSample* counter_sample =
+      response->add_capture_events()->mutable_counter_sample();
+  counter_sample->set_timestamp_ns(timestamp_ns);
+  counter_sample->set_name_key(name_key);
+}
+
+}  // namespace
+
+TEST(CaptureEventPipeline, KeepsOrderOfResponsesAcrossWorkers) {
+  RecordingCaptureListener listener;
+  CaptureEventPipeline pipeline{&listener, 4};
+
+  // Responses of very different sizes, so that workers finish them out of
+  // order.
+  constexpr size_t kResponseCount = 200;
+  std::vector<uint64_t> expected_timer_starts;
+  uint64_t timestamp_ns = 1;
+  for (size_t i = 0; i < kResponseCount; ++i) {
+    size_t event_count = (i % 7 == 0) ? 500 : 1;
+    for (size_t j = 0; j < event_count; ++j) {
+      expected_timer_starts.push_back(timestamp_ns + j);
+    }
+    pipeline.AddResponse(
+        CreateSchedulingSlicesResponse(timestamp_ns, event_count));
+    timestamp_ns += event_count;
+  }
+  pipeline.Finish();
+
+  EXPECT_EQ(listener.GetTimerStarts(), expected_timer_starts);
+}
+
+TEST(CaptureEventPipeline, PassesInternedValuesOnceAndBeforeTheirUse) {
+  for (size_t worker_count : {0, 1, 4}) {
+    RecordingCaptureListener listener;
+    CaptureEventPipeline pipeline{&listener, worker_count};
+
+    // The interned values come in the first response, and every response
+    // refers to them, so that each worker needs them.
+    constexpr size_t kResponseCount = 50;
+    for (size_t i = 0; i < kResponseCount; ++i) {
+      CaptureResponse response;
+      if (i == 0) {
+        AddInternedCallstack(&response, 1, 0xA);
+        AddInternedCallstack(&response, 2, 0xB);
+        AddInternedString(&response, 3, "counter");
+      }
+      AddCallstackSample(&response, 2 * i, 1 + i % 2);
+      AddCounterSample(&response, 2 * i + 1, 3);
+      pipeline.AddResponse(std::move(response));
+    }
+    pipeline.Finish();
+
+    absl::flat_hash_map<uint64_t, size_t> callstack_counts;
+    absl::flat_hash_map<uint64_t, size_t> string_counts;
+    size_t callstack_event_count = 0;
+    for (const RecordingCaptureListener::Call& call : listener.GetCalls()) {
+      switch (call.first) {
+        case RecordingCaptureListener::CallType::kCallstack:
+          ++callstack_counts[call.second];
+          break;
+        case RecordingCaptureListener::CallType::kKeyAndString:
+          ++string_counts[call.second];
+          break;
+        case RecordingCaptureListener::CallType::kCallstackEvent:
+          EXPECT_TRUE(callstack_counts.contains(call.second));
+          ++callstack_event_count;
+          break;
+        case RecordingCaptureListener::CallType::kTimer:
+          break;
+      }
+    }
+    EXPECT_EQ(callstack_event_count, kResponseCount);
+
+    EXPECT_EQ(callstack_counts.size(), 2);
+    for (const auto& [hash, count] : callstack_counts) {
+      EXPECT_EQ(count, 1) << "worker_count " << worker_count;
+    }
+
+    // The string of the counter name was passed before the first counter
+    // sample, and only once.
+    std::vector<uint64_t> counter_name_keys = listener.GetCounterNameKeys();
+    ASSERT_EQ(counter_name_keys.size(), kResponseCount);
+    uint64_t counter_name_key = counter_name_keys[0];
+    EXPECT_EQ(string_counts[counter_name_key], 1);
+    for (const RecordingCaptureListener::Call& call : listener.GetCalls()) {
+      if (call.first == RecordingCaptureListener::CallType::kKeyAndString &&
+          call.second == counter_name_key) {
+        break;
+      }
+      EXPECT_NE(call.first, RecordingCaptureListener::CallType::kTimer);
+    }
+  }
+}
+
+TEST(CaptureEventPipeline, AddResponseWaitsWhileOutputIsStalled) {
+  RecordingCaptureListener listener;
+  listener.SetTimersBlocked(true);
+  constexpr size_t kWorkerCount = 2;
+  CaptureEventPipeline pipeline{&listener, kWorkerCount};
+
+  constexpr size_t kResponseCount = 100;
+  std::atomic<size_t> added_count = 0;
+  std::thread reader_thread{[&pipeline, &added_count] {
+    for (size_t i = 0; i < kResponseCount; ++i) {
+      pipeline.AddResponse(CreateSchedulingSlicesResponse(i, 1));
+      ++added_count;
+    }
+  }};
+
+  // The reader gets ahead of the output by a bounded number of responses
+  // only, instead of buffering the whole capture.
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  size_t added_count_while_stalled = added_count;
+  EXPECT_GT(added_count_while_stalled, 0);
+  EXPECT_LT(added_count_while_stalled, kResponseCount);
+
+  listener.SetTimersBlocked(false);
+  reader_thread.join();
+  pipeline.Finish();
+
+  std::vector<uint64_t> timer_starts = listener.GetTimerStarts();
+  ASSERT_EQ(timer_starts.size(), kResponseCount);
+  for (size_t i = 0; i < kResponseCount; ++i) {
+    EXPECT_EQ(timer_starts[i], i);
+  }
+}
+
+TEST(CaptureEventPipeline, FinishOutputsAllPendingResponses) {
+  RecordingCaptureListener listener;
+  listener.SetTimersBlocked(true);
+  CaptureEventPipeline pipeline{&listener, 4};
+
+  // With the output stalled, responses are queued for the workers and batches
+  // for the output thread when Finish is called.
+  constexpr size_t kResponseCount = 16;
+  for (size_t i = 0; i < kResponseCount; ++i) {
+    pipeline.AddResponse(CreateSchedulingSlicesResponse(i, 1));
+  }
+  std::thread unblock_thread{[&listener] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    listener.SetTimersBlocked(false);
+  }};
+  pipeline.Finish();
+  unblock_thread.join();
+
+  EXPECT_EQ(listener.GetTimerStarts().size(), kResponseCount);
+
+  // Finish is idempotent, and the destructor calls it again.
+  pipeline.Finish();
+}
@@ -0,0 +1,441 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "CaptureEventProcessor.h"
+
+#include <OrbitBase/Logging.h>
+
+#include "FunctionCallBatch.h"
+#include "absl/base/casts.h"
+
+void CaptureInternPools::AddInternedValues(const CaptureResponse& response) {
+  for (const CaptureEvent& event : response.capture_events()) {
+    if (event.has_interned_callstack()) {
+      const InternedCallstack& interned_callstack = event.interned_callstack();
+      absl::MutexLock lock{&mutex_};
+      if (!callstacks_
+               .try_emplace(interned_callstack.key(),
+                            interned_callstack.intern())
+               .second) {
+        ERROR("Ignoring InternedCallstack with existing key %llu",
+              interned_callstack.key());
+      }
+    } else if (event.has_interned_string()) {
+      const InternedString& interned_string = event.interned_string();
+      absl::MutexLock lock{&mutex_};
+      if (!strings_
+               .try_emplace(interned_string.key(), interned_string.intern())
+               .second) {
+        ERROR("Ignoring InternedString with existing key %llu",
+              interned_string.key());
+      }
+    }
+  }
+}
+
+const Callstack& CaptureInternPools::GetCallstack(uint64_t key) const {
+  static const Callstack kEmptyCallstack;
+  absl::ReaderMutexLock lock{&mutex_};
+  auto callstack_it = callstacks_.find(key);
+  if (callstack_it == callstacks_.end()) {
+    return kEmptyCallstack;
+  }
+  return callstack_it->second;
+}
+
+const std::string& CaptureInternPools::GetString(uint64_t key) const {
+  static const std::string kEmptyString;
+  absl::ReaderMutexLock lock{&mutex_};
+  auto string_it = strings_.find(key);
+  if (string_it == strings_.end()) {
+    return kEmptyString;
+  }
+  return string_it->second;
+}
+
+void CaptureEventProcessor::ProcessEvent(const CaptureEvent& event) {
+  switch (event.event_case()) {
+    case CaptureEvent::kSchedulingSlice:
+      ProcessSchedulingSlice(event.scheduling_slice());
+      break;
+    case CaptureEvent::kInternedCallstack:
+    case CaptureEvent::kInternedString:
+      // Already added to intern_pools_.
+      break;
+    case CaptureEvent::kCallstackSample:
+      ProcessCallstackSample(event.callstack_sample());
+      break;
+    case CaptureEvent::kFunctionCall:
+      ProcessFunctionCall(event.function_call());
+      break;
+    case CaptureEvent::kFunctionCallBatch:
+      for (const FunctionCall& function_call :
+           UnpackFunctionCallBatch(event.function_call_batch())) {
+        ProcessFunctionCall(function_call);
+      }
+      break;
+    case CaptureEvent::kGpuJob:
+      ProcessGpuJob(event.gpu_job());
+      break;
+    case CaptureEvent::kThreadName:
+      ProcessThreadName(event.thread_name());
+      break;
+    case CaptureEvent::kAddressInfo:
+      ProcessAddressInfo(event.address_info());
+      break;
+    case CaptureEvent::kSystemCall:
+      ProcessSystemCall(event.system_call());
+      break;
+    case CaptureEvent::kFutexWait:
+      ProcessFutexWait(event.futex_wait());
+      break;
+    case CaptureEvent::kCounterSample:
+      ProcessCounterSample(event.counter_sample());
+      break;
+    case CaptureEvent::kTracerStats:
+      ProcessTracerStats(event.tracer_stats());
+      break;
+    case CaptureEvent::kLostEventsGap:
+      ProcessLostEventsGap(event.lost_events_gap());
+      break;
+    case CaptureEvent::kAggregatedCallstackSamples:
+      ProcessAggregatedCallstackSamples(event.aggregated_callstack_samples());
+      break;
+    case CaptureEvent::kFunctionInstrumentationDisabled:
+      capture_listener_->OnFunctionInstrumentationDisabled(
+          event.function_instrumentation_disabled());
+      break;
+    case CaptureEvent::kManualInstrumentationScope:
+      ProcessManualInstrumentationScope(event.manual_instrumentation_scope());
+      break;
+    case CaptureEvent::EVENT_NOT_SET:
+      ERROR("CaptureEvent::EVENT_NOT_SET read from Capture's gRPC stream");
+      break;
+  }
+}
+
+void CaptureEventProcessor::ProcessSchedulingSlice(
+    const SchedulingSlice& scheduling_slice) {
+  Timer timer;
+  timer.m_Start = scheduling_slice.in_timestamp_ns();
+  timer.m_End = scheduling_slice.out_timestamp_ns();
+  timer.m_PID = scheduling_slice.pid();
+  timer.m_TID = scheduling_slice.tid();
+  timer.m_Processor = static_cast<int8_t>(scheduling_slice.core());
+  timer.m_Depth = timer.m_Processor;
+  timer.SetType(Timer::CORE_ACTIVITY);
+
+  capture_listener_->OnTimer(timer);
+}
+
+void CaptureEventProcessor::ProcessCallstackSample(
+    const CallstackSample& callstack_sample) {
+  const Callstack& callstack =
+      callstack_sample.callstack_or_key_case() ==
+              CallstackSample::kCallstackKey
+          ? intern_pools_->GetCallstack(callstack_sample.callstack_key())
+          : callstack_sample.callstack();
+
+  uint64_t hash = GetCallstackHashAndSendToListenerIfNecessary(
+      callstack_sample.pid(), callstack);
+  CallstackEvent callstack_event{callstack_sample.timestamp_ns(), hash,
+                                 callstack_sample.tid()};
+  capture_listener_->OnCallstackEvent(std::move(callstack_event));
+}
+
+void CaptureEventProcessor::ProcessAggregatedCallstackSamples(
+    const AggregatedCallstackSamples& aggregated_callstack_samples) {
+  for (const AggregatedCallstackSamples::Count& count :
+       aggregated_callstack_samples.counts()) {
+    uint64_t hash = GetCallstackHashAndSendToListenerIfNecessary(
+        count.pid(), intern_pools_->GetCallstack(count.callstack_key()));
+    CallstackEvent callstack_event{
+        aggregated_callstack_samples.begin_timestamp_ns(), hash, count.tid()};
+    capture_listener_->OnAggregatedCallstackEvents(std::move(callstack_event),
+                                                   count.count());
+  }
+}
+
+void CaptureEventProcessor::ProcessFunctionCall(
+    const FunctionCall& function_call) {
+  Timer timer;
+  timer.m_PID = function_call.pid();
+  timer.m_TID = function_call.tid();
+  timer.m_Start = function_call.begin_timestamp_ns();
+  timer.m_End = function_call.end_timestamp_ns();
+  timer.m_Depth = static_cast<uint8_t>(function_call.depth());
+  timer.m_FunctionAddress = function_call.absolute_address();
+  timer.m_UserData[0] = function_call.return_value();
+  if (function_call.entry_callstack_or_key_case() ==
+      FunctionCall::kEntryCallstackKey) {
+    timer.m_CallstackHash = GetCallstackHashAndSendToListenerIfNecessary(
+        function_call.pid(),
+        intern_pools_->GetCallstack(function_call.entry_callstack_key()));
+  } else if (function_call.has_entry_callstack()) {
+    timer.m_CallstackHash = GetCallstackHashAndSendToListenerIfNecessary(
+        function_call.pid(), function_call.entry_callstack());
+  }
+
+  capture_listener_->OnTimer(timer);
+}
+
+void CaptureEventProcessor::ProcessGpuJob(const GpuJob& gpu_job) {
+  Timer timer_user_to_sched;
+  timer_user_to_sched.m_TID = gpu_job.tid();
+  timer_user_to_sched.m_Start = gpu_job.amdgpu_cs_ioctl_time_ns();
+  timer_user_to_sched.m_End = gpu_job.amdgpu_sched_run_job_time_ns();
+  timer_user_to_sched.m_Depth = gpu_job.depth();
+
+  std::string timeline;
+  if (gpu_job.timeline_or_key_case() == GpuJob::kTimelineKey) {
+    timeline = intern_pools_->GetString(gpu_job.timeline_key());
+  } else {
+    timeline = gpu_job.timeline();
+  }
+  uint64_t timeline_hash = GetStringHashAndSendToListenerIfNecessary(timeline);
+
+  constexpr const char* sw_queue = "sw queue";
+  uint64_t sw_queue_key = GetStringHashAndSendToListenerIfNecessary(sw_queue);
+  timer_user_to_sched.m_UserData[0] = sw_queue_key;
+  timer_user_to_sched.m_UserData[1] = timeline_hash;
+
+  timer_user_to_sched.m_Type = Timer::GPU_ACTIVITY;
+  capture_listener_->OnTimer(std::move(timer_user_to_sched));
+
+  Timer timer_sched_to_start;
+  timer_sched_to_start.m_TID = gpu_job.tid();
+  timer_sched_to_start.m_Start = gpu_job.amdgpu_sched_run_job_time_ns();
+  timer_sched_to_start.m_End = gpu_job.gpu_hardware_start_time_ns();
+  timer_sched_to_start.m_Depth = gpu_job.depth();
+
+  constexpr const char* hw_queue = "hw queue";
+  uint64_t hw_queue_key = GetStringHashAndSendToListenerIfNecessary(hw_queue);
+
+  timer_sched_to_start.m_UserData[0] = hw_queue_key;
+  timer_sched_to_start.m_UserData[1] = timeline_hash;
+
+  timer_sched_to_start.m_Type = Timer::GPU_ACTIVITY;
+  capture_listener_->OnTimer(std::move(timer_sched_to_start));
+
+  Timer timer_start_to_finish;
+  timer_start_to_finish.m_TID = gpu_job.tid();
+  timer_start_to_finish.m_Start = gpu_job.gpu_hardware_start_time_ns();
+  timer_start_to_finish.m_End = gpu_job.dma_fence_signaled_time_ns();
+  timer_start_to_finish.m_Depth = gpu_job.depth();
+
+  constexpr const char* hw_execution = "hw execution";
+  uint64_t hw_execution_key =
+      GetStringHashAndSendToListenerIfNecessary(hw_execution);
+
+  timer_start_to_finish.m_UserData[0] = hw_execution_key;
+  timer_start_to_finish.m_UserData[1] = timeline_hash;
+
+  timer_start_to_finish.m_Type = Timer::GPU_ACTIVITY;
+  capture_listener_->OnTimer(std::move(timer_start_to_finish));
+}
+
+void CaptureEventProcessor::ProcessThreadName(const ThreadName& thread_name) {
+  capture_listener_->OnThreadName(thread_name.pid(), thread_name.tid(),
+                                  thread_name.name());
+}
+
+void CaptureEventProcessor::ProcessAddressInfo(
+    const AddressInfo& address_info) {
+  std::string function_name;
+  if (address_info.function_name_or_key_case() ==
+      AddressInfo::kFunctionNameKey) {
+    function_name = intern_pools_->GetString(address_info.function_name_key());
+  } else {
+    function_name = address_info.function_name();
+  }
+
+  std::string map_name;
+  if (address_info.map_name_or_key_case() == AddressInfo::kMapNameKey) {
+    map_name = intern_pools_->GetString(address_info.map_name_key());
+  } else {
+    map_name = address_info.map_name();
+  }
+
+  LinuxAddressInfo linux_address_info{
+      address_info.absolute_address(), map_name, function_name,
+      address_info.offset_in_function(), address_info.pid()};
+  capture_listener_->OnAddressInfo(linux_address_info);
+}
+
+void CaptureEventProcessor::ProcessSystemCall(const SystemCall& system_call) {
+  Timer timer;
+  timer.m_PID = system_call.pid();
+  timer.m_TID = system_call.tid();
+  timer.m_Start = system_call.begin_timestamp_ns();
+  timer.m_End = system_call.end_timestamp_ns();
+  timer.m_UserData[0] = system_call.syscall_number();
+  timer.m_UserData[1] = system_call.return_value();
+  timer.m_Type = Timer::SYSCALL;
+
+  capture_listener_->OnTimer(timer);
+}
+
+void CaptureEventProcessor::ProcessFutexWait(const FutexWait& futex_wait) {
+  uint64_t callstack_hash = 0;
+  if (futex_wait.callstack_or_key_case() == FutexWait::kCallstackKey) {
+    callstack_hash = GetCallstackHashAndSendToListenerIfNecessary(
+        futex_wait.pid(),
+        intern_pools_->GetCallstack(futex_wait.callstack_key()));
+  } else if (futex_wait.has_callstack()) {
+    callstack_hash = GetCallstackHashAndSendToListenerIfNecessary(
+        futex_wait.pid(), futex_wait.callstack());
+  }
+
+  // The waker callstack is only present if another thread woke up this futex
+  // during the wait. That thread is in the same process, as futexes are
+  // matched by process.
+  uint64_t waker_callstack_hash = 0;
+  if (futex_wait.waker_callstack_or_key_case() ==
+      FutexWait::kWakerCallstackKey) {
+    waker_callstack_hash = GetCallstackHashAndSendToListenerIfNecessary(
+        futex_wait.pid(),
+        intern_pools_->GetCallstack(futex_wait.waker_callstack_key()));
+  } else if (futex_wait.has_waker_callstack()) {
+    waker_callstack_hash = GetCallstackHashAndSendToListenerIfNecessary(
+        futex_wait.pid(), futex_wait.waker_callstack());
+  }
+
+  Timer timer;
+  timer.m_PID = futex_wait.pid();
+  timer.m_TID = futex_wait.tid();
+  timer.m_Start = futex_wait.begin_timestamp_ns();
+  timer.m_End = futex_wait.end_timestamp_ns();
+  timer.m_CallstackHash = callstack_hash;
+  timer.m_UserData[0] = futex_wait.futex_address();
+  timer.m_UserData[1] = waker_callstack_hash;
+  timer.m_Type = Timer::LOCK_WAIT;
+
+  capture_listener_->OnTimer(timer);
+}
+
+void CaptureEventProcessor::ProcessCounterSample(
+    const CounterSample& counter_sample) {
+  std::string name;
+  if (counter_sample.name_or_key_case() == CounterSample::kNameKey) {
+    name = intern_pools_->GetString(counter_sample.name_key());
+  } else {
+    name = counter_sample.name();
+  }
+
+  Timer timer;
+  timer.m_PID = counter_sample.pid();
+  timer.m_TID = counter_sample.tid();
+  timer.m_Start = counter_sample.timestamp_ns();
+  timer.m_End = counter_sample.timestamp_ns();
+  timer.m_UserData[0] = absl::bit_cast<uint64_t>(counter_sample.value());
+  timer.m_UserData[1] = GetStringHashAndSendToListenerIfNecessary(name);
+  timer.m_Type = Timer::COUNTER;
+
+  capture_listener_->OnTimer(timer);
+}
+
+void CaptureEventProcessor::ProcessManualInstrumentationScope(
+    const ManualInstrumentationScope& manual_instrumentation_scope) {
+  std::string name;
+  if (manual_instrumentation_scope.name_or_key_case() ==
+      ManualInstrumentationScope::kNameKey) {
+    name = intern_pools_->GetString(manual_instrumentation_scope.name_key());
+  } else {
+    name = manual_instrumentation_scope.name();
+  }
+
+  Timer timer;
+  timer.m_PID = manual_instrumentation_scope.pid();
+  timer.m_TID = manual_instrumentation_scope.tid();
+  timer.m_Start = manual_instrumentation_scope.begin_timestamp_ns();
+  timer.m_End = manual_instrumentation_scope.end_timestamp_ns();
+  timer.m_Depth = static_cast<uint8_t>(manual_instrumentation_scope.depth());
+  timer.m_UserData[0] = GetStringHashAndSendToListenerIfNecessary(name);
+  timer.m_Type = Timer::ZONE;
+
+  capture_listener_->OnTimer(timer);
+}
+
+void CaptureEventProcessor::ProcessTracerStats(
+    const TracerStats& tracer_stats) {
+  capture_listener_->OnTracerStats(tracer_stats);
+
+  // Also show the overhead of the tracer over time, as system-wide counters.
+  if (tracer_stats.window_ns() == 0) {
+    return;
+  }
+  double window_s = tracer_stats.window_ns() / 1'000'000'000.0;
+  SendOverheadCounterToListener(
+      "OrbitService cpu usage (%)", tracer_stats.timestamp_ns(),
+      100.0 *
+          (tracer_stats.tracer_thread_cpu_time_ns() +
+           tracer_stats.processing_thread_cpu_time_ns()) /
+          tracer_stats.window_ns());
+  SendOverheadCounterToListener("OrbitService lost records (/s)",
+                                tracer_stats.timestamp_ns(),
+                                tracer_stats.lost_count() / window_s);
+  SendOverheadCounterToListener("OrbitService dropped events (/s)",
+                                tracer_stats.timestamp_ns(),
+                                tracer_stats.sender_dropped_count() / window_s);
+  SendOverheadCounterToListener(
+      "OrbitService processing lag (ms)", tracer_stats.timestamp_ns(),
+      tracer_stats.max_processing_lag_ns() / 1'000'000.0);
+}
+
+void CaptureEventProcessor::SendOverheadCounterToListener(
+    const std::string& name, uint64_t timestamp_ns, double value) {
+  // Same tid as the system-wide counters sampled by the service.
+  constexpr int32_t kSystemCounterTid = -1;
+  Timer timer;
+  timer.m_TID = kSystemCounterTid;
+  timer.m_Start = timestamp_ns;
+  timer.m_End = timestamp_ns;
+  timer.m_UserData[0] = absl::bit_cast<uint64_t>(value);
+  timer.m_UserData[1] = GetStringHashAndSendToListenerIfNecessary(name);
+  timer.m_Type = Timer::COUNTER;
+
+  capture_listener_->OnTimer(timer);
+}
+
+void CaptureEventProcessor::ProcessLostEventsGap(
+    const LostEventsGap& lost_events_gap) {
+  Timer timer;
+  timer.m_Start = lost_events_gap.begin_timestamp_ns();
+  timer.m_End = lost_events_gap.end_timestamp_ns();
+  timer.m_Processor = static_cast<int8_t>(lost_events_gap.cpu());
+  timer.m_UserData[0] = lost_events_gap.lost_count();
+  timer.m_UserData[1] =
+      GetStringHashAndSendToListenerIfNecessary(lost_events_gap.buffer_name());
+  timer.m_Type = Timer::LOST_EVENTS;
+
+  capture_listener_->OnTimer(timer);
+}
+
+uint64_t CaptureEventProcessor::GetCallstackHashAndSendToListenerIfNecessary(
+    int32_t pid, const Callstack& callstack) {
+  CallStack cs;
+  cs.m_ProcessId = pid;
+  for (uint64_t pc : callstack.pcs()) {
+    cs.m_Data.push_back(pc);
+  }
+  cs.m_Depth = cs.m_Data.size();
+  // TODO: Compute the hash without creating the CallStack if not necessary.
+  uint64_t hash = cs.Hash();
+
+  if (!callstack_hashes_seen_.contains(hash)) {
+    callstack_hashes_seen_.emplace(hash);
+    capture_listener_->OnCallstack(cs);
+  }
+  return hash;
+}
+
+uint64_t CaptureEventProcessor::GetStringHashAndSendToListenerIfNecessary(
+    const std::string& str) {
+  uint64_t hash = StringHash(str);
+  if (!string_hashes_seen_.contains(hash)) {
+    string_hashes_seen_.emplace(hash);
+    capture_listener_->OnKeyAndString(hash, str);
+  }
+  return hash;
+}
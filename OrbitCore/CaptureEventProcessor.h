@@ -0,0 +1,82 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_CORE_CAPTURE_EVENT_PROCESSOR_H_
+#define ORBIT_CORE_CAPTURE_EVENT_PROCESSOR_H_
+
+#include <string>
+
+#include "CaptureListener.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/container/node_hash_map.h"
+#include "absl/synchronization/mutex.h"
+#include "services.pb.h"
+
+// The InternedCallstacks and InternedStrings of a capture. The thread reading
+// the capture adds them as they are received, while CaptureEventProcessors
+// might be looking up the ones received earlier on other threads. As values
+// are never moved or removed, references to them stay valid.
+class CaptureInternPools {
+ public:
+  CaptureInternPools() = default;
+  CaptureInternPools(const CaptureInternPools&) = delete;
+  CaptureInternPools& operator=(const CaptureInternPools&) = delete;
+
+  // Adds the interned values among the events of response.
+  void AddInternedValues(const CaptureResponse& response);
+
+  // Return an empty value for an unknown key.
+  [[nodiscard]] const Callstack& GetCallstack(uint64_t key) const;
+  [[nodiscard]] const std::string& GetString(uint64_t key) const;
+
+ private:
+  mutable absl::Mutex mutex_;
+  absl::node_hash_map<uint64_t, Callstack> callstacks_;
+  absl::node_hash_map<uint64_t, std::string> strings_;
+};
+
+// Converts CaptureEvents to calls to a CaptureListener. Callstacks and strings
+// are only passed to the listener the first time this processor refers to
+// them. Interned values are looked up in intern_pools, to which they must have
+// been added first, and are otherwise ignored. Not thread safe, but several
+// processors can share the same intern pools.
+class CaptureEventProcessor {
+ public:
+  CaptureEventProcessor(const CaptureInternPools* intern_pools,
+                        CaptureListener* capture_listener)
+      : intern_pools_{intern_pools}, capture_listener_{capture_listener} {}
+
+  void ProcessEvent(const CaptureEvent& event);
+
+ private:
+  void ProcessSchedulingSlice(const SchedulingSlice& scheduling_slice);
+  void ProcessCallstackSample(const CallstackSample& callstack_sample);
+  void ProcessAggregatedCallstackSamples(
+      const AggregatedCallstackSamples& aggregated_callstack_samples);
+  void ProcessFunctionCall(const FunctionCall& function_call);
+  void ProcessManualInstrumentationScope(
+      const ManualInstrumentationScope& manual_instrumentation_scope);
+  void ProcessGpuJob(const GpuJob& gpu_job);
+  void ProcessThreadName(const ThreadName& thread_name);
+  void ProcessAddressInfo(const AddressInfo& address_info);
+  void ProcessSystemCall(const SystemCall& system_call);
+  void ProcessFutexWait(const FutexWait& futex_wait);
+  void ProcessCounterSample(const CounterSample& counter_sample);
+  void ProcessTracerStats(const TracerStats& tracer_stats);
+  void ProcessLostEventsGap(const LostEventsGap& lost_events_gap);
+  void SendOverheadCounterToListener(const std::string& name,
+                                     uint64_t timestamp_ns, double value);
+
+  const CaptureInternPools* intern_pools_;
+  CaptureListener* capture_listener_;
+
+  absl::flat_hash_set<uint64_t> callstack_hashes_seen_;
+  // The addresses of callstack are in the process pid.
+  uint64_t GetCallstackHashAndSendToListenerIfNecessary(
+      int32_t pid, const Callstack& callstack);
+  absl::flat_hash_set<uint64_t> string_hashes_seen_;
+  uint64_t GetStringHashAndSendToListenerIfNecessary(const std::string& str);
+};
+
+#endif  // ORBIT_CORE_CAPTURE_EVENT_PROCESSOR_H_
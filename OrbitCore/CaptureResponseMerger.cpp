@@ -0,0 +1,60 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "CaptureResponseMerger.h"
+
+#include "OrbitBase/Logging.h"
+
+void CaptureResponseMerger::AddResponse(size_t stream_index,
+                                        CaptureResponse&& response) {
+  CHECK(stream_index < streams_.size());
+  absl::MutexLock lock{&mutex_};
+  Stream& stream = streams_[stream_index];
+  CHECK(!stream.finished);
+  mutex_.Await(absl::Condition(
+      +[](Stream* stream) {
+        return stream->responses.size() < kMaxWaitingResponsesPerStream;
+      },
+      &stream));
+  stream.responses.emplace_back(std::move(response));
+}
+
+void CaptureResponseMerger::FinishStream(size_t stream_index) {
+  CHECK(stream_index < streams_.size());
+  absl::MutexLock lock{&mutex_};
+  streams_[stream_index].finished = true;
+}
+
+bool CaptureResponseMerger::IsNextResponseKnown() const {
+  for (const Stream& stream : streams_) {
+    if (stream.responses.empty() && !stream.finished) {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::optional<CaptureResponse> CaptureResponseMerger::TakeNextResponse() {
+  absl::MutexLock lock{&mutex_};
+  mutex_.Await(
+      absl::Condition(this, &CaptureResponseMerger::IsNextResponseKnown));
+
+  Stream* next_stream = nullptr;
+  for (Stream& stream : streams_) {
+    if (stream.responses.empty()) {
+      continue;
+    }
+    if (next_stream == nullptr ||
+        stream.responses.front().send_timestamp_ns() <
+            next_stream->responses.front().send_timestamp_ns()) {
+      next_stream = &stream;
+    }
+  }
+  if (next_stream == nullptr) {
+    return std::nullopt;
+  }
+  CaptureResponse response = std::move(next_stream->responses.front());
+  next_stream->responses.pop_front();
+  return response;
+}
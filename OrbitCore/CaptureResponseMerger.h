@@ -0,0 +1,53 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_CORE_CAPTURE_RESPONSE_MERGER_H_
+#define ORBIT_CORE_CAPTURE_RESPONSE_MERGER_H_
+
+#include <deque>
+#include <optional>
+#include <vector>
+
+#include "absl/synchronization/mutex.h"
+#include "services.pb.h"
+
+// Merges the CaptureResponses of the streams of a capture with
+// CaptureOptions::separate_stream_categories, in the order of their
+// send_timestamp_ns. Stream 0 is the Capture call, which goes first on ties.
+// A response is only taken once every stream that is not finished has
+// responses waiting, as the next one in order could still arrive on a stream
+// that has none. Thread safe: each stream is read by its own thread, which
+// calls AddResponse and FinishStream, while another thread processes the
+// responses.
+class CaptureResponseMerger {
+ public:
+  explicit CaptureResponseMerger(size_t stream_count)
+      : streams_(stream_count) {}
+
+  CaptureResponseMerger(const CaptureResponseMerger&) = delete;
+  CaptureResponseMerger& operator=(const CaptureResponseMerger&) = delete;
+
+  // Waits while too many responses of this stream are waiting, so that a
+  // stream ahead of the others doesn't accumulate them without bound.
+  void AddResponse(size_t stream_index, CaptureResponse&& response);
+  void FinishStream(size_t stream_index);
+
+  // Waits until the next response in order is known. Returns nullopt when all
+  // the streams are finished and all their responses were taken.
+  [[nodiscard]] std::optional<CaptureResponse> TakeNextResponse();
+
+ private:
+  static constexpr size_t kMaxWaitingResponsesPerStream = 256;
+
+  struct Stream {
+    std::deque<CaptureResponse> responses;
+    bool finished = false;
+  };
+  bool IsNextResponseKnown() const;
+
+  absl::Mutex mutex_;
+  std::vector<Stream> streams_;
+};
+
+#endif  // ORBIT_CORE_CAPTURE_RESPONSE_MERGER_H_
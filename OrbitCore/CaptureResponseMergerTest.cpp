@@ -0,0 +1,99 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "CaptureResponseMerger.h"
+
+namespace {
+
+CaptureResponse CreateResponse(uint64_t send_timestamp_ns, int32_t tid) {
+  CaptureResponse response;
+  response.set_send_timestamp_ns(send_timestamp_ns);
+  response.add_capture_events()->mutable_thread_name()->set_tid(tid);
+  return response;
+}
+
+// Returns the send timestamp and the tid of each response.
+std::vector<std::pair<uint64_t, int32_t>> TakeAllResponses(
+    CaptureResponseMerger* merger) {
+  std::vector<std::pair<uint64_t, int32_t>> responses;
+  while (std::optional<CaptureResponse> response =
+             merger->TakeNextResponse()) {
+    responses.emplace_back(response->send_timestamp_ns(),
+                           response->capture_events(0).thread_name().tid());
+  }
+  return responses;
+}
+
+}  // namespace
+
+TEST(CaptureResponseMerger, MergesBySendTimestamp) {
+  CaptureResponseMerger merger{3};
+  merger.AddResponse(1, CreateResponse(10, 1));
+  merger.AddResponse(1, CreateResponse(30, 1));
+  merger.AddResponse(2, CreateResponse(20, 2));
+  merger.AddResponse(0, CreateResponse(5, 0));
+  merger.AddResponse(0, CreateResponse(40, 0));
+  for (size_t i = 0; i < 3; ++i) {
+    merger.FinishStream(i);
+  }
+
+  std::vector<std::pair<uint64_t, int32_t>> expected{
+      {5, 0}, {10, 1}, {20, 2}, {30, 1}, {40, 0}};
+  EXPECT_EQ(TakeAllResponses(&merger), expected);
+}
+
+TEST(CaptureResponseMerger, FirstStreamGoesFirstOnTies) {
+  CaptureResponseMerger merger{2};
+  merger.AddResponse(1, CreateResponse(10, 1));
+  merger.AddResponse(0, CreateResponse(10, 0));
+  merger.FinishStream(0);
+  merger.FinishStream(1);
+
+  std::vector<std::pair<uint64_t, int32_t>> expected{{10, 0}, {10, 1}};
+  EXPECT_EQ(TakeAllResponses(&merger), expected);
+}
+
+TEST(CaptureResponseMerger, WaitsForStreamsWithoutResponses) {
+  constexpr uint64_t kResponseCount = 1000;
+  CaptureResponseMerger merger{2};
+  // Stream 0 gets even timestamps and stream 1 odd ones, but stream 1 is read
+  // entirely first.
+  std::thread stream_1_thread{[&merger] {
+    for (uint64_t i = 0; i < kResponseCount; ++i) {
+      merger.AddResponse(1, CreateResponse(2 * i + 1, 1));
+    }
+    merger.FinishStream(1);
+  }};
+  std::thread stream_0_thread{[&merger] {
+    for (uint64_t i = 0; i < kResponseCount; ++i) {
+      merger.AddResponse(0, CreateResponse(2 * i, 0));
+    }
+    merger.FinishStream(0);
+  }};
+
+  std::vector<std::pair<uint64_t, int32_t>> responses =
+      TakeAllResponses(&merger);
+  stream_0_thread.join();
+  stream_1_thread.join();
+  ASSERT_EQ(responses.size(), 2 * kResponseCount);
+  for (uint64_t i = 0; i < responses.size(); ++i) {
+    EXPECT_EQ(responses[i].first, i);
+  }
+}
+
+TEST(CaptureResponseMerger, ContinuesWithoutFinishedStreams) {
+  CaptureResponseMerger merger{2};
+  merger.FinishStream(1);
+  merger.AddResponse(0, CreateResponse(10, 0));
+  merger.FinishStream(0);
+
+  std::vector<std::pair<uint64_t, int32_t>> expected{{10, 0}};
+  EXPECT_EQ(TakeAllResponses(&merger), expected);
+}
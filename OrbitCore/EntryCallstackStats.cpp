@@ -0,0 +1,50 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "EntryCallstackStats.h"
+
+#include <algorithm>
+
+void EntryCallstackStats::AddCall(uint64_t function_address,
+                                  CallstackID callstack_id,
+                                  uint64_t duration_ns) {
+  absl::MutexLock lock{&mutex_};
+  CallstackStats& stats =
+      function_and_callstack_to_stats_[{function_address, callstack_id}];
+  stats.function_address = function_address;
+  stats.callstack_id = callstack_id;
+  ++stats.count;
+  stats.total_time_ns += duration_ns;
+  function_to_total_time_ns_[function_address] += duration_ns;
+}
+
+std::vector<EntryCallstackStats::CallstackStats>
+EntryCallstackStats::GetCallstacksSortedByTotalTime() {
+  std::vector<CallstackStats> callstacks;
+  {
+    absl::MutexLock lock{&mutex_};
+    callstacks.reserve(function_and_callstack_to_stats_.size());
+    for (const auto& [key, stats] : function_and_callstack_to_stats_) {
+      callstacks.push_back(stats);
+    }
+  }
+  std::sort(callstacks.begin(), callstacks.end(),
+            [](const CallstackStats& lhs, const CallstackStats& rhs) {
+              return lhs.total_time_ns > rhs.total_time_ns;
+            });
+  return callstacks;
+}
+
+uint64_t EntryCallstackStats::GetFunctionTotalTimeNs(
+    uint64_t function_address) {
+  absl::MutexLock lock{&mutex_};
+  auto it = function_to_total_time_ns_.find(function_address);
+  return it != function_to_total_time_ns_.end() ? it->second : 0;
+}
+
+void EntryCallstackStats::Clear() {
+  absl::MutexLock lock{&mutex_};
+  function_and_callstack_to_stats_.clear();
+  function_to_total_time_ns_.clear();
+}
@@ -0,0 +1,46 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_CORE_ENTRY_CALLSTACK_STATS_H_
+#define ORBIT_CORE_ENTRY_CALLSTACK_STATS_H_
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "CallstackTypes.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+
+// Aggregates the time spent in instrumented functions, per function and per
+// callstack recorded at the entry of the function. This allows to break down
+// the cost of a function by its callers.
+class EntryCallstackStats {
+ public:
+  struct CallstackStats {
+    uint64_t function_address = 0;
+    CallstackID callstack_id = 0;
+    uint64_t count = 0;
+    uint64_t total_time_ns = 0;
+  };
+
+  EntryCallstackStats() = default;
+
+  void AddCall(uint64_t function_address, CallstackID callstack_id,
+               uint64_t duration_ns);
+  // Returns a snapshot of the stats of all (function, callstack) pairs, sorted
+  // by decreasing total time.
+  std::vector<CallstackStats> GetCallstacksSortedByTotalTime();
+  // Total time of the calls to this function that have an entry callstack.
+  uint64_t GetFunctionTotalTimeNs(uint64_t function_address);
+  void Clear();
+
+ private:
+  absl::flat_hash_map<std::pair<uint64_t, CallstackID>, CallstackStats>
+      function_and_callstack_to_stats_;
+  absl::flat_hash_map<uint64_t, uint64_t> function_to_total_time_ns_;
+  absl::Mutex mutex_;
+};
+
+#endif  // ORBIT_CORE_ENTRY_CALLSTACK_STATS_H_
@@ -0,0 +1,51 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+
+#include "EntryCallstackStats.h"
+
+TEST(EntryCallstackStats, Empty) {
+  EntryCallstackStats stats;
+  EXPECT_TRUE(stats.GetCallstacksSortedByTotalTime().empty());
+  EXPECT_EQ(stats.GetFunctionTotalTimeNs(0x1000), 0);
+}
+
+TEST(EntryCallstackStats, AggregatesPerFunctionAndCallstack) {
+  EntryCallstackStats stats;
+  stats.AddCall(0x1000, 1, 100);
+  stats.AddCall(0x1000, 2, 500);
+  stats.AddCall(0x1000, 1, 300);
+  stats.AddCall(0x2000, 1, 50);
+
+  std::vector<EntryCallstackStats::CallstackStats> callstacks =
+      stats.GetCallstacksSortedByTotalTime();
+  ASSERT_EQ(callstacks.size(), 3);
+
+  EXPECT_EQ(callstacks[0].function_address, 0x1000);
+  EXPECT_EQ(callstacks[0].callstack_id, 2);
+  EXPECT_EQ(callstacks[0].count, 1);
+  EXPECT_EQ(callstacks[0].total_time_ns, 500);
+
+  EXPECT_EQ(callstacks[1].function_address, 0x1000);
+  EXPECT_EQ(callstacks[1].callstack_id, 1);
+  EXPECT_EQ(callstacks[1].count, 2);
+  EXPECT_EQ(callstacks[1].total_time_ns, 400);
+
+  EXPECT_EQ(callstacks[2].function_address, 0x2000);
+  EXPECT_EQ(callstacks[2].callstack_id, 1);
+  EXPECT_EQ(callstacks[2].count, 1);
+  EXPECT_EQ(callstacks[2].total_time_ns, 50);
+
+  EXPECT_EQ(stats.GetFunctionTotalTimeNs(0x1000), 900);
+  EXPECT_EQ(stats.GetFunctionTotalTimeNs(0x2000), 50);
+}
+
+TEST(EntryCallstackStats, Clear) {
+  EntryCallstackStats stats;
+  stats.AddCall(0x1000, 1, 100);
+  stats.Clear();
+  EXPECT_TRUE(stats.GetCallstacksSortedByTotalTime().empty());
+  EXPECT_EQ(stats.GetFunctionTotalTimeNs(0x1000), 0);
+}
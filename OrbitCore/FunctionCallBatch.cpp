@@ -0,0 +1,122 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "FunctionCallBatch.h"
+
+#include "OrbitBase/Logging.h"
+
+void FunctionCallBatchBuilder::AddFunctionCall(
+    const FunctionCall& function_call) {
+  CHECK(!function_call.has_entry_callstack());
+
+  auto [thread_it, thread_inserted] = thread_indices_.try_emplace(
+      std::make_pair(function_call.pid(), function_call.tid()),
+      batch_.thread_pids_size());
+  if (thread_inserted) {
+    batch_.add_thread_pids(function_call.pid());
+    batch_.add_thread_tids(function_call.tid());
+  }
+  auto [address_it, address_inserted] = absolute_address_indices_.try_emplace(
+      function_call.absolute_address(), batch_.absolute_addresses_size());
+  if (address_inserted) {
+    batch_.add_absolute_addresses(function_call.absolute_address());
+  }
+
+  if (function_call.entry_callstack_or_key_case() ==
+      FunctionCall::kEntryCallstackKey) {
+    batch_.add_entry_callstack_call_indices(batch_.thread_indices_size());
+    batch_.add_entry_callstack_keys(function_call.entry_callstack_key());
+  }
+  batch_.add_thread_indices(thread_it->second);
+  batch_.add_absolute_address_indices(address_it->second);
+  batch_.add_begin_timestamp_deltas_ns(
+      static_cast<int64_t>(function_call.begin_timestamp_ns() -
+                           previous_begin_timestamp_ns_));
+  previous_begin_timestamp_ns_ = function_call.begin_timestamp_ns();
+  batch_.add_durations_ns(function_call.end_timestamp_ns() -
+                          function_call.begin_timestamp_ns());
+  batch_.add_depths(function_call.depth());
+  batch_.add_return_values(function_call.return_value());
+}
+
+FunctionCallBatch FunctionCallBatchBuilder::Build() {
+  FunctionCallBatch batch = std::move(batch_);
+  batch_.Clear();
+  thread_indices_.clear();
+  absolute_address_indices_.clear();
+  previous_begin_timestamp_ns_ = 0;
+  return batch;
+}
+
+std::vector<FunctionCall> UnpackFunctionCallBatch(
+    const FunctionCallBatch& batch) {
+  const int call_count = batch.thread_indices_size();
+  if (batch.thread_pids_size() != batch.thread_tids_size() ||
+      batch.absolute_address_indices_size() != call_count ||
+      batch.begin_timestamp_deltas_ns_size() != call_count ||
+      batch.durations_ns_size() != call_count ||
+      batch.depths_size() != call_count ||
+      batch.return_values_size() != call_count ||
+      batch.entry_callstack_call_indices_size() !=
+          batch.entry_callstack_keys_size()) {
+    ERROR("Ignoring FunctionCallBatch with fields of inconsistent sizes");
+    return {};
+  }
+
+  std::vector<FunctionCall> function_calls(call_count);
+  uint64_t begin_timestamp_ns = 0;
+  for (int i = 0; i < call_count; ++i) {
+    uint32_t thread_index = batch.thread_indices(i);
+    uint32_t address_index = batch.absolute_address_indices(i);
+    if (thread_index >= static_cast<uint32_t>(batch.thread_pids_size()) ||
+        address_index >=
+            static_cast<uint32_t>(batch.absolute_addresses_size())) {
+      ERROR("Ignoring FunctionCallBatch with invalid index");
+      return {};
+    }
+    begin_timestamp_ns += batch.begin_timestamp_deltas_ns(i);
+
+    FunctionCall& function_call = function_calls[i];
+    function_call.set_pid(batch.thread_pids(thread_index));
+    function_call.set_tid(batch.thread_tids(thread_index));
+    function_call.set_absolute_address(
+        batch.absolute_addresses(address_index));
+    function_call.set_begin_timestamp_ns(begin_timestamp_ns);
+    function_call.set_end_timestamp_ns(begin_timestamp_ns +
+                                       batch.durations_ns(i));
+    function_call.set_depth(batch.depths(i));
+    function_call.set_return_value(batch.return_values(i));
+  }
+
+  for (int i = 0; i < batch.entry_callstack_call_indices_size(); ++i) {
+    uint32_t call_index = batch.entry_callstack_call_indices(i);
+    if (call_index >= static_cast<uint32_t>(call_count)) {
+      ERROR("Ignoring FunctionCallBatch with invalid index");
+      return {};
+    }
+    function_calls[call_index].set_entry_callstack_key(
+        batch.entry_callstack_keys(i));
+  }
+  return function_calls;
+}
+
+void PackFunctionCalls(
+    google::protobuf::RepeatedPtrField<CaptureEvent>* events) {
+  FunctionCallBatchBuilder builder;
+  int kept_count = 0;
+  for (int i = 0; i < events->size(); ++i) {
+    if (events->Get(i).has_function_call()) {
+      builder.AddFunctionCall(events->Get(i).function_call());
+      continue;
+    }
+    if (i != kept_count) {
+      events->SwapElements(i, kept_count);
+    }
+    ++kept_count;
+  }
+  events->DeleteSubrange(kept_count, events->size() - kept_count);
+  if (!builder.IsEmpty()) {
+    *events->Add()->mutable_function_call_batch() = builder.Build();
+  }
+}
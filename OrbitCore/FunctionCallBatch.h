@@ -0,0 +1,52 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_CORE_FUNCTION_CALL_BATCH_H_
+#define ORBIT_CORE_FUNCTION_CALL_BATCH_H_
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "capture.pb.h"
+
+// Packs FunctionCalls into a FunctionCallBatch: threads and addresses are
+// stored once and referred to by index, begin timestamps as differences from
+// the previous call and end timestamps as durations, so that most values fit
+// in one or two bytes. OrbitService uses this to send function calls, the
+// client unpacks them with UnpackFunctionCallBatch.
+class FunctionCallBatchBuilder {
+ public:
+  FunctionCallBatchBuilder() = default;
+
+  // The entry callstack of function_call, if any, must already be replaced by
+  // its key.
+  void AddFunctionCall(const FunctionCall& function_call);
+
+  [[nodiscard]] bool IsEmpty() const {
+    return batch_.thread_indices().empty();
+  }
+
+  // Returns the batch and resets the builder.
+  [[nodiscard]] FunctionCallBatch Build();
+
+ private:
+  FunctionCallBatch batch_;
+  absl::flat_hash_map<std::pair<int32_t, int32_t>, uint32_t> thread_indices_;
+  absl::flat_hash_map<uint64_t, uint32_t> absolute_address_indices_;
+  uint64_t previous_begin_timestamp_ns_ = 0;
+};
+
+// Replaces the FunctionCalls among events with a FunctionCallBatch at the end,
+// keeping the order of the other events.
+void PackFunctionCalls(
+    google::protobuf::RepeatedPtrField<CaptureEvent>* events);
+
+// Returns the FunctionCalls of batch, in the order they were added. Returns no
+// calls if the batch is malformed.
+std::vector<FunctionCall> UnpackFunctionCallBatch(
+    const FunctionCallBatch& batch);
+
+#endif  // ORBIT_CORE_FUNCTION_CALL_BATCH_H_
@@ -0,0 +1,129 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <google/protobuf/util/message_differencer.h>
+#include <gtest/gtest.h>
+
+#include "FunctionCallBatch.h"
+
+namespace {
+
+FunctionCall CreateFunctionCall(int32_t pid, int32_t tid,
+                                uint64_t absolute_address,
+                                uint64_t begin_timestamp_ns,
+                                uint64_t end_timestamp_ns, int32_t depth) {
+  FunctionCall function_call;
+  function_call.set_pid(pid);
+  function_call.set_tid(tid);
+  function_call.set_absolute_address(absolute_address);
+  function_call.set_begin_timestamp_ns(begin_timestamp_ns);
+  function_call.set_end_timestamp_ns(end_timestamp_ns);
+  function_call.set_depth(depth);
+  return function_call;
+}
+
+void ExpectEqual(const std::vector<FunctionCall>& actual,
+                 const std::vector<FunctionCall>& expected) {
+  ASSERT_EQ(actual.size(), expected.size());
+  for (size_t i = 0; i < actual.size(); ++i) {
+    EXPECT_TRUE(google::protobuf::util::MessageDifferencer::Equals(
+        actual[i], expected[i]))
+        << actual[i].DebugString() << expected[i].DebugString();
+  }
+}
+
+}  // namespace
+
+TEST(FunctionCallBatch, RoundTrip) {
+  std::vector<FunctionCall> function_calls;
+  // Nested calls arrive in order of end timestamp, not of begin timestamp.
+  function_calls.push_back(
+      CreateFunctionCall(10, 11, 0x1000, 1'000'200, 1'000'300, 1));
+  function_calls.push_back(
+      CreateFunctionCall(10, 11, 0x2000, 1'000'100, 1'000'400, 0));
+  function_calls.push_back(
+      CreateFunctionCall(10, 12, 0x1000, 1'000'150, 1'000'500, 0));
+  function_calls.push_back(
+      CreateFunctionCall(20, 21, 0x3000, 2'000'000, 2'000'000, 0));
+  function_calls[1].set_return_value(42);
+  function_calls[2].set_entry_callstack_key(0xABCDEF);
+
+  FunctionCallBatchBuilder builder;
+  EXPECT_TRUE(builder.IsEmpty());
+  for (const FunctionCall& function_call : function_calls) {
+    builder.AddFunctionCall(function_call);
+  }
+  EXPECT_FALSE(builder.IsEmpty());
+  FunctionCallBatch batch = builder.Build();
+  EXPECT_TRUE(builder.IsEmpty());
+
+  EXPECT_EQ(batch.thread_tids_size(), 3);
+  EXPECT_EQ(batch.absolute_addresses_size(), 3);
+  EXPECT_EQ(batch.entry_callstack_keys_size(), 1);
+  ExpectEqual(UnpackFunctionCallBatch(batch), function_calls);
+}
+
+TEST(FunctionCallBatch, BuilderStartsOverAfterBuild) {
+  FunctionCallBatchBuilder builder;
+  builder.AddFunctionCall(CreateFunctionCall(10, 11, 0x1000, 100, 200, 0));
+  (void)builder.Build();
+
+  FunctionCall function_call = CreateFunctionCall(10, 12, 0x2000, 300, 400, 0);
+  builder.AddFunctionCall(function_call);
+  FunctionCallBatch batch = builder.Build();
+  EXPECT_EQ(batch.thread_tids_size(), 1);
+  EXPECT_EQ(batch.absolute_addresses_size(), 1);
+  ExpectEqual(UnpackFunctionCallBatch(batch), {function_call});
+}
+
+TEST(FunctionCallBatch, IsSmallerThanIndividualEvents) {
+  uint64_t individual_events_size = 0;
+  FunctionCallBatchBuilder builder;
+  for (uint64_t i = 0; i < 1000; ++i) {
+    FunctionCall function_call = CreateFunctionCall(
+        10, 11 + i % 4, 0x7F0000001000 + 0x100 * (i % 8),
+        1'600'000'000'000'000'000 + 1000 * i,
+        1'600'000'000'000'000'000 + 1000 * i + 500, 0);
+    builder.AddFunctionCall(function_call);
+    CaptureEvent event;
+    *event.mutable_function_call() = std::move(function_call);
+    individual_events_size += event.ByteSizeLong();
+  }
+  CaptureEvent batch_event;
+  *batch_event.mutable_function_call_batch() = builder.Build();
+  EXPECT_LT(3 * batch_event.ByteSizeLong(), individual_events_size);
+}
+
+TEST(FunctionCallBatch, MalformedBatchIsIgnored) {
+  FunctionCallBatchBuilder builder;
+  builder.AddFunctionCall(CreateFunctionCall(10, 11, 0x1000, 100, 200, 0));
+  FunctionCallBatch batch = builder.Build();
+
+  FunctionCallBatch missing_field = batch;
+  missing_field.clear_durations_ns();
+  EXPECT_TRUE(UnpackFunctionCallBatch(missing_field).empty());
+
+  FunctionCallBatch invalid_index = batch;
+  invalid_index.set_absolute_address_indices(0, 1);
+  EXPECT_TRUE(UnpackFunctionCallBatch(invalid_index).empty());
+}
+
+TEST(FunctionCallBatch, PackFunctionCallsKeepsOtherEvents) {
+  std::vector<FunctionCall> function_calls{
+      CreateFunctionCall(10, 11, 0x1000, 100, 200, 0),
+      CreateFunctionCall(10, 11, 0x2000, 300, 400, 0)};
+  google::protobuf::RepeatedPtrField<CaptureEvent> events;
+  *events.Add()->mutable_function_call() = function_calls[0];
+  events.Add()->mutable_thread_name()->set_tid(11);
+  *events.Add()->mutable_function_call() = function_calls[1];
+  events.Add()->mutable_thread_name()->set_tid(12);
+
+  PackFunctionCalls(&events);
+  ASSERT_EQ(events.size(), 3);
+  EXPECT_EQ(events.Get(0).thread_name().tid(), 11);
+  EXPECT_EQ(events.Get(1).thread_name().tid(), 12);
+  ASSERT_TRUE(events.Get(2).has_function_call_batch());
+  ExpectEqual(UnpackFunctionCallBatch(events.Get(2).function_call_batch()),
+              function_calls);
+}
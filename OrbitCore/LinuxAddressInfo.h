@@ -13,23 +13,28 @@
 struct LinuxAddressInfo {
   LinuxAddressInfo() = default;
   LinuxAddressInfo(uint64_t address, std::string module_name,
-                   std::string function_name, uint64_t offset_in_function)
+                   std::string function_name, uint64_t offset_in_function,
+                   int32_t process_id)
       : address{address},
         module_name{std::move(module_name)},
         function_name{std::move(function_name)},
-        offset_in_function{offset_in_function} {}
+        offset_in_function{offset_in_function},
+        process_id{process_id} {}
 
   uint64_t address = 0;
   std::string module_name;
   std::string function_name;
   uint64_t offset_in_function = 0;
+  // Different processes can have different code at the same address.
+  int32_t process_id = 0;
 
   ORBIT_SERIALIZABLE;
 };
 
-ORBIT_SERIALIZE(LinuxAddressInfo, 0) {
+ORBIT_SERIALIZE(LinuxAddressInfo, 1) {
   ORBIT_NVP_VAL(0, module_name);
   ORBIT_NVP_VAL(0, function_name);
   ORBIT_NVP_VAL(0, address);
   ORBIT_NVP_VAL(0, offset_in_function);
+  ORBIT_NVP_VAL(1, process_id);
 }
@@ -239,12 +239,12 @@ TEST(LinuxTracingBuffer, AddressInfos) {
   LinuxTracingBuffer buffer;
 
   {
-    LinuxAddressInfo address_info{0x11, "module1", "function1", 0x1};
+    LinuxAddressInfo address_info{0x11, "module1", "function1", 0x1, 1};
     buffer.RecordAddressInfo(std::move(address_info));
   }
 
   {
-    LinuxAddressInfo address_info{0x22, "module2", "function2", 0x2};
+    LinuxAddressInfo address_info{0x22, "module2", "function2", 0x2, 1};
     buffer.RecordAddressInfo(std::move(address_info));
   }
 
@@ -265,7 +265,7 @@ TEST(LinuxTracingBuffer, AddressInfos) {
   EXPECT_EQ(address_infos[1].offset_in_function, 0x2);
 
   {
-    LinuxAddressInfo address_info{0x33, "module3", "function3", 0x3};
+    LinuxAddressInfo address_info{0x33, "module3", "function3", 0x3, 1};
     buffer.RecordAddressInfo(std::move(address_info));
   }
 
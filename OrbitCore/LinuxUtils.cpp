@@ -8,6 +8,8 @@
 #include <asm/unistd.h>
 #include <cxxabi.h>
 #include <dirent.h>
+#include <elf.h>
+#include <fcntl.h>
 #include <linux/perf_event.h>
 #include <linux/types.h>
 #include <linux/version.h>
@@ -34,7 +36,7 @@
 #include "Callstack.h"
 #include "Capture.h"
 #include "ConnectionManager.h"
-#include "ElfUtils/ElfFile.h"
+#include "ElfUtils/BuildIdReader.h"
 #include "EventBuffer.h"
 #include "OrbitBase/Logging.h"
 #include "OrbitModule.h"
@@ -51,8 +53,6 @@
 
 namespace LinuxUtils {
 
-using ::ElfUtils::ElfFile;
-
 //-----------------------------------------------------------------------------
 outcome::result<std::vector<std::string>> ReadProcMaps(pid_t pid) {
   std::filesystem::path maps_path{absl::StrFormat("/proc/%d/maps", pid)};
@@ -129,9 +129,13 @@ outcome::result<std::vector<ModuleInfo>, std::string> ListModules(int32_t pid) {
     uint64_t file_size = Path::FileSize(module_path);
     if (file_size == 0) continue;
 
-    std::unique_ptr<ElfFile> elf_file = ElfFile::Create(module_path);
-    if (!elf_file) {
-      ERROR("Unable to create an elf file for module %s", module_path.c_str());
+    // Only reads the notes of the file, and only once as long as the file
+    // doesn't change, as processes can map hundreds of modules.
+    static ElfUtils::BuildIdCache build_id_cache;
+    const auto build_id = build_id_cache.GetBuildId(module_path);
+    if (!build_id) {
+      ERROR("Unable to read the build id of module %s: %s", module_path,
+            build_id.error().message());
       continue;
     }
 
@@ -141,7 +145,7 @@ outcome::result<std::vector<ModuleInfo>, std::string> ListModules(int32_t pid) {
     module_info.set_file_size(file_size);
     module_info.set_address_start(address_range.start_address);
     module_info.set_address_end(address_range.end_address);
-    module_info.set_build_id(elf_file->GetBuildId());
+    module_info.set_build_id(build_id.value());
 
     result.push_back(module_info);
   }
@@ -150,30 +154,69 @@ outcome::result<std::vector<ModuleInfo>, std::string> ListModules(int32_t pid) {
 }
 
 //-----------------------------------------------------------------------------
-outcome::result<std::unordered_map<pid_t, double>> GetCpuUtilization() {
-  const std::string cmd =
-      "top -b -n 1 | sed -n '8, 1000{s/^ *//;s/ *$//;s/  */,/gp;};1000q'";
-  OUTCOME_TRY(result, ExecuteCommand(cmd));
-
-  std::unordered_map<pid_t, double> process_map;
-
-  for (const auto& line : absl::StrSplit(result, "\n")) {
-    std::vector<std::string> tokens = absl::StrSplit(line, ",");
-    if (tokens.size() > 8) {
-      pid_t pid = atoi(tokens[0].c_str());
-      double cpu = atof(tokens[8].c_str());
-      process_map[pid] = cpu;
-    }
+outcome::result<ProcessTimes> ParseProcessTimes(const std::string& stat) {
+  // The command name is in parentheses and can itself contain spaces and
+  // parentheses, so the fields are counted from the last ')'. The first field
+  // after it is the state, the third field of the line.
+  size_t command_end = stat.rfind(')');
+  if (command_end == std::string::npos) {
+    return outcome::failure(std::errc::invalid_argument);
   }
+  std::vector<std::string> fields =
+      absl::StrSplit(stat.substr(command_end + 1), ' ', absl::SkipEmpty());
+  constexpr size_t kFirstField = 3;
+  constexpr size_t kUtimeField = 14;
+  constexpr size_t kStimeField = 15;
+  constexpr size_t kStartTimeField = 22;
+  if (fields.size() <= kStartTimeField - kFirstField) {
+    return outcome::failure(std::errc::invalid_argument);
+  }
+
+  uint64_t utime;
+  uint64_t stime;
+  ProcessTimes times;
+  if (!absl::SimpleAtoi(fields[kUtimeField - kFirstField], &utime) ||
+      !absl::SimpleAtoi(fields[kStimeField - kFirstField], &stime) ||
+      !absl::SimpleAtoi(fields[kStartTimeField - kFirstField],
+                        &times.start_time_ticks)) {
+    return outcome::failure(std::errc::invalid_argument);
+  }
+  times.cpu_time_ticks = utime + stime;
+  return times;
+}
+
+//-----------------------------------------------------------------------------
+outcome::result<ProcessTimes> GetProcessTimes(pid_t pid) {
+  OUTCOME_TRY(stat, OrbitUtils::FileToString(
+                        absl::StrFormat("/proc/%d/stat", pid)));
+  return ParseProcessTimes(stat);
+}
 
-  return process_map;
+//-----------------------------------------------------------------------------
+outcome::result<double> GetUptimeSeconds() {
+  OUTCOME_TRY(uptime, OrbitUtils::FileToString("/proc/uptime"));
+  double uptime_seconds;
+  if (!absl::SimpleAtod(uptime.substr(0, uptime.find(' ')),
+                        &uptime_seconds)) {
+    return outcome::failure(std::errc::invalid_argument);
+  }
+  return uptime_seconds;
 }
 
 //-----------------------------------------------------------------------------
 outcome::result<bool> Is64Bit(pid_t pid) {
-  OUTCOME_TRY(result,
-              ExecuteCommand(absl::StrFormat("file -L /proc/%d/exe", pid)));
-  return absl::StrContains(result, "64-bit");
+  const std::string exe_path = absl::StrFormat("/proc/%d/exe", pid);
+  int fd = open(exe_path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd == -1) {
+    return outcome::failure(static_cast<std::errc>(errno));
+  }
+  unsigned char ident[EI_NIDENT];
+  ssize_t read_size = pread(fd, ident, sizeof(ident), 0);
+  close(fd);
+  if (read_size != sizeof(ident) || memcmp(ident, ELFMAG, SELFMAG) != 0) {
+    return outcome::failure(std::errc::executable_format_error);
+  }
+  return ident[EI_CLASS] == ELFCLASS64;
 }
 
 }  // namespace LinuxUtils
@@ -4,6 +4,8 @@
 
 #pragma once
 
+#include <sys/types.h>
+
 #include <functional>
 #include <map>
 #include <memory>
@@ -20,6 +22,19 @@ namespace LinuxUtils {
 outcome::result<std::string> ExecuteCommand(const std::string& cmd);
 outcome::result<std::vector<std::string>> ReadProcMaps(pid_t pid);
 outcome::result<std::vector<ModuleInfo>, std::string> ListModules(int32_t pid);
-outcome::result<std::unordered_map<pid_t, double>> GetCpuUtilization();
+
+// The times of a process in /proc/<pid>/stat, in clock ticks (see
+// sysconf(_SC_CLK_TCK)).
+struct ProcessTimes {
+  // User and system time, not including children.
+  uint64_t cpu_time_ticks = 0;
+  // Since boot. Together with the pid, identifies a process.
+  uint64_t start_time_ticks = 0;
+};
+outcome::result<ProcessTimes> ParseProcessTimes(const std::string& stat);
+outcome::result<ProcessTimes> GetProcessTimes(pid_t pid);
+// From /proc/uptime, on the same clock as ProcessTimes::start_time_ticks.
+outcome::result<double> GetUptimeSeconds();
+// Reads the ELF header of /proc/<pid>/exe, which fails for kernel threads.
 outcome::result<bool> Is64Bit(pid_t pid);
 }  // namespace LinuxUtils
@@ -0,0 +1,40 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <string>
+
+#include "LinuxUtils.h"
+
+TEST(LinuxUtils, ParseProcessTimes) {
+  const std::string stat =
+      "1234 (a) (b c)) S 1 1234 1234 0 -1 4194560 1000 0 0 0 "
+      "170 30 0 0 20 0 1 0 4567 10000000 100 18446744073709551615";
+  const auto times = LinuxUtils::ParseProcessTimes(stat);
+  ASSERT_TRUE(times);
+  EXPECT_EQ(times.value().cpu_time_ticks, 200);
+  EXPECT_EQ(times.value().start_time_ticks, 4567);
+}
+
+TEST(LinuxUtils, ParseProcessTimesTruncated) {
+  EXPECT_FALSE(LinuxUtils::ParseProcessTimes("1234 (a) S 1 1234"));
+  EXPECT_FALSE(LinuxUtils::ParseProcessTimes("1234 a S"));
+}
+
+TEST(LinuxUtils, GetProcessTimesOfSelf) {
+  const auto times = LinuxUtils::GetProcessTimes(getpid());
+  ASSERT_TRUE(times);
+  const auto uptime_seconds = LinuxUtils::GetUptimeSeconds();
+  ASSERT_TRUE(uptime_seconds);
+  EXPECT_LE(times.value().start_time_ticks / sysconf(_SC_CLK_TCK),
+            uptime_seconds.value());
+}
+
+TEST(LinuxUtils, Is64BitOfSelf) {
+  const auto is_64_bit = LinuxUtils::Is64Bit(getpid());
+  ASSERT_TRUE(is_64_bit);
+  EXPECT_EQ(is_64_bit.value(), sizeof(void*) == 8);
+}
@@ -0,0 +1,69 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "LockContentionStats.h"
+
+#include <algorithm>
+
+namespace {
+CallstackID GetTopCallstack(
+    const absl::flat_hash_map<CallstackID, uint64_t>& wait_ns_per_callstack) {
+  CallstackID top_callstack = 0;
+  uint64_t top_wait_ns = 0;
+  for (const auto& [callstack, wait_ns] : wait_ns_per_callstack) {
+    if (top_callstack == 0 || wait_ns > top_wait_ns) {
+      top_callstack = callstack;
+      top_wait_ns = wait_ns;
+    }
+  }
+  return top_callstack;
+}
+}  // namespace
+
+CallstackID LockContentionStats::LockStats::GetTopWaiterCallstack() const {
+  return GetTopCallstack(wait_ns_per_waiter_callstack);
+}
+
+CallstackID LockContentionStats::LockStats::GetTopWakerCallstack() const {
+  return GetTopCallstack(wait_ns_per_waker_callstack);
+}
+
+void LockContentionStats::AddWait(uint64_t address, uint64_t wait_ns,
+                                  CallstackID waiter_callstack,
+                                  CallstackID waker_callstack) {
+  absl::MutexLock lock{&mutex_};
+  LockStats& lock_stats = address_to_lock_stats_[address];
+  lock_stats.address = address;
+  ++lock_stats.count;
+  lock_stats.total_wait_ns += wait_ns;
+  lock_stats.max_wait_ns = std::max(lock_stats.max_wait_ns, wait_ns);
+  if (waiter_callstack != 0) {
+    lock_stats.wait_ns_per_waiter_callstack[waiter_callstack] += wait_ns;
+  }
+  if (waker_callstack != 0) {
+    lock_stats.wait_ns_per_waker_callstack[waker_callstack] += wait_ns;
+  }
+}
+
+std::vector<LockContentionStats::LockStats>
+LockContentionStats::GetLocksSortedByTotalWait() {
+  std::vector<LockStats> locks;
+  {
+    absl::MutexLock lock{&mutex_};
+    locks.reserve(address_to_lock_stats_.size());
+    for (const auto& [address, lock_stats] : address_to_lock_stats_) {
+      locks.push_back(lock_stats);
+    }
+  }
+  std::sort(locks.begin(), locks.end(),
+            [](const LockStats& lhs, const LockStats& rhs) {
+              return lhs.total_wait_ns > rhs.total_wait_ns;
+            });
+  return locks;
+}
+
+void LockContentionStats::Clear() {
+  absl::MutexLock lock{&mutex_};
+  address_to_lock_stats_.clear();
+}
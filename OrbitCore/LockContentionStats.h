@@ -0,0 +1,49 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_CORE_LOCK_CONTENTION_STATS_H_
+#define ORBIT_CORE_LOCK_CONTENTION_STATS_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "CallstackTypes.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+
+// Aggregates the time threads spent blocked on locks (futexes), per lock
+// address and, for each lock, per callstack of the waiting threads and per
+// callstack of the threads that woke them up. For a mutex, the latter is where
+// the holder released it.
+class LockContentionStats {
+ public:
+  struct LockStats {
+    uint64_t address = 0;
+    uint64_t count = 0;
+    uint64_t total_wait_ns = 0;
+    uint64_t max_wait_ns = 0;
+    absl::flat_hash_map<CallstackID, uint64_t> wait_ns_per_waiter_callstack;
+    absl::flat_hash_map<CallstackID, uint64_t> wait_ns_per_waker_callstack;
+
+    // Return 0 if no callstack is known.
+    CallstackID GetTopWaiterCallstack() const;
+    CallstackID GetTopWakerCallstack() const;
+  };
+
+  LockContentionStats() = default;
+
+  // waiter_callstack and waker_callstack can be 0 if unknown.
+  void AddWait(uint64_t address, uint64_t wait_ns, CallstackID waiter_callstack,
+               CallstackID waker_callstack);
+  // Returns a snapshot of the stats of all locks, sorted by decreasing total
+  // wait time.
+  std::vector<LockStats> GetLocksSortedByTotalWait();
+  void Clear();
+
+ private:
+  absl::flat_hash_map<uint64_t, LockStats> address_to_lock_stats_;
+  absl::Mutex mutex_;
+};
+
+#endif  // ORBIT_CORE_LOCK_CONTENTION_STATS_H_
@@ -0,0 +1,45 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+
+#include "LockContentionStats.h"
+
+TEST(LockContentionStats, Empty) {
+  LockContentionStats stats;
+  EXPECT_TRUE(stats.GetLocksSortedByTotalWait().empty());
+}
+
+TEST(LockContentionStats, AggregatesPerLock) {
+  LockContentionStats stats;
+  stats.AddWait(0x1000, 100, 1, 10);
+  stats.AddWait(0x2000, 500, 2, 0);
+  stats.AddWait(0x1000, 300, 3, 10);
+  stats.AddWait(0x1000, 50, 1, 11);
+
+  std::vector<LockContentionStats::LockStats> locks =
+      stats.GetLocksSortedByTotalWait();
+  ASSERT_EQ(locks.size(), 2);
+
+  EXPECT_EQ(locks[0].address, 0x2000);
+  EXPECT_EQ(locks[0].count, 1);
+  EXPECT_EQ(locks[0].total_wait_ns, 500);
+  EXPECT_EQ(locks[0].GetTopWaiterCallstack(), 2);
+  EXPECT_EQ(locks[0].GetTopWakerCallstack(), 0);
+
+  EXPECT_EQ(locks[1].address, 0x1000);
+  EXPECT_EQ(locks[1].count, 3);
+  EXPECT_EQ(locks[1].total_wait_ns, 450);
+  EXPECT_EQ(locks[1].max_wait_ns, 300);
+  EXPECT_EQ(locks[1].wait_ns_per_waiter_callstack.at(1), 150);
+  EXPECT_EQ(locks[1].GetTopWaiterCallstack(), 3);
+  EXPECT_EQ(locks[1].GetTopWakerCallstack(), 10);
+}
+
+TEST(LockContentionStats, Clear) {
+  LockContentionStats stats;
+  stats.AddWait(0x1000, 100, 1, 10);
+  stats.Clear();
+  EXPECT_TRUE(stats.GetLocksSortedByTotalWait().empty());
+}
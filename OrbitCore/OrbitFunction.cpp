@@ -70,12 +70,26 @@ void Function::Select() {
 
 void Function::UnSelect() {
   Capture::GSelectedFunctionsMap.erase(GetVirtualAddress());
+  Capture::GEntryCallstackFunctions.erase(GetVirtualAddress());
 }
 
 bool Function::IsSelected() const {
   return Capture::GSelectedFunctionsMap.count(GetVirtualAddress()) > 0;
 }
 
+void Function::SetRecordEntryCallstack(bool record_entry_callstack) {
+  if (record_entry_callstack) {
+    Capture::GEntryCallstackFunctions.insert(GetVirtualAddress());
+  } else {
+    Capture::GEntryCallstackFunctions.erase(GetVirtualAddress());
+  }
+}
+
+bool Function::RecordsEntryCallstack() const {
+  return IsSelected() &&
+         Capture::GEntryCallstackFunctions.count(GetVirtualAddress()) > 0;
+}
+
 void Function::ResetStats() {
   if (stats_ == nullptr) {
     stats_ = std::make_shared<FunctionStats>();
@@ -140,6 +140,9 @@ class Function {
   void Select();
   void UnSelect();
   bool IsSelected() const;
+  // Only has an effect on selected functions.
+  void SetRecordEntryCallstack(bool record_entry_callstack);
+  bool RecordsEntryCallstack() const;
 
   void SetId(uint32_t id) { id_ = id; }
   void SetParentId(uint32_t parent_id) { parent_id_ = parent_id; }
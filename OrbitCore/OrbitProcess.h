@@ -44,6 +44,14 @@ class Process {
   std::string GetThreadNameFromTID(DWORD a_ThreadId) {
     return m_ThreadNames[a_ThreadId];
   }
+  // Threads can belong to other processes in multi-process captures.
+  void SetThreadProcessId(int32_t thread_id, int32_t process_id) {
+    m_ThreadProcessIds[thread_id] = process_id;
+  }
+  int32_t GetProcessIdFromTID(int32_t thread_id) const {
+    auto it = m_ThreadProcessIds.find(thread_id);
+    return it != m_ThreadProcessIds.end() ? it->second : m_ID;
+  }
   void AddModule(std::shared_ptr<Module>& a_Module);
   void FindPdbs(const std::vector<std::string>& a_SearchLocations);
 
@@ -155,6 +163,7 @@ class Process {
   std::map<std::string, std::shared_ptr<Module>> m_NameToModuleMap;
   std::map<std::string, std::shared_ptr<Module>> path_to_module_map_;
   std::map<int32_t, std::string> m_ThreadNames;
+  std::map<int32_t, int32_t> m_ThreadProcessIds;
 
   // Transients
   std::vector<std::shared_ptr<Function>> m_Functions;
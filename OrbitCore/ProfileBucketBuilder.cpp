@@ -0,0 +1,147 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ProfileBucketBuilder.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "OrbitBase/Logging.h"
+#include "absl/container/flat_hash_set.h"
+
+void ProfileBucketBuilder::AddCallstackSamples(int32_t pid,
+                                               const Callstack& callstack,
+                                               uint64_t count) {
+  if (count == 0) {
+    return;
+  }
+  std::vector<uint64_t> pcs{callstack.pcs().begin(), callstack.pcs().end()};
+  callstack_counts_[std::make_pair(pid, std::move(pcs))] += count;
+  sample_count_ += count;
+}
+
+void ProfileBucketBuilder::AddAddressInfo(const AddressInfo& address_info) {
+  CHECK(address_info.function_name_or_key_case() ==
+        AddressInfo::kFunctionName);
+  CHECK(address_info.map_name_or_key_case() == AddressInfo::kMapName);
+  AddAddressSymbol(address_info.pid(), address_info.absolute_address(),
+                   {address_info.function_name(),
+                    address_info.offset_in_function(),
+                    address_info.map_name()});
+}
+
+void ProfileBucketBuilder::AddAddressSymbol(int32_t pid,
+                                            uint64_t absolute_address,
+                                            AddressSymbol symbol) {
+  // The first symbol information received for an address is kept.
+  address_symbols_.try_emplace(std::make_pair(pid, absolute_address),
+                               std::move(symbol));
+}
+
+void ProfileBucketBuilder::AddBucket(const ProfileBucket& bucket) {
+  for (const ProfileBucket::CallstackCount& callstack_count :
+       bucket.callstack_counts()) {
+    AddCallstackSamples(callstack_count.pid(), callstack_count.callstack(),
+                        callstack_count.count());
+  }
+
+  const auto& strings = bucket.strings();
+  for (const AddressInfo& address_info : bucket.address_infos()) {
+    uint64_t function_name_key = address_info.function_name_key();
+    uint64_t map_name_key = address_info.map_name_key();
+    if (function_name_key >= static_cast<uint64_t>(strings.size()) ||
+        map_name_key >= static_cast<uint64_t>(strings.size())) {
+      ERROR("Ignoring address info for %#lx with invalid string index",
+            address_info.absolute_address());
+      continue;
+    }
+    AddAddressSymbol(address_info.pid(), address_info.absolute_address(),
+                     {strings[function_name_key],
+                      address_info.offset_in_function(),
+                      strings[map_name_key]});
+  }
+}
+
+ProfileBucket ProfileBucketBuilder::Build(uint64_t begin_unix_time_ns,
+                                          uint64_t end_unix_time_ns) const {
+  ProfileBucket bucket;
+  bucket.set_begin_unix_time_ns(begin_unix_time_ns);
+  bucket.set_end_unix_time_ns(end_unix_time_ns);
+
+  std::vector<std::pair<const std::pair<int32_t, std::vector<uint64_t>>*,
+                        uint64_t>>
+      sorted_counts;
+  sorted_counts.reserve(callstack_counts_.size());
+  for (const auto& [pid_and_pcs, count] : callstack_counts_) {
+    sorted_counts.emplace_back(&pid_and_pcs, count);
+  }
+  // Ties are broken by pid and pcs so that the output is deterministic.
+  std::sort(sorted_counts.begin(), sorted_counts.end(),
+            [](const auto& lhs, const auto& rhs) {
+              if (lhs.second != rhs.second) return lhs.second > rhs.second;
+              return *lhs.first < *rhs.first;
+            });
+
+  // Pids and addresses.
+  std::vector<std::pair<int32_t, uint64_t>> addresses;
+  absl::flat_hash_set<std::pair<int32_t, uint64_t>> addresses_seen;
+  for (const auto& [pid_and_pcs, count] : sorted_counts) {
+    ProfileBucket::CallstackCount* callstack_count =
+        bucket.add_callstack_counts();
+    callstack_count->set_pid(pid_and_pcs->first);
+    for (uint64_t pc : pid_and_pcs->second) {
+      callstack_count->mutable_callstack()->add_pcs(pc);
+      if (addresses_seen.emplace(pid_and_pcs->first, pc).second) {
+        addresses.emplace_back(pid_and_pcs->first, pc);
+      }
+    }
+    callstack_count->set_count(count);
+  }
+  std::sort(addresses.begin(), addresses.end());
+
+  absl::flat_hash_map<std::string, uint64_t> string_indices;
+  auto get_string_index = [&bucket,
+                           &string_indices](const std::string& string) {
+    auto [it, inserted] =
+        string_indices.try_emplace(string, bucket.strings_size());
+    if (inserted) {
+      bucket.add_strings(string);
+    }
+    return it->second;
+  };
+
+  for (const std::pair<int32_t, uint64_t>& pid_and_address : addresses) {
+    auto symbol_it = address_symbols_.find(pid_and_address);
+    if (symbol_it == address_symbols_.end()) {
+      continue;
+    }
+    const AddressSymbol& symbol = symbol_it->second;
+    AddressInfo* address_info = bucket.add_address_infos();
+    address_info->set_pid(pid_and_address.first);
+    address_info->set_absolute_address(pid_and_address.second);
+    address_info->set_function_name_key(
+        get_string_index(symbol.function_name));
+    address_info->set_offset_in_function(symbol.offset_in_function);
+    address_info->set_map_name_key(get_string_index(symbol.map_name));
+  }
+
+  return bucket;
+}
+
+ProfileBucket MergeProfileBuckets(const std::vector<ProfileBucket>& buckets) {
+  if (buckets.empty()) {
+    return ProfileBucket{};
+  }
+
+  ProfileBucketBuilder builder;
+  uint64_t begin_unix_time_ns = std::numeric_limits<uint64_t>::max();
+  uint64_t end_unix_time_ns = 0;
+  for (const ProfileBucket& bucket : buckets) {
+    builder.AddBucket(bucket);
+    begin_unix_time_ns =
+        std::min(begin_unix_time_ns, bucket.begin_unix_time_ns());
+    end_unix_time_ns = std::max(end_unix_time_ns, bucket.end_unix_time_ns());
+  }
+  return builder.Build(begin_unix_time_ns, end_unix_time_ns);
+}
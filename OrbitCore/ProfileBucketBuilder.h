@@ -0,0 +1,66 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_CORE_PROFILE_BUCKET_BUILDER_H_
+#define ORBIT_CORE_PROFILE_BUCKET_BUILDER_H_
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "capture.pb.h"
+#include "profile.pb.h"
+
+// Accumulates callstack sample counts and the symbol information of their
+// addresses into a ProfileBucket. Identical callstacks of the same process are
+// counted once, and function and map names are stored once in the string
+// table. OrbitService uses this to aggregate samples, the client to merge the
+// buckets it fetched.
+class ProfileBucketBuilder {
+ public:
+  ProfileBucketBuilder() = default;
+
+  void AddCallstackSamples(int32_t pid, const Callstack& callstack,
+                           uint64_t count);
+  // address_info must have function_name and map_name set, as sent by the
+  // tracer. It only applies to the callstacks of the process it has the pid
+  // of.
+  void AddAddressInfo(const AddressInfo& address_info);
+  // Adds the counts and the symbol information of an existing bucket.
+  // Address infos referencing strings out of range are ignored.
+  void AddBucket(const ProfileBucket& bucket);
+
+  [[nodiscard]] bool IsEmpty() const { return callstack_counts_.empty(); }
+  [[nodiscard]] uint64_t GetSampleCount() const { return sample_count_; }
+
+  // Only the address infos of addresses that appear in a callstack are
+  // included. Callstacks are sorted by decreasing count.
+  [[nodiscard]] ProfileBucket Build(uint64_t begin_unix_time_ns,
+                                    uint64_t end_unix_time_ns) const;
+
+ private:
+  struct AddressSymbol {
+    std::string function_name;
+    uint64_t offset_in_function = 0;
+    std::string map_name;
+  };
+
+  void AddAddressSymbol(int32_t pid, uint64_t absolute_address,
+                        AddressSymbol symbol);
+
+  absl::flat_hash_map<std::pair<int32_t, std::vector<uint64_t>>, uint64_t>
+      callstack_counts_;
+  // Keyed by pid and absolute address.
+  absl::flat_hash_map<std::pair<int32_t, uint64_t>, AddressSymbol>
+      address_symbols_;
+  uint64_t sample_count_ = 0;
+};
+
+// Merges buckets, for example the ones of consecutive minutes or of several
+// hosts, into one bucket covering all their time ranges.
+ProfileBucket MergeProfileBuckets(const std::vector<ProfileBucket>& buckets);
+
+#endif  // ORBIT_CORE_PROFILE_BUCKET_BUILDER_H_
@@ -0,0 +1,133 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+
+#include "ProfileBucketBuilder.h"
+
+namespace {
+
+Callstack MakeCallstack(const std::vector<uint64_t>& pcs) {
+  Callstack callstack;
+  for (uint64_t pc : pcs) {
+    callstack.add_pcs(pc);
+  }
+  return callstack;
+}
+
+AddressInfo MakeAddressInfo(int32_t pid, uint64_t address,
+                            const std::string& function_name,
+                            const std::string& map_name) {
+  AddressInfo address_info;
+  address_info.set_pid(pid);
+  address_info.set_absolute_address(address);
+  address_info.set_function_name(function_name);
+  address_info.set_offset_in_function(4);
+  address_info.set_map_name(map_name);
+  return address_info;
+}
+
+}  // namespace
+
+TEST(ProfileBucketBuilder, CountsIdenticalCallstacksOnce) {
+  ProfileBucketBuilder builder;
+  EXPECT_TRUE(builder.IsEmpty());
+  builder.AddCallstackSamples(1, MakeCallstack({0x10, 0x20}), 1);
+  builder.AddCallstackSamples(1, MakeCallstack({0x10, 0x20}), 2);
+  builder.AddCallstackSamples(2, MakeCallstack({0x10, 0x20}), 1);
+  builder.AddCallstackSamples(1, MakeCallstack({0x30}), 0);
+  EXPECT_FALSE(builder.IsEmpty());
+  EXPECT_EQ(builder.GetSampleCount(), 4);
+
+  ProfileBucket bucket = builder.Build(100, 200);
+  EXPECT_EQ(bucket.begin_unix_time_ns(), 100);
+  EXPECT_EQ(bucket.end_unix_time_ns(), 200);
+  ASSERT_EQ(bucket.callstack_counts_size(), 2);
+  EXPECT_EQ(bucket.callstack_counts(0).pid(), 1);
+  EXPECT_EQ(bucket.callstack_counts(0).count(), 3);
+  ASSERT_EQ(bucket.callstack_counts(0).callstack().pcs_size(), 2);
+  EXPECT_EQ(bucket.callstack_counts(0).callstack().pcs(0), 0x10);
+  EXPECT_EQ(bucket.callstack_counts(1).pid(), 2);
+  EXPECT_EQ(bucket.callstack_counts(1).count(), 1);
+}
+
+TEST(ProfileBucketBuilder, StoresNamesOfUsedAddressesOnce) {
+  ProfileBucketBuilder builder;
+  builder.AddCallstackSamples(1, MakeCallstack({0x10, 0x20}), 1);
+  builder.AddAddressInfo(MakeAddressInfo(1, 0x10, "foo", "libfoo.so"));
+  builder.AddAddressInfo(MakeAddressInfo(1, 0x20, "bar", "libfoo.so"));
+  builder.AddAddressInfo(MakeAddressInfo(1, 0x30, "unused", "libfoo.so"));
+
+  ProfileBucket bucket = builder.Build(0, 1);
+  ASSERT_EQ(bucket.address_infos_size(), 2);
+  ASSERT_EQ(bucket.strings_size(), 3);
+  const AddressInfo& foo = bucket.address_infos(0);
+  EXPECT_EQ(foo.absolute_address(), 0x10);
+  EXPECT_EQ(bucket.strings(foo.function_name_key()), "foo");
+  EXPECT_EQ(bucket.strings(foo.map_name_key()), "libfoo.so");
+  EXPECT_EQ(foo.offset_in_function(), 4);
+  const AddressInfo& bar = bucket.address_infos(1);
+  EXPECT_EQ(bucket.strings(bar.function_name_key()), "bar");
+  EXPECT_EQ(bar.map_name_key(), foo.map_name_key());
+}
+
+TEST(ProfileBucketBuilder, KeepsNamesOfSameAddressInEachProcess) {
+  ProfileBucketBuilder builder;
+  builder.AddCallstackSamples(1, MakeCallstack({0x10}), 1);
+  builder.AddCallstackSamples(2, MakeCallstack({0x10}), 2);
+  builder.AddAddressInfo(MakeAddressInfo(1, 0x10, "foo", "foo"));
+  builder.AddAddressInfo(MakeAddressInfo(2, 0x10, "bar", "bar"));
+
+  ProfileBucket rebuilt = MergeProfileBuckets({builder.Build(0, 1)});
+  ASSERT_EQ(rebuilt.address_infos_size(), 2);
+  for (const AddressInfo& address_info : rebuilt.address_infos()) {
+    EXPECT_EQ(address_info.absolute_address(), 0x10);
+    EXPECT_EQ(rebuilt.strings(address_info.function_name_key()),
+              address_info.pid() == 1 ? "foo" : "bar");
+  }
+}
+
+TEST(ProfileBucketBuilder, MergeProfileBuckets) {
+  ProfileBucketBuilder first_builder;
+  first_builder.AddCallstackSamples(1, MakeCallstack({0x10}), 2);
+  first_builder.AddAddressInfo(MakeAddressInfo(1, 0x10, "foo", "libfoo.so"));
+  ProfileBucketBuilder second_builder;
+  second_builder.AddCallstackSamples(1, MakeCallstack({0x20}), 1);
+  second_builder.AddCallstackSamples(1, MakeCallstack({0x10}), 3);
+  second_builder.AddAddressInfo(MakeAddressInfo(1, 0x20, "bar", "libbar.so"));
+
+  ProfileBucket merged = MergeProfileBuckets(
+      {second_builder.Build(200, 300), first_builder.Build(100, 200)});
+  EXPECT_EQ(merged.begin_unix_time_ns(), 100);
+  EXPECT_EQ(merged.end_unix_time_ns(), 300);
+  ASSERT_EQ(merged.callstack_counts_size(), 2);
+  EXPECT_EQ(merged.callstack_counts(0).callstack().pcs(0), 0x10);
+  EXPECT_EQ(merged.callstack_counts(0).count(), 5);
+  EXPECT_EQ(merged.callstack_counts(1).callstack().pcs(0), 0x20);
+  EXPECT_EQ(merged.callstack_counts(1).count(), 1);
+  ASSERT_EQ(merged.address_infos_size(), 2);
+  EXPECT_EQ(merged.strings(merged.address_infos(0).function_name_key()),
+            "foo");
+  EXPECT_EQ(merged.strings(merged.address_infos(1).function_name_key()),
+            "bar");
+  EXPECT_EQ(merged.strings(merged.address_infos(1).map_name_key()),
+            "libbar.so");
+}
+
+TEST(ProfileBucketBuilder, IgnoresInvalidStringIndices) {
+  ProfileBucket bucket;
+  AddressInfo* address_info = bucket.add_address_infos();
+  address_info->set_absolute_address(0x10);
+  address_info->set_function_name_key(3);
+  ProfileBucket::CallstackCount* callstack_count =
+      bucket.add_callstack_counts();
+  *callstack_count->mutable_callstack() = MakeCallstack({0x10});
+  callstack_count->set_count(1);
+
+  ProfileBucketBuilder builder;
+  builder.AddBucket(bucket);
+  ProfileBucket rebuilt = builder.Build(0, 1);
+  EXPECT_EQ(rebuilt.callstack_counts_size(), 1);
+  EXPECT_EQ(rebuilt.address_infos_size(), 0);
+}
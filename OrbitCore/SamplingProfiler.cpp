@@ -7,6 +7,7 @@
 #include <map>
 #include <memory>
 #include <set>
+#include <utility>
 #include <vector>
 
 #include "Capture.h"
@@ -98,6 +99,18 @@ void SamplingProfiler::AddHashedCallStack(CallstackEvent& a_CallStack) {
   m_Callstacks.push_back(a_CallStack);
 }
 
+//-----------------------------------------------------------------------------
+void SamplingProfiler::AddHashedCallStacks(const CallstackEvent& a_CallStack,
+                                           uint64_t count) {
+  if (!HasCallStack(a_CallStack.m_Id)) {
+    ERROR("Callstacks can only be added by hash when already present.");
+    return;
+  }
+  ScopeLock lock(m_Mutex);
+  m_AggregatedCallstackCounts[a_CallStack.m_TID][a_CallStack.m_Id] += count;
+  m_NumAggregatedSamples += count;
+}
+
 //-----------------------------------------------------------------------------
 void SamplingProfiler::AddUniqueCallStack(CallStack& a_CallStack) {
   ScopeLock lock(m_Mutex);
@@ -194,6 +207,20 @@ void SamplingProfiler::ProcessSamples() {
     }
   }
 
+  for (const auto& [tid, callstack_counts] : m_AggregatedCallstackCounts) {
+    ThreadSampleData& threadSampleData = m_ThreadSampleData[tid];
+    for (const auto& [callstack_id, count] : callstack_counts) {
+      threadSampleData.m_NumSamples += count;
+      threadSampleData.m_CallstackCount[callstack_id] += count;
+
+      if (m_GenerateSummary) {
+        ThreadSampleData& threadSampleDataAll = m_ThreadSampleData[0];
+        threadSampleDataAll.m_NumSamples += count;
+        threadSampleDataAll.m_CallstackCount[callstack_id] += count;
+      }
+    }
+  }
+
   ResolveCallstacks();
 
   for (auto& dataIt : m_ThreadSampleData) {
@@ -238,7 +265,7 @@ void SamplingProfiler::ProcessSamples() {
 
   FillThreadSampleDataSampleReports();
 
-  m_NumSamples = m_Callstacks.size();
+  m_NumSamples = m_Callstacks.size() + m_NumAggregatedSamples;
 
   // Don't clear m_Callstacks, so that ProcessSamples can be called again, e.g.
   // when new callstacks have been added or after a module has been loaded.
@@ -286,17 +313,21 @@ void SamplingProfiler::ResolveCallstacks() {
     // A "resolved callstack" is a callstack where every address is replaced by
     // the start address of the function (if known).
     CallStack resolved_callstack = *callstack;
+    // The addresses are resolved in the process the callstack was taken in.
+    int32_t process_id = callstack->m_ProcessId;
+    std::unordered_map<uint64_t, uint64_t>& exact_address_to_function_address =
+        m_ExactAddressToFunctionAddress[process_id];
 
     for (uint32_t i = 0; i < callstack->m_Depth; ++i) {
       uint64_t addr = callstack->m_Data[i];
 
-      if (m_ExactAddressToFunctionAddress.find(addr) ==
-          m_ExactAddressToFunctionAddress.end()) {
-        UpdateAddressInfo(addr);
+      if (exact_address_to_function_address.find(addr) ==
+          exact_address_to_function_address.end()) {
+        UpdateAddressInfo(process_id, addr);
       }
 
-      auto addrIt = m_ExactAddressToFunctionAddress.find(addr);
-      if (addrIt != m_ExactAddressToFunctionAddress.end()) {
+      auto addrIt = exact_address_to_function_address.find(addr);
+      if (addrIt != exact_address_to_function_address.end()) {
         const uint64_t& functionAddr = addrIt->second;
         resolved_callstack.m_Data[i] = functionAddr;
         m_FunctionToCallstacks[functionAddr].insert(rawCallstackId);
@@ -316,11 +347,18 @@ void SamplingProfiler::ResolveCallstacks() {
 }
 
 //-----------------------------------------------------------------------------
-void SamplingProfiler::UpdateAddressInfo(uint64_t address) {
+void SamplingProfiler::UpdateAddressInfo(int32_t process_id,
+                                         uint64_t address) {
   ScopeLock lock(m_Mutex);
 
-  LinuxAddressInfo* address_info = Capture::GetAddressInfo(address);
-  Function* function = m_Process->GetFunctionFromAddress(address, false);
+  LinuxAddressInfo* address_info =
+      Capture::GetAddressInfo(process_id, address);
+  // The modules of m_Process only describe the addresses of that process.
+  // Callstacks without a process id predate it and are of m_Process.
+  Function* function = nullptr;
+  if (process_id == 0 || process_id == m_Process->GetID()) {
+    function = m_Process->GetFunctionFromAddress(address, false);
+  }
 
   // Find the start address of the function this address falls inside.
   // Use the Function returned by Process::GetFunctionFromAddress, and
@@ -348,7 +386,7 @@ void SamplingProfiler::UpdateAddressInfo(uint64_t address) {
     address_info->function_name = function->PrettyName();
   }
 
-  m_ExactAddressToFunctionAddress[address] = function_address;
+  m_ExactAddressToFunctionAddress[process_id][address] = function_address;
 
   Capture::GAddressToFunctionName[address] = function_name;
   Capture::GAddressToFunctionName[function_address] = function_name;
@@ -428,7 +466,7 @@ ORBIT_SERIALIZE_WSTRING(SampledFunction, 0) {
 }
 
 //-----------------------------------------------------------------------------
-ORBIT_SERIALIZE_WSTRING(SamplingProfiler, 3) {
+ORBIT_SERIALIZE_WSTRING(SamplingProfiler, 4) {
   ORBIT_NVP_VAL(0, m_PeriodMs);
   ORBIT_NVP_VAL(0, m_NumSamples);
   ORBIT_NVP_DEBUG(0, m_ThreadSampleData);
@@ -436,7 +474,15 @@ ORBIT_SERIALIZE_WSTRING(SamplingProfiler, 3) {
   ORBIT_NVP_DEBUG(0, m_UniqueResolvedCallstacks);
   ORBIT_NVP_DEBUG(0, m_OriginalCallstackToResolvedCallstack);
   ORBIT_NVP_DEBUG(0, m_FunctionToCallstacks);
-  ORBIT_NVP_DEBUG(0, m_ExactAddressToFunctionAddress);
+  if (a_Version >= 4) {
+    ORBIT_NVP_DEBUG(4, m_ExactAddressToFunctionAddress);
+  } else {
+    // Older captures have no process ids, which is what process id 0 means.
+    std::unordered_map<uint64_t, uint64_t> exact_address_to_function_address;
+    ORBIT_NVP_DEBUG(0, exact_address_to_function_address);
+    m_ExactAddressToFunctionAddress[0] =
+        std::move(exact_address_to_function_address);
+  }
 }
 
 //-----------------------------------------------------------------------------
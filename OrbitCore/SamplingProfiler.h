@@ -100,6 +100,9 @@ class SamplingProfiler {
 
   void AddCallStack(CallStack& a_CallStack);
   void AddHashedCallStack(CallstackEvent& a_CallStack);
+  // Adds count samples of the callstack on the thread of a_CallStack at once,
+  // for samples aggregated by the service.
+  void AddHashedCallStacks(const CallstackEvent& a_CallStack, uint64_t count);
   void AddUniqueCallStack(CallStack& a_CallStack);
 
   std::shared_ptr<CallStack> GetCallStack(CallstackID a_ID) {
@@ -148,7 +151,7 @@ class SamplingProfiler {
   void SortByThreadUsage();
   void SortByThreadID();
   void ProcessSamples();
-  void UpdateAddressInfo(uint64_t address);
+  void UpdateAddressInfo(int32_t process_id, uint64_t address);
 
   const ThreadSampleData& GetSummary() { return m_ThreadSampleData[0]; }
 
@@ -176,6 +179,10 @@ class SamplingProfiler {
 
   // Filled before ProcessSamples by AddCallstack, AddHashedCallstack.
   BlockChain<CallstackEvent, 16 * 1024> m_Callstacks;
+  // Filled by AddHashedCallStacks: count per callstack per thread.
+  std::unordered_map<ThreadID, std::unordered_map<CallstackID, unsigned int>>
+      m_AggregatedCallstackCounts;
+  uint64_t m_NumAggregatedSamples = 0;
   std::unordered_map<CallstackID, std::shared_ptr<CallStack>>
       m_UniqueCallstacks;
 
@@ -186,6 +193,8 @@ class SamplingProfiler {
   std::unordered_map<CallstackID, CallstackID>
       m_OriginalCallstackToResolvedCallstack;
   std::unordered_map<uint64_t, std::set<CallstackID>> m_FunctionToCallstacks;
-  std::unordered_map<uint64_t, uint64_t> m_ExactAddressToFunctionAddress;
+  // Keyed by process id, then by address.
+  std::unordered_map<int32_t, std::unordered_map<uint64_t, uint64_t>>
+      m_ExactAddressToFunctionAddress;
   std::vector<ThreadSampleData*> m_SortedThreadSampleData;
 };
@@ -65,6 +65,10 @@ class Timer {
     FREE,
     INTROSPECTION,
     GPU_ACTIVITY,
+    SYSCALL,
+    LOCK_WAIT,
+    COUNTER,
+    LOST_EVENTS,
   };
 
   Type GetType() const { return m_Type; }
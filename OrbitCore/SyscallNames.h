@@ -0,0 +1,13 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Returns the name of the syscall with the given number in the x86_64 Linux
+// syscall table, or "syscall_<number>" if the number is unknown. The table is
+// compiled in as the client does not necessarily run on Linux.
+std::string GetSyscallName(int64_t syscall_number);
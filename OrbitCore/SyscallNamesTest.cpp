@@ -0,0 +1,23 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+
+#include "SyscallNames.h"
+
+TEST(SyscallNames, KnownSyscalls) {
+  EXPECT_EQ(GetSyscallName(0), "read");
+  EXPECT_EQ(GetSyscallName(1), "write");
+  EXPECT_EQ(GetSyscallName(202), "futex");
+  EXPECT_EQ(GetSyscallName(334), "rseq");
+  EXPECT_EQ(GetSyscallName(424), "pidfd_send_signal");
+  EXPECT_EQ(GetSyscallName(435), "clone3");
+}
+
+TEST(SyscallNames, UnknownSyscalls) {
+  EXPECT_EQ(GetSyscallName(-1), "syscall_-1");
+  EXPECT_EQ(GetSyscallName(335), "syscall_335");
+  EXPECT_EQ(GetSyscallName(423), "syscall_423");
+  EXPECT_EQ(GetSyscallName(100000), "syscall_100000");
+}
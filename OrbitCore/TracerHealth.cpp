@@ -0,0 +1,82 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "TracerHealth.h"
+
+#include <algorithm>
+
+namespace {
+void Accumulate(const TracerStats& window, TracerStats* capture) {
+  capture->set_timestamp_ns(window.timestamp_ns());
+  capture->set_window_ns(capture->window_ns() + window.window_ns());
+  capture->set_sched_switch_count(capture->sched_switch_count() +
+                                  window.sched_switch_count());
+  capture->set_sample_count(capture->sample_count() + window.sample_count());
+  capture->set_uprobes_count(capture->uprobes_count() +
+                             window.uprobes_count());
+  capture->set_gpu_events_count(capture->gpu_events_count() +
+                                window.gpu_events_count());
+  capture->set_syscalls_count(capture->syscalls_count() +
+                              window.syscalls_count());
+  capture->set_futex_count(capture->futex_count() + window.futex_count());
+  capture->set_lost_count(capture->lost_count() + window.lost_count());
+  for (const TracerStats::LostRecords& window_lost : window.lost_per_buffer()) {
+    auto capture_lost_it = std::find_if(
+        capture->mutable_lost_per_buffer()->begin(),
+        capture->mutable_lost_per_buffer()->end(),
+        [&window_lost](const TracerStats::LostRecords& capture_lost) {
+          return capture_lost.buffer_name() == window_lost.buffer_name();
+        });
+    if (capture_lost_it == capture->mutable_lost_per_buffer()->end()) {
+      *capture->add_lost_per_buffer() = window_lost;
+    } else {
+      capture_lost_it->set_count(capture_lost_it->count() +
+                                 window_lost.count());
+    }
+  }
+  capture->set_unwind_error_count(capture->unwind_error_count() +
+                                  window.unwind_error_count());
+  capture->set_discarded_samples_in_uretprobes_count(
+      capture->discarded_samples_in_uretprobes_count() +
+      window.discarded_samples_in_uretprobes_count());
+  capture->set_max_deferred_events_count(
+      std::max(capture->max_deferred_events_count(),
+               window.max_deferred_events_count()));
+  capture->set_max_processing_lag_ns(std::max(capture->max_processing_lag_ns(),
+                                              window.max_processing_lag_ns()));
+  capture->set_tracer_thread_cpu_time_ns(capture->tracer_thread_cpu_time_ns() +
+                                         window.tracer_thread_cpu_time_ns());
+  capture->set_processing_thread_cpu_time_ns(
+      capture->processing_thread_cpu_time_ns() +
+      window.processing_thread_cpu_time_ns());
+  capture->set_sender_dropped_count(capture->sender_dropped_count() +
+                                    window.sender_dropped_count());
+}
+}  // namespace
+
+void TracerHealth::AddTracerStats(const TracerStats& tracer_stats) {
+  absl::MutexLock lock{&mutex_};
+  last_tracer_stats_ = tracer_stats;
+  if (!capture_tracer_stats_.has_value()) {
+    capture_tracer_stats_ = tracer_stats;
+  } else {
+    Accumulate(tracer_stats, &capture_tracer_stats_.value());
+  }
+}
+
+std::optional<TracerStats> TracerHealth::GetLastTracerStats() {
+  absl::MutexLock lock{&mutex_};
+  return last_tracer_stats_;
+}
+
+std::optional<TracerStats> TracerHealth::GetCaptureTracerStats() {
+  absl::MutexLock lock{&mutex_};
+  return capture_tracer_stats_;
+}
+
+void TracerHealth::Clear() {
+  absl::MutexLock lock{&mutex_};
+  last_tracer_stats_.reset();
+  capture_tracer_stats_.reset();
+}
@@ -0,0 +1,32 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_CORE_TRACER_HEALTH_H_
+#define ORBIT_CORE_TRACER_HEALTH_H_
+
+#include <optional>
+
+#include "absl/synchronization/mutex.h"
+#include "capture.pb.h"
+
+// Keeps the TracerStats periodically sent by the service during a capture:
+// the ones of the last window, and their aggregation over the whole capture.
+class TracerHealth {
+ public:
+  TracerHealth() = default;
+
+  void AddTracerStats(const TracerStats& tracer_stats);
+  std::optional<TracerStats> GetLastTracerStats();
+  // Counts and CPU times are summed over all windows, maximums are the
+  // maximums over all windows. Lost records are merged by buffer name.
+  std::optional<TracerStats> GetCaptureTracerStats();
+  void Clear();
+
+ private:
+  std::optional<TracerStats> last_tracer_stats_;
+  std::optional<TracerStats> capture_tracer_stats_;
+  absl::Mutex mutex_;
+};
+
+#endif  // ORBIT_CORE_TRACER_HEALTH_H_
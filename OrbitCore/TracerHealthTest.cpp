@@ -0,0 +1,80 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+
+#include "TracerHealth.h"
+
+namespace {
+TracerStats CreateTracerStats(uint64_t timestamp_ns, uint64_t sample_count,
+                              uint64_t max_processing_lag_ns) {
+  TracerStats tracer_stats;
+  tracer_stats.set_timestamp_ns(timestamp_ns);
+  tracer_stats.set_window_ns(1'000'000'000);
+  tracer_stats.set_sample_count(sample_count);
+  tracer_stats.set_max_processing_lag_ns(max_processing_lag_ns);
+  tracer_stats.set_tracer_thread_cpu_time_ns(10'000'000);
+  return tracer_stats;
+}
+}  // namespace
+
+TEST(TracerHealth, Empty) {
+  TracerHealth tracer_health;
+  EXPECT_FALSE(tracer_health.GetLastTracerStats().has_value());
+  EXPECT_FALSE(tracer_health.GetCaptureTracerStats().has_value());
+}
+
+TEST(TracerHealth, AccumulatesWindows) {
+  TracerHealth tracer_health;
+  tracer_health.AddTracerStats(CreateTracerStats(1'000, 100, 5'000));
+  tracer_health.AddTracerStats(CreateTracerStats(2'000, 300, 2'000));
+
+  std::optional<TracerStats> last = tracer_health.GetLastTracerStats();
+  ASSERT_TRUE(last.has_value());
+  EXPECT_EQ(last->timestamp_ns(), 2'000);
+  EXPECT_EQ(last->sample_count(), 300);
+  EXPECT_EQ(last->max_processing_lag_ns(), 2'000);
+
+  std::optional<TracerStats> capture = tracer_health.GetCaptureTracerStats();
+  ASSERT_TRUE(capture.has_value());
+  EXPECT_EQ(capture->timestamp_ns(), 2'000);
+  EXPECT_EQ(capture->window_ns(), 2'000'000'000);
+  EXPECT_EQ(capture->sample_count(), 400);
+  EXPECT_EQ(capture->max_processing_lag_ns(), 5'000);
+  EXPECT_EQ(capture->tracer_thread_cpu_time_ns(), 20'000'000);
+}
+
+TEST(TracerHealth, MergesLostRecordsByBuffer) {
+  TracerHealth tracer_health;
+  TracerStats first = CreateTracerStats(1'000, 0, 0);
+  TracerStats::LostRecords* lost = first.add_lost_per_buffer();
+  lost->set_buffer_name("sampling_0");
+  lost->set_count(10);
+  tracer_health.AddTracerStats(first);
+
+  TracerStats second = CreateTracerStats(2'000, 0, 0);
+  lost = second.add_lost_per_buffer();
+  lost->set_buffer_name("sampling_0");
+  lost->set_count(5);
+  lost = second.add_lost_per_buffer();
+  lost->set_buffer_name("uprobes_1");
+  lost->set_count(1);
+  tracer_health.AddTracerStats(second);
+
+  std::optional<TracerStats> capture = tracer_health.GetCaptureTracerStats();
+  ASSERT_TRUE(capture.has_value());
+  ASSERT_EQ(capture->lost_per_buffer_size(), 2);
+  EXPECT_EQ(capture->lost_per_buffer(0).buffer_name(), "sampling_0");
+  EXPECT_EQ(capture->lost_per_buffer(0).count(), 15);
+  EXPECT_EQ(capture->lost_per_buffer(1).buffer_name(), "uprobes_1");
+  EXPECT_EQ(capture->lost_per_buffer(1).count(), 1);
+}
+
+TEST(TracerHealth, Clear) {
+  TracerHealth tracer_health;
+  tracer_health.AddTracerStats(CreateTracerStats(1'000, 100, 0));
+  tracer_health.Clear();
+  EXPECT_FALSE(tracer_health.GetLastTracerStats().has_value());
+  EXPECT_FALSE(tracer_health.GetCaptureTracerStats().has_value());
+}
@@ -15,6 +15,7 @@
 #include <utility>
 
 #include "CallStackDataView.h"
+#include "CallersDataView.h"
 #include "Callstack.h"
 #include "Capture.h"
 #include "CaptureListener.h"
@@ -34,6 +35,7 @@
 #include "LinuxCallstackEvent.h"
 #include "LiveFunctionsDataView.h"
 #include "Log.h"
+#include "LockContentionDataView.h"
 #include "LogDataView.h"
 #include "ModulesDataView.h"
 #include "OrbitBase/Logging.h"
@@ -49,12 +51,14 @@
 #include "ScopeTimer.h"
 #include "SessionsDataView.h"
 #include "StringManager.h"
+#include "SyscallsDataView.h"
 #include "Systrace.h"
 #include "Tcp.h"
 #include "TcpClient.h"
 #include "TcpServer.h"
 #include "TextRenderer.h"
 #include "TimerManager.h"
+#include "TracerHealthDataView.h"
 #include "TypesDataView.h"
 #include "Utils.h"
 #include "Version.h"
@@ -143,8 +147,9 @@ void OrbitApp::ProcessHashedSamplingCallStack(CallstackEvent& a_CallStack) {
 
 //-----------------------------------------------------------------------------
 void OrbitApp::AddAddressInfo(LinuxAddressInfo address_info) {
+  int32_t process_id = address_info.process_id;
   uint64_t address = address_info.address;
-  Capture::GAddressInfos.emplace(address, std::move(address_info));
+  Capture::GAddressInfos[process_id].emplace(address, std::move(address_info));
 }
 
 //-----------------------------------------------------------------------------
@@ -172,7 +177,20 @@ void OrbitApp::OnCallstackEvent(CallstackEvent callstack_event) {
   ProcessHashedSamplingCallStack(callstack_event);
 }
 
-void OrbitApp::OnThreadName(int32_t thread_id, std::string thread_name) {
+void OrbitApp::OnAggregatedCallstackEvents(CallstackEvent callstack_event,
+                                           uint64_t count) {
+  if (Capture::GSamplingProfiler == nullptr) {
+    ERROR("GSamplingProfiler is null, ignoring aggregated callstack events.");
+    return;
+  }
+  // Aggregated samples have no individual timestamps, so they are not shown in
+  // the timeline, only in the sampling report.
+  Capture::GSamplingProfiler->AddHashedCallStacks(callstack_event, count);
+}
+
+void OrbitApp::OnThreadName(int32_t process_id, int32_t thread_id,
+                            std::string thread_name) {
+  Capture::GTargetProcess->SetThreadProcessId(thread_id, process_id);
   UpdateThreadName(thread_id, thread_name);
 }
 
@@ -180,6 +198,28 @@ void OrbitApp::OnAddressInfo(LinuxAddressInfo address_info) {
   AddAddressInfo(std::move(address_info));
 }
 
+void OrbitApp::OnTracerStats(TracerStats tracer_stats) {
+  Capture::GTracerHealth.AddTracerStats(tracer_stats);
+}
+
+void OrbitApp::OnFunctionInstrumentationDisabled(
+    FunctionInstrumentationDisabled function_instrumentation_disabled) {
+  uint64_t address = function_instrumentation_disabled.absolute_address();
+  std::string function_name = absl::StrFormat("%#x", address);
+  auto function_it = Capture::GSelectedFunctionsMap.find(address);
+  if (function_it != Capture::GSelectedFunctionsMap.end()) {
+    function_name = function_it->second->PrettyName();
+  }
+  SendInfoToUi(
+      "Instrumentation disabled",
+      absl::StrFormat("Function \"%s\" was called %u times per second, more "
+                      "than the limit. It is no longer instrumented for the "
+                      "rest of the capture, and the calls in progress at that "
+                      "time were dropped.",
+                      function_name,
+                      function_instrumentation_disabled.calls_per_second()));
+}
+
 //-----------------------------------------------------------------------------
 void OrbitApp::OnValidateFramePointers(
     std::vector<std::shared_ptr<Module>> modules_to_validate) {
@@ -1072,6 +1112,34 @@ DataView* OrbitApp::GetOrCreateDataView(DataViewType type) {
       }
       return m_LogDataView.get();
 
+    case DataViewType::SYSCALLS:
+      if (!m_SyscallsDataView) {
+        m_SyscallsDataView = std::make_unique<SyscallsDataView>();
+        m_Panels.push_back(m_SyscallsDataView.get());
+      }
+      return m_SyscallsDataView.get();
+
+    case DataViewType::LOCK_CONTENTION:
+      if (!m_LockContentionDataView) {
+        m_LockContentionDataView = std::make_unique<LockContentionDataView>();
+        m_Panels.push_back(m_LockContentionDataView.get());
+      }
+      return m_LockContentionDataView.get();
+
+    case DataViewType::CALLERS:
+      if (!m_CallersDataView) {
+        m_CallersDataView = std::make_unique<CallersDataView>();
+        m_Panels.push_back(m_CallersDataView.get());
+      }
+      return m_CallersDataView.get();
+
+    case DataViewType::TRACER_HEALTH:
+      if (!m_TracerHealthDataView) {
+        m_TracerHealthDataView = std::make_unique<TracerHealthDataView>();
+        m_Panels.push_back(m_TracerHealthDataView.get());
+      }
+      return m_TracerHealthDataView.get();
+
     case DataViewType::SAMPLING:
       FATAL(
           "DataViewType::SAMPLING Data View construction is not supported by"
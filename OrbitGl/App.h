@@ -14,6 +14,7 @@
 
 #include "ApplicationOptions.h"
 #include "CallStackDataView.h"
+#include "CallersDataView.h"
 #include "CaptureClient.h"
 #include "CaptureListener.h"
 #include "ContextSwitch.h"
@@ -26,6 +27,7 @@
 #include "FunctionsDataView.h"
 #include "GlobalsDataView.h"
 #include "LiveFunctionsDataView.h"
+#include "LockContentionDataView.h"
 #include "LogDataView.h"
 #include "Message.h"
 #include "ModulesDataView.h"
@@ -37,7 +39,9 @@
 #include "SessionsDataView.h"
 #include "StringManager.h"
 #include "SymbolHelper.h"
+#include "SyscallsDataView.h"
 #include "Threading.h"
+#include "TracerHealthDataView.h"
 #include "TypesDataView.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
@@ -100,8 +104,15 @@ class OrbitApp final : public CoreApp,
   void OnKeyAndString(uint64_t key, std::string str) override;
   void OnCallstack(CallStack callstack) override;
   void OnCallstackEvent(CallstackEvent callstack_event) override;
-  void OnThreadName(int32_t thread_id, std::string thread_name) override;
+  void OnAggregatedCallstackEvents(CallstackEvent callstack_event,
+                                   uint64_t count) override;
+  void OnThreadName(int32_t process_id, int32_t thread_id,
+                    std::string thread_name) override;
   void OnAddressInfo(LinuxAddressInfo address_info) override;
+  void OnTracerStats(TracerStats tracer_stats) override;
+  void OnFunctionInstrumentationDisabled(
+      FunctionInstrumentationDisabled function_instrumentation_disabled)
+      override;
 
   void OnValidateFramePointers(
       std::vector<std::shared_ptr<Module>> modules_to_validate);
@@ -247,6 +258,10 @@ class OrbitApp final : public CoreApp,
   std::unique_ptr<GlobalsDataView> m_GlobalsDataView;
   std::unique_ptr<PresetsDataView> m_PresetsDataView;
   std::unique_ptr<LogDataView> m_LogDataView;
+  std::unique_ptr<SyscallsDataView> m_SyscallsDataView;
+  std::unique_ptr<LockContentionDataView> m_LockContentionDataView;
+  std::unique_ptr<CallersDataView> m_CallersDataView;
+  std::unique_ptr<TracerHealthDataView> m_TracerHealthDataView;
 
   CaptureWindow* m_CaptureWindow = nullptr;
 
@@ -221,10 +221,14 @@ CallStackDataView::CallStackDataViewFrame CallStackDataView::GetFrameFromIndex(
   }
 
   uint64_t address = m_CallStack->m_Data[index_in_callstack];
+  int32_t process_id = m_CallStack->m_ProcessId;
   Function* function = nullptr;
   std::shared_ptr<Module> module = nullptr;
 
-  if (Capture::GTargetProcess != nullptr) {
+  // The modules of the target process don't describe the addresses of other
+  // processes.
+  if (Capture::GTargetProcess != nullptr &&
+      (process_id == 0 || process_id == Capture::GTargetProcess->GetID())) {
     ScopeLock lock(Capture::GTargetProcess->GetDataMutex());
     function = Capture::GTargetProcess->GetFunctionFromAddress(address, false);
     module = Capture::GTargetProcess->GetModuleFromAddress(address);
@@ -234,7 +238,11 @@ CallStackDataView::CallStackDataViewFrame CallStackDataView::GetFrameFromIndex(
     return CallStackDataViewFrame(address, function, module);
   } else {
     std::string fallback_name;
-    if (Capture::GSamplingProfiler != nullptr) {
+    LinuxAddressInfo* address_info =
+        Capture::GetAddressInfo(process_id, address);
+    if (address_info != nullptr && !address_info->function_name.empty()) {
+      fallback_name = address_info->function_name;
+    } else if (Capture::GSamplingProfiler != nullptr) {
       fallback_name = Capture::GAddressToFunctionName[address];
     }
     return CallStackDataViewFrame(address, fallback_name, module);
@@ -0,0 +1,297 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "CallersDataView.h"
+
+#include "App.h"
+#include "Callstack.h"
+#include "Capture.h"
+#include "Core.h"
+#include "OrbitFunction.h"
+#include "SamplingProfiler.h"
+#include "Utils.h"
+#include "absl/container/flat_hash_map.h"
+
+//-----------------------------------------------------------------------------
+CallersDataView::CallersDataView() : DataView(DataViewType::CALLERS) {
+  m_UpdatePeriodMs = 300;
+  OnDataChanged();
+}
+
+//-----------------------------------------------------------------------------
+const std::vector<DataView::Column>& CallersDataView::GetColumns() {
+  static const std::vector<Column> columns = [] {
+    std::vector<Column> columns;
+    columns.resize(COLUMN_NUM);
+    columns[COLUMN_FUNCTION] = {"Function", .3f, SortingOrder::Ascending};
+    columns[COLUMN_CALLER] = {"Caller", .3f, SortingOrder::Ascending};
+    columns[COLUMN_COUNT] = {"Calls", .0f, SortingOrder::Descending};
+    columns[COLUMN_TIME_TOTAL] = {"Total", .0f, SortingOrder::Descending};
+    columns[COLUMN_TIME_AVG] = {"Avg", .0f, SortingOrder::Descending};
+    columns[COLUMN_PERCENTAGE] = {"% of function", .0f,
+                                  SortingOrder::Descending};
+    return columns;
+  }();
+  return columns;
+}
+
+//-----------------------------------------------------------------------------
+std::string CallersDataView::GetValue(int a_Row, int a_Column) {
+  if (a_Row >= static_cast<int>(GetNumElements())) {
+    return "";
+  }
+
+  const Caller& caller = GetCaller(a_Row);
+  constexpr double kNsPerMs = 1'000'000.0;
+
+  switch (a_Column) {
+    case COLUMN_FUNCTION:
+      return caller.function_name;
+    case COLUMN_CALLER:
+      return caller.caller_name;
+    case COLUMN_COUNT:
+      return absl::StrFormat("%lu", caller.count);
+    case COLUMN_TIME_TOTAL:
+      return GetPrettyTime(caller.total_time_ns / kNsPerMs);
+    case COLUMN_TIME_AVG:
+      return GetPrettyTime(
+          caller.count > 0 ? caller.total_time_ns / kNsPerMs / caller.count
+                           : 0);
+    case COLUMN_PERCENTAGE:
+      return absl::StrFormat(
+          "%.2f", caller.function_total_time_ns > 0
+                      ? 100.0 * caller.total_time_ns /
+                            caller.function_total_time_ns
+                      : 0);
+    default:
+      return "";
+  }
+}
+
+//-----------------------------------------------------------------------------
+#define ORBIT_CALLER_SORT(Member)                                         \
+  [&](int a, int b) {                                                     \
+    return OrbitUtils::Compare(callers[a].Member, callers[b].Member,      \
+                               ascending);                                \
+  }
+
+//-----------------------------------------------------------------------------
+void CallersDataView::DoSort() {
+  bool ascending = m_SortingOrders[m_SortingColumn] == SortingOrder::Ascending;
+  std::function<bool(int a, int b)> sorter = nullptr;
+
+  const std::vector<Caller>& callers = m_Callers;
+
+  switch (m_SortingColumn) {
+    case COLUMN_FUNCTION:
+      sorter = ORBIT_CALLER_SORT(function_name);
+      break;
+    case COLUMN_CALLER:
+      sorter = ORBIT_CALLER_SORT(caller_name);
+      break;
+    case COLUMN_COUNT:
+      sorter = ORBIT_CALLER_SORT(count);
+      break;
+    case COLUMN_TIME_TOTAL:
+      sorter = ORBIT_CALLER_SORT(total_time_ns);
+      break;
+    case COLUMN_TIME_AVG:
+      sorter = [&](int a, int b) {
+        return OrbitUtils::Compare(
+            static_cast<double>(callers[a].total_time_ns) / callers[a].count,
+            static_cast<double>(callers[b].total_time_ns) / callers[b].count,
+            ascending);
+      };
+      break;
+    case COLUMN_PERCENTAGE:
+      sorter = [&](int a, int b) {
+        return OrbitUtils::Compare(
+            static_cast<double>(callers[a].total_time_ns) /
+                callers[a].function_total_time_ns,
+            static_cast<double>(callers[b].total_time_ns) /
+                callers[b].function_total_time_ns,
+            ascending);
+      };
+      break;
+    default:
+      break;
+  }
+
+  if (sorter) {
+    std::stable_sort(m_Indices.begin(), m_Indices.end(), sorter);
+  }
+}
+
+//-----------------------------------------------------------------------------
+const std::string CallersDataView::MENU_ACTION_SHOW_TOP_CALLSTACK =
+    "Show top callstack";
+
+//-----------------------------------------------------------------------------
+std::vector<std::string> CallersDataView::GetContextMenu(
+    int a_ClickedIndex, const std::vector<int>& a_SelectedIndices) {
+  std::vector<std::string> menu;
+  if (GetCaller(a_ClickedIndex).top_callstack_id != 0) {
+    menu.emplace_back(MENU_ACTION_SHOW_TOP_CALLSTACK);
+  }
+  Append(menu, DataView::GetContextMenu(a_ClickedIndex, a_SelectedIndices));
+  return menu;
+}
+
+//-----------------------------------------------------------------------------
+void CallersDataView::OnContextMenu(const std::string& a_Action,
+                                    int a_MenuIndex,
+                                    const std::vector<int>& a_ItemIndices) {
+  if (a_Action == MENU_ACTION_SHOW_TOP_CALLSTACK) {
+    if (!a_ItemIndices.empty()) {
+      ShowCallstack(GetCaller(a_ItemIndices[0]).top_callstack_id);
+    }
+  } else {
+    DataView::OnContextMenu(a_Action, a_MenuIndex, a_ItemIndices);
+  }
+}
+
+//-----------------------------------------------------------------------------
+void CallersDataView::OnSelect(int a_Index) {
+  ShowCallstack(GetCaller(a_Index).top_callstack_id);
+}
+
+//-----------------------------------------------------------------------------
+void CallersDataView::ShowCallstack(CallstackID callstack_id) {
+  if (callstack_id == 0 || Capture::GSamplingProfiler == nullptr ||
+      !Capture::GSamplingProfiler->HasCallStack(callstack_id)) {
+    return;
+  }
+  GOrbitApp->SetCallStack(
+      Capture::GSamplingProfiler->GetCallStack(callstack_id));
+}
+
+//-----------------------------------------------------------------------------
+void CallersDataView::DoFilter() {
+  std::vector<uint32_t> indices;
+
+  std::vector<std::string> tokens = absl::StrSplit(ToLower(m_Filter), ' ');
+
+  for (size_t i = 0; i < m_Callers.size(); ++i) {
+    std::string name = ToLower(
+        absl::StrFormat("%s %s", m_Callers[i].function_name,
+                        m_Callers[i].caller_name));
+
+    bool match = true;
+
+    for (std::string& filterToken : tokens) {
+      if (name.find(filterToken) == std::string::npos) {
+        match = false;
+        break;
+      }
+    }
+
+    if (match) {
+      indices.push_back(i);
+    }
+  }
+
+  m_Indices = indices;
+
+  OnSort(m_SortingColumn, {});
+}
+
+namespace {
+// Returns the address of the function containing address, or address itself
+// if the function is not known, together with a name to display.
+std::pair<uint64_t, std::string> GetFunctionAddressAndName(uint64_t address) {
+  if (Capture::GTargetProcess != nullptr) {
+    ScopeLock lock(Capture::GTargetProcess->GetDataMutex());
+    Function* function =
+        Capture::GTargetProcess->GetFunctionFromAddress(address, false);
+    if (function != nullptr) {
+      return {function->GetVirtualAddress(), function->PrettyName()};
+    }
+  }
+  auto name_it = Capture::GAddressToFunctionName.find(address);
+  if (name_it != Capture::GAddressToFunctionName.end()) {
+    return {address, name_it->second};
+  }
+  return {address, absl::StrFormat("%#llx", address)};
+}
+}  // namespace
+
+//-----------------------------------------------------------------------------
+void CallersDataView::UpdateCallers() {
+  m_Callers.clear();
+  if (Capture::GSamplingProfiler == nullptr) {
+    return;
+  }
+
+  // Group the entry callstacks of each function by the function they return
+  // to. The first frame is the instrumented function itself.
+  absl::flat_hash_map<std::pair<uint64_t, uint64_t>, size_t> caller_indices;
+  for (const EntryCallstackStats::CallstackStats& callstack_stats :
+       Capture::GEntryCallstackStats.GetCallstacksSortedByTotalTime()) {
+    if (!Capture::GSamplingProfiler->HasCallStack(
+            callstack_stats.callstack_id)) {
+      continue;
+    }
+    std::shared_ptr<CallStack> callstack =
+        Capture::GSamplingProfiler->GetCallStack(callstack_stats.callstack_id);
+
+    std::pair<uint64_t, std::string> caller_address_and_name{0, "[unknown]"};
+    if (callstack->m_Depth > 1) {
+      caller_address_and_name = GetFunctionAddressAndName(callstack->m_Data[1]);
+    }
+
+    auto [it, inserted] = caller_indices.try_emplace(
+        std::make_pair(callstack_stats.function_address,
+                       caller_address_and_name.first),
+        m_Callers.size());
+    if (inserted) {
+      Caller caller;
+      caller.function_address = callstack_stats.function_address;
+      caller.function_name =
+          GetFunctionAddressAndName(callstack_stats.function_address).second;
+      caller.caller_address = caller_address_and_name.first;
+      caller.caller_name = std::move(caller_address_and_name.second);
+      caller.function_total_time_ns =
+          Capture::GEntryCallstackStats.GetFunctionTotalTimeNs(
+              callstack_stats.function_address);
+      m_Callers.push_back(std::move(caller));
+    }
+
+    Caller& caller = m_Callers[it->second];
+    caller.count += callstack_stats.count;
+    caller.total_time_ns += callstack_stats.total_time_ns;
+    if (callstack_stats.total_time_ns > caller.top_callstack_time_ns) {
+      caller.top_callstack_id = callstack_stats.callstack_id;
+      caller.top_callstack_time_ns = callstack_stats.total_time_ns;
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+void CallersDataView::OnDataChanged() {
+  UpdateCallers();
+
+  m_Indices.resize(m_Callers.size());
+  for (size_t i = 0; i < m_Callers.size(); ++i) {
+    m_Indices[i] = i;
+  }
+
+  DataView::OnDataChanged();
+}
+
+//-----------------------------------------------------------------------------
+void CallersDataView::OnTimer() {
+  if (Capture::IsCapturing()) {
+    // New function calls arrive during the whole capture, so rebuild the
+    // callers and re-apply the filter, which also sorts.
+    UpdateCallers();
+    DoFilter();
+  }
+}
+
+//-----------------------------------------------------------------------------
+const CallersDataView::Caller& CallersDataView::GetCaller(
+    unsigned int a_Row) const {
+  CHECK(a_Row < m_Indices.size());
+  return m_Callers[m_Indices[a_Row]];
+}
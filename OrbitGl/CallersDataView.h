@@ -0,0 +1,69 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "CallstackTypes.h"
+#include "DataView.h"
+
+// Breaks down the time spent in instrumented functions by their callers, for
+// the functions hooked with "Hook and record entry callstacks".
+//-----------------------------------------------------------------------------
+class CallersDataView : public DataView {
+ public:
+  CallersDataView();
+
+  const std::vector<Column>& GetColumns() override;
+  int GetDefaultSortingColumn() override { return COLUMN_TIME_TOTAL; }
+  std::vector<std::string> GetContextMenu(
+      int a_ClickedIndex, const std::vector<int>& a_SelectedIndices) override;
+  std::string GetValue(int a_Row, int a_Column) override;
+
+  void OnContextMenu(const std::string& a_Action, int a_MenuIndex,
+                     const std::vector<int>& a_ItemIndices) override;
+  void OnSelect(int a_Index) override;
+  void OnDataChanged() override;
+  void OnTimer() override;
+
+ protected:
+  // The calls to a function from one caller, possibly from different call
+  // sites and through different callstacks.
+  struct Caller {
+    uint64_t function_address = 0;
+    std::string function_name;
+    uint64_t caller_address = 0;
+    std::string caller_name;
+    uint64_t count = 0;
+    uint64_t total_time_ns = 0;
+    // Total time of all the calls to the function with an entry callstack.
+    uint64_t function_total_time_ns = 0;
+    CallstackID top_callstack_id = 0;
+    uint64_t top_callstack_time_ns = 0;
+  };
+
+  void DoFilter() override;
+  void DoSort() override;
+  void UpdateCallers();
+  const Caller& GetCaller(unsigned int a_Row) const;
+  static void ShowCallstack(CallstackID callstack_id);
+
+  // Built from Capture::GEntryCallstackStats, which is updated while
+  // capturing.
+  std::vector<Caller> m_Callers;
+
+  enum ColumnIndex {
+    COLUMN_FUNCTION,
+    COLUMN_CALLER,
+    COLUMN_COUNT,
+    COLUMN_TIME_TOTAL,
+    COLUMN_TIME_AVG,
+    COLUMN_PERCENTAGE,
+    COLUMN_NUM
+  };
+
+  static const std::string MENU_ACTION_SHOW_TOP_CALLSTACK;
+};
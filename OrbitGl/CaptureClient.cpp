@@ -6,21 +6,41 @@
 
 #include <OrbitBase/Logging.h>
 
+#include <thread>
+
+#include "CaptureResponseMerger.h"
 #include "absl/flags/flag.h"
+#include "absl/strings/numbers.h"
 
 ABSL_DECLARE_FLAG(uint16_t, sampling_rate);
 ABSL_DECLARE_FLAG(bool, frame_pointer_unwinding);
+ABSL_DECLARE_FLAG(bool, trace_syscalls);
+ABSL_DECLARE_FLAG(bool, trace_lock_contention);
+ABSL_DECLARE_FLAG(bool, sample_thread_counters);
+ABSL_DECLARE_FLAG(double, system_counters_sampling_rate);
+ABSL_DECLARE_FLAG(uint32_t, flight_recorder_window_s);
+ABSL_DECLARE_FLAG(uint32_t, flight_recorder_max_mb);
+ABSL_DECLARE_FLAG(uint32_t, trigger_min_duration_ms);
+ABSL_DECLARE_FLAG(std::string, trigger_counter_name);
+ABSL_DECLARE_FLAG(double, trigger_counter_min_value);
+ABSL_DECLARE_FLAG(uint32_t, trigger_post_ms);
+ABSL_DECLARE_FLAG(std::vector<std::string>, additional_pids);
+ABSL_DECLARE_FLAG(bool, system_wide);
+ABSL_DECLARE_FLAG(uint32_t, sample_aggregation_ms);
+ABSL_DECLARE_FLAG(uint64_t, max_function_calls_per_second);
+ABSL_DECLARE_FLAG(std::string, capture_compression);
+ABSL_DECLARE_FLAG(uint64_t, max_buffered_events);
+ABSL_DECLARE_FLAG(std::string, buffer_full_policy);
+ABSL_DECLARE_FLAG(std::vector<std::string>, separate_streams);
+ABSL_DECLARE_FLAG(uint32_t, entry_callstack_stack_dump_size);
+ABSL_DECLARE_FLAG(uint32_t, capture_processing_threads);
+ABSL_DECLARE_FLAG(bool, user_space_instrumentation);
 
 void CaptureClient::Capture(
     int32_t pid,
     const std::vector<std::shared_ptr<Function>>& selected_functions) {
   CHECK(reader_writer_ == nullptr);
 
-  callstack_intern_pool.clear();
-  string_intern_pool.clear();
-  callstack_hashes_seen_.clear();
-  string_hashes_seen_.clear();
-
   grpc::ClientContext context;
   reader_writer_ = capture_service_->Capture(&context);
 
@@ -28,6 +48,44 @@ void CaptureClient::Capture(
   CaptureOptions* capture_options = request.mutable_capture_options();
   capture_options->set_trace_context_switches(true);
   capture_options->set_pid(pid);
+  for (const std::string& additional_pid_str :
+       absl::GetFlag(FLAGS_additional_pids)) {
+    int32_t additional_pid;
+    if (!absl::SimpleAtoi(additional_pid_str, &additional_pid)) {
+      ERROR("Invalid pid in --additional_pids: \"%s\"", additional_pid_str);
+      continue;
+    }
+    capture_options->add_additional_pids(additional_pid);
+  }
+  capture_options->set_system_wide(absl::GetFlag(FLAGS_system_wide));
+  capture_options->set_sample_aggregation_bucket_ns(
+      absl::GetFlag(FLAGS_sample_aggregation_ms) * 1'000'000ULL);
+  capture_options->set_max_function_calls_per_second(
+      absl::GetFlag(FLAGS_max_function_calls_per_second));
+  capture_options->set_read_orbit_api_ring_buffers(true);
+  capture_options->set_batch_function_calls(true);
+  std::string capture_compression = absl::GetFlag(FLAGS_capture_compression);
+  if (capture_compression == "gzip") {
+    capture_options->set_compression_algorithm(CaptureOptions::kGzip);
+  } else if (capture_compression == "deflate") {
+    capture_options->set_compression_algorithm(CaptureOptions::kDeflate);
+  } else if (!capture_compression.empty()) {
+    ERROR("Invalid --capture_compression \"%s\"", capture_compression);
+  }
+  capture_options->set_max_buffered_events(
+      absl::GetFlag(FLAGS_max_buffered_events));
+  std::string buffer_full_policy = absl::GetFlag(FLAGS_buffer_full_policy);
+  if (buffer_full_policy == "block") {
+    capture_options->set_buffer_full_policy(CaptureOptions::kBlockProducers);
+  } else if (buffer_full_policy == "drop_samples") {
+    capture_options->set_buffer_full_policy(
+        CaptureOptions::kDropLowPriorityEvents);
+  } else if (buffer_full_policy == "reduce_sampling") {
+    capture_options->set_buffer_full_policy(
+        CaptureOptions::kReduceSamplingRate);
+  } else {
+    ERROR("Invalid --buffer_full_policy \"%s\"", buffer_full_policy);
+  }
   uint16_t sampling_rate = absl::GetFlag(FLAGS_sampling_rate);
   if (sampling_rate == 0) {
     capture_options->set_unwinding_method(CaptureOptions::kUndefined);
@@ -40,13 +98,80 @@ void CaptureClient::Capture(
     }
   }
   capture_options->set_trace_gpu_driver(true);
+  capture_options->set_trace_syscalls(absl::GetFlag(FLAGS_trace_syscalls));
+  capture_options->set_trace_lock_contention(
+      absl::GetFlag(FLAGS_trace_lock_contention));
+  capture_options->set_sample_thread_counters(
+      absl::GetFlag(FLAGS_sample_thread_counters));
+  capture_options->set_system_counters_sampling_rate(
+      absl::GetFlag(FLAGS_system_counters_sampling_rate));
+  uint32_t flight_recorder_window_s =
+      absl::GetFlag(FLAGS_flight_recorder_window_s);
+  uint32_t flight_recorder_max_mb = absl::GetFlag(FLAGS_flight_recorder_max_mb);
+  if (flight_recorder_window_s > 0 || flight_recorder_max_mb > 0) {
+    CaptureOptions::FlightRecorderOptions* flight_recorder =
+        capture_options->mutable_flight_recorder();
+    flight_recorder->set_window_ns(flight_recorder_window_s * 1'000'000'000ULL);
+    flight_recorder->set_max_bytes(flight_recorder_max_mb * 1024ULL * 1024);
+  }
+  uint32_t trigger_min_duration_ms =
+      absl::GetFlag(FLAGS_trigger_min_duration_ms);
+  if (trigger_min_duration_ms > 0) {
+    for (const std::shared_ptr<Function>& function : selected_functions) {
+      CaptureOptions::Trigger::FunctionDuration* function_duration =
+          capture_options->add_triggers()->mutable_function_duration();
+      function_duration->set_absolute_address(function->GetVirtualAddress());
+      function_duration->set_min_duration_ns(trigger_min_duration_ms *
+                                              1'000'000ULL);
+    }
+  }
+  std::string trigger_counter_name = absl::GetFlag(FLAGS_trigger_counter_name);
+  if (!trigger_counter_name.empty()) {
+    CaptureOptions::Trigger::CounterThreshold* counter_threshold =
+        capture_options->add_triggers()->mutable_counter_threshold();
+    counter_threshold->set_name(std::move(trigger_counter_name));
+    counter_threshold->set_min_value(
+        absl::GetFlag(FLAGS_trigger_counter_min_value));
+  }
+  capture_options->set_post_trigger_ns(absl::GetFlag(FLAGS_trigger_post_ms) *
+                                       1'000'000ULL);
+  // With triggers, the service records in a flight recorder even if no
+  // limits were given.
+  flight_recorder_enabled_ = capture_options->has_flight_recorder() ||
+                             !capture_options->triggers().empty();
+  // The service sends flight-recorder captures on the Capture call only.
+  if (!flight_recorder_enabled_) {
+    for (const std::string& category : absl::GetFlag(FLAGS_separate_streams)) {
+      if (category == "callstack_samples") {
+        capture_options->add_separate_stream_categories(
+            CaptureOptions::kCallstackSamples);
+      } else if (category == "function_calls") {
+        capture_options->add_separate_stream_categories(
+            CaptureOptions::kFunctionCalls);
+      } else if (category == "scheduling_slices") {
+        capture_options->add_separate_stream_categories(
+            CaptureOptions::kSchedulingSlices);
+      } else {
+        ERROR("Invalid category in --separate_streams: \"%s\"", category);
+      }
+    }
+  }
   for (const std::shared_ptr<Function>& function : selected_functions) {
     CaptureOptions::InstrumentedFunction* instrumented_function =
         capture_options->add_instrumented_functions();
     instrumented_function->set_file_path(function->GetLoadedModulePath());
     instrumented_function->set_file_offset(function->Offset());
     instrumented_function->set_absolute_address(function->GetVirtualAddress());
+    instrumented_function->set_record_entry_callstack(
+        function->RecordsEntryCallstack());
+    instrumented_function->set_size(function->Size());
   }
+  capture_options->set_entry_callstack_stack_dump_size(
+      absl::GetFlag(FLAGS_entry_callstack_stack_dump_size));
+  capture_options->set_dynamic_instrumentation_method(
+      absl::GetFlag(FLAGS_user_space_instrumentation)
+          ? CaptureOptions::kUserSpaceTrampolines
+          : CaptureOptions::kKernelUprobes);
 
   if (!reader_writer_->Write(request)) {
     ERROR("Sending CaptureRequest on Capture's gRPC stream");
@@ -57,232 +182,111 @@ void CaptureClient::Capture(
   LOG("Sent CaptureRequest on Capture's gRPC stream: asking to start "
       "capturing");
 
-  CaptureResponse response;
-  while (reader_writer_->Read(&response)) {
-    for (const CaptureEvent& event : response.capture_events()) {
-      switch (event.event_case()) {
-        case CaptureEvent::kSchedulingSlice:
-          ProcessSchedulingSlice(event.scheduling_slice());
-          break;
-        case CaptureEvent::kInternedCallstack:
-          ProcessInternedCallstack(event.interned_callstack());
-          break;
-        case CaptureEvent::kCallstackSample:
-          ProcessCallstackSample(event.callstack_sample());
-          break;
-        case CaptureEvent::kFunctionCall:
-          ProcessFunctionCall(event.function_call());
-          break;
-        case CaptureEvent::kInternedString:
-          ProcessInternedString(event.interned_string());
-          break;
-        case CaptureEvent::kGpuJob:
-          ProcessGpuJob(event.gpu_job());
-          break;
-        case CaptureEvent::kThreadName:
-          ProcessThreadName(event.thread_name());
-          break;
-        case CaptureEvent::kAddressInfo:
-          ProcessAddressInfo(event.address_info());
-          break;
-        case CaptureEvent::EVENT_NOT_SET:
-          ERROR("CaptureEvent::EVENT_NOT_SET read from Capture's gRPC stream");
-          break;
-      }
+  event_pipeline_ = std::make_unique<CaptureEventPipeline>(
+      capture_listener_, absl::GetFlag(FLAGS_capture_processing_threads));
+  if (capture_options->separate_stream_categories().empty()) {
+    CaptureResponse response;
+    while (reader_writer_->Read(&response)) {
+      event_pipeline_->AddResponse(std::move(response));
     }
+  } else {
+    ReadAndMergeStreams(*capture_options);
   }
   LOG("Finished reading from Capture's gRPC stream: all capture data has been "
       "received");
+  event_pipeline_->Finish();
+  event_pipeline_.reset();
   FinishCapture();
 }
 
-void CaptureClient::StopCapture() {
-  CHECK(reader_writer_ != nullptr);
-
-  if (!reader_writer_->WritesDone()) {
-    ERROR("Finishing writing on Capture's gRPC stream");
-    FinishCapture();
-  }
-  LOG("Finished writing on Capture's gRPC stream: asking to stop capturing");
-}
-
-void CaptureClient::FinishCapture() {
-  if (reader_writer_ == nullptr) {
+void CaptureClient::ReadAndMergeStreams(
+    const CaptureOptions& capture_options) {
+  CaptureResponse first_response;
+  if (!reader_writer_->Read(&first_response)) {
     return;
   }
-
-  grpc::Status status = reader_writer_->Finish();
-  if (!status.ok()) {
-    ERROR("Finishing gRPC call to Capture: %s", status.error_message());
+  uint64_t capture_id = first_response.capture_id();
+
+  // Each stream is read on its own thread, so that responses are parsed in
+  // parallel, and processed on this thread in the order they were sent.
+  size_t stream_count = 1 + capture_options.separate_stream_categories_size();
+  CaptureResponseMerger merger{stream_count};
+  std::vector<std::thread> reader_threads;
+  reader_threads.emplace_back([this, &merger] {
+    CaptureResponse response;
+    while (reader_writer_->Read(&response)) {
+      merger.AddResponse(0, std::move(response));
+    }
+    merger.FinishStream(0);
+  });
+  for (size_t stream_index = 1; stream_index < stream_count; ++stream_index) {
+    CaptureEventStreamRequest request;
+    request.set_capture_id(capture_id);
+    request.set_category(
+        capture_options.separate_stream_categories(stream_index - 1));
+    reader_threads.emplace_back([this, &merger, stream_index, request] {
+      grpc::ClientContext context;
+      std::unique_ptr<grpc::ClientReader<CaptureResponse>> reader =
+          capture_service_->CaptureEventStream(&context, request);
+      CaptureResponse response;
+      while (reader->Read(&response)) {
+        merger.AddResponse(stream_index, std::move(response));
+      }
+      grpc::Status status = reader->Finish();
+      if (!status.ok()) {
+        ERROR("Finishing gRPC call to CaptureEventStream for %s: %s",
+              CaptureOptions::StreamCategory_Name(request.category()),
+              status.error_message());
+      }
+      merger.FinishStream(stream_index);
+    });
   }
-  reader_writer_.reset();
-}
-
-void CaptureClient::ProcessSchedulingSlice(
-    const SchedulingSlice& scheduling_slice) {
-  Timer timer;
-  timer.m_Start = scheduling_slice.in_timestamp_ns();
-  timer.m_End = scheduling_slice.out_timestamp_ns();
-  timer.m_PID = scheduling_slice.pid();
-  timer.m_TID = scheduling_slice.tid();
-  timer.m_Processor = static_cast<int8_t>(scheduling_slice.core());
-  timer.m_Depth = timer.m_Processor;
-  timer.SetType(Timer::CORE_ACTIVITY);
 
-  capture_listener_->OnTimer(timer);
-}
-
-void CaptureClient::ProcessInternedCallstack(
-    InternedCallstack interned_callstack) {
-  if (callstack_intern_pool.contains(interned_callstack.key())) {
-    ERROR("Overwriting InternedCallstack with key %llu",
-          interned_callstack.key());
+  while (std::optional<CaptureResponse> next_response =
+             merger.TakeNextResponse()) {
+    event_pipeline_->AddResponse(std::move(next_response.value()));
   }
-  callstack_intern_pool.emplace(
-      interned_callstack.key(),
-      std::move(*interned_callstack.mutable_intern()));
-}
-
-void CaptureClient::ProcessCallstackSample(
-    const CallstackSample& callstack_sample) {
-  Callstack callstack;
-  if (callstack_sample.callstack_or_key_case() ==
-      CallstackSample::kCallstackKey) {
-    callstack = callstack_intern_pool[callstack_sample.callstack_key()];
-  } else {
-    callstack = callstack_sample.callstack();
+  for (std::thread& reader_thread : reader_threads) {
+    reader_thread.join();
   }
-
-  uint64_t hash = GetCallstackHashAndSendToListenerIfNecessary(callstack);
-  CallstackEvent callstack_event{callstack_sample.timestamp_ns(), hash,
-                                 callstack_sample.tid()};
-  capture_listener_->OnCallstackEvent(std::move(callstack_event));
 }
 
-void CaptureClient::ProcessFunctionCall(const FunctionCall& function_call) {
-  Timer timer;
-  timer.m_TID = function_call.tid();
-  timer.m_Start = function_call.begin_timestamp_ns();
-  timer.m_End = function_call.end_timestamp_ns();
-  timer.m_Depth = static_cast<uint8_t>(function_call.depth());
-  timer.m_FunctionAddress = function_call.absolute_address();
-  timer.m_UserData[0] = function_call.return_value();
-
-  capture_listener_->OnTimer(timer);
-}
+void CaptureClient::StopCapture() {
+  CHECK(reader_writer_ != nullptr);
 
-void CaptureClient::ProcessInternedString(InternedString interned_string) {
-  if (string_intern_pool.contains(interned_string.key())) {
-    ERROR("Overwriting InternedString with key %llu", interned_string.key());
+  // The service only sends the events of a flight-recorder capture on request,
+  // so ask for them one last time before stopping.
+  if (flight_recorder_enabled_) {
+    RequestSnapshot();
   }
-  string_intern_pool.emplace(interned_string.key(),
-                             std::move(*interned_string.mutable_intern()));
-}
 
-void CaptureClient::ProcessGpuJob(const GpuJob& gpu_job) {
-  Timer timer_user_to_sched;
-  timer_user_to_sched.m_TID = gpu_job.tid();
-  timer_user_to_sched.m_Start = gpu_job.amdgpu_cs_ioctl_time_ns();
-  timer_user_to_sched.m_End = gpu_job.amdgpu_sched_run_job_time_ns();
-  timer_user_to_sched.m_Depth = gpu_job.depth();
-
-  std::string timeline;
-  if (gpu_job.timeline_or_key_case() == GpuJob::kTimelineKey) {
-    timeline = string_intern_pool[gpu_job.timeline_key()];
-  } else {
-    timeline = gpu_job.timeline();
+  if (!reader_writer_->WritesDone()) {
+    ERROR("Finishing writing on Capture's gRPC stream");
+    FinishCapture();
   }
-  uint64_t timeline_hash = GetStringHashAndSendToListenerIfNecessary(timeline);
-
-  constexpr const char* sw_queue = "sw queue";
-  uint64_t sw_queue_key = GetStringHashAndSendToListenerIfNecessary(sw_queue);
-  timer_user_to_sched.m_UserData[0] = sw_queue_key;
-  timer_user_to_sched.m_UserData[1] = timeline_hash;
-
-  timer_user_to_sched.m_Type = Timer::GPU_ACTIVITY;
-  capture_listener_->OnTimer(std::move(timer_user_to_sched));
-
-  Timer timer_sched_to_start;
-  timer_sched_to_start.m_TID = gpu_job.tid();
-  timer_sched_to_start.m_Start = gpu_job.amdgpu_sched_run_job_time_ns();
-  timer_sched_to_start.m_End = gpu_job.gpu_hardware_start_time_ns();
-  timer_sched_to_start.m_Depth = gpu_job.depth();
-
-  constexpr const char* hw_queue = "hw queue";
-  uint64_t hw_queue_key = GetStringHashAndSendToListenerIfNecessary(hw_queue);
-
-  timer_sched_to_start.m_UserData[0] = hw_queue_key;
-  timer_sched_to_start.m_UserData[1] = timeline_hash;
-
-  timer_sched_to_start.m_Type = Timer::GPU_ACTIVITY;
-  capture_listener_->OnTimer(std::move(timer_sched_to_start));
-
-  Timer timer_start_to_finish;
-  timer_start_to_finish.m_TID = gpu_job.tid();
-  timer_start_to_finish.m_Start = gpu_job.gpu_hardware_start_time_ns();
-  timer_start_to_finish.m_End = gpu_job.dma_fence_signaled_time_ns();
-  timer_start_to_finish.m_Depth = gpu_job.depth();
-
-  constexpr const char* hw_execution = "hw execution";
-  uint64_t hw_execution_key =
-      GetStringHashAndSendToListenerIfNecessary(hw_execution);
-
-  timer_start_to_finish.m_UserData[0] = hw_execution_key;
-  timer_start_to_finish.m_UserData[1] = timeline_hash;
-
-  timer_start_to_finish.m_Type = Timer::GPU_ACTIVITY;
-  capture_listener_->OnTimer(std::move(timer_start_to_finish));
-}
-
-void CaptureClient::ProcessThreadName(const ThreadName& thread_name) {
-  capture_listener_->OnThreadName(thread_name.tid(), thread_name.name());
+  LOG("Finished writing on Capture's gRPC stream: asking to stop capturing");
 }
 
-void CaptureClient::ProcessAddressInfo(const AddressInfo& address_info) {
-  std::string function_name;
-  if (address_info.function_name_or_key_case() ==
-      AddressInfo::kFunctionNameKey) {
-    function_name = string_intern_pool[address_info.function_name_key()];
-  } else {
-    function_name = address_info.function_name();
-  }
+void CaptureClient::RequestSnapshot() {
+  CHECK(reader_writer_ != nullptr);
 
-  std::string map_name;
-  if (address_info.map_name_or_key_case() == AddressInfo::kMapNameKey) {
-    map_name = string_intern_pool[address_info.map_name_key()];
-  } else {
-    map_name = address_info.map_name();
+  CaptureRequest request;
+  request.set_snapshot(true);
+  if (!reader_writer_->Write(request)) {
+    ERROR("Requesting snapshot on Capture's gRPC stream");
+    return;
   }
-
-  LinuxAddressInfo linux_address_info{address_info.absolute_address(), map_name,
-                                      function_name,
-                                      address_info.offset_in_function()};
-  capture_listener_->OnAddressInfo(linux_address_info);
+  LOG("Sent snapshot request on Capture's gRPC stream");
 }
 
-uint64_t CaptureClient::GetCallstackHashAndSendToListenerIfNecessary(
-    const Callstack& callstack) {
-  CallStack cs;
-  for (uint64_t pc : callstack.pcs()) {
-    cs.m_Data.push_back(pc);
-  }
-  cs.m_Depth = cs.m_Data.size();
-  // TODO: Compute the hash without creating the CallStack if not necessary.
-  uint64_t hash = cs.Hash();
-
-  if (!callstack_hashes_seen_.contains(hash)) {
-    callstack_hashes_seen_.emplace(hash);
-    capture_listener_->OnCallstack(cs);
+void CaptureClient::FinishCapture() {
+  if (reader_writer_ == nullptr) {
+    return;
   }
-  return hash;
-}
 
-uint64_t CaptureClient::GetStringHashAndSendToListenerIfNecessary(
-    const std::string& str) {
-  uint64_t hash = StringHash(str);
-  if (!string_hashes_seen_.contains(hash)) {
-    string_hashes_seen_.emplace(hash);
-    capture_listener_->OnKeyAndString(hash, str);
+  grpc::Status status = reader_writer_->Finish();
+  if (!status.ok()) {
+    ERROR("Finishing gRPC call to Capture: %s", status.error_message());
   }
-  return hash;
+  reader_writer_.reset();
 }
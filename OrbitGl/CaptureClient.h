@@ -5,11 +5,10 @@
 #ifndef ORBIT_GL_CAPTURE_CLIENT_H_
 #define ORBIT_GL_CAPTURE_CLIENT_H_
 
+#include "CaptureEventPipeline.h"
 #include "CaptureListener.h"
 #include "OrbitBase/Logging.h"
 #include "OrbitFunction.h"
-#include "absl/container/flat_hash_map.h"
-#include "absl/container/flat_hash_set.h"
 #include "grpcpp/channel.h"
 #include "services.grpc.pb.h"
 
@@ -26,32 +25,24 @@ class CaptureClient {
       int32_t pid,
       const std::vector<std::shared_ptr<Function>>& selected_functions);
   void StopCapture();
+  // For flight-recorder captures, asks the service for the events it has
+  // recorded so far. They are received like any other event.
+  void RequestSnapshot();
 
  private:
   void FinishCapture();
+  // Reads the Capture call and the CaptureEventStream calls of
+  // CaptureOptions::separate_stream_categories.
+  void ReadAndMergeStreams(const CaptureOptions& capture_options);
 
   std::unique_ptr<CaptureService::Stub> capture_service_;
   std::unique_ptr<grpc::ClientReaderWriter<CaptureRequest, CaptureResponse>>
       reader_writer_;
+  bool flight_recorder_enabled_ = false;
 
-  void ProcessSchedulingSlice(const SchedulingSlice& scheduling_slice);
-  void ProcessInternedCallstack(InternedCallstack interned_callstack);
-  void ProcessCallstackSample(const CallstackSample& callstack_sample);
-  void ProcessFunctionCall(const FunctionCall& function_call);
-  void ProcessInternedString(InternedString interned_string);
-  void ProcessGpuJob(const GpuJob& gpu_job);
-  void ProcessThreadName(const ThreadName& thread_name);
-  void ProcessAddressInfo(const AddressInfo& address_info);
-
-  absl::flat_hash_map<uint64_t, Callstack> callstack_intern_pool;
-  absl::flat_hash_map<uint64_t, std::string> string_intern_pool;
   CaptureListener* capture_listener_;
-
-  absl::flat_hash_set<uint64_t> callstack_hashes_seen_;
-  uint64_t GetCallstackHashAndSendToListenerIfNecessary(
-      const Callstack& callstack);
-  absl::flat_hash_set<uint64_t> string_hashes_seen_;
-  uint64_t GetStringHashAndSendToListenerIfNecessary(const std::string& str);
+  // Only set during a capture.
+  std::unique_ptr<CaptureEventPipeline> event_pipeline_;
 };
 
 #endif  // ORBIT_GL_CAPTURE_CLIENT_H_
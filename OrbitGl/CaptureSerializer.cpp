@@ -6,6 +6,8 @@
 
 #include <fstream>
 #include <memory>
+#include <unordered_map>
+#include <utility>
 
 #include "App.h"
 #include "Callstack.h"
@@ -26,7 +28,7 @@
 
 //-----------------------------------------------------------------------------
 CaptureSerializer::CaptureSerializer() {
-  m_Version = 2;
+  m_Version = 3;
   m_TimerVersion = Timer::Version;
   m_SizeOfTimer = sizeof(Timer);
 }
@@ -188,7 +190,18 @@ outcome::result<void, std::string> CaptureSerializer::Load(
 
   archive(Capture::GCallstacks);
 
-  archive(Capture::GAddressInfos);
+  if (m_Version >= 3) {
+    archive(Capture::GAddressInfos);
+  } else {
+    // Older captures have a single address table for all processes.
+    std::unordered_map<uint64_t, LinuxAddressInfo> address_infos;
+    archive(address_infos);
+    Capture::GAddressInfos.clear();
+    for (auto& [address, address_info] : address_infos) {
+      Capture::GAddressInfos[address_info.process_id].emplace(
+          address, std::move(address_info));
+    }
+  }
 
   archive(Capture::GAddressToFunctionName);
 
@@ -10,6 +10,7 @@
 #include "EventTracer.h"
 #include "GlUtils.h"
 #include "PluginManager.h"
+#include "SamplingProfiler.h"
 #include "Systrace.h"
 #include "TcpClient.h"
 #include "TcpServer.h"
@@ -235,6 +236,16 @@ void CaptureWindow::SelectTextBox(class TextBox* a_TextBox) {
   Capture::GSelectedThreadId = a_TextBox->GetTimer().m_TID;
   Capture::GSelectedCallstack =
       Capture::GetCallstack(a_TextBox->GetTimer().m_CallstackHash);
+  // Callstacks of lock waits and entry callstacks of function calls are
+  // received with the sampled callstacks.
+  if (Capture::GSelectedCallstack == nullptr &&
+      a_TextBox->GetTimer().m_CallstackHash != 0 &&
+      Capture::GSamplingProfiler != nullptr &&
+      Capture::GSamplingProfiler->HasCallStack(
+          a_TextBox->GetTimer().m_CallstackHash)) {
+    Capture::GSelectedCallstack = Capture::GSamplingProfiler->GetCallStack(
+        a_TextBox->GetTimer().m_CallstackHash);
+  }
   GOrbitApp->SetCallStack(Capture::GSelectedCallstack);
 
   const Timer& a_Timer = a_TextBox->GetTimer();
@@ -8,15 +8,19 @@
 
 #include "App.h"
 #include "CallStackDataView.h"
+#include "CallersDataView.h"
 #include "FunctionsDataView.h"
 #include "GlobalsDataView.h"
 #include "LiveFunctionsDataView.h"
+#include "LockContentionDataView.h"
 #include "LogDataView.h"
 #include "ModulesDataView.h"
 #include "OrbitType.h"
 #include "ProcessesDataView.h"
 #include "SamplingReportDataView.h"
 #include "SessionsDataView.h"
+#include "SyscallsDataView.h"
+#include "TracerHealthDataView.h"
 #include "TypesDataView.h"
 
 //-----------------------------------------------------------------------------
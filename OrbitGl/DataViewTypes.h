@@ -16,6 +16,10 @@ enum class DataViewType {
   SAMPLING,
   PRESETS,
   LOG,
+  SYSCALLS,
+  LOCK_CONTENTION,
+  CALLERS,
+  TRACER_HEALTH,
   ALL,
   INVALID
 };
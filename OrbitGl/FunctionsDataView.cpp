@@ -130,6 +130,8 @@ void FunctionsDataView::DoSort() {
 
 //-----------------------------------------------------------------------------
 const std::string FunctionsDataView::MENU_ACTION_SELECT = "Hook";
+const std::string FunctionsDataView::MENU_ACTION_SELECT_WITH_CALLSTACK =
+    "Hook and record entry callstacks";
 const std::string FunctionsDataView::MENU_ACTION_UNSELECT = "Unhook";
 const std::string FunctionsDataView::MENU_ACTION_VIEW = "Visualize";
 const std::string FunctionsDataView::MENU_ACTION_DISASSEMBLY =
@@ -141,16 +143,21 @@ const std::string FunctionsDataView::MENU_ACTION_SET_AS_FRAME =
 std::vector<std::string> FunctionsDataView::GetContextMenu(
     int a_ClickedIndex, const std::vector<int>& a_SelectedIndices) {
   bool enable_select = false;
+  bool enable_select_with_callstack = false;
   bool enable_unselect = false;
   bool enable_view = absl::GetFlag(FLAGS_enable_stale_features);
   for (int index : a_SelectedIndices) {
     const Function& function = GetFunction(index);
     enable_select |= !function.IsSelected();
+    enable_select_with_callstack |= !function.RecordsEntryCallstack();
     enable_unselect |= function.IsSelected();
   }
 
   std::vector<std::string> menu;
   if (enable_select) menu.emplace_back(MENU_ACTION_SELECT);
+  if (enable_select_with_callstack) {
+    menu.emplace_back(MENU_ACTION_SELECT_WITH_CALLSTACK);
+  }
   if (enable_unselect) menu.emplace_back(MENU_ACTION_UNSELECT);
   if (enable_view) menu.emplace_back(MENU_ACTION_VIEW);
   menu.emplace_back(MENU_ACTION_DISASSEMBLY);
@@ -166,6 +173,12 @@ void FunctionsDataView::OnContextMenu(const std::string& a_Action,
     for (int i : a_ItemIndices) {
       GetFunction(i).Select();
     }
+  } else if (a_Action == MENU_ACTION_SELECT_WITH_CALLSTACK) {
+    for (int i : a_ItemIndices) {
+      Function& function = GetFunction(i);
+      function.Select();
+      function.SetRecordEntryCallstack(true);
+    }
   } else if (a_Action == MENU_ACTION_UNSELECT) {
     for (int i : a_ItemIndices) {
       GetFunction(i).UnSelect();
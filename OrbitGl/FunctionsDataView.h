@@ -43,6 +43,7 @@ class FunctionsDataView : public DataView {
   };
 
   static const std::string MENU_ACTION_SELECT;
+  static const std::string MENU_ACTION_SELECT_WITH_CALLSTACK;
   static const std::string MENU_ACTION_UNSELECT;
   static const std::string MENU_ACTION_VIEW;
   static const std::string MENU_ACTION_DISASSEMBLY;
@@ -41,6 +41,10 @@ void ClearCaptureData() {
   }
 
   GOrbitApp->FireRefreshCallbacks(DataViewType::LIVE_FUNCTIONS);
+  GOrbitApp->FireRefreshCallbacks(DataViewType::SYSCALLS);
+  GOrbitApp->FireRefreshCallbacks(DataViewType::LOCK_CONTENTION);
+  GOrbitApp->FireRefreshCallbacks(DataViewType::CALLERS);
+  GOrbitApp->FireRefreshCallbacks(DataViewType::TRACER_HEALTH);
 }
 
 //-----------------------------------------------------------------------------
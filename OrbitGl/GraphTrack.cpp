@@ -5,6 +5,7 @@
 #include "GraphTrack.h"
 
 #include "GlCanvas.h"
+#include "absl/strings/str_format.h"
 
 GraphTrack::GraphTrack(TimeGraph* time_graph) : Track(time_graph) {}
 
@@ -51,6 +52,19 @@ void GraphTrack::Draw(GlCanvas* canvas, bool picking) {
   glVertex3f(x0, y1, track_z);
   glEnd();
 
+  // Draw label and value range.
+  const Color kTextWhite(255, 255, 255, 255);
+  ScopeLock lock(mutex_);
+  if (!label_.empty()) {
+    std::string label =
+        values_.empty()
+            ? label_
+            : absl::StrFormat("%s [%.3g, %.3g]", label_.c_str(), min_, max_);
+    canvas->AddText(label.c_str(), x0 + layout.GetTrackLabelOffsetX(),
+                    y1 + layout.GetTrackLabelOffsetY(), text_z, kTextWhite,
+                    m_Size[0]);
+  }
+
   const Color kLineColor(0, 128, 255, 128);
 
   // Current time window
@@ -84,6 +98,7 @@ void GraphTrack::OnDrag(int /*x*/, int /*y*/) {}
 
 void GraphTrack::AddTimer(const Timer& timer) {
   double value = *reinterpret_cast<const double*>(&timer.m_UserData[0]);
+  ScopeLock lock(mutex_);
   values_[timer.m_Start] = value;
   if (value > max_) max_ = value;
   if (value < min_) min_ = value;
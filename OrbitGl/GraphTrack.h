@@ -8,6 +8,7 @@
 #include <limits>
 
 #include "ScopeTimer.h"
+#include "Threading.h"
 #include "Track.h"
 
 class TimeGraph;
@@ -22,9 +23,11 @@ class GraphTrack : public Track {
   float GetHeight() const override;
 
  protected:
+  // Timers are added from the capture thread while the track is drawn.
+  mutable Mutex mutex_;
   std::map<uint64_t, double> values_;
   double min_ = std::numeric_limits<double>::max();
-  double max_ = std::numeric_limits<double>::min();
+  double max_ = std::numeric_limits<double>::lowest();
   double value_range_ = 0;
   double inv_value_range_ = 0;
 };
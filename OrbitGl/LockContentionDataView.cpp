@@ -0,0 +1,233 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "LockContentionDataView.h"
+
+#include "App.h"
+#include "Capture.h"
+#include "Core.h"
+#include "SamplingProfiler.h"
+#include "Utils.h"
+
+//-----------------------------------------------------------------------------
+LockContentionDataView::LockContentionDataView()
+    : DataView(DataViewType::LOCK_CONTENTION) {
+  m_UpdatePeriodMs = 300;
+  OnDataChanged();
+}
+
+//-----------------------------------------------------------------------------
+const std::vector<DataView::Column>& LockContentionDataView::GetColumns() {
+  static const std::vector<Column> columns = [] {
+    std::vector<Column> columns;
+    columns.resize(COLUMN_NUM);
+    columns[COLUMN_ADDRESS] = {"Lock", .2f, SortingOrder::Ascending};
+    columns[COLUMN_COUNT] = {"Waits", .0f, SortingOrder::Descending};
+    columns[COLUMN_TIME_TOTAL] = {"Total", .0f, SortingOrder::Descending};
+    columns[COLUMN_TIME_AVG] = {"Avg", .0f, SortingOrder::Descending};
+    columns[COLUMN_TIME_MAX] = {"Max", .0f, SortingOrder::Descending};
+    columns[COLUMN_NUM_WAITER_CALLSTACKS] = {"Waiter callstacks", .0f,
+                                             SortingOrder::Descending};
+    columns[COLUMN_NUM_WAKER_CALLSTACKS] = {"Holder callstacks", .0f,
+                                            SortingOrder::Descending};
+    return columns;
+  }();
+  return columns;
+}
+
+//-----------------------------------------------------------------------------
+std::string LockContentionDataView::GetValue(int a_Row, int a_Column) {
+  if (a_Row >= static_cast<int>(GetNumElements())) {
+    return "";
+  }
+
+  const LockContentionStats::LockStats& lock = GetLock(a_Row);
+  constexpr double kNsPerMs = 1'000'000.0;
+
+  switch (a_Column) {
+    case COLUMN_ADDRESS:
+      return absl::StrFormat("%#llx", lock.address);
+    case COLUMN_COUNT:
+      return absl::StrFormat("%lu", lock.count);
+    case COLUMN_TIME_TOTAL:
+      return GetPrettyTime(lock.total_wait_ns / kNsPerMs);
+    case COLUMN_TIME_AVG:
+      return GetPrettyTime(
+          lock.count > 0 ? lock.total_wait_ns / kNsPerMs / lock.count : 0);
+    case COLUMN_TIME_MAX:
+      return GetPrettyTime(lock.max_wait_ns / kNsPerMs);
+    case COLUMN_NUM_WAITER_CALLSTACKS:
+      return absl::StrFormat("%lu", lock.wait_ns_per_waiter_callstack.size());
+    case COLUMN_NUM_WAKER_CALLSTACKS:
+      return absl::StrFormat("%lu", lock.wait_ns_per_waker_callstack.size());
+    default:
+      return "";
+  }
+}
+
+//-----------------------------------------------------------------------------
+#define ORBIT_LOCK_STAT_SORT(Member)                                 \
+  [&](int a, int b) {                                                \
+    return OrbitUtils::Compare(locks[a].Member, locks[b].Member,     \
+                               ascending);                           \
+  }
+
+//-----------------------------------------------------------------------------
+void LockContentionDataView::DoSort() {
+  bool ascending = m_SortingOrders[m_SortingColumn] == SortingOrder::Ascending;
+  std::function<bool(int a, int b)> sorter = nullptr;
+
+  const std::vector<LockContentionStats::LockStats>& locks = m_Locks;
+
+  switch (m_SortingColumn) {
+    case COLUMN_ADDRESS:
+      sorter = ORBIT_LOCK_STAT_SORT(address);
+      break;
+    case COLUMN_COUNT:
+      sorter = ORBIT_LOCK_STAT_SORT(count);
+      break;
+    case COLUMN_TIME_TOTAL:
+      sorter = ORBIT_LOCK_STAT_SORT(total_wait_ns);
+      break;
+    case COLUMN_TIME_AVG:
+      sorter = [&](int a, int b) {
+        return OrbitUtils::Compare(
+            static_cast<double>(locks[a].total_wait_ns) / locks[a].count,
+            static_cast<double>(locks[b].total_wait_ns) / locks[b].count,
+            ascending);
+      };
+      break;
+    case COLUMN_TIME_MAX:
+      sorter = ORBIT_LOCK_STAT_SORT(max_wait_ns);
+      break;
+    case COLUMN_NUM_WAITER_CALLSTACKS:
+      sorter = ORBIT_LOCK_STAT_SORT(wait_ns_per_waiter_callstack.size());
+      break;
+    case COLUMN_NUM_WAKER_CALLSTACKS:
+      sorter = ORBIT_LOCK_STAT_SORT(wait_ns_per_waker_callstack.size());
+      break;
+    default:
+      break;
+  }
+
+  if (sorter) {
+    std::stable_sort(m_Indices.begin(), m_Indices.end(), sorter);
+  }
+}
+
+//-----------------------------------------------------------------------------
+const std::string LockContentionDataView::MENU_ACTION_SHOW_WAITER_CALLSTACK =
+    "Show top waiter callstack";
+const std::string LockContentionDataView::MENU_ACTION_SHOW_WAKER_CALLSTACK =
+    "Show top holder callstack";
+
+//-----------------------------------------------------------------------------
+std::vector<std::string> LockContentionDataView::GetContextMenu(
+    int a_ClickedIndex, const std::vector<int>& a_SelectedIndices) {
+  const LockContentionStats::LockStats& lock = GetLock(a_ClickedIndex);
+
+  std::vector<std::string> menu;
+  if (!lock.wait_ns_per_waiter_callstack.empty()) {
+    menu.emplace_back(MENU_ACTION_SHOW_WAITER_CALLSTACK);
+  }
+  if (!lock.wait_ns_per_waker_callstack.empty()) {
+    menu.emplace_back(MENU_ACTION_SHOW_WAKER_CALLSTACK);
+  }
+  Append(menu, DataView::GetContextMenu(a_ClickedIndex, a_SelectedIndices));
+  return menu;
+}
+
+//-----------------------------------------------------------------------------
+void LockContentionDataView::OnContextMenu(
+    const std::string& a_Action, int a_MenuIndex,
+    const std::vector<int>& a_ItemIndices) {
+  if (a_Action == MENU_ACTION_SHOW_WAITER_CALLSTACK) {
+    if (!a_ItemIndices.empty()) {
+      ShowCallstack(GetLock(a_ItemIndices[0]).GetTopWaiterCallstack());
+    }
+  } else if (a_Action == MENU_ACTION_SHOW_WAKER_CALLSTACK) {
+    if (!a_ItemIndices.empty()) {
+      ShowCallstack(GetLock(a_ItemIndices[0]).GetTopWakerCallstack());
+    }
+  } else {
+    DataView::OnContextMenu(a_Action, a_MenuIndex, a_ItemIndices);
+  }
+}
+
+//-----------------------------------------------------------------------------
+void LockContentionDataView::OnSelect(int a_Index) {
+  ShowCallstack(GetLock(a_Index).GetTopWaiterCallstack());
+}
+
+//-----------------------------------------------------------------------------
+void LockContentionDataView::ShowCallstack(CallstackID callstack_id) {
+  if (callstack_id == 0 || Capture::GSamplingProfiler == nullptr ||
+      !Capture::GSamplingProfiler->HasCallStack(callstack_id)) {
+    return;
+  }
+  GOrbitApp->SetCallStack(
+      Capture::GSamplingProfiler->GetCallStack(callstack_id));
+}
+
+//-----------------------------------------------------------------------------
+void LockContentionDataView::DoFilter() {
+  std::vector<uint32_t> indices;
+
+  std::vector<std::string> tokens = absl::StrSplit(ToLower(m_Filter), ' ');
+
+  for (size_t i = 0; i < m_Locks.size(); ++i) {
+    std::string address = absl::StrFormat("%#llx", m_Locks[i].address);
+
+    bool match = true;
+
+    for (std::string& filterToken : tokens) {
+      if (address.find(filterToken) == std::string::npos) {
+        match = false;
+        break;
+      }
+    }
+
+    if (match) {
+      indices.push_back(i);
+    }
+  }
+
+  m_Indices = indices;
+
+  OnSort(m_SortingColumn, {});
+}
+
+//-----------------------------------------------------------------------------
+void LockContentionDataView::UpdateLocks() {
+  m_Locks = Capture::GLockContentionStats.GetLocksSortedByTotalWait();
+}
+
+//-----------------------------------------------------------------------------
+void LockContentionDataView::OnDataChanged() {
+  UpdateLocks();
+
+  m_Indices.resize(m_Locks.size());
+  for (size_t i = 0; i < m_Locks.size(); ++i) {
+    m_Indices[i] = i;
+  }
+
+  DataView::OnDataChanged();
+}
+
+//-----------------------------------------------------------------------------
+void LockContentionDataView::OnTimer() {
+  if (Capture::IsCapturing()) {
+    // New lock waits arrive during the whole capture, so take a new snapshot
+    // and re-apply the filter, which also sorts.
+    UpdateLocks();
+    DoFilter();
+  }
+}
+
+//-----------------------------------------------------------------------------
+const LockContentionStats::LockStats& LockContentionDataView::GetLock(
+    unsigned int a_Row) const {
+  CHECK(a_Row < m_Indices.size());
+  return m_Locks[m_Indices[a_Row]];
+}
@@ -0,0 +1,53 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <vector>
+
+#include "DataView.h"
+#include "LockContentionStats.h"
+
+//-----------------------------------------------------------------------------
+class LockContentionDataView : public DataView {
+ public:
+  LockContentionDataView();
+
+  const std::vector<Column>& GetColumns() override;
+  int GetDefaultSortingColumn() override { return COLUMN_TIME_TOTAL; }
+  std::vector<std::string> GetContextMenu(
+      int a_ClickedIndex, const std::vector<int>& a_SelectedIndices) override;
+  std::string GetValue(int a_Row, int a_Column) override;
+
+  void OnContextMenu(const std::string& a_Action, int a_MenuIndex,
+                     const std::vector<int>& a_ItemIndices) override;
+  void OnSelect(int a_Index) override;
+  void OnDataChanged() override;
+  void OnTimer() override;
+
+ protected:
+  void DoFilter() override;
+  void DoSort() override;
+  void UpdateLocks();
+  const LockContentionStats::LockStats& GetLock(unsigned int a_Row) const;
+  static void ShowCallstack(CallstackID callstack_id);
+
+  // Snapshot of Capture::GLockContentionStats, which is updated while
+  // capturing.
+  std::vector<LockContentionStats::LockStats> m_Locks;
+
+  enum ColumnIndex {
+    COLUMN_ADDRESS,
+    COLUMN_COUNT,
+    COLUMN_TIME_TOTAL,
+    COLUMN_TIME_AVG,
+    COLUMN_TIME_MAX,
+    COLUMN_NUM_WAITER_CALLSTACKS,
+    COLUMN_NUM_WAKER_CALLSTACKS,
+    COLUMN_NUM
+  };
+
+  static const std::string MENU_ACTION_SHOW_WAITER_CALLSTACK;
+  static const std::string MENU_ACTION_SHOW_WAKER_CALLSTACK;
+};
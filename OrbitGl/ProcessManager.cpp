@@ -5,10 +5,12 @@
 #include "ProcessManager.h"
 
 #include <chrono>
+#include <map>
 #include <memory>
 #include <string>
 
 #include "OrbitBase/Logging.h"
+#include "ProfileBucketBuilder.h"
 #include "grpcpp/grpcpp.h"
 #include "outcome.hpp"
 #include "services.grpc.pb.h"
@@ -21,6 +23,7 @@ constexpr uint64_t kGrpcDefaultTimeoutMilliseconds = 1000;
 // support slow internet connections, or multiple requests in parallel, this is
 // set to a generous 60 seconds.
 constexpr uint64_t kGrpcSymbolLoadingTimeoutMilliseconds = 60 * 1000;
+constexpr uint64_t kGrpcProfileLoadingTimeoutMilliseconds = 10 * 1000;
 
 class ProcessManagerImpl final : public ProcessManager {
  public:
@@ -40,6 +43,13 @@ class ProcessManagerImpl final : public ProcessManager {
   outcome::result<ModuleSymbols, std::string> LoadSymbols(
       const std::string& module_path) const override;
 
+  outcome::result<std::vector<ProfileInfo>, std::string> LoadProfileList()
+      const override;
+  outcome::result<ProfileBucket, std::string> LoadProfile(
+      const std::string& name) const override;
+  outcome::result<ProfileBucket, std::string> LoadMergedProfile(
+      uint64_t begin_unix_time_ns, uint64_t end_unix_time_ns) const override;
+
   void Start();
   void Shutdown() override;
 
@@ -47,12 +57,22 @@ class ProcessManagerImpl final : public ProcessManager {
   std::unique_ptr<grpc::ClientContext> CreateContext(
       uint64_t timeout_milliseconds) const;
   void WorkerFunction();
+  // Returns false if the service doesn't implement WatchProcessList, and
+  // otherwise only on shutdown.
+  bool WatchProcessList();
+  void PollProcessList();
+  // Returns true if shutdown was initiated.
+  bool WaitForShutdown(absl::Duration timeout);
+  void SetProcessList(std::vector<ProcessInfo> process_list);
 
   std::unique_ptr<ProcessService::Stub> process_service_;
 
   absl::Duration refresh_timeout_;
   absl::Mutex shutdown_mutex_;
   bool shutdown_initiated_;
+  // The context of the running WatchProcessList call, to cancel it on
+  // shutdown.
+  grpc::ClientContext* watch_context_ = nullptr;
 
   mutable absl::Mutex mutex_;
   std::vector<ProcessInfo> process_list_;
@@ -121,6 +141,63 @@ outcome::result<ModuleSymbols, std::string> ProcessManagerImpl::LoadSymbols(
   return response.module_symbols();
 }
 
+outcome::result<std::vector<ProfileInfo>, std::string>
+ProcessManagerImpl::LoadProfileList() const {
+  ListProfilesRequest request;
+  ListProfilesResponse response;
+
+  std::unique_ptr<grpc::ClientContext> context =
+      CreateContext(kGrpcDefaultTimeoutMilliseconds);
+
+  grpc::Status status =
+      process_service_->ListProfiles(context.get(), request, &response);
+  if (!status.ok()) {
+    ERROR("gRPC call to ListProfiles failed: %s", status.error_message());
+    return status.error_message();
+  }
+
+  const auto& profiles = response.profiles();
+  return std::vector<ProfileInfo>(profiles.begin(), profiles.end());
+}
+
+outcome::result<ProfileBucket, std::string> ProcessManagerImpl::LoadProfile(
+    const std::string& name) const {
+  GetProfileRequest request;
+  GetProfileResponse response;
+
+  request.set_name(name);
+
+  std::unique_ptr<grpc::ClientContext> context =
+      CreateContext(kGrpcProfileLoadingTimeoutMilliseconds);
+
+  grpc::Status status =
+      process_service_->GetProfile(context.get(), request, &response);
+  if (!status.ok()) {
+    ERROR("gRPC call to GetProfile failed: %s", status.error_message());
+    return status.error_message();
+  }
+
+  return std::move(*response.mutable_profile());
+}
+
+outcome::result<ProfileBucket, std::string>
+ProcessManagerImpl::LoadMergedProfile(uint64_t begin_unix_time_ns,
+                                      uint64_t end_unix_time_ns) const {
+  OUTCOME_TRY(profiles, LoadProfileList());
+
+  std::vector<ProfileBucket> buckets;
+  for (const ProfileInfo& profile : profiles) {
+    if (profile.end_unix_time_ns() <= begin_unix_time_ns ||
+        profile.begin_unix_time_ns() >= end_unix_time_ns) {
+      continue;
+    }
+    OUTCOME_TRY(bucket, LoadProfile(profile.name()));
+    buckets.push_back(std::move(bucket));
+  }
+
+  return MergeProfileBuckets(buckets);
+}
+
 void ProcessManagerImpl::Start() {
   CHECK(!worker_thread_.joinable());
   worker_thread_ = std::thread([this] { WorkerFunction(); });
@@ -129,6 +206,9 @@ void ProcessManagerImpl::Start() {
 void ProcessManagerImpl::Shutdown() {
   shutdown_mutex_.Lock();
   shutdown_initiated_ = true;
+  if (watch_context_ != nullptr) {
+    watch_context_->TryCancel();
+  }
   shutdown_mutex_.Unlock();
   if (worker_thread_.joinable()) {
     worker_thread_.join();
@@ -149,15 +229,89 @@ std::unique_ptr<grpc::ClientContext> ProcessManagerImpl::CreateContext(
 
 bool IsTrue(bool* var) { return *var; }
 
+bool ProcessManagerImpl::WaitForShutdown(absl::Duration timeout) {
+  bool shutdown_initiated = shutdown_mutex_.LockWhenWithTimeout(
+      absl::Condition(IsTrue, &shutdown_initiated_), timeout);
+  shutdown_mutex_.Unlock();
+  return shutdown_initiated;
+}
+
+void ProcessManagerImpl::SetProcessList(std::vector<ProcessInfo> process_list) {
+  absl::MutexLock callback_lock(&mutex_);
+  process_list_ = std::move(process_list);
+  if (process_list_update_listener_) {
+    process_list_update_listener_(this);
+  }
+}
+
 void ProcessManagerImpl::WorkerFunction() {
+  if (!WatchProcessList()) {
+    LOG("WatchProcessList is not available, polling the process list instead");
+    PollProcessList();
+  }
+}
+
+bool ProcessManagerImpl::WatchProcessList() {
   while (true) {
-    if (shutdown_mutex_.LockWhenWithTimeout(
-            absl::Condition(IsTrue, &shutdown_initiated_), refresh_timeout_)) {
+    grpc::ClientContext context;
+    {
+      absl::MutexLock lock(&shutdown_mutex_);
+      if (shutdown_initiated_) {
+        return true;
+      }
+      watch_context_ = &context;
+    }
+
+    WatchProcessListRequest request;
+    request.set_refresh_interval_ms(
+        absl::ToInt64Milliseconds(refresh_timeout_));
+    std::unique_ptr<grpc::ClientReader<WatchProcessListResponse>> reader =
+        process_service_->WatchProcessList(&context, request);
+
+    // The first response of each call contains all the processes.
+    std::map<int32_t, ProcessInfo> processes_by_pid;
+    WatchProcessListResponse response;
+    while (reader->Read(&response)) {
+      for (int32_t pid : response.removed_pids()) {
+        processes_by_pid.erase(pid);
+      }
+      for (ProcessInfo& process : *response.mutable_updated_processes()) {
+        processes_by_pid[process.pid()] = std::move(process);
+      }
+
+      std::vector<ProcessInfo> process_list;
+      process_list.reserve(processes_by_pid.size());
+      for (const auto& [pid, process] : processes_by_pid) {
+        process_list.push_back(process);
+      }
+      SetProcessList(std::move(process_list));
+    }
+    grpc::Status status = reader->Finish();
+
+    {
+      absl::MutexLock lock(&shutdown_mutex_);
+      watch_context_ = nullptr;
+    }
+    if (status.error_code() == grpc::StatusCode::UNIMPLEMENTED) {
+      return false;
+    }
+    if (!status.ok()) {
+      ERROR("gRPC call to WatchProcessList failed: %s",
+            status.error_message());
+    }
+    // Retry after refresh_timeout_, like the polling would.
+    if (WaitForShutdown(refresh_timeout_)) {
+      return true;
+    }
+  }
+}
+
+void ProcessManagerImpl::PollProcessList() {
+  while (true) {
+    if (WaitForShutdown(refresh_timeout_)) {
       // Shutdown was initiated we need to exit
-      shutdown_mutex_.Unlock();
       return;
     }
-    shutdown_mutex_.Unlock();
     // Timeout expired - refresh the list
 
     GetProcessListRequest request;
@@ -172,12 +326,9 @@ void ProcessManagerImpl::WorkerFunction() {
       continue;
     }
 
-    absl::MutexLock callback_lock(&mutex_);
     const auto& processes = response.processes();
-    process_list_.assign(processes.begin(), processes.end());
-    if (process_list_update_listener_) {
-      process_list_update_listener_(this);
-    }
+    SetProcessList(
+        std::vector<ProcessInfo>(processes.begin(), processes.end()));
   }
 }
 
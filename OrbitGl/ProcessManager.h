@@ -14,12 +14,15 @@
 #include "module.pb.h"
 #include "outcome.hpp"
 #include "process.pb.h"
+#include "profile.pb.h"
 #include "symbol.pb.h"
 
 // This class is responsible for maintaining
-// process list. It periodically updates it
-// and calls callback to notify listeners when
-// the list is updated.
+// process list. It receives the updates of it
+// from the service, or periodically polls it
+// from services that can't send them, and calls
+// callback to notify listeners when the list
+// is updated.
 //
 // Usage example:
 //
@@ -58,6 +61,16 @@ class ProcessManager {
   virtual outcome::result<ModuleSymbols, std::string> LoadSymbols(
       const std::string& module_path) const = 0;
 
+  // Get the profiles written by the continuous profiling daemon of the
+  // service.
+  virtual outcome::result<std::vector<ProfileInfo>, std::string>
+  LoadProfileList() const = 0;
+  virtual outcome::result<ProfileBucket, std::string> LoadProfile(
+      const std::string& name) const = 0;
+  // Fetch the profiles overlapping the time range and merge them into one.
+  virtual outcome::result<ProfileBucket, std::string> LoadMergedProfile(
+      uint64_t begin_unix_time_ns, uint64_t end_unix_time_ns) const = 0;
+
   // Note that this method waits for the worker thread to stop, which could
   // take up to refresh_timeout.
   virtual void Shutdown() = 0;
@@ -0,0 +1,178 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "SyscallsDataView.h"
+
+#include "App.h"
+#include "Capture.h"
+#include "Core.h"
+#include "SyscallNames.h"
+#include "Utils.h"
+
+//-----------------------------------------------------------------------------
+SyscallsDataView::SyscallsDataView() : DataView(DataViewType::SYSCALLS) {
+  m_UpdatePeriodMs = 300;
+  OnDataChanged();
+}
+
+//-----------------------------------------------------------------------------
+const std::vector<DataView::Column>& SyscallsDataView::GetColumns() {
+  static const std::vector<Column> columns = [] {
+    std::vector<Column> columns;
+    columns.resize(COLUMN_NUM);
+    columns[COLUMN_NAME] = {"Syscall", .4f, SortingOrder::Ascending};
+    columns[COLUMN_NUMBER] = {"Number", .0f, SortingOrder::Ascending};
+    columns[COLUMN_COUNT] = {"Count", .0f, SortingOrder::Descending};
+    columns[COLUMN_TIME_TOTAL] = {"Total", .0f, SortingOrder::Descending};
+    columns[COLUMN_TIME_AVG] = {"Avg", .0f, SortingOrder::Descending};
+    columns[COLUMN_TIME_MIN] = {"Min", .0f, SortingOrder::Descending};
+    columns[COLUMN_TIME_MAX] = {"Max", .0f, SortingOrder::Descending};
+    return columns;
+  }();
+  return columns;
+}
+
+//-----------------------------------------------------------------------------
+std::string SyscallsDataView::GetValue(int a_Row, int a_Column) {
+  if (a_Row >= static_cast<int>(GetNumElements())) {
+    return "";
+  }
+
+  const auto& [syscall_number, stats] = GetSyscall(a_Row);
+
+  switch (a_Column) {
+    case COLUMN_NAME:
+      return GetSyscallName(syscall_number);
+    case COLUMN_NUMBER:
+      return absl::StrFormat("%d", syscall_number);
+    case COLUMN_COUNT:
+      return absl::StrFormat("%lu", stats.m_Count);
+    case COLUMN_TIME_TOTAL:
+      return GetPrettyTime(stats.m_TotalTimeMs);
+    case COLUMN_TIME_AVG:
+      return GetPrettyTime(stats.m_AverageTimeMs);
+    case COLUMN_TIME_MIN:
+      return GetPrettyTime(stats.m_MinMs);
+    case COLUMN_TIME_MAX:
+      return GetPrettyTime(stats.m_MaxMs);
+    default:
+      return "";
+  }
+}
+
+//-----------------------------------------------------------------------------
+#define ORBIT_SYSCALL_STAT_SORT(Member)                               \
+  [&](int a, int b) {                                                 \
+    return OrbitUtils::Compare(syscalls[a].second.Member,             \
+                               syscalls[b].second.Member, ascending); \
+  }
+
+//-----------------------------------------------------------------------------
+void SyscallsDataView::DoSort() {
+  bool ascending = m_SortingOrders[m_SortingColumn] == SortingOrder::Ascending;
+  std::function<bool(int a, int b)> sorter = nullptr;
+
+  const std::vector<std::pair<int64_t, FunctionStats>>& syscalls = m_Syscalls;
+
+  switch (m_SortingColumn) {
+    case COLUMN_NAME:
+      sorter = [&](int a, int b) {
+        return OrbitUtils::Compare(GetSyscallName(syscalls[a].first),
+                                   GetSyscallName(syscalls[b].first),
+                                   ascending);
+      };
+      break;
+    case COLUMN_NUMBER:
+      sorter = [&](int a, int b) {
+        return OrbitUtils::Compare(syscalls[a].first, syscalls[b].first,
+                                   ascending);
+      };
+      break;
+    case COLUMN_COUNT:
+      sorter = ORBIT_SYSCALL_STAT_SORT(m_Count);
+      break;
+    case COLUMN_TIME_TOTAL:
+      sorter = ORBIT_SYSCALL_STAT_SORT(m_TotalTimeMs);
+      break;
+    case COLUMN_TIME_AVG:
+      sorter = ORBIT_SYSCALL_STAT_SORT(m_AverageTimeMs);
+      break;
+    case COLUMN_TIME_MIN:
+      sorter = ORBIT_SYSCALL_STAT_SORT(m_MinMs);
+      break;
+    case COLUMN_TIME_MAX:
+      sorter = ORBIT_SYSCALL_STAT_SORT(m_MaxMs);
+      break;
+    default:
+      break;
+  }
+
+  if (sorter) {
+    std::stable_sort(m_Indices.begin(), m_Indices.end(), sorter);
+  }
+}
+
+//-----------------------------------------------------------------------------
+void SyscallsDataView::DoFilter() {
+  std::vector<uint32_t> indices;
+
+  std::vector<std::string> tokens = absl::StrSplit(ToLower(m_Filter), ' ');
+
+  for (size_t i = 0; i < m_Syscalls.size(); ++i) {
+    std::string name = ToLower(GetSyscallName(m_Syscalls[i].first));
+
+    bool match = true;
+
+    for (std::string& filterToken : tokens) {
+      if (name.find(filterToken) == std::string::npos) {
+        match = false;
+        break;
+      }
+    }
+
+    if (match) {
+      indices.push_back(i);
+    }
+  }
+
+  m_Indices = indices;
+
+  OnSort(m_SortingColumn, {});
+}
+
+//-----------------------------------------------------------------------------
+void SyscallsDataView::UpdateSyscalls() {
+  ScopeLock lock(Capture::GSyscallStatsMutex);
+  m_Syscalls.assign(Capture::GSyscallStats.begin(),
+                    Capture::GSyscallStats.end());
+}
+
+//-----------------------------------------------------------------------------
+void SyscallsDataView::OnDataChanged() {
+  UpdateSyscalls();
+
+  m_Indices.resize(m_Syscalls.size());
+  for (size_t i = 0; i < m_Syscalls.size(); ++i) {
+    m_Indices[i] = i;
+  }
+
+  DataView::OnDataChanged();
+}
+
+//-----------------------------------------------------------------------------
+void SyscallsDataView::OnTimer() {
+  if (Capture::IsCapturing()) {
+    // New syscalls can appear at any time during the capture, so take a new
+    // snapshot and re-apply the filter, which also sorts.
+    UpdateSyscalls();
+    DoFilter();
+  }
+}
+
+//-----------------------------------------------------------------------------
+const std::pair<int64_t, FunctionStats>& SyscallsDataView::GetSyscall(
+    unsigned int a_Row) const {
+  CHECK(a_Row < m_Indices.size());
+  return m_Syscalls[m_Indices[a_Row]];
+}
@@ -0,0 +1,44 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <utility>
+#include <vector>
+
+#include "DataView.h"
+#include "FunctionStats.h"
+
+//-----------------------------------------------------------------------------
+class SyscallsDataView : public DataView {
+ public:
+  SyscallsDataView();
+
+  const std::vector<Column>& GetColumns() override;
+  int GetDefaultSortingColumn() override { return COLUMN_TIME_TOTAL; }
+  std::string GetValue(int a_Row, int a_Column) override;
+
+  void OnDataChanged() override;
+  void OnTimer() override;
+
+ protected:
+  void DoFilter() override;
+  void DoSort() override;
+  void UpdateSyscalls();
+  const std::pair<int64_t, FunctionStats>& GetSyscall(unsigned int a_Row) const;
+
+  // Snapshot of Capture::GSyscallStats, which is updated while capturing.
+  std::vector<std::pair<int64_t, FunctionStats>> m_Syscalls;
+
+  enum ColumnIndex {
+    COLUMN_NAME,
+    COLUMN_NUMBER,
+    COLUMN_COUNT,
+    COLUMN_TIME_TOTAL,
+    COLUMN_TIME_AVG,
+    COLUMN_TIME_MIN,
+    COLUMN_TIME_MAX,
+    COLUMN_NUM
+  };
+};
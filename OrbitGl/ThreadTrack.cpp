@@ -10,6 +10,7 @@
 #include "EventTrack.h"
 #include "GlCanvas.h"
 #include "OrbitUnreal.h"
+#include "SyscallNames.h"
 #include "Systrace.h"
 #include "TextBox.h"
 #include "TimeGraph.h"
@@ -64,13 +65,25 @@ std::string ThreadTrack::GetExtraInfo(const Timer& timer) {
   return info;
 }
 
+//-----------------------------------------------------------------------------
+// Lock waits are blocking futex syscalls, so they share the syscall lane.
+inline bool IsInSyscallLane(const Timer& timer) {
+  return timer.m_Type == Timer::SYSCALL || timer.m_Type == Timer::LOCK_WAIT;
+}
+
 //-----------------------------------------------------------------------------
 inline Color GetTimerColor(const Timer& timer, TimeGraph* time_graph,
                            bool is_selected, bool inactive) {
   const Color kInactiveColor(100, 100, 100, 255);
   const Color kSelectionColor(0, 128, 255, 255);
+  const Color kSyscallColor(196, 118, 52, 255);
+  const Color kLockWaitColor(200, 40, 40, 255);
   if (is_selected) {
     return kSelectionColor;
+  } else if (timer.m_Type == Timer::SYSCALL) {
+    return kSyscallColor;
+  } else if (timer.m_Type == Timer::LOCK_WAIT) {
+    return kLockWaitColor;
   } else if (inactive) {
     return kInactiveColor;
   }
@@ -95,7 +108,20 @@ float ThreadTrack::GetYFromDepth(float track_y, uint32_t depth,
   }
 
   return track_y - layout.GetEventTrackHeight() -
-         layout.GetSpaceBetweenTracksAndThread() - box_height * (depth + 1);
+         layout.GetSpaceBetweenTracksAndThread() - GetSyscallLaneHeight() -
+         box_height * (depth + 1);
+}
+
+//-----------------------------------------------------------------------------
+float ThreadTrack::GetSyscallLaneHeight() const {
+  return HasSyscalls() ? time_graph_->GetLayout().GetTextBoxHeight() : 0.f;
+}
+
+//-----------------------------------------------------------------------------
+float ThreadTrack::GetSyscallLaneY(float track_y) const {
+  const TimeGraphLayout& layout = time_graph_->GetLayout();
+  return track_y - layout.GetEventTrackHeight() -
+         layout.GetSpaceBetweenTracksAndThread() - GetSyscallLaneHeight();
 }
 
 //-----------------------------------------------------------------------------
@@ -117,7 +143,22 @@ void ThreadTrack::SetTimesliceText(const Timer& timer, double elapsed_us,
           absl::StrFormat("%s %s %s", name, extra_info.c_str(), time.c_str());
 
       text_box->SetText(text);
-    } else if (timer.m_Type == Timer::INTROSPECTION) {
+    } else if (timer.m_Type == Timer::SYSCALL) {
+      std::string name =
+          GetSyscallName(static_cast<int64_t>(timer.m_UserData[0]));
+      auto return_value = static_cast<int64_t>(timer.m_UserData[1]);
+      // Negative return values are errors (-errno).
+      std::string error =
+          return_value < 0 ? absl::StrFormat(" [%d]", return_value) : "";
+      std::string text = absl::StrFormat("%s%s %s", name.c_str(),
+                                         error.c_str(), time.c_str());
+      text_box->SetText(text);
+    } else if (timer.m_Type == Timer::LOCK_WAIT) {
+      std::string text = absl::StrFormat("lock %#x %s", timer.m_UserData[0],
+                                         time.c_str());
+      text_box->SetText(text);
+    } else if (timer.m_Type == Timer::INTROSPECTION ||
+               timer.m_Type == Timer::ZONE) {
       std::string text = absl::StrFormat("%s %s",
                                          time_graph_->GetStringManager()
                                              ->Get(timer.m_UserData[0])
@@ -197,7 +238,8 @@ void ThreadTrack::UpdatePrimitives(uint64_t min_tick, uint64_t max_tick) {
         if (min_tick > timer.m_End || max_tick < timer.m_Start) continue;
         if (timer.m_Start >= min_ignore && timer.m_End <= max_ignore) continue;
 
-        UpdateDepth(timer.m_Depth + 1);
+        bool is_syscall = IsInSyscallLane(timer);
+        if (!is_syscall) UpdateDepth(timer.m_Depth + 1);
         double start_us = time_graph_->GetUsFromTick(timer.m_Start);
         double end_us = time_graph_->GetUsFromTick(timer.m_End);
         double elapsed_us = end_us - start_us;
@@ -208,7 +250,8 @@ void ThreadTrack::UpdatePrimitives(uint64_t min_tick, uint64_t max_tick) {
         float world_timer_x =
             static_cast<float>(world_start_x + normalized_start * world_width);
         float world_timer_y =
-            GetYFromDepth(m_Pos[1], timer.m_Depth, is_collapsed);
+            is_syscall ? GetSyscallLaneY(m_Pos[1])
+                       : GetYFromDepth(m_Pos[1], timer.m_Depth, is_collapsed);
 
         bool is_visible_width = normalized_length * canvas->getWidth() > 1;
         bool is_selected = &text_box == Capture::GSelectedTextBox;
@@ -217,7 +260,8 @@ void ThreadTrack::UpdatePrimitives(uint64_t min_tick, uint64_t max_tick) {
             Capture::GVisibleFunctionsMap[timer.m_FunctionAddress] == nullptr;
 
         Vec2 pos(world_timer_x, world_timer_y);
-        Vec2 size(world_timer_width, box_height);
+        Vec2 size(world_timer_width,
+                  is_syscall ? GetSyscallLaneHeight() : box_height);
         float z = GlCanvas::Z_VALUE_BOX_ACTIVE;
         Color color =
             GetTimerColor(timer, time_graph_, is_selected, is_inactive);
@@ -250,17 +294,26 @@ void ThreadTrack::OnDrag(int x, int y) { Track::OnDrag(x, y); }
 
 //-----------------------------------------------------------------------------
 void ThreadTrack::OnTimer(const Timer& timer) {
-  if (timer.m_Type != Timer::CORE_ACTIVITY) {
+  if (timer.m_Type != Timer::CORE_ACTIVITY && !IsInSyscallLane(timer)) {
     UpdateDepth(timer.m_Depth + 1);
   }
 
   TextBox text_box(Vec2(0, 0), Vec2(0, 0), "", Color(255, 0, 0, 255));
   text_box.SetTimer(timer);
 
-  std::shared_ptr<TimerChain> timer_chain = timers_[timer.m_Depth];
-  if (timer_chain == nullptr) {
-    timer_chain = std::make_shared<TimerChain>();
-    timers_[timer.m_Depth] = timer_chain;
+  std::shared_ptr<TimerChain> timer_chain;
+  if (IsInSyscallLane(timer)) {
+    if (syscall_timers_ == nullptr) {
+      ScopeLock lock(mutex_);
+      syscall_timers_ = std::make_shared<TimerChain>();
+    }
+    timer_chain = syscall_timers_;
+  } else {
+    timer_chain = timers_[timer.m_Depth];
+    if (timer_chain == nullptr) {
+      timer_chain = std::make_shared<TimerChain>();
+      timers_[timer.m_Depth] = timer_chain;
+    }
   }
   timer_chain->push_back(text_box);
   ++num_timers_;
@@ -274,8 +327,9 @@ float ThreadTrack::GetHeight() const {
   bool is_collapsed = collapse_toggle_.IsCollapsed();
   uint32_t collapsed_depth = (GetNumTimers() == 0) ? 0 : 1;
   uint32_t depth = is_collapsed ? collapsed_depth : GetDepth();
-  return layout.GetTextBoxHeight() * depth +
-         (depth > 0 ? layout.GetSpaceBetweenTracksAndThread() : 0) +
+  return layout.GetTextBoxHeight() * depth + GetSyscallLaneHeight() +
+         (depth > 0 || HasSyscalls() ? layout.GetSpaceBetweenTracksAndThread()
+                                     : 0) +
          layout.GetEventTrackHeight() + layout.GetTrackBottomMargin();
 }
 
@@ -286,6 +340,9 @@ std::vector<std::shared_ptr<TimerChain>> ThreadTrack::GetTimers() {
   for (auto& pair : timers_) {
     timers.push_back(pair.second);
   }
+  if (syscall_timers_ != nullptr) {
+    timers.push_back(syscall_timers_);
+  }
   return timers;
 }
 
@@ -337,11 +394,21 @@ std::shared_ptr<TimerChain> ThreadTrack::GetTimers(uint32_t depth) const {
   return nullptr;
 }
 
+//-----------------------------------------------------------------------------
+std::shared_ptr<TimerChain> ThreadTrack::GetChainForTimer(
+    const Timer& timer) const {
+  if (IsInSyscallLane(timer)) {
+    ScopeLock lock(mutex_);
+    return syscall_timers_;
+  }
+  return GetTimers(timer.m_Depth);
+}
+
 //-----------------------------------------------------------------------------
 const TextBox* ThreadTrack::GetLeft(TextBox* text_box) const {
   const Timer& timer = text_box->GetTimer();
   if (timer.m_TID == thread_id_) {
-    std::shared_ptr<TimerChain> timers = GetTimers(timer.m_Depth);
+    std::shared_ptr<TimerChain> timers = GetChainForTimer(timer);
     if (timers) return timers->GetElementBefore(text_box);
   }
   return nullptr;
@@ -351,7 +418,7 @@ const TextBox* ThreadTrack::GetLeft(TextBox* text_box) const {
 const TextBox* ThreadTrack::GetRight(TextBox* text_box) const {
   const Timer& timer = text_box->GetTimer();
   if (timer.m_TID == thread_id_) {
-    std::shared_ptr<TimerChain> timers = GetTimers(timer.m_Depth);
+    std::shared_ptr<TimerChain> timers = GetChainForTimer(timer);
     if (timers) return timers->GetElementAfter(text_box);
   }
   return nullptr;
@@ -375,6 +442,9 @@ std::vector<std::shared_ptr<TimerChain>> ThreadTrack::GetAllChains() {
   for (const auto& pair : timers_) {
     chains.push_back(pair.second);
   }
+  if (syscall_timers_ != nullptr) {
+    chains.push_back(syscall_timers_);
+  }
   return chains;
 }
 
@@ -59,13 +59,19 @@ class ThreadTrack : public Track {
 
   int32_t GetThreadId() const { return thread_id_; }
   bool IsCollapsable() const override { return depth_ > 1; }
+  bool HasSyscalls() const { return syscall_timers_ != nullptr; }
 
  protected:
   void UpdateDepth(uint32_t depth) {
     if (depth > depth_) depth_ = depth;
   }
   virtual float GetYFromDepth(float track_y, uint32_t depth, bool collapsed);
+  // Syscalls are drawn in their own lane, between the event track and the
+  // function calls.
+  float GetSyscallLaneHeight() const;
+  float GetSyscallLaneY(float track_y) const;
   std::shared_ptr<TimerChain> GetTimers(uint32_t depth) const;
+  std::shared_ptr<TimerChain> GetChainForTimer(const Timer& timer) const;
 
  private:
   void SetTimesliceText(const Timer& timer, double elapsed_us, float min_x,
@@ -78,4 +84,5 @@ class ThreadTrack : public Track {
   ThreadID thread_id_;
   mutable Mutex mutex_;
   std::map<int, std::shared_ptr<TimerChain>> timers_;
+  std::shared_ptr<TimerChain> syscall_timers_;
 };
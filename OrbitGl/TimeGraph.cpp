@@ -92,6 +92,8 @@ void TimeGraph::Clear() {
   scheduler_track_ = nullptr;
   thread_tracks_.clear();
   gpu_tracks_.clear();
+  counter_tracks_.clear();
+  lost_events_gaps_.clear();
 
   cores_seen_.clear();
   scheduler_track_ = GetOrCreateSchedulerTrack();
@@ -257,6 +259,22 @@ void TimeGraph::ProcessTimer(const Timer& a_Timer) {
     case Timer::CORE_ACTIVITY:
       Capture::GHasContextSwitches = true;
       break;
+    case Timer::SYSCALL: {
+      ScopeLock lock(Capture::GSyscallStatsMutex);
+      Capture::GSyscallStats[static_cast<int64_t>(a_Timer.m_UserData[0])]
+          .Update(a_Timer);
+      break;
+    }
+    case Timer::LOCK_WAIT:
+      Capture::GLockContentionStats.AddWait(
+          a_Timer.m_UserData[0], a_Timer.m_End - a_Timer.m_Start,
+          a_Timer.m_CallstackHash, a_Timer.m_UserData[1]);
+      break;
+    case Timer::LOST_EVENTS: {
+      ScopeLock lock(m_Mutex);
+      lost_events_gaps_.emplace_back(a_Timer.m_Start, a_Timer.m_End);
+      return;
+    }
     default:
       break;
   }
@@ -268,9 +286,19 @@ void TimeGraph::ProcessTimer(const Timer& a_Timer) {
       ++Capture::GFunctionCountMap[a_Timer.m_FunctionAddress];
       func->UpdateStats(a_Timer);
     }
+    // Function calls carry a callstack if it was recorded at function entry.
+    if (a_Timer.m_Type == Timer::NONE && a_Timer.m_CallstackHash != 0) {
+      Capture::GEntryCallstackStats.AddCall(a_Timer.m_FunctionAddress,
+                                            a_Timer.m_CallstackHash,
+                                            a_Timer.m_End - a_Timer.m_Start);
+    }
   }
 
-  if (a_Timer.m_Type == Timer::GPU_ACTIVITY) {
+  if (a_Timer.m_Type == Timer::COUNTER) {
+    std::shared_ptr<GraphTrack> track =
+        GetOrCreateCounterTrack(a_Timer.m_TID, a_Timer.m_UserData[1]);
+    track->AddTimer(a_Timer);
+  } else if (a_Timer.m_Type == Timer::GPU_ACTIVITY) {
     uint64_t timeline_hash = GetGpuTimelineHash(a_Timer);
     std::shared_ptr<GpuTrack> track = GetOrCreateGpuTrack(timeline_hash);
     track->SetName(string_manager_->Get(timeline_hash).value_or(""));
@@ -508,10 +536,50 @@ void TimeGraph::Draw(bool a_Picking) {
 
   DrawTracks(a_Picking);
   DrawBuffered(a_Picking);
+  if (!a_Picking) {
+    DrawLostEventsGaps();
+  }
 
   m_NeedsRedraw = false;
 }
 
+//-----------------------------------------------------------------------------
+void TimeGraph::DrawLostEventsGaps() {
+  ScopeLock lock(m_Mutex);
+  if (lost_events_gaps_.empty()) {
+    return;
+  }
+
+  // Shade the gaps over all tracks, so that missing data is not mistaken for
+  // inactivity. Keep even very short gaps visible.
+  const Color kLostEventsColor(255, 0, 0, 48);
+  const float min_width = m_Canvas->ScreenToworldWidth(1);
+  const float z = GlCanvas::Z_VALUE_EVENT;
+  float y0 = -m_Layout.GetSchedulerTrackOffset();
+  float y1 = min_y_;
+  uint64_t min_tick = GetTickFromUs(m_MinTimeUs);
+  uint64_t max_tick = GetTickFromUs(m_MaxTimeUs);
+
+  glPushAttrib(GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT);
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+  glColor4ubv(&kLostEventsColor[0]);
+  glBegin(GL_QUADS);
+  for (const auto& [begin_tick, end_tick] : lost_events_gaps_) {
+    if (end_tick < min_tick || begin_tick > max_tick) {
+      continue;
+    }
+    float x0 = GetWorldFromTick(begin_tick);
+    float x1 = std::max(GetWorldFromTick(end_tick), x0 + min_width);
+    glVertex3f(x0, y0, z);
+    glVertex3f(x1, y0, z);
+    glVertex3f(x1, y1, z);
+    glVertex3f(x0, y1, z);
+  }
+  glEnd();
+  glPopAttrib();
+}
+
 //-----------------------------------------------------------------------------
 void TimeGraph::DrawTracks(bool a_Picking) {
   uint32_t num_cores = GetNumCores();
@@ -532,6 +600,10 @@ void TimeGraph::DrawTracks(bool a_Picking) {
             Capture::GTargetProcess->GetThreadNameFromTID(tid);
         track->SetName(thread_name);
         std::string track_label = absl::StrFormat("%s [%u]", thread_name, tid);
+        int32_t pid = Capture::GTargetProcess->GetProcessIdFromTID(tid);
+        if (pid != Capture::GTargetProcess->GetID()) {
+          track_label = absl::StrFormat("(pid %d) %s", pid, track_label);
+        }
         track->SetLabel(track_label);
       }
     }
@@ -583,6 +655,27 @@ void TimeGraph::SetThreadFilter(const std::string& a_Filter) {
   NeedsUpdate();
 }
 
+std::shared_ptr<GraphTrack> TimeGraph::GetOrCreateCounterTrack(
+    ThreadID tid, uint64_t name_hash) {
+  ScopeLock lock(m_Mutex);
+  std::shared_ptr<GraphTrack> track = counter_tracks_[tid][name_hash];
+  if (track == nullptr) {
+    track = std::make_shared<GraphTrack>(this);
+    std::string name = string_manager_->Get(name_hash).value_or("");
+    if (tid == kProcessCounterTid) {
+      track->SetName(absl::StrFormat("%s [process]", name));
+    } else if (tid == kSystemCounterTid) {
+      track->SetName(absl::StrFormat("%s [system]", name));
+    } else {
+      track->SetName(absl::StrFormat("%s [%d]", name, tid));
+    }
+    track->SetLabel(name);
+    tracks_.emplace_back(track);
+    counter_tracks_[tid][name_hash] = track;
+  }
+  return track;
+}
+
 //-----------------------------------------------------------------------------
 void TimeGraph::SortTracks() {
   // Get or create thread track from events' thread id.
@@ -623,6 +716,32 @@ void TimeGraph::SortTracks() {
       }
     }
 
+    // Then show threads that only have counters.
+    {
+      ScopeLock lock(m_Mutex);
+      for (const auto& tid_and_tracks : counter_tracks_) {
+        ThreadID tid = tid_and_tracks.first;
+        if (tid == kProcessCounterTid || tid == kSystemCounterTid) continue;
+        if (m_ThreadCountMap.find(tid) == m_ThreadCountMap.end() &&
+            m_EventCount.find(tid) == m_EventCount.end()) {
+          sortedThreadIds.push_back(tid);
+        }
+      }
+    }
+
+    // Group the threads of other processes (multi-process captures) after the
+    // ones of the target process, by process, keeping the order above.
+    const int32_t target_pid = Capture::GTargetProcess->GetID();
+    std::stable_sort(sortedThreadIds.begin(), sortedThreadIds.end(),
+                     [target_pid](ThreadID a, ThreadID b) {
+                       int32_t a_pid =
+                           Capture::GTargetProcess->GetProcessIdFromTID(a);
+                       int32_t b_pid =
+                           Capture::GTargetProcess->GetProcessIdFromTID(b);
+                       return std::make_pair(a_pid != target_pid, a_pid) <
+                              std::make_pair(b_pid != target_pid, b_pid);
+                     });
+
     // Filter thread ids if needed
     if (!m_ThreadFilter.empty()) {
       std::vector<std::string> filters = absl::StrSplit(m_ThreadFilter, ' ');
@@ -641,33 +760,48 @@ void TimeGraph::SortTracks() {
 
     sorted_tracks_.clear();
 
-    // Scheduler Track.
+    ScopeLock lock(m_Mutex);
+
+    // Scheduler Track, followed by the system-wide counter tracks.
     if (!scheduler_track_->IsEmpty()) {
       sorted_tracks_.emplace_back(scheduler_track_);
     }
+    AppendCounterTracks(kSystemCounterTid);
 
     // Gpu Tracks.
     for (const auto& timeline_and_track : gpu_tracks_) {
       sorted_tracks_.emplace_back(timeline_and_track.second);
     }
 
-    // Process Track.
+    // Process Track, followed by the process-wide counter tracks.
     if (!process_track_->IsEmpty()) {
       sorted_tracks_.emplace_back(process_track_);
     }
+    AppendCounterTracks(kProcessCounterTid);
 
-    // Thread Tracks.
+    // Thread Tracks, each followed by the counter tracks of the thread.
     for (auto thread_id : sortedThreadIds) {
       std::shared_ptr<ThreadTrack> track = GetOrCreateThreadTrack(thread_id);
       if (!track->IsEmpty()) {
         sorted_tracks_.emplace_back(track);
       }
+      AppendCounterTracks(thread_id);
     }
 
     m_LastThreadReorder.Reset();
   }
 }
 
+void TimeGraph::AppendCounterTracks(ThreadID tid) {
+  auto counter_tracks_it = counter_tracks_.find(tid);
+  if (counter_tracks_it == counter_tracks_.end()) {
+    return;
+  }
+  for (const auto& name_and_track : counter_tracks_it->second) {
+    sorted_tracks_.emplace_back(name_and_track.second);
+  }
+}
+
 //----------------------------------------------------------------------------
 void TimeGraph::OnLeft() {
   TextBox* selection = Capture::GSelectedTextBox;
@@ -14,6 +14,7 @@
 #include "EventBuffer.h"
 #include "Geometry.h"
 #include "GpuTrack.h"
+#include "GraphTrack.h"
 #include "MemoryTracker.h"
 #include "SchedulerTrack.h"
 #include "StringManager.h"
@@ -36,6 +37,7 @@ class TimeGraph {
   void DrawLineBuffer(bool a_Picking);
   void DrawBoxBuffer(bool a_Picking);
   void DrawBuffered(bool a_Picking);
+  void DrawLostEventsGaps();
   void DrawText();
 
   void NeedsUpdate();
@@ -123,8 +125,17 @@ class TimeGraph {
   std::shared_ptr<SchedulerTrack> GetOrCreateSchedulerTrack();
   std::shared_ptr<ThreadTrack> GetOrCreateThreadTrack(ThreadID a_TID);
   std::shared_ptr<GpuTrack> GetOrCreateGpuTrack(uint64_t timeline_hash);
+  std::shared_ptr<GraphTrack> GetOrCreateCounterTrack(ThreadID tid,
+                                                      uint64_t name_hash);
 
  private:
+  // Counters sampled for the whole process or for the whole system rather
+  // than for a single thread use these thread ids.
+  static constexpr ThreadID kProcessCounterTid = 0;
+  static constexpr ThreadID kSystemCounterTid = -1;
+
+  void AppendCounterTracks(ThreadID tid);
+
   TextRenderer m_TextRendererStatic;
   TextRenderer* m_TextRenderer = nullptr;
   GlCanvas* m_Canvas = nullptr;
@@ -166,6 +177,12 @@ class TimeGraph {
   std::unordered_map<ThreadID, std::shared_ptr<ThreadTrack>> thread_tracks_;
   // Mapping from timeline hash to GPU tracks.
   std::unordered_map<uint64_t, std::shared_ptr<GpuTrack>> gpu_tracks_;
+  // Mapping from thread id, then counter name hash, to counter tracks.
+  std::unordered_map<ThreadID,
+                     std::map<uint64_t, std::shared_ptr<GraphTrack>>>
+      counter_tracks_;
+  // Time ranges in which the service lost records, shaded over all tracks.
+  std::vector<std::pair<TickType, TickType>> lost_events_gaps_;
   std::vector<std::shared_ptr<Track>> sorted_tracks_;
   std::string m_ThreadFilter;
 
@@ -0,0 +1,225 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "TracerHealthDataView.h"
+
+#include <functional>
+#include <optional>
+
+#include "Capture.h"
+#include "Utils.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/str_split.h"
+
+//-----------------------------------------------------------------------------
+TracerHealthDataView::TracerHealthDataView()
+    : DataView(DataViewType::TRACER_HEALTH) {
+  m_UpdatePeriodMs = 500;
+  OnDataChanged();
+}
+
+//-----------------------------------------------------------------------------
+const std::vector<DataView::Column>& TracerHealthDataView::GetColumns() {
+  static const std::vector<Column> columns = [] {
+    std::vector<Column> columns;
+    columns.resize(COLUMN_NUM);
+    columns[COLUMN_METRIC] = {"Metric", .4f, SortingOrder::Ascending};
+    columns[COLUMN_LAST_WINDOW] = {"Last window", .3f,
+                                   SortingOrder::Descending};
+    columns[COLUMN_CAPTURE] = {"Capture", .0f, SortingOrder::Descending};
+    return columns;
+  }();
+  return columns;
+}
+
+//-----------------------------------------------------------------------------
+std::string TracerHealthDataView::GetValue(int a_Row, int a_Column) {
+  if (a_Row >= static_cast<int>(GetNumElements())) {
+    return "";
+  }
+
+  const Metric& metric = m_Metrics[m_Indices[a_Row]];
+  switch (a_Column) {
+    case COLUMN_METRIC:
+      return metric.name;
+    case COLUMN_LAST_WINDOW:
+      return metric.last_window_value;
+    case COLUMN_CAPTURE:
+      return metric.capture_value;
+    default:
+      return "";
+  }
+}
+
+//-----------------------------------------------------------------------------
+void TracerHealthDataView::DoFilter() {
+  std::vector<uint32_t> indices;
+
+  std::vector<std::string> tokens = absl::StrSplit(ToLower(m_Filter), ' ');
+
+  for (size_t i = 0; i < m_Metrics.size(); ++i) {
+    std::string name = ToLower(m_Metrics[i].name);
+
+    bool match = true;
+
+    for (std::string& filterToken : tokens) {
+      if (name.find(filterToken) == std::string::npos) {
+        match = false;
+        break;
+      }
+    }
+
+    if (match) {
+      indices.push_back(i);
+    }
+  }
+
+  m_Indices = indices;
+}
+
+namespace {
+std::string FormatRate(uint64_t count, uint64_t window_ns) {
+  if (window_ns == 0) return "";
+  return absl::StrFormat("%.0f /s", count * 1'000'000'000.0 / window_ns);
+}
+
+std::string FormatPercentage(uint64_t part, uint64_t total) {
+  if (total == 0) return "";
+  return absl::StrFormat("%.2f%%", 100.0 * part / total);
+}
+
+std::string FormatMs(uint64_t duration_ns) {
+  return absl::StrFormat("%.1f ms", duration_ns / 1'000'000.0);
+}
+
+// Each metric is computed in the same way for the last window and for the
+// whole capture.
+struct MetricDefinition {
+  std::string name;
+  std::function<std::string(const TracerStats&)> format;
+};
+
+std::vector<MetricDefinition> GetMetricDefinitions(
+    const TracerStats& capture) {
+  std::vector<MetricDefinition> definitions = {
+      {"Tracer thread cpu usage",
+       [](const TracerStats& stats) {
+         return FormatPercentage(stats.tracer_thread_cpu_time_ns(),
+                                 stats.window_ns());
+       }},
+      {"Processing thread cpu usage",
+       [](const TracerStats& stats) {
+         return FormatPercentage(stats.processing_thread_cpu_time_ns(),
+                                 stats.window_ns());
+       }},
+      {"Max processing lag",
+       [](const TracerStats& stats) {
+         return FormatMs(stats.max_processing_lag_ns());
+       }},
+      {"Max deferred events",
+       [](const TracerStats& stats) {
+         return absl::StrFormat("%lu", stats.max_deferred_events_count());
+       }},
+      {"Lost records",
+       [](const TracerStats& stats) {
+         return FormatRate(stats.lost_count(), stats.window_ns());
+       }},
+      {"Events dropped by the sender",
+       [](const TracerStats& stats) {
+         return FormatRate(stats.sender_dropped_count(), stats.window_ns());
+       }},
+      {"Unwind errors",
+       [](const TracerStats& stats) {
+         return FormatPercentage(stats.unwind_error_count(),
+                                 stats.sample_count());
+       }},
+      {"Samples discarded in u(ret)probes",
+       [](const TracerStats& stats) {
+         return FormatPercentage(stats.discarded_samples_in_uretprobes_count(),
+                                 stats.sample_count());
+       }},
+      {"Samples",
+       [](const TracerStats& stats) {
+         return FormatRate(stats.sample_count(), stats.window_ns());
+       }},
+      {"Scheduler switches",
+       [](const TracerStats& stats) {
+         return FormatRate(stats.sched_switch_count(), stats.window_ns());
+       }},
+      {"U(ret)probes",
+       [](const TracerStats& stats) {
+         return FormatRate(stats.uprobes_count(), stats.window_ns());
+       }},
+      {"GPU events",
+       [](const TracerStats& stats) {
+         return FormatRate(stats.gpu_events_count(), stats.window_ns());
+       }},
+      {"Syscalls",
+       [](const TracerStats& stats) {
+         return FormatRate(stats.syscalls_count(), stats.window_ns());
+       }},
+      {"Futex calls",
+       [](const TracerStats& stats) {
+         return FormatRate(stats.futex_count(), stats.window_ns());
+       }},
+  };
+
+  // One row per ring buffer that lost records at some point of the capture.
+  for (const TracerStats::LostRecords& capture_lost :
+       capture.lost_per_buffer()) {
+    const std::string& buffer_name = capture_lost.buffer_name();
+    definitions.push_back(
+        {absl::StrFormat("  Lost records from %s", buffer_name),
+         [buffer_name](const TracerStats& stats) {
+           for (const TracerStats::LostRecords& lost :
+                stats.lost_per_buffer()) {
+             if (lost.buffer_name() == buffer_name) {
+               return FormatRate(lost.count(), stats.window_ns());
+             }
+           }
+           return FormatRate(0, stats.window_ns());
+         }});
+  }
+  return definitions;
+}
+}  // namespace
+
+//-----------------------------------------------------------------------------
+void TracerHealthDataView::UpdateMetrics() {
+  m_Metrics.clear();
+  std::optional<TracerStats> last_window =
+      Capture::GTracerHealth.GetLastTracerStats();
+  std::optional<TracerStats> capture =
+      Capture::GTracerHealth.GetCaptureTracerStats();
+  if (!last_window.has_value() || !capture.has_value()) {
+    return;
+  }
+
+  for (const MetricDefinition& definition :
+       GetMetricDefinitions(capture.value())) {
+    m_Metrics.push_back({definition.name,
+                         definition.format(last_window.value()),
+                         definition.format(capture.value())});
+  }
+}
+
+//-----------------------------------------------------------------------------
+void TracerHealthDataView::OnDataChanged() {
+  UpdateMetrics();
+
+  m_Indices.resize(m_Metrics.size());
+  for (size_t i = 0; i < m_Metrics.size(); ++i) {
+    m_Indices[i] = i;
+  }
+
+  DataView::OnDataChanged();
+}
+
+//-----------------------------------------------------------------------------
+void TracerHealthDataView::OnTimer() {
+  if (Capture::IsCapturing()) {
+    UpdateMetrics();
+    DoFilter();
+  }
+}
@@ -0,0 +1,46 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "DataView.h"
+
+// Shows the statistics periodically reported by the tracer in the service
+// during a capture, both for the last reported window and for the whole
+// capture, to tell whether the data being captured can be trusted.
+//-----------------------------------------------------------------------------
+class TracerHealthDataView : public DataView {
+ public:
+  TracerHealthDataView();
+
+  const std::vector<Column>& GetColumns() override;
+  bool IsSortingAllowed() override { return false; }
+  std::string GetValue(int a_Row, int a_Column) override;
+
+  void OnDataChanged() override;
+  void OnTimer() override;
+
+ protected:
+  struct Metric {
+    std::string name;
+    std::string last_window_value;
+    std::string capture_value;
+  };
+
+  void DoFilter() override;
+  void UpdateMetrics();
+
+  // Built from Capture::GTracerHealth, which is updated while capturing.
+  std::vector<Metric> m_Metrics;
+
+  enum ColumnIndex {
+    COLUMN_METRIC,
+    COLUMN_LAST_WINDOW,
+    COLUMN_CAPTURE,
+    COLUMN_NUM
+  };
+};
@@ -0,0 +1,19 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "CpuFrequencyVisitor.h"
+
+#include "OrbitBase/Logging.h"
+#include "SystemCounters.h"
+
+namespace LinuxTracing {
+
+void CpuFrequencyVisitor::visit(CpuFrequencyPerfEvent* event) {
+  CHECK(listener_ != nullptr);
+  listener_->OnCounterSample(CreateCpuFrequencyCounterSample(
+      pid_, event->GetTimestamp(), event->GetCpuId(),
+      event->GetFrequencyKhz()));
+}
+
+}  // namespace LinuxTracing
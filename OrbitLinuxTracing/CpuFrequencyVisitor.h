@@ -0,0 +1,42 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_LINUX_TRACING_CPU_FREQUENCY_VISITOR_H_
+#define ORBIT_LINUX_TRACING_CPU_FREQUENCY_VISITOR_H_
+
+#include <OrbitLinuxTracing/TracerListener.h>
+#include <sys/types.h>
+
+#include "PerfEvent.h"
+#include "PerfEventVisitor.h"
+
+namespace LinuxTracing {
+
+// CpuFrequencyVisitor notifies the listener of a CounterSample of the cpu
+// frequency track for every power:cpu_frequency record. Events need to be
+// sorted across ring buffers, as the change of frequency of a cpu is recorded
+// on the cpu that requests it.
+class CpuFrequencyVisitor : public PerfEventVisitor {
+ public:
+  // pid is the process the counter samples are attributed to.
+  explicit CpuFrequencyVisitor(pid_t pid) : pid_{pid} {}
+
+  CpuFrequencyVisitor(const CpuFrequencyVisitor&) = delete;
+  CpuFrequencyVisitor& operator=(const CpuFrequencyVisitor&) = delete;
+
+  CpuFrequencyVisitor(CpuFrequencyVisitor&&) = default;
+  CpuFrequencyVisitor& operator=(CpuFrequencyVisitor&&) = default;
+
+  void SetListener(TracerListener* listener) { listener_ = listener; }
+
+  void visit(CpuFrequencyPerfEvent* event) override;
+
+ private:
+  pid_t pid_;
+  TracerListener* listener_ = nullptr;
+};
+
+}  // namespace LinuxTracing
+
+#endif  // ORBIT_LINUX_TRACING_CPU_FREQUENCY_VISITOR_H_
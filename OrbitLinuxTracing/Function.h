@@ -12,10 +12,11 @@ namespace LinuxTracing {
 class Function {
  public:
   Function(std::string binary_path, uint64_t file_offset,
-           uint64_t virtual_address)
+           uint64_t virtual_address, bool record_entry_callstack = false)
       : binary_path_{std::move(binary_path)},
         file_offset_{file_offset},
-        virtual_address_{virtual_address} {}
+        virtual_address_{virtual_address},
+        record_entry_callstack_{record_entry_callstack} {}
 
   const std::string& BinaryPath() const { return binary_path_; }
 
@@ -23,10 +24,13 @@ class Function {
 
   uint64_t VirtualAddress() const { return virtual_address_; }
 
+  bool RecordEntryCallstack() const { return record_entry_callstack_; }
+
  private:
   std::string binary_path_;
   uint64_t file_offset_;
   uint64_t virtual_address_;
+  bool record_entry_callstack_;
 };
 }  // namespace LinuxTracing
 
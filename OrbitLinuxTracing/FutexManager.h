@@ -0,0 +1,179 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_LINUX_TRACING_FUTEX_MANAGER_H_
+#define ORBIT_LINUX_TRACING_FUTEX_MANAGER_H_
+
+#include <linux/futex.h>
+#include <sys/types.h>
+
+#include <cerrno>
+#include <optional>
+#include <utility>
+
+#include "absl/container/flat_hash_map.h"
+#include "capture.pb.h"
+
+namespace LinuxTracing {
+
+// Matches syscalls:sys_enter_futex with the following syscalls:sys_exit_futex
+// of the same thread to produce a FutexWait for every time a thread blocked on
+// a futex (which is what every contended pthread mutex, condition variable,
+// etc. ends up doing).
+// While a thread is waiting, the last thread that issues a wake-up operation on
+// the same futex is recorded as the waker. For a mutex, this is the thread that
+// was holding the lock, and its callstack shows where it was released.
+// Futexes are identified by process and address, as the same address refers to
+// different futexes in different processes.
+class FutexManager {
+ public:
+  FutexManager() = default;
+
+  FutexManager(const FutexManager&) = delete;
+  FutexManager& operator=(const FutexManager&) = delete;
+
+  FutexManager(FutexManager&&) = default;
+  FutexManager& operator=(FutexManager&&) = default;
+
+  static bool IsWaitOperation(int futex_op) {
+    switch (futex_op & FUTEX_CMD_MASK) {
+      case FUTEX_WAIT:
+      case FUTEX_WAIT_BITSET:
+      case FUTEX_LOCK_PI:
+      case FUTEX_WAIT_REQUEUE_PI:
+        return true;
+      default:
+        return false;
+    }
+  }
+
+  static bool IsWakeOperation(int futex_op) {
+    switch (futex_op & FUTEX_CMD_MASK) {
+      case FUTEX_WAKE:
+      case FUTEX_WAKE_BITSET:
+      case FUTEX_WAKE_OP:
+      case FUTEX_UNLOCK_PI:
+      case FUTEX_REQUEUE:
+      case FUTEX_CMP_REQUEUE:
+      case FUTEX_CMP_REQUEUE_PI:
+        return true;
+      default:
+        return false;
+    }
+  }
+
+  bool HasWaiters(pid_t pid, uint64_t futex_address) const {
+    return waiter_count_per_futex_.contains(std::make_pair(pid, futex_address));
+  }
+
+  void ProcessFutexWaitEnter(pid_t pid, pid_t tid, uint64_t futex_address,
+                             Callstack callstack, uint64_t begin_timestamp) {
+    // If this thread was already waiting, the sys_exit_futex was lost.
+    RemoveOpenWait(tid);
+    tid_open_waits_.insert_or_assign(
+        tid, OpenWait{pid, futex_address, begin_timestamp, std::move(callstack)});
+    ++waiter_count_per_futex_[std::make_pair(pid, futex_address)];
+  }
+
+  void ProcessFutexWakeEnter(pid_t pid, pid_t tid, uint64_t futex_address,
+                             Callstack callstack, uint64_t timestamp) {
+    // A thread that is waking up others is not waiting itself.
+    RemoveOpenWait(tid);
+    // Only keep track of wake-ups that can be attributed to a waiter.
+    if (!HasWaiters(pid, futex_address)) {
+      return;
+    }
+    last_wake_per_futex_.insert_or_assign(
+        std::make_pair(pid, futex_address),
+        Wake{tid, timestamp, std::move(callstack)});
+  }
+
+  std::optional<FutexWait> ProcessFutexExit(pid_t tid, int64_t return_value,
+                                            uint64_t end_timestamp) {
+    auto open_wait_it = tid_open_waits_.find(tid);
+    if (open_wait_it == tid_open_waits_.end()) {
+      // Either the end of a wake-up operation, or a wait that started before
+      // the capture.
+      return std::nullopt;
+    }
+    OpenWait open_wait = std::move(open_wait_it->second);
+    std::optional<Wake> last_wake = FindWake(open_wait);
+    RemoveOpenWait(tid);
+
+    // The value of the futex had already changed: the thread didn't block.
+    if (return_value == -EAGAIN || open_wait.begin_timestamp > end_timestamp) {
+      return std::nullopt;
+    }
+
+    FutexWait futex_wait;
+    futex_wait.set_pid(open_wait.pid);
+    futex_wait.set_tid(tid);
+    futex_wait.set_futex_address(open_wait.futex_address);
+    futex_wait.set_begin_timestamp_ns(open_wait.begin_timestamp);
+    futex_wait.set_end_timestamp_ns(end_timestamp);
+    *futex_wait.mutable_callstack() = std::move(open_wait.callstack);
+    if (last_wake.has_value() && last_wake->timestamp <= end_timestamp) {
+      futex_wait.set_waker_tid(last_wake->tid);
+      *futex_wait.mutable_waker_callstack() = std::move(last_wake->callstack);
+    }
+    return futex_wait;
+  }
+
+  void Clear() {
+    tid_open_waits_.clear();
+    waiter_count_per_futex_.clear();
+    last_wake_per_futex_.clear();
+  }
+
+ private:
+  struct OpenWait {
+    pid_t pid;
+    uint64_t futex_address;
+    uint64_t begin_timestamp;
+    Callstack callstack;
+  };
+
+  struct Wake {
+    pid_t tid;
+    uint64_t timestamp;
+    Callstack callstack;
+  };
+
+  std::optional<Wake> FindWake(const OpenWait& open_wait) const {
+    auto wake_it = last_wake_per_futex_.find(
+        std::make_pair(open_wait.pid, open_wait.futex_address));
+    if (wake_it == last_wake_per_futex_.end() ||
+        wake_it->second.timestamp < open_wait.begin_timestamp) {
+      return std::nullopt;
+    }
+    return wake_it->second;
+  }
+
+  void RemoveOpenWait(pid_t tid) {
+    auto open_wait_it = tid_open_waits_.find(tid);
+    if (open_wait_it == tid_open_waits_.end()) {
+      return;
+    }
+    std::pair<pid_t, uint64_t> futex = std::make_pair(
+        open_wait_it->second.pid, open_wait_it->second.futex_address);
+    tid_open_waits_.erase(open_wait_it);
+
+    auto waiter_count_it = waiter_count_per_futex_.find(futex);
+    if (waiter_count_it != waiter_count_per_futex_.end() &&
+        --waiter_count_it->second == 0) {
+      waiter_count_per_futex_.erase(waiter_count_it);
+      last_wake_per_futex_.erase(futex);
+    }
+  }
+
+  absl::flat_hash_map<pid_t, OpenWait> tid_open_waits_{};
+  // Keyed by pid and futex address.
+  absl::flat_hash_map<std::pair<pid_t, uint64_t>, uint32_t>
+      waiter_count_per_futex_{};
+  absl::flat_hash_map<std::pair<pid_t, uint64_t>, Wake> last_wake_per_futex_{};
+};
+
+}  // namespace LinuxTracing
+
+#endif  // ORBIT_LINUX_TRACING_FUTEX_MANAGER_H_
@@ -0,0 +1,161 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "FutexManager.h"
+
+namespace LinuxTracing {
+
+namespace {
+Callstack MakeCallstack(std::vector<uint64_t> pcs) {
+  Callstack callstack;
+  for (uint64_t pc : pcs) {
+    callstack.add_pcs(pc);
+  }
+  return callstack;
+}
+}  // namespace
+
+TEST(FutexManager, Operations) {
+  EXPECT_TRUE(FutexManager::IsWaitOperation(FUTEX_WAIT));
+  EXPECT_TRUE(FutexManager::IsWaitOperation(FUTEX_WAIT_PRIVATE));
+  EXPECT_TRUE(FutexManager::IsWaitOperation(FUTEX_WAIT_BITSET_PRIVATE |
+                                            FUTEX_CLOCK_REALTIME));
+  EXPECT_FALSE(FutexManager::IsWaitOperation(FUTEX_WAKE_PRIVATE));
+
+  EXPECT_TRUE(FutexManager::IsWakeOperation(FUTEX_WAKE));
+  EXPECT_TRUE(FutexManager::IsWakeOperation(FUTEX_WAKE_PRIVATE));
+  EXPECT_TRUE(FutexManager::IsWakeOperation(FUTEX_UNLOCK_PI_PRIVATE));
+  EXPECT_FALSE(FutexManager::IsWakeOperation(FUTEX_WAIT_PRIVATE));
+}
+
+TEST(FutexManager, WaitWithWaker) {
+  constexpr pid_t pid = 41;
+  constexpr pid_t waiter_tid = 42;
+  constexpr pid_t waker_tid = 43;
+  constexpr uint64_t futex_address = 0x1000;
+  FutexManager futex_manager;
+
+  futex_manager.ProcessFutexWaitEnter(pid, waiter_tid, futex_address,
+                                      MakeCallstack({1, 2, 3}), 100);
+  EXPECT_TRUE(futex_manager.HasWaiters(pid, futex_address));
+  futex_manager.ProcessFutexWakeEnter(pid, waker_tid, futex_address,
+                                      MakeCallstack({4, 5}), 150);
+  EXPECT_FALSE(futex_manager.ProcessFutexExit(waker_tid, 1, 160).has_value());
+
+  std::optional<FutexWait> futex_wait =
+      futex_manager.ProcessFutexExit(waiter_tid, 0, 200);
+  ASSERT_TRUE(futex_wait.has_value());
+  EXPECT_EQ(futex_wait->pid(), pid);
+  EXPECT_EQ(futex_wait->tid(), waiter_tid);
+  EXPECT_EQ(futex_wait->futex_address(), futex_address);
+  EXPECT_EQ(futex_wait->begin_timestamp_ns(), 100);
+  EXPECT_EQ(futex_wait->end_timestamp_ns(), 200);
+  EXPECT_THAT(futex_wait->callstack().pcs(), testing::ElementsAre(1, 2, 3));
+  EXPECT_EQ(futex_wait->waker_tid(), waker_tid);
+  EXPECT_THAT(futex_wait->waker_callstack().pcs(), testing::ElementsAre(4, 5));
+
+  EXPECT_FALSE(futex_manager.HasWaiters(pid, futex_address));
+}
+
+TEST(FutexManager, WaitWithoutWaker) {
+  constexpr pid_t pid = 41;
+  constexpr pid_t tid = 42;
+  FutexManager futex_manager;
+
+  futex_manager.ProcessFutexWaitEnter(pid, tid, 0x1000, MakeCallstack({1}),
+                                      100);
+  std::optional<FutexWait> futex_wait =
+      futex_manager.ProcessFutexExit(tid, -ETIMEDOUT, 200);
+  ASSERT_TRUE(futex_wait.has_value());
+  EXPECT_EQ(futex_wait->waker_tid(), 0);
+  EXPECT_EQ(futex_wait->waker_callstack_or_key_case(),
+            FutexWait::WAKER_CALLSTACK_OR_KEY_NOT_SET);
+}
+
+TEST(FutexManager, WakeBeforeWaitIsIgnored) {
+  constexpr pid_t pid = 41;
+  constexpr uint64_t futex_address = 0x1000;
+  FutexManager futex_manager;
+
+  futex_manager.ProcessFutexWakeEnter(pid, 43, futex_address,
+                                      MakeCallstack({4}), 50);
+  futex_manager.ProcessFutexWaitEnter(pid, 42, futex_address,
+                                      MakeCallstack({1}), 100);
+  std::optional<FutexWait> futex_wait =
+      futex_manager.ProcessFutexExit(42, 0, 200);
+  ASSERT_TRUE(futex_wait.has_value());
+  EXPECT_EQ(futex_wait->waker_tid(), 0);
+}
+
+TEST(FutexManager, WakeOnOtherFutexIsIgnored) {
+  constexpr pid_t pid = 41;
+  FutexManager futex_manager;
+
+  futex_manager.ProcessFutexWaitEnter(pid, 42, 0x1000, MakeCallstack({1}),
+                                      100);
+  futex_manager.ProcessFutexWaitEnter(pid, 44, 0x2000, MakeCallstack({1}),
+                                      110);
+  futex_manager.ProcessFutexWakeEnter(pid, 43, 0x2000, MakeCallstack({4}),
+                                      150);
+  std::optional<FutexWait> futex_wait =
+      futex_manager.ProcessFutexExit(42, 0, 200);
+  ASSERT_TRUE(futex_wait.has_value());
+  EXPECT_EQ(futex_wait->waker_tid(), 0);
+
+  futex_wait = futex_manager.ProcessFutexExit(44, 0, 210);
+  ASSERT_TRUE(futex_wait.has_value());
+  EXPECT_EQ(futex_wait->waker_tid(), 43);
+}
+
+TEST(FutexManager, NoWaitOnEagain) {
+  constexpr pid_t pid = 41;
+  constexpr pid_t tid = 42;
+  FutexManager futex_manager;
+
+  futex_manager.ProcessFutexWaitEnter(pid, tid, 0x1000, MakeCallstack({1}),
+                                      100);
+  EXPECT_FALSE(futex_manager.ProcessFutexExit(tid, -EAGAIN, 101).has_value());
+  EXPECT_FALSE(futex_manager.HasWaiters(pid, 0x1000));
+}
+
+TEST(FutexManager, WakeOnSameAddressInOtherProcessIsIgnored) {
+  constexpr uint64_t futex_address = 0x1000;
+  FutexManager futex_manager;
+
+  futex_manager.ProcessFutexWaitEnter(41, 42, futex_address,
+                                      MakeCallstack({1}), 100);
+  EXPECT_FALSE(futex_manager.HasWaiters(51, futex_address));
+  futex_manager.ProcessFutexWaitEnter(51, 52, futex_address,
+                                      MakeCallstack({1}), 110);
+  futex_manager.ProcessFutexWakeEnter(51, 53, futex_address,
+                                      MakeCallstack({4}), 150);
+  std::optional<FutexWait> futex_wait =
+      futex_manager.ProcessFutexExit(42, 0, 200);
+  ASSERT_TRUE(futex_wait.has_value());
+  EXPECT_EQ(futex_wait->waker_tid(), 0);
+
+  // The first waiter leaving doesn't drop the wake-up in the other process.
+  futex_wait = futex_manager.ProcessFutexExit(52, 0, 210);
+  ASSERT_TRUE(futex_wait.has_value());
+  EXPECT_EQ(futex_wait->pid(), 51);
+  EXPECT_EQ(futex_wait->waker_tid(), 53);
+}
+
+TEST(FutexManager, ExitWithoutEnter) {
+  FutexManager futex_manager;
+  EXPECT_FALSE(futex_manager.ProcessFutexExit(42, 0, 100).has_value());
+}
+
+TEST(FutexManager, Clear) {
+  FutexManager futex_manager;
+  futex_manager.ProcessFutexWaitEnter(41, 42, 0x1000, MakeCallstack({1}), 100);
+  futex_manager.Clear();
+  EXPECT_FALSE(futex_manager.HasWaiters(41, 0x1000));
+  EXPECT_FALSE(futex_manager.ProcessFutexExit(42, 0, 200).has_value());
+}
+
+}  // namespace LinuxTracing
@@ -0,0 +1,49 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "FutexVisitor.h"
+
+#include "OrbitBase/Logging.h"
+
+namespace LinuxTracing {
+
+namespace {
+Callstack CallchainToCallstack(const FutexEnterPerfEvent& event) {
+  Callstack callstack;
+  // Skip the first frame as the top of a perf_event_open callchain is always
+  // inside kernel code.
+  for (uint64_t frame_index = 1; frame_index < event.GetCallchainSize();
+       ++frame_index) {
+    callstack.add_pcs(event.GetCallchain()[frame_index]);
+  }
+  return callstack;
+}
+}  // namespace
+
+void FutexVisitor::visit(FutexEnterPerfEvent* event) {
+  int futex_op = event->GetFutexOp();
+  uint64_t futex_address = event->GetFutexAddress();
+  if (FutexManager::IsWaitOperation(futex_op)) {
+    futex_manager_.ProcessFutexWaitEnter(
+        event->GetPid(), event->GetTid(), futex_address,
+        CallchainToCallstack(*event), event->GetTimestamp());
+  } else if (FutexManager::IsWakeOperation(futex_op) &&
+             futex_manager_.HasWaiters(event->GetPid(), futex_address)) {
+    futex_manager_.ProcessFutexWakeEnter(
+        event->GetPid(), event->GetTid(), futex_address,
+        CallchainToCallstack(*event), event->GetTimestamp());
+  }
+}
+
+void FutexVisitor::visit(FutexExitPerfEvent* event) {
+  CHECK(listener_ != nullptr);
+
+  std::optional<FutexWait> futex_wait = futex_manager_.ProcessFutexExit(
+      event->GetTid(), event->GetReturnValue(), event->GetTimestamp());
+  if (futex_wait.has_value()) {
+    listener_->OnFutexWait(std::move(futex_wait.value()));
+  }
+}
+
+}  // namespace LinuxTracing
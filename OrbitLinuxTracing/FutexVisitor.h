@@ -0,0 +1,41 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_LINUX_TRACING_FUTEX_VISITOR_H_
+#define ORBIT_LINUX_TRACING_FUTEX_VISITOR_H_
+
+#include <OrbitLinuxTracing/TracerListener.h>
+
+#include "FutexManager.h"
+#include "PerfEvent.h"
+#include "PerfEventVisitor.h"
+
+namespace LinuxTracing {
+
+// FutexVisitor processes syscalls:sys_enter_futex and syscalls:sys_exit_futex
+// records, assuming they come in order, and notifies the listener of every
+// FutexWait, i.e., of every time a thread was blocked on a lock.
+class FutexVisitor : public PerfEventVisitor {
+ public:
+  FutexVisitor() = default;
+
+  FutexVisitor(const FutexVisitor&) = delete;
+  FutexVisitor& operator=(const FutexVisitor&) = delete;
+
+  FutexVisitor(FutexVisitor&&) = default;
+  FutexVisitor& operator=(FutexVisitor&&) = default;
+
+  void SetListener(TracerListener* listener) { listener_ = listener; }
+
+  void visit(FutexEnterPerfEvent* event) override;
+  void visit(FutexExitPerfEvent* event) override;
+
+ private:
+  FutexManager futex_manager_{};
+  TracerListener* listener_ = nullptr;
+};
+
+}  // namespace LinuxTracing
+
+#endif  // ORBIT_LINUX_TRACING_FUTEX_VISITOR_H_
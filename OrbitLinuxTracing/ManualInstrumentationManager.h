@@ -0,0 +1,85 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_LINUX_TRACING_MANUAL_INSTRUMENTATION_MANAGER_H_
+#define ORBIT_LINUX_TRACING_MANUAL_INSTRUMENTATION_MANAGER_H_
+
+#include <sys/types.h>
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "capture.pb.h"
+
+namespace LinuxTracing {
+
+// Keeps, for every thread, the stack of the scopes of the Orbit.h API that
+// are open, and matches each stop with the last start of the same thread to
+// produce ManualInstrumentationScope objects.
+class ManualInstrumentationManager {
+ public:
+  ManualInstrumentationManager() = default;
+
+  ManualInstrumentationManager(const ManualInstrumentationManager&) = delete;
+  ManualInstrumentationManager& operator=(const ManualInstrumentationManager&) =
+      delete;
+
+  ManualInstrumentationManager(ManualInstrumentationManager&&) = default;
+  ManualInstrumentationManager& operator=(ManualInstrumentationManager&&) =
+      default;
+
+  void ProcessStart(pid_t pid, pid_t tid, uint64_t begin_timestamp,
+                    std::string name) {
+    tid_open_scopes_[tid].emplace_back(
+        OpenScope{pid, begin_timestamp, std::move(name)});
+  }
+
+  std::optional<ManualInstrumentationScope> ProcessStop(
+      pid_t tid, uint64_t end_timestamp) {
+    auto open_scopes_it = tid_open_scopes_.find(tid);
+    if (open_scopes_it == tid_open_scopes_.end()) {
+      // The scope was started before the capture or the thread's ring buffer
+      // was found, or its start was dropped.
+      return std::nullopt;
+    }
+
+    std::vector<OpenScope>& open_scopes = open_scopes_it->second;
+    OpenScope open_scope = std::move(open_scopes.back());
+    open_scopes.pop_back();
+
+    ManualInstrumentationScope scope;
+    scope.set_pid(open_scope.pid);
+    scope.set_tid(tid);
+    scope.set_begin_timestamp_ns(open_scope.begin_timestamp);
+    scope.set_end_timestamp_ns(end_timestamp);
+    scope.set_depth(static_cast<int32_t>(open_scopes.size()));
+    scope.set_name(std::move(open_scope.name));
+
+    if (open_scopes.empty()) {
+      tid_open_scopes_.erase(open_scopes_it);
+    }
+    return scope;
+  }
+
+  // When events of the thread have been dropped, the open scopes can no
+  // longer be matched.
+  void ClearThread(pid_t tid) { tid_open_scopes_.erase(tid); }
+
+  void Clear() { tid_open_scopes_.clear(); }
+
+ private:
+  struct OpenScope {
+    pid_t pid;
+    uint64_t begin_timestamp;
+    std::string name;
+  };
+
+  absl::flat_hash_map<pid_t, std::vector<OpenScope>> tid_open_scopes_{};
+};
+
+}  // namespace LinuxTracing
+
+#endif  // ORBIT_LINUX_TRACING_MANUAL_INSTRUMENTATION_MANAGER_H_
@@ -0,0 +1,77 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+
+#include "ManualInstrumentationManager.h"
+
+namespace LinuxTracing {
+
+TEST(ManualInstrumentationManager, NestedScopes) {
+  constexpr pid_t pid = 41;
+  constexpr pid_t tid = 42;
+  std::optional<ManualInstrumentationScope> processed_scope;
+  ManualInstrumentationManager manager;
+
+  manager.ProcessStart(pid, tid, 100, "outer");
+  manager.ProcessStart(pid, tid, 200, "inner");
+
+  processed_scope = manager.ProcessStop(tid, 300);
+  ASSERT_TRUE(processed_scope.has_value());
+  EXPECT_EQ(processed_scope.value().pid(), pid);
+  EXPECT_EQ(processed_scope.value().tid(), tid);
+  EXPECT_EQ(processed_scope.value().begin_timestamp_ns(), 200);
+  EXPECT_EQ(processed_scope.value().end_timestamp_ns(), 300);
+  EXPECT_EQ(processed_scope.value().depth(), 1);
+  EXPECT_EQ(processed_scope.value().name(), "inner");
+
+  processed_scope = manager.ProcessStop(tid, 400);
+  ASSERT_TRUE(processed_scope.has_value());
+  EXPECT_EQ(processed_scope.value().begin_timestamp_ns(), 100);
+  EXPECT_EQ(processed_scope.value().end_timestamp_ns(), 400);
+  EXPECT_EQ(processed_scope.value().depth(), 0);
+  EXPECT_EQ(processed_scope.value().name(), "outer");
+
+  processed_scope = manager.ProcessStop(tid, 500);
+  EXPECT_FALSE(processed_scope.has_value());
+}
+
+TEST(ManualInstrumentationManager, ScopesOnDifferentThreads) {
+  constexpr pid_t pid = 41;
+  constexpr pid_t tid1 = 42;
+  constexpr pid_t tid2 = 43;
+  std::optional<ManualInstrumentationScope> processed_scope;
+  ManualInstrumentationManager manager;
+
+  manager.ProcessStart(pid, tid1, 100, "first");
+  manager.ProcessStart(pid, tid2, 150, "second");
+
+  processed_scope = manager.ProcessStop(tid1, 200);
+  ASSERT_TRUE(processed_scope.has_value());
+  EXPECT_EQ(processed_scope.value().tid(), tid1);
+  EXPECT_EQ(processed_scope.value().depth(), 0);
+  EXPECT_EQ(processed_scope.value().name(), "first");
+
+  processed_scope = manager.ProcessStop(tid2, 250);
+  ASSERT_TRUE(processed_scope.has_value());
+  EXPECT_EQ(processed_scope.value().tid(), tid2);
+  EXPECT_EQ(processed_scope.value().depth(), 0);
+  EXPECT_EQ(processed_scope.value().name(), "second");
+}
+
+TEST(ManualInstrumentationManager, ClearThread) {
+  constexpr pid_t pid = 41;
+  constexpr pid_t tid1 = 42;
+  constexpr pid_t tid2 = 43;
+  ManualInstrumentationManager manager;
+
+  manager.ProcessStart(pid, tid1, 100, "first");
+  manager.ProcessStart(pid, tid2, 150, "second");
+  manager.ClearThread(tid1);
+
+  EXPECT_FALSE(manager.ProcessStop(tid1, 200).has_value());
+  EXPECT_TRUE(manager.ProcessStop(tid2, 250).has_value());
+}
+
+}  // namespace LinuxTracing
@@ -0,0 +1,148 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ManualInstrumentationReader.h"
+
+#include <OrbitBase/Logging.h>
+#include <sys/uio.h>
+
+#include <array>
+#include <cstring>
+
+#include "Utils.h"
+#include "absl/base/casts.h"
+
+namespace LinuxTracing {
+
+namespace {
+// Names longer than this are truncated.
+constexpr size_t kMaxNameLength = 256;
+
+// Reads a null-terminated string from the memory of process pid, without
+// crossing into a page that might not be mapped.
+std::string ReadString(pid_t pid, uint64_t address) {
+  std::string result;
+  std::array<char, kMaxNameLength> buffer{};
+  const uint64_t page_size = GetPageSize();
+  while (result.size() < kMaxNameLength) {
+    size_t size = std::min<uint64_t>(kMaxNameLength - result.size(),
+                                     page_size - address % page_size);
+    iovec local{buffer.data(), size};
+    iovec remote{absl::bit_cast<void*>(address), size};
+    ssize_t read_size = process_vm_readv(pid, &local, 1, &remote, 1, 0);
+    if (read_size <= 0) {
+      break;
+    }
+    size_t length = strnlen(buffer.data(), read_size);
+    result.append(buffer.data(), length);
+    if (length < static_cast<size_t>(read_size)) {
+      break;
+    }
+    address += read_size;
+  }
+  return result;
+}
+
+double GetTrackedValue(const orbit_api::ApiEvent& event) {
+  switch (event.type) {
+    case orbit_api::ApiEventType::kTrackInt:
+      return static_cast<int32_t>(static_cast<uint32_t>(event.value));
+    case orbit_api::ApiEventType::kTrackInt64:
+      return static_cast<int64_t>(event.value);
+    case orbit_api::ApiEventType::kTrackUint:
+      return static_cast<uint32_t>(event.value);
+    case orbit_api::ApiEventType::kTrackFloatAsInt:
+      return absl::bit_cast<float>(static_cast<uint32_t>(event.value));
+    case orbit_api::ApiEventType::kTrackDoubleAsInt64:
+      return absl::bit_cast<double>(event.value);
+    default:
+      return event.value;
+  }
+}
+}  // namespace
+
+uint64_t ManualInstrumentationReader::ReadEvents(TracerListener* listener) {
+  uint64_t event_count = 0;
+  ring_buffers_.ReadAll([this, listener, &event_count](
+                            ApiRingBuffers::MappedRingBuffer*
+                                mapped_ring_buffer) {
+    // We don't know where events were dropped, so the scopes open at this
+    // point can no longer be matched.
+    uint64_t dropped_count = mapped_ring_buffer->ring_buffer.GetDroppedCount();
+    if (dropped_count != mapped_ring_buffer->dropped_count) {
+      manual_instrumentation_manager_.ClearThread(mapped_ring_buffer->tid);
+      mapped_ring_buffer->dropped_count = dropped_count;
+    }
+
+    orbit_api::ApiEvent event;
+    while (mapped_ring_buffer->ring_buffer.TryRead(&event)) {
+      ++event_count;
+      ProcessEvent(event, listener);
+    }
+
+    if (mapped_ring_buffer->closed) {
+      manual_instrumentation_manager_.ClearThread(mapped_ring_buffer->tid);
+    }
+  });
+  return event_count;
+}
+
+void ManualInstrumentationReader::ProcessEvent(
+    const orbit_api::ApiEvent& event, TracerListener* listener) {
+  if (event.timestamp_ns < begin_timestamp_ns_) {
+    return;
+  }
+
+  switch (event.type) {
+    case orbit_api::ApiEventType::kStart:
+      manual_instrumentation_manager_.ProcessStart(
+          pid_, event.tid, event.timestamp_ns, GetName(event.name_address));
+      break;
+    case orbit_api::ApiEventType::kStop: {
+      std::optional<ManualInstrumentationScope> scope =
+          manual_instrumentation_manager_.ProcessStop(event.tid,
+                                                      event.timestamp_ns);
+      if (scope.has_value()) {
+        listener->OnManualInstrumentationScope(std::move(scope.value()));
+      }
+      break;
+    }
+    case orbit_api::ApiEventType::kStartAsync:
+    case orbit_api::ApiEventType::kStopAsync:
+      // Scopes across threads are not supported yet.
+      break;
+    case orbit_api::ApiEventType::kTrackInt:
+    case orbit_api::ApiEventType::kTrackInt64:
+    case orbit_api::ApiEventType::kTrackUint:
+    case orbit_api::ApiEventType::kTrackUint64:
+    case orbit_api::ApiEventType::kTrackFloatAsInt:
+    case orbit_api::ApiEventType::kTrackDoubleAsInt64: {
+      CounterSample counter_sample;
+      counter_sample.set_pid(pid_);
+      counter_sample.set_tid(event.tid);
+      counter_sample.set_timestamp_ns(event.timestamp_ns);
+      counter_sample.set_name(GetName(event.name_address));
+      counter_sample.set_value(GetTrackedValue(event));
+      listener->OnCounterSample(std::move(counter_sample));
+      break;
+    }
+    default:
+      ERROR("Unexpected Orbit API event type %u",
+            static_cast<uint32_t>(event.type));
+      break;
+  }
+}
+
+const std::string& ManualInstrumentationReader::GetName(
+    uint64_t name_address) {
+  auto name_it = names_.find(name_address);
+  if (name_it == names_.end()) {
+    std::string name =
+        name_address != 0 ? ReadString(pid_, name_address) : std::string{};
+    name_it = names_.emplace(name_address, std::move(name)).first;
+  }
+  return name_it->second;
+}
+
+}  // namespace LinuxTracing
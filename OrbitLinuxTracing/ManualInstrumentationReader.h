@@ -0,0 +1,64 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_LINUX_TRACING_MANUAL_INSTRUMENTATION_READER_H_
+#define ORBIT_LINUX_TRACING_MANUAL_INSTRUMENTATION_READER_H_
+
+#include <OrbitApi/ApiEvent.h>
+#include <OrbitLinuxTracing/TracerListener.h>
+#include <sys/types.h>
+
+#include <string>
+
+#include "ManualInstrumentationManager.h"
+#include "MemfdRingBuffers.h"
+#include "absl/container/flat_hash_map.h"
+
+namespace LinuxTracing {
+
+// Reads the events of the Orbit.h API when the target links its OrbitApi
+// implementation. Each thread of the target writes to its own ring buffer in
+// a memfd, which is found in /proc/<pid>/fd and mapped here. Scopes are sent
+// to the listener as ManualInstrumentationScopes, tracked values as
+// CounterSamples. Names are read from the memory of the target, once each.
+class ManualInstrumentationReader {
+ public:
+  // Events older than begin_timestamp_ns, e.g., from before the capture, are
+  // discarded.
+  ManualInstrumentationReader(pid_t pid, uint64_t begin_timestamp_ns)
+      : pid_{pid},
+        begin_timestamp_ns_{begin_timestamp_ns},
+        ring_buffers_{pid, orbit_api::kApiRingBufferMemfdPrefix} {}
+
+  ManualInstrumentationReader(const ManualInstrumentationReader&) = delete;
+  ManualInstrumentationReader& operator=(const ManualInstrumentationReader&) =
+      delete;
+  ManualInstrumentationReader(ManualInstrumentationReader&&) = delete;
+  ManualInstrumentationReader& operator=(ManualInstrumentationReader&&) =
+      delete;
+
+  // Maps the ring buffers of the threads that started using the API. Those of
+  // threads that have exited are unmapped once they have been read.
+  void UpdateRingBuffers() { ring_buffers_.Update(); }
+
+  // Reads all the available events and sends the results to listener.
+  // Returns the number of events read.
+  uint64_t ReadEvents(TracerListener* listener);
+
+ private:
+  using ApiRingBuffers = MemfdRingBuffers<orbit_api::ApiEvent>;
+
+  void ProcessEvent(const orbit_api::ApiEvent& event, TracerListener* listener);
+  const std::string& GetName(uint64_t name_address);
+
+  pid_t pid_;
+  uint64_t begin_timestamp_ns_;
+  ApiRingBuffers ring_buffers_;
+  absl::flat_hash_map<uint64_t, std::string> names_;
+  ManualInstrumentationManager manual_instrumentation_manager_;
+};
+
+}  // namespace LinuxTracing
+
+#endif  // ORBIT_LINUX_TRACING_MANUAL_INSTRUMENTATION_READER_H_
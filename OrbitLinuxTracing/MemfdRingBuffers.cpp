@@ -0,0 +1,74 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "MemfdRingBuffers.h"
+
+#include <OrbitBase/Logging.h>
+#include <OrbitBase/SafeStrerror.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <filesystem>
+
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/string_view.h"
+#include "absl/strings/strip.h"
+
+namespace LinuxTracing {
+
+std::vector<ThreadMemfd> ListThreadMemfds(pid_t pid,
+                                          const std::string& memfd_prefix) {
+  // The target of the link is "/memfd:<memfd_prefix><tid> (deleted)".
+  const std::string link_prefix = absl::StrCat("/memfd:", memfd_prefix);
+
+  std::vector<ThreadMemfd> memfds;
+  std::string fd_directory = absl::StrFormat("/proc/%d/fd", pid);
+  std::error_code error;
+  for (const std::filesystem::directory_entry& entry :
+       std::filesystem::directory_iterator{fd_directory, error}) {
+    std::error_code link_error;
+    std::string link =
+        std::filesystem::read_symlink(entry.path(), link_error).string();
+    absl::string_view tid_string = link;
+    if (link_error || !absl::ConsumePrefix(&tid_string, link_prefix)) {
+      continue;
+    }
+    pid_t tid;
+    if (!absl::SimpleAtoi(tid_string.substr(0, tid_string.find(' ')), &tid)) {
+      continue;
+    }
+
+    struct stat file_stat {};
+    if (stat(entry.path().c_str(), &file_stat) != 0) {
+      continue;
+    }
+    memfds.push_back({tid, file_stat.st_ino, entry.path().string(),
+                      static_cast<size_t>(file_stat.st_size)});
+  }
+  if (error) {
+    ERROR("Listing \"%s\": %s", fd_directory, error.message());
+  }
+  return memfds;
+}
+
+void* MapThreadMemfd(const ThreadMemfd& memfd) {
+  int fd = open(memfd.path.c_str(), O_RDWR | O_CLOEXEC);
+  if (fd < 0) {
+    ERROR("Opening \"%s\": %s", memfd.path, SafeStrerror(errno));
+    return nullptr;
+  }
+  void* memory =
+      mmap(nullptr, memfd.size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (memory == MAP_FAILED) {
+    ERROR("Mapping \"%s\": %s", memfd.path, SafeStrerror(errno));
+    return nullptr;
+  }
+  return memory;
+}
+
+}  // namespace LinuxTracing
@@ -0,0 +1,127 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_LINUX_TRACING_MEMFD_RING_BUFFERS_H_
+#define ORBIT_LINUX_TRACING_MEMFD_RING_BUFFERS_H_
+
+#include <OrbitBase/SharedMemoryRingBuffer.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+
+namespace LinuxTracing {
+
+// A memfd of a process named with a prefix followed by the tid of the thread
+// that created it.
+struct ThreadMemfd {
+  pid_t tid;
+  ino_t inode;
+  // In /proc/<pid>/fd.
+  std::string path;
+  size_t size;
+};
+
+std::vector<ThreadMemfd> ListThreadMemfds(pid_t pid,
+                                          const std::string& memfd_prefix);
+
+// Maps the whole memfd shared and writable, or returns nullptr.
+void* MapThreadMemfd(const ThreadMemfd& memfd);
+
+// The SharedMemoryRingBuffers that the threads of a process write to, one per
+// thread, each in a memfd that is found in /proc/<pid>/fd and mapped here.
+template <typename Record>
+class MemfdRingBuffers {
+ public:
+  using RingBuffer = OrbitBase::SharedMemoryRingBuffer<Record>;
+
+  struct MappedRingBuffer {
+    pid_t tid;
+    void* memory;
+    size_t size;
+    RingBuffer ring_buffer;
+    uint64_t dropped_count;
+    // The target closed the memfd, which happens when the thread exits.
+    bool closed = false;
+  };
+
+  MemfdRingBuffers(pid_t pid, std::string memfd_prefix)
+      : pid_{pid}, memfd_prefix_{std::move(memfd_prefix)} {}
+  ~MemfdRingBuffers() {
+    for (const auto& ring_buffer : ring_buffers_) {
+      munmap(ring_buffer.second.memory, ring_buffer.second.size);
+    }
+  }
+
+  MemfdRingBuffers(const MemfdRingBuffers&) = delete;
+  MemfdRingBuffers& operator=(const MemfdRingBuffers&) = delete;
+  MemfdRingBuffers(MemfdRingBuffers&&) = delete;
+  MemfdRingBuffers& operator=(MemfdRingBuffers&&) = delete;
+
+  // Maps the ring buffers of the threads that created one since the last call,
+  // and marks those of threads that have exited as closed.
+  void Update() {
+    absl::flat_hash_set<ino_t> inodes_found;
+    for (const ThreadMemfd& memfd : ListThreadMemfds(pid_, memfd_prefix_)) {
+      if (ring_buffers_.contains(memfd.inode)) {
+        inodes_found.insert(memfd.inode);
+        continue;
+      }
+      void* memory = MapThreadMemfd(memfd);
+      if (memory == nullptr) {
+        continue;
+      }
+      std::optional<RingBuffer> ring_buffer =
+          RingBuffer::Attach(memory, memfd.size);
+      if (!ring_buffer.has_value()) {
+        // The thread might not have initialized it yet: retry next time.
+        munmap(memory, memfd.size);
+        continue;
+      }
+      inodes_found.insert(memfd.inode);
+      ring_buffers_.emplace(
+          memfd.inode,
+          MappedRingBuffer{memfd.tid, memory, memfd.size, ring_buffer.value(),
+                           ring_buffer->GetDroppedCount()});
+    }
+
+    for (auto& ring_buffer : ring_buffers_) {
+      if (!inodes_found.contains(ring_buffer.first)) {
+        ring_buffer.second.closed = true;
+      }
+    }
+  }
+
+  // Calls read with each MappedRingBuffer, then unmaps the closed ones, as
+  // nothing writes to them anymore.
+  template <typename Read>
+  void ReadAll(Read read) {
+    for (auto it = ring_buffers_.begin(); it != ring_buffers_.end();) {
+      MappedRingBuffer& mapped_ring_buffer = it->second;
+      read(&mapped_ring_buffer);
+      if (mapped_ring_buffer.closed) {
+        munmap(mapped_ring_buffer.memory, mapped_ring_buffer.size);
+        ring_buffers_.erase(it++);
+      } else {
+        ++it;
+      }
+    }
+  }
+
+ private:
+  pid_t pid_;
+  std::string memfd_prefix_;
+  // Keyed by inode, as file descriptor numbers are reused.
+  absl::flat_hash_map<ino_t, MappedRingBuffer> ring_buffers_;
+};
+
+}  // namespace LinuxTracing
+
+#endif  // ORBIT_LINUX_TRACING_MEMFD_RING_BUFFERS_H_
@@ -36,12 +36,40 @@ void UprobesPerfEvent::Accept(PerfEventVisitor* visitor) {
   visitor->visit(this);
 }
 
+void UprobesWithStackPerfEvent::Accept(PerfEventVisitor* visitor) {
+  visitor->visit(this);
+}
+
 void UretprobesPerfEvent::Accept(PerfEventVisitor* visitor) {
   visitor->visit(this);
 }
 
+void SyscallEnterPerfEvent::Accept(PerfEventVisitor* visitor) {
+  visitor->visit(this);
+}
+
+void SyscallExitPerfEvent::Accept(PerfEventVisitor* visitor) {
+  visitor->visit(this);
+}
+
+void FutexEnterPerfEvent::Accept(PerfEventVisitor* visitor) {
+  visitor->visit(this);
+}
+
+void FutexExitPerfEvent::Accept(PerfEventVisitor* visitor) {
+  visitor->visit(this);
+}
+
+void CpuFrequencyPerfEvent::Accept(PerfEventVisitor* visitor) {
+  visitor->visit(this);
+}
+
 void LostPerfEvent::Accept(PerfEventVisitor* visitor) { visitor->visit(this); }
 
 void MapsPerfEvent::Accept(PerfEventVisitor* visitor) { visitor->visit(this); }
 
+void UprobesDisabledPerfEvent::Accept(PerfEventVisitor* visitor) {
+  visitor->visit(this);
+}
+
 }  // namespace LinuxTracing
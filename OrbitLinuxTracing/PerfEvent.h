@@ -6,6 +6,7 @@
 #define ORBIT_LINUX_TRACING_PERF_EVENT_H_
 
 #include <array>
+#include <cstring>
 #include <memory>
 
 #include "Function.h"
@@ -326,6 +327,30 @@ class UprobesPerfEvent : public PerfEvent, public AbstractUprobesPerfEvent {
   }
 };
 
+// Uprobes opened with uprobes_stack_event_open, for functions for which we
+// also record the callstack at entry. The record has the same layout as stack
+// samples.
+class UprobesWithStackPerfEvent : public StackSamplePerfEvent,
+                                  public AbstractUprobesPerfEvent {
+ public:
+  explicit UprobesWithStackPerfEvent(uint64_t dyn_size)
+      : StackSamplePerfEvent(dyn_size) {}
+
+  void Accept(PerfEventVisitor* visitor) override;
+
+  uint64_t GetSp() const { return ring_buffer_record->regs.sp; }
+  uint64_t GetIp() const { return ring_buffer_record->regs.ip; }
+
+  // At function entry, the return address is at the top of the stack.
+  uint64_t GetReturnAddress() const {
+    uint64_t return_address = 0;
+    if (GetStackSize() >= sizeof(return_address)) {
+      memcpy(&return_address, GetStackData(), sizeof(return_address));
+    }
+    return return_address;
+  }
+};
+
 class UretprobesPerfEvent : public PerfEvent, public AbstractUprobesPerfEvent {
  public:
   perf_event_ax_sample ring_buffer_record;
@@ -350,24 +375,169 @@ class UretprobesPerfEvent : public PerfEvent, public AbstractUprobesPerfEvent {
   uint32_t GetCpu() const { return ring_buffer_record.sample_id.cpu; }
 };
 
+class SyscallEnterPerfEvent : public PerfEvent {
+ public:
+  perf_event_raw_syscalls_sys_enter ring_buffer_record;
+
+  uint64_t GetTimestamp() const override {
+    return ring_buffer_record.sample_id.time;
+  }
+
+  void Accept(PerfEventVisitor* visitor) override;
+
+  pid_t GetPid() const { return ring_buffer_record.sample_id.pid; }
+  pid_t GetTid() const { return ring_buffer_record.sample_id.tid; }
+
+  uint64_t GetStreamId() const {
+    return ring_buffer_record.sample_id.stream_id;
+  }
+
+  uint32_t GetCpu() const { return ring_buffer_record.sample_id.cpu; }
+
+  int64_t GetSyscallNumber() const { return ring_buffer_record.id; }
+};
+
+class SyscallExitPerfEvent : public PerfEvent {
+ public:
+  perf_event_raw_syscalls_sys_exit ring_buffer_record;
+
+  uint64_t GetTimestamp() const override {
+    return ring_buffer_record.sample_id.time;
+  }
+
+  void Accept(PerfEventVisitor* visitor) override;
+
+  pid_t GetPid() const { return ring_buffer_record.sample_id.pid; }
+  pid_t GetTid() const { return ring_buffer_record.sample_id.tid; }
+
+  uint64_t GetStreamId() const {
+    return ring_buffer_record.sample_id.stream_id;
+  }
+
+  uint32_t GetCpu() const { return ring_buffer_record.sample_id.cpu; }
+
+  int64_t GetSyscallNumber() const { return ring_buffer_record.id; }
+  int64_t GetReturnValue() const { return ring_buffer_record.ret; }
+};
+
+class FutexEnterPerfEvent : public PerfEvent {
+ public:
+  perf_event_callchain_sample ring_buffer_record;
+  std::vector<uint64_t> ips;
+  syscalls_sys_enter_futex_data data;
+  explicit FutexEnterPerfEvent(uint64_t callchain_size) : ips(callchain_size) {
+    ring_buffer_record.nr = callchain_size;
+  }
+
+  uint64_t GetTimestamp() const override {
+    return ring_buffer_record.sample_id.time;
+  }
+
+  void Accept(PerfEventVisitor* visitor) override;
+
+  pid_t GetPid() const { return ring_buffer_record.sample_id.pid; }
+  pid_t GetTid() const { return ring_buffer_record.sample_id.tid; }
+
+  uint64_t GetStreamId() const {
+    return ring_buffer_record.sample_id.stream_id;
+  }
+
+  uint32_t GetCpu() const { return ring_buffer_record.sample_id.cpu; }
+
+  const uint64_t* GetCallchain() const { return ips.data(); }
+  uint64_t GetCallchainSize() const { return ring_buffer_record.nr; }
+
+  uint64_t GetFutexAddress() const { return data.uaddr; }
+  int GetFutexOp() const { return static_cast<int>(data.op); }
+};
+
+class FutexExitPerfEvent : public PerfEvent {
+ public:
+  perf_event_syscalls_sys_exit_futex ring_buffer_record;
+
+  uint64_t GetTimestamp() const override {
+    return ring_buffer_record.sample_id.time;
+  }
+
+  void Accept(PerfEventVisitor* visitor) override;
+
+  pid_t GetPid() const { return ring_buffer_record.sample_id.pid; }
+  pid_t GetTid() const { return ring_buffer_record.sample_id.tid; }
+
+  uint64_t GetStreamId() const {
+    return ring_buffer_record.sample_id.stream_id;
+  }
+
+  uint32_t GetCpu() const { return ring_buffer_record.sample_id.cpu; }
+
+  int64_t GetReturnValue() const { return ring_buffer_record.ret; }
+};
+
+class CpuFrequencyPerfEvent : public PerfEvent {
+ public:
+  perf_event_power_cpu_frequency ring_buffer_record;
+
+  uint64_t GetTimestamp() const override {
+    return ring_buffer_record.sample_id.time;
+  }
+
+  void Accept(PerfEventVisitor* visitor) override;
+
+  uint64_t GetStreamId() const {
+    return ring_buffer_record.sample_id.stream_id;
+  }
+
+  // The cpu whose frequency changed, not necessarily the one that recorded the
+  // event.
+  uint32_t GetCpuId() const { return ring_buffer_record.cpu_id; }
+  uint64_t GetFrequencyKhz() const { return ring_buffer_record.state; }
+};
+
 // This carries a snapshot of /proc/<pid>/maps and does not reflect a
 // perf_event_open event, but we want it to be part of the same hierarchy.
+// Empty maps mean that the process has exited.
 class MapsPerfEvent : public PerfEvent {
  public:
-  MapsPerfEvent(uint64_t timestamp, std::string maps)
-      : timestamp_{timestamp}, maps_{std::move(maps)} {}
+  MapsPerfEvent(uint64_t timestamp, pid_t pid, std::string maps)
+      : timestamp_{timestamp}, pid_{pid}, maps_{std::move(maps)} {}
 
   uint64_t GetTimestamp() const override { return timestamp_; }
 
   void Accept(PerfEventVisitor* visitor) override;
 
+  pid_t GetPid() const { return pid_; }
   const std::string& GetMaps() const { return maps_; }
 
  private:
   uint64_t timestamp_;
+  pid_t pid_;
   std::string maps_;
 };
 
+// This does not reflect a perf_event_open event either: it marks the time at
+// which the u(ret)probes of an instrumented function were disabled, after which
+// the state of the open calls is no longer consistent.
+class UprobesDisabledPerfEvent : public PerfEvent {
+ public:
+  UprobesDisabledPerfEvent(uint64_t timestamp, uint64_t function_address,
+                           uint64_t calls_per_second)
+      : timestamp_{timestamp},
+        function_address_{function_address},
+        calls_per_second_{calls_per_second} {}
+
+  uint64_t GetTimestamp() const override { return timestamp_; }
+
+  void Accept(PerfEventVisitor* visitor) override;
+
+  uint64_t GetFunctionAddress() const { return function_address_; }
+  uint64_t GetCallsPerSecond() const { return calls_per_second_; }
+
+ private:
+  uint64_t timestamp_;
+  uint64_t function_address_;
+  uint64_t calls_per_second_;
+};
+
 class PerfEventSampleRaw {
  public:
   perf_event_sample_raw ring_buffer_record;
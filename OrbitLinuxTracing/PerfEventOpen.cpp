@@ -40,8 +40,9 @@ perf_event_attr uprobe_event_attr(const char* module,
                                   uint64_t function_offset) {
   perf_event_attr pe = generic_event_attr();
 
-  pe.type = 7;  // TODO: should be read from
-                //  "/sys/bus/event_source/devices/uprobe/type"
+  // 7 is the type on most kernels, in case the actual one can't be read.
+  static const int uprobes_type = GetUprobesEventType();
+  pe.type = uprobes_type != -1 ? static_cast<uint32_t>(uprobes_type) : 7;
   pe.config1 =
       reinterpret_cast<uint64_t>(module);  // pe.config1 == pe.uprobe_path
   pe.config2 = function_offset;            // pe.config2 == pe.probe_offset
@@ -69,6 +70,14 @@ int mmap_task_event_open(pid_t pid, int32_t cpu) {
   return generic_event_open(&pe, pid, cpu);
 }
 
+int ring_buffer_event_open(pid_t pid, int32_t cpu) {
+  perf_event_attr pe = generic_event_attr();
+  pe.type = PERF_TYPE_SOFTWARE;
+  pe.config = PERF_COUNT_SW_DUMMY;
+
+  return generic_event_open(&pe, pid, cpu);
+}
+
 int stack_sample_event_open(uint64_t period_ns, pid_t pid, int32_t cpu) {
   perf_event_attr pe = generic_event_attr();
   pe.type = PERF_TYPE_SOFTWARE;
@@ -110,12 +119,12 @@ int uprobes_retaddr_event_open(const char* module, uint64_t function_offset,
 }
 
 int uprobes_stack_event_open(const char* module, uint64_t function_offset,
-                             pid_t pid, int32_t cpu) {
+                             pid_t pid, int32_t cpu, uint16_t stack_dump_size) {
   perf_event_attr pe = uprobe_event_attr(module, function_offset);
   pe.config = 0;
   pe.sample_type |= PERF_SAMPLE_REGS_USER | PERF_SAMPLE_STACK_USER;
   pe.sample_regs_user = SAMPLE_REGS_USER_ALL;
-  pe.sample_stack_user = SAMPLE_STACK_USER_SIZE;
+  pe.sample_stack_user = stack_dump_size;
 
   return generic_event_open(&pe, pid, cpu);
 }
@@ -131,6 +140,24 @@ int uretprobes_event_open(const char* module, uint64_t function_offset,
   return generic_event_open(&pe, pid, cpu);
 }
 
+int counting_event_open(uint32_t type, uint64_t config, pid_t tid,
+                        int group_fd) {
+  perf_event_attr pe{};
+  pe.size = sizeof(struct perf_event_attr);
+  pe.type = type;
+  pe.config = config;
+  pe.read_format = PERF_FORMAT_GROUP;
+  // Only the group leader needs to be enabled and disabled.
+  pe.disabled = group_fd == -1 ? 1 : 0;
+  pe.exclude_hv = 1;
+
+  int fd = perf_event_open(&pe, tid, -1, group_fd, 0);
+  if (fd == -1) {
+    ERROR("perf_event_open: %s", SafeStrerror(errno));
+  }
+  return fd;
+}
+
 void* perf_event_open_mmap_ring_buffer(int fd, uint64_t mmap_length) {
   // The size of the ring buffer excluding the metadata page must be a power of
   // two number of pages.
@@ -162,4 +189,19 @@ int tracepoint_event_open(const char* tracepoint_category,
   return generic_event_open(&pe, pid, cpu);
 }
 
+int tracepoint_callchain_event_open(const char* tracepoint_category,
+                                    const char* tracepoint_name, pid_t pid,
+                                    int32_t cpu) {
+  int tp_id = GetTracepointId(tracepoint_category, tracepoint_name);
+  perf_event_attr pe = generic_event_attr();
+  pe.type = PERF_TYPE_TRACEPOINT;
+  pe.config = tp_id;
+  pe.sample_type |= PERF_SAMPLE_CALLCHAIN | PERF_SAMPLE_RAW;
+  // TODO: Read this from /proc/sys/kernel/perf_event_max_stack
+  pe.sample_max_stack = 127;
+  pe.exclude_callchain_kernel = true;
+
+  return generic_event_open(&pe, pid, cpu);
+}
+
 }  // namespace LinuxTracing
@@ -122,6 +122,11 @@ int context_switch_event_open(pid_t pid, int32_t cpu);
 // perf_event_open for task (fork and exit) and mmap records in the same buffer.
 int mmap_task_event_open(pid_t pid, int32_t cpu);
 
+// perf_event_open for an event that records nothing, only to own a ring buffer
+// to which other events are redirected. Unlike with one of those events owning
+// the ring buffer, any of them can then be closed during the capture.
+int ring_buffer_event_open(pid_t pid, int32_t cpu);
+
 // perf_event_open for stack sampling.
 int stack_sample_event_open(uint64_t period_ns, pid_t pid, int32_t cpu);
 
@@ -132,12 +137,22 @@ int callchain_sample_event_open(uint64_t period_ns, pid_t pid, int32_t cpu);
 int uprobes_retaddr_event_open(const char* module, uint64_t function_offset,
                                pid_t pid, int32_t cpu);
 
+// Records the top stack_dump_size bytes of the stack, which must be a multiple
+// of 8 and at most SAMPLE_STACK_USER_SIZE. Unlike with stack samples, the size
+// of the records then depends on stack_dump_size.
 int uprobes_stack_event_open(const char* module, uint64_t function_offset,
-                             pid_t pid, int32_t cpu);
+                             pid_t pid, int32_t cpu, uint16_t stack_dump_size);
 
 int uretprobes_event_open(const char* module, uint64_t function_offset,
                           pid_t pid, int32_t cpu);
 
+// perf_event_open for a counting (not sampling) event of a single thread on
+// any cpu. The event is added to the group of group_fd, unless this is -1. The
+// group leader is opened disabled and with read_format PERF_FORMAT_GROUP, so
+// that the values of all the events in the group can be read at once.
+int counting_event_open(uint32_t type, uint64_t config, pid_t tid,
+                        int group_fd);
+
 // Create the ring buffer to use perf_event_open in sampled mode.
 void* perf_event_open_mmap_ring_buffer(int fd, uint64_t mmap_length);
 
@@ -148,6 +163,12 @@ void* perf_event_open_mmap_ring_buffer(int fd, uint64_t mmap_length);
 int tracepoint_event_open(const char* tracepoint_category,
                           const char* tracepoint_name, pid_t pid, int32_t cpu);
 
+// Same as tracepoint_event_open, but also records the user-space callchain
+// (collected using frame pointers) of the thread hitting the tracepoint.
+int tracepoint_callchain_event_open(const char* tracepoint_category,
+                                    const char* tracepoint_name, pid_t pid,
+                                    int32_t cpu);
+
 }  // namespace LinuxTracing
 
 #endif  // ORBIT_LINUX_TRACING_PERF_EVENT_OPEN_H_
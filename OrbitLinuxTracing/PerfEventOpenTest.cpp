@@ -0,0 +1,198 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+#include <linux/perf_event.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <string>
+
+#include "PerfEventOpen.h"
+#include "PerfEventReaders.h"
+#include "PerfEventRecords.h"
+#include "PerfEventRingBuffer.h"
+#include "Utils.h"
+#include "absl/strings/str_split.h"
+
+extern "C" __attribute__((noinline)) int UprobesFirstFunction(int value) {
+  __asm__ __volatile__("");
+  return value + 1;
+}
+
+extern "C" __attribute__((noinline)) int UprobesSecondFunction(int value) {
+  __asm__ __volatile__("");
+  return value + 2;
+}
+
+namespace LinuxTracing {
+
+namespace {
+// Returns the offset in the file of this executable of the given address.
+uint64_t GetFileOffsetOfAddress(const void* address) {
+  uint64_t absolute_address = reinterpret_cast<uint64_t>(address);
+  for (absl::string_view line : absl::StrSplit(ReadMaps(getpid()), '\n')) {
+    std::vector<std::string> tokens =
+        absl::StrSplit(line, ' ', absl::SkipEmpty());
+    if (tokens.size() < 3) {
+      continue;
+    }
+    std::vector<std::string> addresses = absl::StrSplit(tokens[0], '-');
+    uint64_t start = std::stoull(addresses[0], nullptr, 16);
+    uint64_t end = std::stoull(addresses[1], nullptr, 16);
+    if (absolute_address >= start && absolute_address < end) {
+      return absolute_address - start + std::stoull(tokens[2], nullptr, 16);
+    }
+  }
+  return 0;
+}
+
+std::string GetExecutablePath() {
+  char path[PATH_MAX];
+  ssize_t length = readlink("/proc/self/exe", path, sizeof(path) - 1);
+  if (length < 0) {
+    return "";
+  }
+  return std::string(path, length);
+}
+
+uint64_t CountSampleRecords(PerfEventRingBuffer* ring_buffer) {
+  uint64_t count = 0;
+  while (ring_buffer->HasNewData()) {
+    perf_event_header header;
+    ring_buffer->ReadHeader(&header);
+    if (header.type == PERF_RECORD_SAMPLE) {
+      ++count;
+    }
+    ring_buffer->SkipRecord(header);
+  }
+  return count;
+}
+
+// Keeps this thread on the cpu it is running on, so that all events and calls
+// of a test are on the same cpu, until destroyed.
+class ScopedPinToCurrentCpu {
+ public:
+  ScopedPinToCurrentCpu() {
+    sched_getaffinity(0, sizeof(original_cpu_set_), &original_cpu_set_);
+    cpu_ = sched_getcpu();
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    CPU_SET(cpu_, &cpu_set);
+    sched_setaffinity(0, sizeof(cpu_set), &cpu_set);
+  }
+  ~ScopedPinToCurrentCpu() {
+    sched_setaffinity(0, sizeof(original_cpu_set_), &original_cpu_set_);
+  }
+
+  ScopedPinToCurrentCpu(const ScopedPinToCurrentCpu&) = delete;
+  ScopedPinToCurrentCpu& operator=(const ScopedPinToCurrentCpu&) = delete;
+
+  int32_t GetCpu() const { return cpu_; }
+
+ private:
+  cpu_set_t original_cpu_set_;
+  int32_t cpu_;
+};
+
+// uprobes replace the first instruction of the function with a breakpoint.
+bool IsBreakpointInstalled(const void* function) {
+  return *reinterpret_cast<const volatile uint8_t*>(function) == 0xCC;
+}
+}  // namespace
+
+TEST(PerfEventOpen, FirstOpenedUprobesRedirectedToRingBufferEventCanBeClosed) {
+  ScopedPinToCurrentCpu pin;
+  int32_t cpu = pin.GetCpu();
+
+  int ring_buffer_fd = ring_buffer_event_open(-1, cpu);
+  if (ring_buffer_fd == -1) {
+    GTEST_SKIP() << "Not allowed to call perf_event_open";
+  }
+  PerfEventRingBuffer ring_buffer{ring_buffer_fd, 64, "uprobes_test"};
+  ASSERT_TRUE(ring_buffer.IsOpen());
+
+  std::string executable_path = GetExecutablePath();
+  int first_uprobes_fd = uprobes_retaddr_event_open(
+      executable_path.c_str(),
+      GetFileOffsetOfAddress(
+          reinterpret_cast<const void*>(&UprobesFirstFunction)),
+      -1, cpu);
+  ASSERT_NE(first_uprobes_fd, -1);
+  int second_uprobes_fd = uprobes_retaddr_event_open(
+      executable_path.c_str(),
+      GetFileOffsetOfAddress(
+          reinterpret_cast<const void*>(&UprobesSecondFunction)),
+      -1, cpu);
+  ASSERT_NE(second_uprobes_fd, -1);
+  perf_event_redirect(first_uprobes_fd, ring_buffer_fd);
+  perf_event_redirect(second_uprobes_fd, ring_buffer_fd);
+  perf_event_enable(first_uprobes_fd);
+  perf_event_enable(second_uprobes_fd);
+
+  volatile int result = 0;
+  result = UprobesFirstFunction(result);
+  result = UprobesSecondFunction(result);
+  EXPECT_EQ(CountSampleRecords(&ring_buffer), 2);
+  EXPECT_TRUE(IsBreakpointInstalled(
+      reinterpret_cast<const void*>(&UprobesFirstFunction)));
+
+  // As the ring buffer is owned by another event, the uprobes opened first can
+  // be closed, which removes its breakpoint, while the others keep recording.
+  perf_event_disable(first_uprobes_fd);
+  close(first_uprobes_fd);
+  EXPECT_FALSE(IsBreakpointInstalled(
+      reinterpret_cast<const void*>(&UprobesFirstFunction)));
+  result = UprobesFirstFunction(result);
+  result = UprobesSecondFunction(result);
+  EXPECT_EQ(CountSampleRecords(&ring_buffer), 1);
+  EXPECT_EQ(result, 6);
+
+  close(second_uprobes_fd);
+  close(ring_buffer_fd);
+}
+
+TEST(PerfEventOpen, UprobesStackRecordsHaveRequestedStackDumpSize) {
+  ScopedPinToCurrentCpu pin;
+  int32_t cpu = pin.GetCpu();
+
+  int ring_buffer_fd = ring_buffer_event_open(-1, cpu);
+  if (ring_buffer_fd == -1) {
+    GTEST_SKIP() << "Not allowed to call perf_event_open";
+  }
+  PerfEventRingBuffer ring_buffer{ring_buffer_fd, 64, "uprobes_test"};
+  ASSERT_TRUE(ring_buffer.IsOpen());
+
+  constexpr uint16_t kStackDumpSize = 512;
+  int uprobes_fd = uprobes_stack_event_open(
+      GetExecutablePath().c_str(),
+      GetFileOffsetOfAddress(
+          reinterpret_cast<const void*>(&UprobesFirstFunction)),
+      -1, cpu, kStackDumpSize);
+  ASSERT_NE(uprobes_fd, -1);
+  perf_event_redirect(uprobes_fd, ring_buffer_fd);
+  perf_event_enable(uprobes_fd);
+
+  volatile int result = UprobesFirstFunction(0);
+  EXPECT_EQ(result, 1);
+
+  ASSERT_TRUE(ring_buffer.HasNewData());
+  perf_event_header header;
+  ring_buffer.ReadHeader(&header);
+  ASSERT_EQ(header.type, PERF_RECORD_SAMPLE);
+  EXPECT_EQ(header.size, sizeof(perf_event_stack_sample) -
+                             SAMPLE_STACK_USER_SIZE + kStackDumpSize);
+  std::unique_ptr<UprobesWithStackPerfEvent> event =
+      ConsumeUprobesWithStackPerfEvent(&ring_buffer, header);
+  EXPECT_EQ(event->GetStackSize(), kStackDumpSize);
+  EXPECT_EQ(event->GetTid(), syscall(SYS_gettid));
+  EXPECT_FALSE(ring_buffer.HasNewData());
+
+  close(uprobes_fd);
+  close(ring_buffer_fd);
+}
+
+}  // namespace LinuxTracing
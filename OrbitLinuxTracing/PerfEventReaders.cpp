@@ -52,14 +52,43 @@ pid_t ReadSampleRecordPid(PerfEventRingBuffer* ring_buffer) {
   return pid;
 }
 
-std::unique_ptr<StackSamplePerfEvent> ConsumeStackSamplePerfEvent(
+uint64_t ReadRecordTimestamp(PerfEventRingBuffer* ring_buffer,
+                             const perf_event_header& header) {
+  uint64_t offset;
+  if (header.type == PERF_RECORD_SAMPLE) {
+    // All PERF_RECORD_SAMPLEs start with
+    //   perf_event_header header;
+    //   perf_event_sample_id_tid_time_streamid_cpu sample_id;
+    offset = sizeof(perf_event_header) +
+             offsetof(perf_event_sample_id_tid_time_streamid_cpu, time);
+  } else {
+    // As we always set perf_event_attr::sample_id_all, all other records end
+    // with
+    //   perf_event_sample_id_tid_time_streamid_cpu sample_id;
+    offset = header.size - sizeof(perf_event_sample_id_tid_time_streamid_cpu) +
+             offsetof(perf_event_sample_id_tid_time_streamid_cpu, time);
+  }
+  uint64_t time;
+  ring_buffer->ReadValueAtOffset(&time, offset);
+  return time;
+}
+
+namespace {
+template <typename StackSamplePerfEventT>
+std::unique_ptr<StackSamplePerfEventT> ConsumeStackSamplePerfEventOfType(
     PerfEventRingBuffer* ring_buffer, const perf_event_header& header) {
   // Data in the ring buffer has the layout of perf_event_stack_sample, but we
-  // copy it into dynamically_sized_perf_event_stack_sample.
-  uint64_t dyn_size;
-  ring_buffer->ReadValueAtOffset(
-      &dyn_size, offsetof(perf_event_stack_sample, stack.dyn_size));
-  auto event = std::make_unique<StackSamplePerfEvent>(dyn_size);
+  // copy it into dynamically_sized_perf_event_stack_sample. The size of the
+  // stack copy can be smaller than SAMPLE_STACK_USER_SIZE (see
+  // uprobes_stack_event_open), so dyn_size is read from the end of the record.
+  uint64_t size;
+  ring_buffer->ReadValueAtOffset(&size,
+                                 offsetof(perf_event_stack_sample, stack.size));
+  uint64_t dyn_size = 0;
+  if (size != 0) {
+    ring_buffer->ReadValueAtOffset(&dyn_size, header.size - sizeof(uint64_t));
+  }
+  auto event = std::make_unique<StackSamplePerfEventT>(dyn_size);
   event->ring_buffer_record->header = header;
   ring_buffer->ReadValueAtOffset(&event->ring_buffer_record->sample_id,
                                  offsetof(perf_event_stack_sample, sample_id));
@@ -71,6 +100,64 @@ std::unique_ptr<StackSamplePerfEvent> ConsumeStackSamplePerfEvent(
   ring_buffer->SkipRecord(header);
   return event;
 }
+}  // namespace
+
+std::unique_ptr<StackSamplePerfEvent> ConsumeStackSamplePerfEvent(
+    PerfEventRingBuffer* ring_buffer, const perf_event_header& header) {
+  return ConsumeStackSamplePerfEventOfType<StackSamplePerfEvent>(ring_buffer,
+                                                                 header);
+}
+
+std::unique_ptr<UprobesWithStackPerfEvent> ConsumeUprobesWithStackPerfEvent(
+    PerfEventRingBuffer* ring_buffer, const perf_event_header& header) {
+  // uprobes_stack_event_open produces the same record as stack samples.
+  return ConsumeStackSamplePerfEventOfType<UprobesWithStackPerfEvent>(
+      ring_buffer, header);
+}
+
+std::unique_ptr<UprobesPerfEvent> ConsumeUprobesPerfEventWithoutStack(
+    PerfEventRingBuffer* ring_buffer, const perf_event_header& header) {
+  // Without registers, the regs field is only abi, and the offsets of the
+  // stack in perf_event_stack_sample don't apply.
+  uint64_t abi = PERF_SAMPLE_REGS_ABI_NONE;
+  uint64_t size = 0;
+  if (header.size >= offsetof(perf_event_stack_sample, stack.data)) {
+    ring_buffer->ReadValueAtOffset(&abi,
+                                   offsetof(perf_event_stack_sample, regs.abi));
+    ring_buffer->ReadValueAtOffset(
+        &size, offsetof(perf_event_stack_sample, stack.size));
+  }
+  if (abi == PERF_SAMPLE_REGS_ABI_NONE || size < sizeof(uint64_t) ||
+      header.size < offsetof(perf_event_stack_sample, stack.data) +
+                        sizeof(uint64_t)) {
+    ring_buffer->SkipRecord(header);
+    return nullptr;
+  }
+
+  uint64_t sp;
+  uint64_t ip;
+  uint64_t top8bytes;
+  ring_buffer->ReadValueAtOffset(&sp,
+                                 offsetof(perf_event_stack_sample, regs.sp));
+  ring_buffer->ReadValueAtOffset(&ip,
+                                 offsetof(perf_event_stack_sample, regs.ip));
+  ring_buffer->ReadValueAtOffset(&top8bytes,
+                                 offsetof(perf_event_stack_sample, stack.data));
+
+  auto event = make_unique_for_overwrite<UprobesPerfEvent>();
+  perf_event_sp_ip_8bytes_sample& record = event->ring_buffer_record;
+  record.header = header;
+  ring_buffer->ReadValueAtOffset(&record.sample_id,
+                                 offsetof(perf_event_stack_sample, sample_id));
+  record.regs.abi = abi;
+  record.regs.sp = sp;
+  record.regs.ip = ip;
+  record.stack.size = sizeof(uint64_t);
+  record.stack.top8bytes = top8bytes;
+  record.stack.dyn_size = sizeof(uint64_t);
+  ring_buffer->SkipRecord(header);
+  return event;
+}
 
 std::unique_ptr<CallchainSamplePerfEvent> ConsumeCallchainSamplePerfEvent(
     PerfEventRingBuffer* ring_buffer, const perf_event_header& header) {
@@ -93,6 +180,33 @@ std::unique_ptr<CallchainSamplePerfEvent> ConsumeCallchainSamplePerfEvent(
   return event;
 }
 
+std::unique_ptr<FutexEnterPerfEvent> ConsumeFutexEnterPerfEvent(
+    PerfEventRingBuffer* ring_buffer, const perf_event_header& header) {
+  uint64_t nr = 0;
+  ring_buffer->ReadValueAtOffset(&nr,
+                                 offsetof(perf_event_callchain_sample, nr));
+  auto event = std::make_unique<FutexEnterPerfEvent>(nr);
+  event->ring_buffer_record.header = header;
+  ring_buffer->ReadValueAtOffset(
+      &event->ring_buffer_record.sample_id,
+      offsetof(perf_event_callchain_sample, sample_id));
+
+  uint64_t ips_offset = sizeof(perf_event_callchain_sample);
+  uint64_t ips_size_in_bytes = nr * sizeof(uint64_t);
+  ring_buffer->ReadRawAtOffset(reinterpret_cast<char*>(event->ips.data()),
+                               ips_offset, ips_size_in_bytes);
+
+  // The raw data follows the callchain, preceded by its size.
+  uint64_t raw_size_offset = ips_offset + ips_size_in_bytes;
+  uint32_t raw_size = 0;
+  ring_buffer->ReadValueAtOffset(&raw_size, raw_size_offset);
+  CHECK(raw_size >= sizeof(syscalls_sys_enter_futex_data));
+  ring_buffer->ReadValueAtOffset(&event->data,
+                                 raw_size_offset + sizeof(uint32_t));
+  ring_buffer->SkipRecord(header);
+  return event;
+}
+
 std::unique_ptr<PerfEventSampleRaw> ConsumeSampleRaw(
     PerfEventRingBuffer* ring_buffer, const perf_event_header& header) {
   uint32_t size = 0;
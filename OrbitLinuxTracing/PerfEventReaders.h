@@ -5,6 +5,9 @@
 #ifndef ORBIT_LINUX_TRACING_PERF_EVENT_READERS_H_
 #define ORBIT_LINUX_TRACING_PERF_EVENT_READERS_H_
 
+#include <OrbitBase/Logging.h>
+
+#include "MakeUniqueForOverwrite.h"
 #include "PerfEvent.h"
 #include "PerfEventRingBuffer.h"
 
@@ -18,15 +21,44 @@ uint64_t ReadSampleRecordStreamId(PerfEventRingBuffer* ring_buffer);
 
 pid_t ReadSampleRecordPid(PerfEventRingBuffer* ring_buffer);
 
+uint64_t ReadRecordTimestamp(PerfEventRingBuffer* ring_buffer,
+                             const perf_event_header& header);
+
 std::unique_ptr<StackSamplePerfEvent> ConsumeStackSamplePerfEvent(
     PerfEventRingBuffer* ring_buffer, const perf_event_header& header);
 
+std::unique_ptr<UprobesWithStackPerfEvent> ConsumeUprobesWithStackPerfEvent(
+    PerfEventRingBuffer* ring_buffer, const perf_event_header& header);
+
+// For a record of uprobes_stack_event_open that doesn't have the expected
+// stack, but still has the registers and at least the top 8 bytes of the
+// stack: the uprobe without its entry callstack. Returns nullptr otherwise.
+// The record is consumed in both cases.
+std::unique_ptr<UprobesPerfEvent> ConsumeUprobesPerfEventWithoutStack(
+    PerfEventRingBuffer* ring_buffer, const perf_event_header& header);
+
 std::unique_ptr<CallchainSamplePerfEvent> ConsumeCallchainSamplePerfEvent(
     PerfEventRingBuffer* ring_buffer, const perf_event_header& header);
 
+std::unique_ptr<FutexEnterPerfEvent> ConsumeFutexEnterPerfEvent(
+    PerfEventRingBuffer* ring_buffer, const perf_event_header& header);
+
 std::unique_ptr<PerfEventSampleRaw> ConsumeSampleRaw(
     PerfEventRingBuffer* ring_buffer, const perf_event_header& header);
 
+// Reads a tracepoint record with a fixed layout into the ring_buffer_record of
+// the corresponding PerfEvent. The record in the ring buffer can be larger than
+// ring_buffer_record because of the padding the kernel adds to the raw data.
+template <typename TracepointPerfEventT>
+std::unique_ptr<TracepointPerfEventT> ConsumeTracepointPerfEvent(
+    PerfEventRingBuffer* ring_buffer, const perf_event_header& header) {
+  auto event = make_unique_for_overwrite<TracepointPerfEventT>();
+  CHECK(header.size >= sizeof(event->ring_buffer_record));
+  ring_buffer->ReadValueAtOffset(&event->ring_buffer_record, 0);
+  ring_buffer->SkipRecord(header);
+  return event;
+}
+
 }  // namespace LinuxTracing
 
 #endif  // ORBIT_LINUX_TRACING_PERF_EVENT_READERS_H_
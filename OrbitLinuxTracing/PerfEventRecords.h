@@ -131,6 +131,87 @@ struct __attribute__((__packed__)) perf_event_sample_raw {
   // The rest of the sample is a char[size] that we read dynamically.
 };
 
+// Fields shared by all tracepoints, as described at the top of the "format"
+// file of any tracepoint in /sys/kernel/debug/tracing/events/.
+struct __attribute__((__packed__)) tracepoint_common {
+  uint16_t common_type;
+  uint8_t common_flags;
+  uint8_t common_preempt_count;
+  int32_t common_pid;
+};
+
+// Layout of the data of raw_syscalls:sys_enter, see
+// /sys/kernel/debug/tracing/events/raw_syscalls/sys_enter/format.
+// Note that the kernel pads the raw data so that the record is 8-byte aligned,
+// so perf_event_header::size can be larger than the size of this struct.
+struct __attribute__((__packed__)) perf_event_raw_syscalls_sys_enter {
+  perf_event_header header;
+  perf_event_sample_id_tid_time_streamid_cpu sample_id;
+  uint32_t size;
+  tracepoint_common common;
+  int64_t id;
+  uint64_t args[6];
+};
+
+// Layout of the data of raw_syscalls:sys_exit, see
+// /sys/kernel/debug/tracing/events/raw_syscalls/sys_exit/format.
+struct __attribute__((__packed__)) perf_event_raw_syscalls_sys_exit {
+  perf_event_header header;
+  perf_event_sample_id_tid_time_streamid_cpu sample_id;
+  uint32_t size;
+  tracepoint_common common;
+  int64_t id;
+  int64_t ret;
+};
+
+// Layout of the data of syscalls:sys_enter_futex, see
+// /sys/kernel/debug/tracing/events/syscalls/sys_enter_futex/format. All
+// syscall arguments are stored as 8 bytes.
+struct __attribute__((__packed__)) syscalls_sys_enter_futex_data {
+  tracepoint_common common;
+  int32_t syscall_nr;
+  int32_t padding;
+  uint64_t uaddr;
+  int64_t op;
+  uint64_t val;
+  uint64_t utime;
+  uint64_t uaddr2;
+  uint64_t val3;
+};
+
+// syscalls:sys_enter_futex is opened with PERF_SAMPLE_CALLCHAIN, which comes
+// before PERF_SAMPLE_RAW. The layout of the record is then:
+//   perf_event_header header;
+//   perf_event_sample_id_tid_time_streamid_cpu sample_id;
+//   uint64_t nr;
+//   uint64_t ips[nr];
+//   uint32_t size;
+//   syscalls_sys_enter_futex_data data;
+// As the callchain is dynamically sized, this record is read piece by piece.
+
+// Layout of the data of syscalls:sys_exit_futex, see
+// /sys/kernel/debug/tracing/events/syscalls/sys_exit_futex/format.
+struct __attribute__((__packed__)) perf_event_syscalls_sys_exit_futex {
+  perf_event_header header;
+  perf_event_sample_id_tid_time_streamid_cpu sample_id;
+  uint32_t size;
+  tracepoint_common common;
+  int32_t syscall_nr;
+  int32_t padding;
+  int64_t ret;
+};
+
+// Layout of the data of power:cpu_frequency, see
+// /sys/kernel/debug/tracing/events/power/cpu_frequency/format.
+struct __attribute__((__packed__)) perf_event_power_cpu_frequency {
+  perf_event_header header;
+  perf_event_sample_id_tid_time_streamid_cpu sample_id;
+  uint32_t size;
+  tracepoint_common common;
+  uint32_t state;  // The new frequency, in kHz.
+  uint32_t cpu_id;
+};
+
 struct __attribute__((__packed__)) perf_event_lost {
   perf_event_header header;
   uint64_t id;
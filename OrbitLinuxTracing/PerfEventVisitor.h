@@ -20,9 +20,16 @@ class PerfEventVisitor {
   virtual void visit(StackSamplePerfEvent*) {}
   virtual void visit(CallchainSamplePerfEvent*) {}
   virtual void visit(UprobesPerfEvent*) {}
+  virtual void visit(UprobesWithStackPerfEvent*) {}
   virtual void visit(UretprobesPerfEvent*) {}
+  virtual void visit(SyscallEnterPerfEvent*) {}
+  virtual void visit(SyscallExitPerfEvent*) {}
+  virtual void visit(FutexEnterPerfEvent*) {}
+  virtual void visit(FutexExitPerfEvent*) {}
+  virtual void visit(CpuFrequencyPerfEvent*) {}
   virtual void visit(LostPerfEvent*) {}
   virtual void visit(MapsPerfEvent*) {}
+  virtual void visit(UprobesDisabledPerfEvent*) {}
 };
 
 }  // namespace LinuxTracing
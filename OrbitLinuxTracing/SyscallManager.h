@@ -0,0 +1,82 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_LINUX_TRACING_SYSCALL_MANAGER_H_
+#define ORBIT_LINUX_TRACING_SYSCALL_MANAGER_H_
+
+#include <sys/types.h>
+
+#include <optional>
+
+#include "absl/container/flat_hash_map.h"
+#include "capture.pb.h"
+
+namespace LinuxTracing {
+
+// Keeps, for every thread, the syscall currently in progress (as syscalls
+// cannot nest) and matches raw_syscalls:sys_enter with the following
+// raw_syscalls:sys_exit to produce SystemCall objects.
+class SyscallManager {
+ public:
+  SyscallManager() = default;
+
+  SyscallManager(const SyscallManager&) = delete;
+  SyscallManager& operator=(const SyscallManager&) = delete;
+
+  SyscallManager(SyscallManager&&) = default;
+  SyscallManager& operator=(SyscallManager&&) = default;
+
+  void ProcessSyscallEnter(pid_t pid, pid_t tid, int64_t syscall_number,
+                           uint64_t begin_timestamp) {
+    // If a syscall was already open for this thread, its sys_exit was lost
+    // (or, as for exit and exit_group, never generated): just replace it.
+    tid_open_syscalls_.insert_or_assign(
+        tid, OpenSyscall{pid, syscall_number, begin_timestamp});
+  }
+
+  std::optional<SystemCall> ProcessSyscallExit(pid_t tid,
+                                               int64_t syscall_number,
+                                               int64_t return_value,
+                                               uint64_t end_timestamp) {
+    auto open_syscall_it = tid_open_syscalls_.find(tid);
+    if (open_syscall_it == tid_open_syscalls_.end()) {
+      // The syscall was entered before the capture started or its sys_enter
+      // was lost.
+      return std::nullopt;
+    }
+
+    OpenSyscall open_syscall = open_syscall_it->second;
+    tid_open_syscalls_.erase(open_syscall_it);
+    if (open_syscall.syscall_number != syscall_number ||
+        open_syscall.begin_timestamp > end_timestamp) {
+      // This sys_exit doesn't match the sys_enter we have, which means that
+      // events have been lost in between.
+      return std::nullopt;
+    }
+
+    SystemCall system_call;
+    system_call.set_pid(open_syscall.pid);
+    system_call.set_tid(tid);
+    system_call.set_syscall_number(syscall_number);
+    system_call.set_begin_timestamp_ns(open_syscall.begin_timestamp);
+    system_call.set_end_timestamp_ns(end_timestamp);
+    system_call.set_return_value(return_value);
+    return system_call;
+  }
+
+  void Clear() { tid_open_syscalls_.clear(); }
+
+ private:
+  struct OpenSyscall {
+    pid_t pid;
+    int64_t syscall_number;
+    uint64_t begin_timestamp;
+  };
+
+  absl::flat_hash_map<pid_t, OpenSyscall> tid_open_syscalls_{};
+};
+
+}  // namespace LinuxTracing
+
+#endif  // ORBIT_LINUX_TRACING_SYSCALL_MANAGER_H_
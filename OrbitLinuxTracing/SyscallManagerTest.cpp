@@ -0,0 +1,101 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+
+#include "SyscallManager.h"
+
+namespace LinuxTracing {
+
+TEST(SyscallManager, OneSyscall) {
+  constexpr pid_t pid = 41;
+  constexpr pid_t tid = 42;
+  std::optional<SystemCall> processed_system_call;
+  SyscallManager syscall_manager;
+
+  syscall_manager.ProcessSyscallEnter(pid, tid, 0, 100);
+
+  processed_system_call = syscall_manager.ProcessSyscallExit(tid, 0, 8, 200);
+  ASSERT_TRUE(processed_system_call.has_value());
+  EXPECT_EQ(processed_system_call.value().pid(), pid);
+  EXPECT_EQ(processed_system_call.value().tid(), tid);
+  EXPECT_EQ(processed_system_call.value().syscall_number(), 0);
+  EXPECT_EQ(processed_system_call.value().begin_timestamp_ns(), 100);
+  EXPECT_EQ(processed_system_call.value().end_timestamp_ns(), 200);
+  EXPECT_EQ(processed_system_call.value().return_value(), 8);
+
+  processed_system_call = syscall_manager.ProcessSyscallExit(tid, 0, 8, 300);
+  EXPECT_FALSE(processed_system_call.has_value());
+}
+
+TEST(SyscallManager, SyscallsOnDifferentThreads) {
+  constexpr pid_t pid = 41;
+  constexpr pid_t tid1 = 42;
+  constexpr pid_t tid2 = 43;
+  std::optional<SystemCall> processed_system_call;
+  SyscallManager syscall_manager;
+
+  syscall_manager.ProcessSyscallEnter(pid, tid1, 202, 100);
+  syscall_manager.ProcessSyscallEnter(pid, tid2, 1, 150);
+
+  processed_system_call = syscall_manager.ProcessSyscallExit(tid2, 1, -11, 200);
+  ASSERT_TRUE(processed_system_call.has_value());
+  EXPECT_EQ(processed_system_call.value().tid(), tid2);
+  EXPECT_EQ(processed_system_call.value().syscall_number(), 1);
+  EXPECT_EQ(processed_system_call.value().begin_timestamp_ns(), 150);
+  EXPECT_EQ(processed_system_call.value().end_timestamp_ns(), 200);
+  EXPECT_EQ(processed_system_call.value().return_value(), -11);
+
+  processed_system_call = syscall_manager.ProcessSyscallExit(tid1, 202, 0, 300);
+  ASSERT_TRUE(processed_system_call.has_value());
+  EXPECT_EQ(processed_system_call.value().tid(), tid1);
+  EXPECT_EQ(processed_system_call.value().syscall_number(), 202);
+  EXPECT_EQ(processed_system_call.value().begin_timestamp_ns(), 100);
+  EXPECT_EQ(processed_system_call.value().end_timestamp_ns(), 300);
+}
+
+TEST(SyscallManager, ExitWithoutEnter) {
+  constexpr pid_t tid = 42;
+  SyscallManager syscall_manager;
+
+  EXPECT_FALSE(syscall_manager.ProcessSyscallExit(tid, 0, 0, 100).has_value());
+}
+
+TEST(SyscallManager, LostExit) {
+  constexpr pid_t pid = 41;
+  constexpr pid_t tid = 42;
+  std::optional<SystemCall> processed_system_call;
+  SyscallManager syscall_manager;
+
+  syscall_manager.ProcessSyscallEnter(pid, tid, 0, 100);
+  syscall_manager.ProcessSyscallEnter(pid, tid, 1, 200);
+
+  processed_system_call = syscall_manager.ProcessSyscallExit(tid, 1, 4, 300);
+  ASSERT_TRUE(processed_system_call.has_value());
+  EXPECT_EQ(processed_system_call.value().syscall_number(), 1);
+  EXPECT_EQ(processed_system_call.value().begin_timestamp_ns(), 200);
+  EXPECT_EQ(processed_system_call.value().end_timestamp_ns(), 300);
+}
+
+TEST(SyscallManager, MismatchingExit) {
+  constexpr pid_t pid = 41;
+  constexpr pid_t tid = 42;
+  SyscallManager syscall_manager;
+
+  syscall_manager.ProcessSyscallEnter(pid, tid, 0, 100);
+  EXPECT_FALSE(syscall_manager.ProcessSyscallExit(tid, 1, 0, 200).has_value());
+  EXPECT_FALSE(syscall_manager.ProcessSyscallExit(tid, 0, 0, 300).has_value());
+}
+
+TEST(SyscallManager, Clear) {
+  constexpr pid_t pid = 41;
+  constexpr pid_t tid = 42;
+  SyscallManager syscall_manager;
+
+  syscall_manager.ProcessSyscallEnter(pid, tid, 0, 100);
+  syscall_manager.Clear();
+  EXPECT_FALSE(syscall_manager.ProcessSyscallExit(tid, 0, 0, 200).has_value());
+}
+
+}  // namespace LinuxTracing
@@ -0,0 +1,28 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "SyscallVisitor.h"
+
+#include "OrbitBase/Logging.h"
+
+namespace LinuxTracing {
+
+void SyscallVisitor::visit(SyscallEnterPerfEvent* event) {
+  syscall_manager_.ProcessSyscallEnter(event->GetPid(), event->GetTid(),
+                                       event->GetSyscallNumber(),
+                                       event->GetTimestamp());
+}
+
+void SyscallVisitor::visit(SyscallExitPerfEvent* event) {
+  CHECK(listener_ != nullptr);
+
+  std::optional<SystemCall> system_call = syscall_manager_.ProcessSyscallExit(
+      event->GetTid(), event->GetSyscallNumber(), event->GetReturnValue(),
+      event->GetTimestamp());
+  if (system_call.has_value()) {
+    listener_->OnSystemCall(std::move(system_call.value()));
+  }
+}
+
+}  // namespace LinuxTracing
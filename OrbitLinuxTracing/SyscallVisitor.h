@@ -0,0 +1,42 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_LINUX_TRACING_SYSCALL_VISITOR_H_
+#define ORBIT_LINUX_TRACING_SYSCALL_VISITOR_H_
+
+#include <OrbitLinuxTracing/TracerListener.h>
+
+#include "PerfEvent.h"
+#include "PerfEventVisitor.h"
+#include "SyscallManager.h"
+
+namespace LinuxTracing {
+
+// SyscallVisitor processes raw_syscalls:sys_enter and raw_syscalls:sys_exit
+// records, assuming they come in order, and notifies the listener of every
+// completed SystemCall. Events need to be sorted across ring buffers, as a
+// thread can enter a syscall on one cpu and exit it on another.
+class SyscallVisitor : public PerfEventVisitor {
+ public:
+  SyscallVisitor() = default;
+
+  SyscallVisitor(const SyscallVisitor&) = delete;
+  SyscallVisitor& operator=(const SyscallVisitor&) = delete;
+
+  SyscallVisitor(SyscallVisitor&&) = default;
+  SyscallVisitor& operator=(SyscallVisitor&&) = default;
+
+  void SetListener(TracerListener* listener) { listener_ = listener; }
+
+  void visit(SyscallEnterPerfEvent* event) override;
+  void visit(SyscallExitPerfEvent* event) override;
+
+ private:
+  SyscallManager syscall_manager_{};
+  TracerListener* listener_ = nullptr;
+};
+
+}  // namespace LinuxTracing
+
+#endif  // ORBIT_LINUX_TRACING_SYSCALL_VISITOR_H_
@@ -0,0 +1,205 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "SystemCounters.h"
+
+#include <unistd.h>
+
+#include <filesystem>
+
+#include "Utils.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/strip.h"
+
+namespace LinuxTracing {
+
+namespace {
+CounterSample CreateCounterSample(pid_t pid, pid_t tid, uint64_t timestamp_ns,
+                                  std::string name, double value) {
+  CounterSample counter_sample;
+  counter_sample.set_pid(pid);
+  counter_sample.set_tid(tid);
+  counter_sample.set_timestamp_ns(timestamp_ns);
+  counter_sample.set_name(std::move(name));
+  counter_sample.set_value(value);
+  return counter_sample;
+}
+
+std::string GetCpufreqFilename(int cpu) {
+  return absl::StrFormat(
+      "/sys/devices/system/cpu/cpu%d/cpufreq/scaling_cur_freq", cpu);
+}
+
+constexpr double kKbPerMb = 1024.0;
+}  // namespace
+
+std::optional<ProcPidStatusValues> ParseProcPidStatus(
+    const std::string& status_content) {
+  ProcPidStatusValues values;
+  bool found_vm_rss = false;
+  bool found_vm_size = false;
+  for (absl::string_view line : absl::StrSplit(status_content, '\n')) {
+    // Lines have the format "VmRSS:\t    1234 kB".
+    std::vector<absl::string_view> tokens =
+        absl::StrSplit(line, absl::ByAnyChar(" \t"), absl::SkipEmpty());
+    if (tokens.size() < 2) {
+      continue;
+    }
+    if (tokens[0] == "VmRSS:") {
+      found_vm_rss = absl::SimpleAtoi(tokens[1], &values.vm_rss_kb);
+    } else if (tokens[0] == "VmSize:") {
+      found_vm_size = absl::SimpleAtoi(tokens[1], &values.vm_size_kb);
+    }
+  }
+  if (!found_vm_rss || !found_vm_size) {
+    return std::nullopt;
+  }
+  return values;
+}
+
+std::optional<ProcPidStatValues> ParseProcPidStat(
+    const std::string& stat_content) {
+  // The second field is the command name in parentheses, which can itself
+  // contain spaces and parentheses: start after the last ')'.
+  size_t comm_end = stat_content.rfind(')');
+  if (comm_end == std::string::npos) {
+    return std::nullopt;
+  }
+  std::vector<absl::string_view> fields =
+      absl::StrSplit(absl::string_view(stat_content).substr(comm_end + 1), ' ',
+                     absl::SkipWhitespace());
+  // fields[0] is the third field of the file, "state". See proc(5).
+  constexpr size_t kMinorFaultsIndex = 10 - 3;
+  constexpr size_t kMajorFaultsIndex = 12 - 3;
+  constexpr size_t kUserTimeIndex = 14 - 3;
+  constexpr size_t kSystemTimeIndex = 15 - 3;
+  if (fields.size() <= kSystemTimeIndex) {
+    return std::nullopt;
+  }
+
+  ProcPidStatValues values;
+  if (!absl::SimpleAtoi(fields[kMinorFaultsIndex], &values.minor_faults) ||
+      !absl::SimpleAtoi(fields[kMajorFaultsIndex], &values.major_faults) ||
+      !absl::SimpleAtoi(fields[kUserTimeIndex], &values.user_time_ticks) ||
+      !absl::SimpleAtoi(fields[kSystemTimeIndex], &values.system_time_ticks)) {
+    return std::nullopt;
+  }
+  return values;
+}
+
+std::optional<uint64_t> ParseProcStatProcsRunning(
+    const std::string& stat_content) {
+  for (absl::string_view line : absl::StrSplit(stat_content, '\n')) {
+    if (absl::ConsumePrefix(&line, "procs_running ")) {
+      uint64_t procs_running;
+      if (absl::SimpleAtoi(line, &procs_running)) {
+        return procs_running;
+      }
+      return std::nullopt;
+    }
+  }
+  return std::nullopt;
+}
+
+CounterSample CreateCpuFrequencyCounterSample(pid_t pid, uint64_t timestamp_ns,
+                                              uint32_t cpu,
+                                              uint64_t frequency_khz) {
+  return CreateCounterSample(pid, kSystemCounterTid, timestamp_ns,
+                             absl::StrFormat("cpu%u frequency (MHz)", cpu),
+                             frequency_khz / 1000.0);
+}
+
+SystemCountersSampler::SystemCountersSampler(pid_t pid) : pid_{pid} {
+  // Not all machines expose cpufreq (e.g., most virtual machines): only read
+  // the files that exist, to avoid logging an error on every sample.
+  for (int cpu = 0; cpu < GetNumCores(); ++cpu) {
+    if (std::filesystem::exists(GetCpufreqFilename(cpu))) {
+      cpus_with_cpufreq_.push_back(cpu);
+    }
+  }
+}
+
+std::vector<CounterSample> SystemCountersSampler::Sample(
+    uint64_t timestamp_ns) {
+  std::vector<CounterSample> counter_samples;
+
+  std::optional<std::string> status_content =
+      ReadFile(absl::StrFormat("/proc/%d/status", pid_));
+  if (status_content.has_value()) {
+    std::optional<ProcPidStatusValues> status_values =
+        ParseProcPidStatus(status_content.value());
+    if (status_values.has_value()) {
+      counter_samples.push_back(CreateCounterSample(
+          pid_, kProcessCounterTid, timestamp_ns, "RSS (MB)",
+          status_values->vm_rss_kb / kKbPerMb));
+      counter_samples.push_back(CreateCounterSample(
+          pid_, kProcessCounterTid, timestamp_ns, "virtual memory (MB)",
+          status_values->vm_size_kb / kKbPerMb));
+    }
+  }
+
+  std::optional<std::string> stat_content =
+      ReadFile(absl::StrFormat("/proc/%d/stat", pid_));
+  std::optional<ProcPidStatValues> stat_values;
+  if (stat_content.has_value()) {
+    stat_values = ParseProcPidStat(stat_content.value());
+  }
+  // Page faults and cpu time are cumulative: report them per interval.
+  if (stat_values.has_value() && last_stat_values_.has_value() &&
+      timestamp_ns > last_timestamp_ns_) {
+    static const double kNsPerTick = 1e9 / sysconf(_SC_CLK_TCK);
+    double interval_ns = timestamp_ns - last_timestamp_ns_;
+    counter_samples.push_back(CreateCounterSample(
+        pid_, kProcessCounterTid, timestamp_ns, "minor page faults",
+        stat_values->minor_faults - last_stat_values_->minor_faults));
+    counter_samples.push_back(CreateCounterSample(
+        pid_, kProcessCounterTid, timestamp_ns, "major page faults",
+        stat_values->major_faults - last_stat_values_->major_faults));
+    counter_samples.push_back(CreateCounterSample(
+        pid_, kProcessCounterTid, timestamp_ns, "user cpu time (%)",
+        100.0 * kNsPerTick *
+            (stat_values->user_time_ticks -
+             last_stat_values_->user_time_ticks) /
+            interval_ns));
+    counter_samples.push_back(CreateCounterSample(
+        pid_, kProcessCounterTid, timestamp_ns, "system cpu time (%)",
+        100.0 * kNsPerTick *
+            (stat_values->system_time_ticks -
+             last_stat_values_->system_time_ticks) /
+            interval_ns));
+  }
+  if (stat_values.has_value()) {
+    last_stat_values_ = stat_values;
+    last_timestamp_ns_ = timestamp_ns;
+  }
+
+  std::optional<std::string> proc_stat_content = ReadFile("/proc/stat");
+  if (proc_stat_content.has_value()) {
+    std::optional<uint64_t> procs_running =
+        ParseProcStatProcsRunning(proc_stat_content.value());
+    if (procs_running.has_value()) {
+      counter_samples.push_back(
+          CreateCounterSample(pid_, kSystemCounterTid, timestamp_ns,
+                              "run queue length", procs_running.value()));
+    }
+  }
+
+  for (int cpu : cpus_with_cpufreq_) {
+    std::optional<std::string> cpufreq_content =
+        ReadFile(GetCpufreqFilename(cpu));
+    uint64_t frequency_khz;
+    if (cpufreq_content.has_value() &&
+        absl::SimpleAtoi(absl::StripAsciiWhitespace(cpufreq_content.value()),
+                         &frequency_khz)) {
+      counter_samples.push_back(CreateCpuFrequencyCounterSample(
+          pid_, timestamp_ns, cpu, frequency_khz));
+    }
+  }
+
+  return counter_samples;
+}
+
+}  // namespace LinuxTracing
@@ -0,0 +1,73 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_LINUX_TRACING_SYSTEM_COUNTERS_H_
+#define ORBIT_LINUX_TRACING_SYSTEM_COUNTERS_H_
+
+#include <sys/types.h>
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "capture.pb.h"
+
+namespace LinuxTracing {
+
+// Values of CounterSample::tid for counters that are not specific to a thread.
+static constexpr pid_t kProcessCounterTid = 0;
+static constexpr pid_t kSystemCounterTid = -1;
+
+struct ProcPidStatusValues {
+  uint64_t vm_rss_kb = 0;
+  uint64_t vm_size_kb = 0;
+};
+
+// Parses the content of /proc/<pid>/status.
+std::optional<ProcPidStatusValues> ParseProcPidStatus(
+    const std::string& status_content);
+
+struct ProcPidStatValues {
+  uint64_t minor_faults = 0;
+  uint64_t major_faults = 0;
+  uint64_t user_time_ticks = 0;
+  uint64_t system_time_ticks = 0;
+};
+
+// Parses the content of /proc/<pid>/stat.
+std::optional<ProcPidStatValues> ParseProcPidStat(
+    const std::string& stat_content);
+
+// Parses the "procs_running" line of /proc/stat, i.e., the number of threads
+// that are running or ready to run on any cpu.
+std::optional<uint64_t> ParseProcStatProcsRunning(
+    const std::string& stat_content);
+
+// Creates the CounterSample for a change of frequency of a cpu, as reported by
+// the power:cpu_frequency tracepoint or read from cpufreq.
+CounterSample CreateCpuFrequencyCounterSample(pid_t pid, uint64_t timestamp_ns,
+                                              uint32_t cpu,
+                                              uint64_t frequency_khz);
+
+// Periodically samples counters of the target process (memory, page faults,
+// cpu time) from /proc/<pid>, the run queue length from /proc/stat and the
+// frequency of each cpu from cpufreq. All the CounterSamples produced by the
+// same call to Sample have the same timestamp, so that they are aligned on the
+// client.
+class SystemCountersSampler {
+ public:
+  explicit SystemCountersSampler(pid_t pid);
+
+  std::vector<CounterSample> Sample(uint64_t timestamp_ns);
+
+ private:
+  pid_t pid_;
+  std::vector<int> cpus_with_cpufreq_;
+  std::optional<ProcPidStatValues> last_stat_values_;
+  uint64_t last_timestamp_ns_ = 0;
+};
+
+}  // namespace LinuxTracing
+
+#endif  // ORBIT_LINUX_TRACING_SYSTEM_COUNTERS_H_
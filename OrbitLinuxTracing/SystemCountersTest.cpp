@@ -0,0 +1,84 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+
+#include "SystemCounters.h"
+
+namespace LinuxTracing {
+
+TEST(ParseProcPidStatus, VmRssAndVmSize) {
+  std::string status_content =
+      "Name:\tcat\n"
+      "State:\tR (running)\n"
+      "VmPeak:\t    5748 kB\n"
+      "VmSize:\t    5748 kB\n"
+      "VmRSS:\t     736 kB\n"
+      "Threads:\t1\n";
+  std::optional<ProcPidStatusValues> values =
+      ParseProcPidStatus(status_content);
+  ASSERT_TRUE(values.has_value());
+  EXPECT_EQ(values->vm_size_kb, 5748);
+  EXPECT_EQ(values->vm_rss_kb, 736);
+}
+
+TEST(ParseProcPidStatus, KernelThread) {
+  // Kernel threads have no VmRSS and VmSize.
+  std::string status_content = "Name:\tkthreadd\nState:\tS (sleeping)\n";
+  EXPECT_FALSE(ParseProcPidStatus(status_content).has_value());
+}
+
+TEST(ParseProcPidStat, CommWithSpacesAndParentheses) {
+  std::string stat_content =
+      "1234 (a (b) c) S 1 1234 1234 0 -1 4194560 100 0 7 0 250 30 0 0 20 0 "
+      "3 0 12345 1000000 500 18446744073709551615\n";
+  std::optional<ProcPidStatValues> values = ParseProcPidStat(stat_content);
+  ASSERT_TRUE(values.has_value());
+  EXPECT_EQ(values->minor_faults, 100);
+  EXPECT_EQ(values->major_faults, 7);
+  EXPECT_EQ(values->user_time_ticks, 250);
+  EXPECT_EQ(values->system_time_ticks, 30);
+}
+
+TEST(ParseProcPidStat, Truncated) {
+  EXPECT_FALSE(ParseProcPidStat("1234 (cat) S 1 1234").has_value());
+  EXPECT_FALSE(ParseProcPidStat("").has_value());
+}
+
+TEST(ParseProcStatProcsRunning, ProcsRunning) {
+  std::string stat_content =
+      "cpu  1 2 3 4 5 6 7 0 0 0\n"
+      "ctxt 123456\n"
+      "procs_running 5\n"
+      "procs_blocked 0\n";
+  std::optional<uint64_t> procs_running =
+      ParseProcStatProcsRunning(stat_content);
+  ASSERT_TRUE(procs_running.has_value());
+  EXPECT_EQ(procs_running.value(), 5);
+
+  EXPECT_FALSE(ParseProcStatProcsRunning("ctxt 123456\n").has_value());
+}
+
+TEST(SystemCountersSampler, SampleSelf) {
+  SystemCountersSampler sampler{getpid()};
+  std::vector<CounterSample> first_samples = sampler.Sample(1'000'000'000);
+  std::vector<CounterSample> second_samples = sampler.Sample(2'000'000'000);
+
+  bool found_rss = false;
+  for (const CounterSample& counter_sample : first_samples) {
+    EXPECT_EQ(counter_sample.timestamp_ns(), 1'000'000'000);
+    found_rss |= counter_sample.name() == "RSS (MB)";
+  }
+  EXPECT_TRUE(found_rss);
+
+  // Cumulative counters are only reported from the second sample.
+  bool found_page_faults = false;
+  for (const CounterSample& counter_sample : second_samples) {
+    EXPECT_EQ(counter_sample.timestamp_ns(), 2'000'000'000);
+    found_page_faults |= counter_sample.name() == "minor page faults";
+  }
+  EXPECT_TRUE(found_page_faults);
+}
+
+}  // namespace LinuxTracing
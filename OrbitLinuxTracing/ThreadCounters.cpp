@@ -0,0 +1,168 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ThreadCounters.h"
+
+#include <OrbitBase/Logging.h>
+#include <OrbitBase/SafeStrerror.h>
+#include <linux/perf_event.h>
+#include <unistd.h>
+
+#include <array>
+#include <cerrno>
+
+#include "PerfEventOpen.h"
+
+namespace LinuxTracing {
+
+namespace {
+// The order of the events in the group, which is also the order of the values
+// returned by read(2) on the group leader.
+struct CounterEventConfig {
+  uint32_t type;
+  uint64_t config;
+};
+constexpr std::array<CounterEventConfig, 5> kThreadCounterEvents{{
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CPU_MIGRATIONS},
+}};
+
+// Layout of the data returned by read(2) on the group leader when opened with
+// read_format = PERF_FORMAT_GROUP.
+struct __attribute__((__packed__)) thread_counters_read_format {
+  uint64_t nr;
+  uint64_t values[kThreadCounterEvents.size()];
+};
+
+CounterSample CreateCounterSample(pid_t pid, pid_t tid, uint64_t timestamp_ns,
+                                  const char* name, double value) {
+  CounterSample counter_sample;
+  counter_sample.set_pid(pid);
+  counter_sample.set_tid(tid);
+  counter_sample.set_timestamp_ns(timestamp_ns);
+  counter_sample.set_name(name);
+  counter_sample.set_value(value);
+  return counter_sample;
+}
+}  // namespace
+
+std::vector<CounterSample> ComputeThreadCounterSamples(
+    pid_t pid, pid_t tid, uint64_t timestamp_ns,
+    const ThreadCounterValues& previous, const ThreadCounterValues& current) {
+  std::vector<CounterSample> counter_samples;
+
+  uint64_t cycles = current.cycles - previous.cycles;
+  uint64_t instructions = current.instructions - previous.instructions;
+  if (cycles > 0) {
+    counter_samples.push_back(CreateCounterSample(
+        pid, tid, timestamp_ns, "IPC",
+        static_cast<double>(instructions) / cycles));
+  }
+
+  uint64_t cache_references =
+      current.cache_references - previous.cache_references;
+  uint64_t cache_misses = current.cache_misses - previous.cache_misses;
+  if (cache_references > 0) {
+    counter_samples.push_back(CreateCounterSample(
+        pid, tid, timestamp_ns, "cache miss rate",
+        static_cast<double>(cache_misses) / cache_references));
+  }
+
+  uint64_t cpu_migrations = current.cpu_migrations - previous.cpu_migrations;
+  counter_samples.push_back(
+      CreateCounterSample(pid, tid, timestamp_ns, "cpu migrations",
+                          static_cast<double>(cpu_migrations)));
+
+  return counter_samples;
+}
+
+bool ThreadCountersManager::OpenAndEnable(pid_t tid) {
+  if (tid_to_counters_.contains(tid)) {
+    return true;
+  }
+
+  ThreadCounters thread_counters;
+  for (const CounterEventConfig& event : kThreadCounterEvents) {
+    int group_fd =
+        thread_counters.fds.empty() ? -1 : thread_counters.fds.front();
+    int fd = counting_event_open(event.type, event.config, tid, group_fd);
+    if (fd == -1) {
+      for (int opened_fd : thread_counters.fds) {
+        close(opened_fd);
+      }
+      return false;
+    }
+    thread_counters.fds.push_back(fd);
+  }
+
+  int group_leader_fd = thread_counters.fds.front();
+  perf_event_reset_and_enable(group_leader_fd);
+  tid_to_counters_.emplace(tid, std::move(thread_counters));
+  return true;
+}
+
+void ThreadCountersManager::Close(pid_t tid) {
+  auto counters_it = tid_to_counters_.find(tid);
+  if (counters_it == tid_to_counters_.end()) {
+    return;
+  }
+  for (int fd : counters_it->second.fds) {
+    close(fd);
+  }
+  tid_to_counters_.erase(counters_it);
+}
+
+void ThreadCountersManager::CloseAll() {
+  for (const auto& [tid, thread_counters] : tid_to_counters_) {
+    for (int fd : thread_counters.fds) {
+      close(fd);
+    }
+  }
+  tid_to_counters_.clear();
+}
+
+std::vector<CounterSample> ThreadCountersManager::ReadAll(
+    uint64_t timestamp_ns) {
+  std::vector<CounterSample> counter_samples;
+  for (auto& [tid, thread_counters] : tid_to_counters_) {
+    std::optional<ThreadCounterValues> values =
+        Read(thread_counters.fds.front());
+    if (!values.has_value()) {
+      continue;
+    }
+    std::vector<CounterSample> thread_counter_samples =
+        ComputeThreadCounterSamples(pid_, tid, timestamp_ns,
+                                    thread_counters.last_values,
+                                    values.value());
+    counter_samples.insert(
+        counter_samples.end(),
+        std::make_move_iterator(thread_counter_samples.begin()),
+        std::make_move_iterator(thread_counter_samples.end()));
+    thread_counters.last_values = values.value();
+  }
+  return counter_samples;
+}
+
+std::optional<ThreadCounterValues> ThreadCountersManager::Read(
+    int group_leader_fd) {
+  thread_counters_read_format data{};
+  ssize_t bytes_read = read(group_leader_fd, &data, sizeof(data));
+  if (bytes_read != sizeof(data) || data.nr != kThreadCounterEvents.size()) {
+    ERROR("Reading thread counters: %s", SafeStrerror(errno));
+    return std::nullopt;
+  }
+
+  ThreadCounterValues values;
+  values.cycles = data.values[0];
+  values.instructions = data.values[1];
+  values.cache_references = data.values[2];
+  values.cache_misses = data.values[3];
+  values.cpu_migrations = data.values[4];
+  return values;
+}
+
+}  // namespace LinuxTracing
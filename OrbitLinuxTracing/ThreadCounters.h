@@ -0,0 +1,74 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_LINUX_TRACING_THREAD_COUNTERS_H_
+#define ORBIT_LINUX_TRACING_THREAD_COUNTERS_H_
+
+#include <sys/types.h>
+
+#include <optional>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "capture.pb.h"
+
+namespace LinuxTracing {
+
+// Cumulative values of the counters of a thread.
+struct ThreadCounterValues {
+  uint64_t cycles = 0;
+  uint64_t instructions = 0;
+  uint64_t cache_references = 0;
+  uint64_t cache_misses = 0;
+  uint64_t cpu_migrations = 0;
+};
+
+// Converts the difference between two consecutive reads of the counters of a
+// thread into CounterSamples: instructions per cycle, cache miss rate and
+// number of cpu migrations in the interval. The ratios are omitted if their
+// denominator didn't change, e.g., because the thread didn't run.
+std::vector<CounterSample> ComputeThreadCounterSamples(
+    pid_t pid, pid_t tid, uint64_t timestamp_ns,
+    const ThreadCounterValues& previous, const ThreadCounterValues& current);
+
+// Keeps, for each thread of the target process, a group of counting (as
+// opposed to sampling) perf_event_open events for cycles, instructions, cache
+// references, cache misses and cpu migrations. Counting events don't write to
+// a ring buffer: their values are read with read(2) on the group leader.
+// Threads are added and removed explicitly, so that each group only counts a
+// single thread (which is why the events are not opened with inherit).
+class ThreadCountersManager {
+ public:
+  explicit ThreadCountersManager(pid_t pid) : pid_{pid} {}
+  ~ThreadCountersManager() { CloseAll(); }
+
+  ThreadCountersManager(const ThreadCountersManager&) = delete;
+  ThreadCountersManager& operator=(const ThreadCountersManager&) = delete;
+  ThreadCountersManager(ThreadCountersManager&&) = delete;
+  ThreadCountersManager& operator=(ThreadCountersManager&&) = delete;
+
+  bool OpenAndEnable(pid_t tid);
+  void Close(pid_t tid);
+  void CloseAll();
+
+  // Reads the counters of all threads and returns the CounterSamples for the
+  // interval since the previous read.
+  std::vector<CounterSample> ReadAll(uint64_t timestamp_ns);
+
+ private:
+  struct ThreadCounters {
+    // The first file descriptor is the group leader.
+    std::vector<int> fds;
+    ThreadCounterValues last_values;
+  };
+
+  static std::optional<ThreadCounterValues> Read(int group_leader_fd);
+
+  pid_t pid_;
+  absl::flat_hash_map<pid_t, ThreadCounters> tid_to_counters_;
+};
+
+}  // namespace LinuxTracing
+
+#endif  // ORBIT_LINUX_TRACING_THREAD_COUNTERS_H_
@@ -0,0 +1,43 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+
+#include "ThreadCounters.h"
+
+namespace LinuxTracing {
+
+TEST(ThreadCounters, ComputeThreadCounterSamples) {
+  constexpr pid_t pid = 41;
+  constexpr pid_t tid = 42;
+  ThreadCounterValues previous{1000, 1500, 100, 10, 1};
+  ThreadCounterValues current{3000, 4500, 300, 60, 4};
+
+  std::vector<CounterSample> counter_samples =
+      ComputeThreadCounterSamples(pid, tid, 100, previous, current);
+  ASSERT_EQ(counter_samples.size(), 3);
+  for (const CounterSample& counter_sample : counter_samples) {
+    EXPECT_EQ(counter_sample.pid(), pid);
+    EXPECT_EQ(counter_sample.tid(), tid);
+    EXPECT_EQ(counter_sample.timestamp_ns(), 100);
+  }
+  EXPECT_EQ(counter_samples[0].name(), "IPC");
+  EXPECT_DOUBLE_EQ(counter_samples[0].value(), 1.5);
+  EXPECT_EQ(counter_samples[1].name(), "cache miss rate");
+  EXPECT_DOUBLE_EQ(counter_samples[1].value(), 0.25);
+  EXPECT_EQ(counter_samples[2].name(), "cpu migrations");
+  EXPECT_DOUBLE_EQ(counter_samples[2].value(), 3);
+}
+
+TEST(ThreadCounters, NoRatiosIfThreadDidNotRun) {
+  ThreadCounterValues values{1000, 1500, 100, 10, 1};
+
+  std::vector<CounterSample> counter_samples =
+      ComputeThreadCounterSamples(41, 42, 100, values, values);
+  ASSERT_EQ(counter_samples.size(), 1);
+  EXPECT_EQ(counter_samples[0].name(), "cpu migrations");
+  EXPECT_DOUBLE_EQ(counter_samples[0].value(), 0);
+}
+
+}  // namespace LinuxTracing
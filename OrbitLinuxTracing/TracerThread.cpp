@@ -6,9 +6,16 @@
 
 #include <OrbitBase/Logging.h>
 #include <OrbitBase/Tracing.h>
+#include <pthread.h>
+#include <time.h>
 
+#include <algorithm>
+#include <limits>
 #include <thread>
 
+#include "CpuFrequencyVisitor.h"
+#include "FutexVisitor.h"
+#include "SyscallVisitor.h"
 #include "UprobesUnwindingVisitor.h"
 #include "absl/strings/str_format.h"
 
@@ -17,8 +24,44 @@ namespace LinuxTracing {
 TracerThread::TracerThread(const CaptureOptions& capture_options)
     : trace_context_switches_{capture_options.trace_context_switches()},
       pid_{capture_options.pid()},
+      system_wide_{capture_options.system_wide()},
       unwinding_method_{capture_options.unwinding_method()},
-      trace_gpu_driver_{capture_options.trace_gpu_driver()} {
+      trace_gpu_driver_{capture_options.trace_gpu_driver()},
+      trace_syscalls_{capture_options.trace_syscalls()},
+      trace_lock_contention_{capture_options.trace_lock_contention()},
+      sample_thread_counters_{capture_options.sample_thread_counters()},
+      max_function_calls_per_second_{
+          capture_options.max_function_calls_per_second()},
+      read_orbit_api_ring_buffers_{
+          capture_options.read_orbit_api_ring_buffers()} {
+  // perf_event_open requires the size of the stack dump to be a multiple of 8.
+  uint64_t entry_callstack_stack_dump_size =
+      capture_options.entry_callstack_stack_dump_size();
+  if (entry_callstack_stack_dump_size == 0) {
+    entry_callstack_stack_dump_size = DEFAULT_ENTRY_CALLSTACK_STACK_DUMP_SIZE;
+  }
+  entry_callstack_stack_dump_size =
+      std::clamp<uint64_t>(entry_callstack_stack_dump_size,
+                           SAMPLE_STACK_USER_SIZE_8BYTES,
+                           SAMPLE_STACK_USER_SIZE) /
+      8 * 8;
+  entry_callstack_stack_dump_size_ =
+      static_cast<uint16_t>(entry_callstack_stack_dump_size);
+
+  pids_.insert(pid_);
+  if (!system_wide_) {
+    pids_.insert(capture_options.additional_pids().begin(),
+                 capture_options.additional_pids().end());
+  }
+
+  if (capture_options.system_counters_sampling_rate() > 0) {
+    system_counters_sampling_period_ns_ = ComputeSamplingPeriodNs(
+        capture_options.system_counters_sampling_rate());
+    FAIL_IF(!system_counters_sampling_period_ns_.has_value(),
+            "Invalid system counters sampling rate: %.1f",
+            capture_options.system_counters_sampling_rate());
+  }
+
   if (unwinding_method_ != CaptureOptions::kUndefined) {
     std::optional<uint64_t> sampling_period_ns =
         ComputeSamplingPeriodNs(capture_options.sampling_rate());
@@ -36,7 +79,24 @@ TracerThread::TracerThread(const CaptureOptions& capture_options)
        capture_options.instrumented_functions()) {
     instrumented_functions_.emplace_back(
         instrumented_function.file_path(), instrumented_function.file_offset(),
-        instrumented_function.absolute_address());
+        instrumented_function.absolute_address(),
+        instrumented_function.record_entry_callstack());
+  }
+
+  // The trampolines record neither callstacks nor calls in other processes.
+  functions_to_patch_.clear();
+  if (capture_options.dynamic_instrumentation_method() ==
+          CaptureOptions::kUserSpaceTrampolines &&
+      !system_wide_ && pids_.size() == 1) {
+    for (const CaptureOptions::InstrumentedFunction& instrumented_function :
+         capture_options.instrumented_functions()) {
+      if (instrumented_function.record_entry_callstack() ||
+          instrumented_function.size() == 0) {
+        continue;
+      }
+      functions_to_patch_.push_back({instrumented_function.absolute_address(),
+                                     instrumented_function.size()});
+    }
   }
 }
 
@@ -76,9 +136,20 @@ bool TracerThread::OpenContextSwitches(const std::vector<int32_t>& cpus) {
   return true;
 }
 
+std::vector<pid_t> TracerThread::GetTracedPids() const {
+  if (system_wide_) {
+    return ListProcesses();
+  }
+  return std::vector<pid_t>(pids_.begin(), pids_.end());
+}
+
 void TracerThread::InitUprobesEventProcessor() {
+  absl::flat_hash_map<pid_t, std::string> initial_maps_per_pid;
+  for (pid_t pid : GetTracedPids()) {
+    initial_maps_per_pid.emplace(pid, ReadMaps(pid));
+  }
   auto uprobes_unwinding_visitor =
-      std::make_unique<UprobesUnwindingVisitor>(ReadMaps(pid_));
+      std::make_unique<UprobesUnwindingVisitor>(initial_maps_per_pid);
   uprobes_unwinding_visitor->SetListener(listener_);
   uprobes_unwinding_visitor->SetUnwindErrorsAndDiscardedSamplesCounters(
       stats_.unwind_error_count, stats_.discarded_samples_in_uretprobes_count);
@@ -89,18 +160,83 @@ void TracerThread::InitUprobesEventProcessor() {
       std::move(uprobes_unwinding_visitor));
 }
 
+bool TracerThread::OpenUprobesRingBuffers(
+    const std::vector<int32_t>& cpus, uint64_t size_kb, const char* name_prefix,
+    absl::flat_hash_map<int32_t, int>* ring_buffer_fds_per_cpu) {
+  std::vector<int> ring_buffer_fds;
+  std::vector<PerfEventRingBuffer> ring_buffers;
+  for (int32_t cpu : cpus) {
+    int fd = ring_buffer_event_open(-1, cpu);
+    if (fd == -1) {
+      ERROR("Opening %s ring buffer event for cpu %d", name_prefix, cpu);
+      CloseFileDescriptors(ring_buffer_fds);
+      return false;
+    }
+    ring_buffer_fds.push_back(fd);
+
+    std::string buffer_name = absl::StrFormat("%s_%u", name_prefix, cpu);
+    PerfEventRingBuffer ring_buffer{fd, size_kb, buffer_name};
+    if (!ring_buffer.IsOpen()) {
+      ERROR("Opening %s ring buffer for cpu %d", name_prefix, cpu);
+      CloseFileDescriptors(ring_buffer_fds);
+      return false;
+    }
+    ring_buffers.push_back(std::move(ring_buffer));
+    ring_buffer_fds_per_cpu->emplace(cpu, fd);
+  }
+
+  for (int fd : ring_buffer_fds) {
+    tracing_fds_.push_back(fd);
+    uprobes_ring_buffer_fds_.insert(fd);
+  }
+  for (PerfEventRingBuffer& buffer : ring_buffers) {
+    ring_buffers_.emplace_back(std::move(buffer));
+  }
+  return true;
+}
+
 bool TracerThread::OpenUprobes(const std::vector<int32_t>& cpus) {
-  bool uprobes_event_open_errors = false;
+  // All uprobes and uretprobes on the same cpu are redirected to a single ring
+  // buffer to reduce the number of ring buffers. The ring buffer is owned by a
+  // dummy event rather than by the u(ret)probes of one of the functions, so
+  // that the u(ret)probes of any function can be closed in DisableUprobes.
   absl::flat_hash_map<int32_t, int> uprobes_ring_buffer_fds_per_cpu;
+  if (!OpenUprobesRingBuffers(cpus, UPROBES_RING_BUFFER_SIZE_KB,
+                              "uprobes_uretprobes",
+                              &uprobes_ring_buffer_fds_per_cpu)) {
+    return false;
+  }
+
+  // The records of the uprobes that copy the stack are much larger than the
+  // others: they get ring buffers of their own, so that they don't cause
+  // records of the other functions to be lost.
+  absl::flat_hash_map<int32_t, int> uprobes_with_stack_ring_buffer_fds_per_cpu;
+  if (std::any_of(instrumented_functions_.begin(),
+                  instrumented_functions_.end(), [](const Function& function) {
+                    return function.RecordEntryCallstack();
+                  }) &&
+      !OpenUprobesRingBuffers(cpus, UPROBES_WITH_STACK_RING_BUFFER_SIZE_KB,
+                              "uprobes_with_stack",
+                              &uprobes_with_stack_ring_buffer_fds_per_cpu)) {
+    return false;
+  }
 
+  bool uprobes_event_open_errors = false;
   for (const auto& function : instrumented_functions_) {
     absl::flat_hash_map<int32_t, int> function_uprobes_fds_per_cpu;
     absl::flat_hash_map<int32_t, int> function_uretprobes_fds_per_cpu;
     bool function_uprobes_open_error = false;
 
     for (int32_t cpu : cpus) {
-      int uprobes_fd = uprobes_retaddr_event_open(
-          function.BinaryPath().c_str(), function.FileOffset(), -1, cpu);
+      // uprobes_stack_event_open also records the return address, as the
+      // top of the stack it copies.
+      int uprobes_fd =
+          function.RecordEntryCallstack()
+              ? uprobes_stack_event_open(function.BinaryPath().c_str(),
+                                         function.FileOffset(), -1, cpu,
+                                         entry_callstack_stack_dump_size_)
+              : uprobes_retaddr_event_open(function.BinaryPath().c_str(),
+                                           function.FileOffset(), -1, cpu);
       if (uprobes_fd < 0) {
         function_uprobes_open_error = true;
         break;
@@ -140,12 +276,25 @@ bool TracerThread::OpenUprobes(const std::vector<int32_t>& cpus) {
       tracing_fds_.push_back(uprobes_fd.second);
     }
 
+    // Keep the file descriptors of each function, in case its u(ret)probes
+    // need to be disabled during the capture.
+    for (const auto& uprobes_fd : function_uprobes_fds_per_cpu) {
+      function_uprobes_fds_[&function].push_back(uprobes_fd.second);
+    }
+    for (const auto& uretprobes_fd : function_uretprobes_fds_per_cpu) {
+      function_uretprobes_fds_[&function].push_back(uretprobes_fd.second);
+    }
+
     // Record the association between the stream_id and the function
     // (as well as which stream_ids are uprobes and uretprobes).
     for (const auto& uprobes_fd : function_uprobes_fds_per_cpu) {
       uint64_t stream_id = perf_event_get_id(uprobes_fd.second);
       uprobes_uretprobes_ids_to_function_.emplace(stream_id, &function);
-      uprobes_ids_.insert(stream_id);
+      if (function.RecordEntryCallstack()) {
+        uprobes_with_stack_ids_.insert(stream_id);
+      } else {
+        uprobes_ids_.insert(stream_id);
+      }
     }
     for (const auto& uretprobes_fd : function_uretprobes_fds_per_cpu) {
       uint64_t stream_id = perf_event_get_id(uretprobes_fd.second);
@@ -153,30 +302,16 @@ bool TracerThread::OpenUprobes(const std::vector<int32_t>& cpus) {
       uretprobes_ids_.insert(stream_id);
     }
 
-    // Redirect all uprobes and uretprobes on the same cpu to a single ring
-    // buffer to reduce the number of ring buffers.
+    const absl::flat_hash_map<int32_t, int>& ring_buffer_fds_per_cpu =
+        function.RecordEntryCallstack()
+            ? uprobes_with_stack_ring_buffer_fds_per_cpu
+            : uprobes_ring_buffer_fds_per_cpu;
     for (int32_t cpu : cpus) {
-      int uprobes_fd = function_uprobes_fds_per_cpu.at(cpu);
-      int uretprobes_fd = function_uretprobes_fds_per_cpu.at(cpu);
-      if (uprobes_ring_buffer_fds_per_cpu.contains(cpu)) {
-        // Redirect to the already opened ring buffer.
-        int ring_buffer_fd = uprobes_ring_buffer_fds_per_cpu.at(cpu);
-        perf_event_redirect(uprobes_fd, ring_buffer_fd);
-        perf_event_redirect(uretprobes_fd, ring_buffer_fd);
-      } else {
-        // No ring buffer has yet been created for this cpu, as this is the
-        // first uprobes to have been opened successfully. Hence, create a
-        // ring buffer for this cpu associated to uprobes_fd and redirect the
-        // uretprobes to it. The other uprobes and uretprobes for this cpu
-        // will be redirected to this ring buffer.
-        int ring_buffer_fd = uprobes_fd;
-        std::string buffer_name = absl::StrFormat("uprobes_uretprobes_%u", cpu);
-        ring_buffers_.emplace_back(ring_buffer_fd, UPROBES_RING_BUFFER_SIZE_KB,
-                                   buffer_name);
-        uprobes_ring_buffer_fds_per_cpu[cpu] = ring_buffer_fd;
-        // Must be called after the ring buffer has been opened.
-        perf_event_redirect(uretprobes_fd, ring_buffer_fd);
-      }
+      int ring_buffer_fd = ring_buffer_fds_per_cpu.at(cpu);
+      perf_event_redirect(function_uprobes_fds_per_cpu.at(cpu),
+                          ring_buffer_fd);
+      perf_event_redirect(function_uretprobes_fds_per_cpu.at(cpu),
+                          ring_buffer_fd);
     }
   }
 
@@ -347,6 +482,188 @@ bool TracerThread::OpenGpuTracepoints(const std::vector<int32_t>& cpus) {
   return true;
 }
 
+void TracerThread::InitSyscallEventProcessor() {
+  auto syscall_visitor = std::make_unique<SyscallVisitor>();
+  syscall_visitor->SetListener(listener_);
+  syscall_event_processor_ =
+      std::make_shared<PerfEventProcessor2>(std::move(syscall_visitor));
+}
+
+// This method enables the raw_syscalls:sys_enter and raw_syscalls:sys_exit
+// tracepoints, which are hit by every syscall of every process. As a thread
+// can enter a syscall on a cpu and exit it on another, the two events are then
+// paired by SyscallVisitor, after being sorted by PerfEventProcessor2.
+// Tracepoints can only be filtered by tid in the kernel, so filtering by pid
+// happens in ProcessSampleEvent.
+// This method returns true on success, otherwise false.
+bool TracerThread::OpenSyscallTracepoints(const std::vector<int32_t>& cpus) {
+  std::vector<int> sys_enter_fds;
+  std::vector<int> sys_exit_fds;
+  std::vector<PerfEventRingBuffer> syscall_ring_buffers;
+  for (int32_t cpu : cpus) {
+    int sys_enter_fd =
+        tracepoint_event_open("raw_syscalls", "sys_enter", -1, cpu);
+    if (sys_enter_fd == -1) {
+      ERROR("Opening raw_syscalls:sys_enter for cpu %d", cpu);
+      CloseFileDescriptors(sys_enter_fds);
+      CloseFileDescriptors(sys_exit_fds);
+      return false;
+    }
+    sys_enter_fds.push_back(sys_enter_fd);
+
+    int sys_exit_fd =
+        tracepoint_event_open("raw_syscalls", "sys_exit", -1, cpu);
+    if (sys_exit_fd == -1) {
+      ERROR("Opening raw_syscalls:sys_exit for cpu %d", cpu);
+      CloseFileDescriptors(sys_enter_fds);
+      CloseFileDescriptors(sys_exit_fds);
+      return false;
+    }
+    sys_exit_fds.push_back(sys_exit_fd);
+
+    // Redirect sys_exit to the ring buffer of sys_enter on the same cpu, so
+    // that events from the same cpu are already sorted.
+    std::string buffer_name = absl::StrFormat("raw_syscalls_%d", cpu);
+    PerfEventRingBuffer ring_buffer{sys_enter_fd, SYSCALLS_RING_BUFFER_SIZE_KB,
+                                    buffer_name};
+    if (!ring_buffer.IsOpen()) {
+      ERROR("Opening ring buffer for raw_syscalls for cpu %d", cpu);
+      CloseFileDescriptors(sys_enter_fds);
+      CloseFileDescriptors(sys_exit_fds);
+      return false;
+    }
+    perf_event_redirect(sys_exit_fd, sys_enter_fd);
+    syscall_ring_buffers.push_back(std::move(ring_buffer));
+  }
+
+  // As for uprobes and uretprobes, enable the "closing" event first.
+  for (int fd : sys_exit_fds) {
+    tracing_fds_.push_back(fd);
+    syscall_exit_ids_.insert(perf_event_get_id(fd));
+  }
+  for (int fd : sys_enter_fds) {
+    tracing_fds_.push_back(fd);
+    syscall_enter_ids_.insert(perf_event_get_id(fd));
+    syscall_ring_buffer_fds_.insert(fd);
+  }
+  for (PerfEventRingBuffer& buffer : syscall_ring_buffers) {
+    ring_buffers_.emplace_back(std::move(buffer));
+  }
+
+  return true;
+}
+
+void TracerThread::InitFutexEventProcessor() {
+  auto futex_visitor = std::make_unique<FutexVisitor>();
+  futex_visitor->SetListener(listener_);
+  futex_event_processor_ =
+      std::make_shared<PerfEventProcessor2>(std::move(futex_visitor));
+}
+
+// This method enables the syscalls:sys_enter_futex and syscalls:sys_exit_futex
+// tracepoints, in order to measure for how long threads are blocked on locks.
+// sys_enter_futex also records the callchain, so that waiters (and the threads
+// waking them up) can be attributed to a callstack. As with raw_syscalls, the
+// events are sorted by PerfEventProcessor2 before being paired by FutexVisitor,
+// and filtering by pid happens in ProcessSampleEvent.
+// This method returns true on success, otherwise false.
+bool TracerThread::OpenFutexTracepoints(const std::vector<int32_t>& cpus) {
+  std::vector<int> futex_enter_fds;
+  std::vector<int> futex_exit_fds;
+  std::vector<PerfEventRingBuffer> futex_ring_buffers;
+  for (int32_t cpu : cpus) {
+    int futex_enter_fd = tracepoint_callchain_event_open(
+        "syscalls", "sys_enter_futex", -1, cpu);
+    if (futex_enter_fd == -1) {
+      ERROR("Opening syscalls:sys_enter_futex for cpu %d", cpu);
+      CloseFileDescriptors(futex_enter_fds);
+      CloseFileDescriptors(futex_exit_fds);
+      return false;
+    }
+    futex_enter_fds.push_back(futex_enter_fd);
+
+    int futex_exit_fd =
+        tracepoint_event_open("syscalls", "sys_exit_futex", -1, cpu);
+    if (futex_exit_fd == -1) {
+      ERROR("Opening syscalls:sys_exit_futex for cpu %d", cpu);
+      CloseFileDescriptors(futex_enter_fds);
+      CloseFileDescriptors(futex_exit_fds);
+      return false;
+    }
+    futex_exit_fds.push_back(futex_exit_fd);
+
+    std::string buffer_name = absl::StrFormat("futex_%d", cpu);
+    PerfEventRingBuffer ring_buffer{futex_enter_fd, FUTEX_RING_BUFFER_SIZE_KB,
+                                    buffer_name};
+    if (!ring_buffer.IsOpen()) {
+      ERROR("Opening ring buffer for futex for cpu %d", cpu);
+      CloseFileDescriptors(futex_enter_fds);
+      CloseFileDescriptors(futex_exit_fds);
+      return false;
+    }
+    perf_event_redirect(futex_exit_fd, futex_enter_fd);
+    futex_ring_buffers.push_back(std::move(ring_buffer));
+  }
+
+  for (int fd : futex_exit_fds) {
+    tracing_fds_.push_back(fd);
+    futex_exit_ids_.insert(perf_event_get_id(fd));
+  }
+  for (int fd : futex_enter_fds) {
+    tracing_fds_.push_back(fd);
+    futex_enter_ids_.insert(perf_event_get_id(fd));
+    futex_ring_buffer_fds_.insert(fd);
+  }
+  for (PerfEventRingBuffer& buffer : futex_ring_buffers) {
+    ring_buffers_.emplace_back(std::move(buffer));
+  }
+
+  return true;
+}
+
+void TracerThread::InitCpuFrequencyEventProcessor() {
+  auto cpu_frequency_visitor = std::make_unique<CpuFrequencyVisitor>(pid_);
+  cpu_frequency_visitor->SetListener(listener_);
+  cpu_frequency_event_processor_ =
+      std::make_shared<PerfEventProcessor2>(std::move(cpu_frequency_visitor));
+}
+
+bool TracerThread::OpenCpuFrequencyTracepoint(
+    const std::vector<int32_t>& cpus) {
+  std::vector<int> cpu_frequency_fds;
+  std::vector<PerfEventRingBuffer> cpu_frequency_ring_buffers;
+  for (int32_t cpu : cpus) {
+    int fd = tracepoint_event_open("power", "cpu_frequency", -1, cpu);
+    if (fd == -1) {
+      ERROR("Opening power:cpu_frequency for cpu %d", cpu);
+      CloseFileDescriptors(cpu_frequency_fds);
+      return false;
+    }
+    cpu_frequency_fds.push_back(fd);
+
+    std::string buffer_name = absl::StrFormat("cpu_frequency_%d", cpu);
+    PerfEventRingBuffer ring_buffer{fd, CPU_FREQUENCY_RING_BUFFER_SIZE_KB,
+                                    buffer_name};
+    if (!ring_buffer.IsOpen()) {
+      ERROR("Opening ring buffer for cpu_frequency for cpu %d", cpu);
+      CloseFileDescriptors(cpu_frequency_fds);
+      return false;
+    }
+    cpu_frequency_ring_buffers.push_back(std::move(ring_buffer));
+  }
+
+  for (int fd : cpu_frequency_fds) {
+    tracing_fds_.push_back(fd);
+    cpu_frequency_ids_.insert(perf_event_get_id(fd));
+    cpu_frequency_ring_buffer_fds_.insert(fd);
+  }
+  for (PerfEventRingBuffer& buffer : cpu_frequency_ring_buffers) {
+    ring_buffers_.emplace_back(std::move(buffer));
+  }
+
+  return true;
+}
+
 void TracerThread::Run(
     const std::shared_ptr<std::atomic<bool>>& exit_requested) {
   FAIL_IF(listener_ == nullptr, "No listener set");
@@ -362,11 +679,24 @@ void TracerThread::Run(
   }
 
   // Record calls to dynamically instrumented functions and sample only on cores
-  // in this process's cgroup's cpuset, as these are the only cores the process
-  // will be scheduled on.
-  std::vector<int32_t> cpuset_cpus = GetCpusetCpus(pid_);
+  // in the traced processes' cgroups' cpusets, as these are the only cores the
+  // processes will be scheduled on.
+  std::vector<int32_t> cpuset_cpus;
+  if (!system_wide_) {
+    absl::flat_hash_set<int32_t> cpuset_cpus_set;
+    for (pid_t pid : pids_) {
+      std::vector<int32_t> pid_cpuset_cpus = GetCpusetCpus(pid);
+      if (pid_cpuset_cpus.empty()) {
+        ERROR("Could not read cpuset of process %d", pid);
+        cpuset_cpus_set.clear();
+        break;
+      }
+      cpuset_cpus_set.insert(pid_cpuset_cpus.begin(), pid_cpuset_cpus.end());
+    }
+    cpuset_cpus.assign(cpuset_cpus_set.begin(), cpuset_cpus_set.end());
+    std::sort(cpuset_cpus.begin(), cpuset_cpus.end());
+  }
   if (cpuset_cpus.empty()) {
-    ERROR("Could not read cpuset");
     cpuset_cpus = all_cpus;
   }
 
@@ -384,6 +714,11 @@ void TracerThread::Run(
 
   perf_event_open_errors |= !OpenMmapTask(cpuset_cpus);
 
+  // Before OpenUprobes, as the functions patched get no uprobes.
+  if (!functions_to_patch_.empty()) {
+    InstrumentFunctionsInUserSpace();
+  }
+
   bool uprobes_event_open_errors = false;
   if (!instrumented_functions_.empty()) {
     uprobes_event_open_errors = !OpenUprobes(cpuset_cpus);
@@ -401,6 +736,34 @@ void TracerThread::Run(
     perf_event_open_errors |= !OpenSampling(cpuset_cpus);
   }
 
+  if (trace_syscalls_) {
+    InitSyscallEventProcessor();
+    perf_event_open_errors |= !OpenSyscallTracepoints(cpuset_cpus);
+  }
+
+  if (trace_lock_contention_) {
+    InitFutexEventProcessor();
+    perf_event_open_errors |= !OpenFutexTracepoints(cpuset_cpus);
+  }
+
+  if (sample_thread_counters_) {
+    OpenThreadCounters();
+  }
+
+  if (read_orbit_api_ring_buffers_) {
+    manual_instrumentation_reader_ =
+        std::make_unique<ManualInstrumentationReader>(pid_,
+                                                      MonotonicTimestampNs());
+  }
+
+  if (system_counters_sampling_period_ns_.has_value()) {
+    system_counters_sampler_ = std::make_unique<SystemCountersSampler>(pid_);
+    // Frequency changes are recorded on the cpu that requests them, which is
+    // not necessarily the cpu whose frequency changes.
+    InitCpuFrequencyEventProcessor();
+    perf_event_open_errors |= !OpenCpuFrequencyTracepoint(all_cpus);
+  }
+
   bool gpu_event_open_errors = false;
   if (trace_gpu_driver_) {
     if (InitGpuTracepointEventProcessor()) {
@@ -426,26 +789,44 @@ void TracerThread::Run(
   }
 
   // Start recording events.
+  ring_buffers_last_record_timestamps_.assign(ring_buffers_.size(),
+                                              MonotonicTimestampNs());
   for (int fd : tracing_fds_) {
     perf_event_enable(fd);
   }
 
-  stats_.Reset();
-
   bool last_iteration_saw_events = false;
   std::thread deferred_events_thread(&TracerThread::ProcessDeferredEvents,
                                      this);
+  clockid_t processing_thread_cpu_clock;
+  if (pthread_getcpuclockid(deferred_events_thread.native_handle(),
+                            &processing_thread_cpu_clock) == 0) {
+    processing_thread_cpu_clock_ = processing_thread_cpu_clock;
+  }
+
+  stats_window_count_ = 0;
+  ResetStats();
+  function_call_counts_begin_ns_ = MonotonicTimestampNs();
 
   while (!(*exit_requested)) {
     ORBIT_SCOPE("Tracer Iteration");
 
+    // Read the thread counters even when there are always new events, as the
+    // samples need to be evenly spaced to be meaningful.
+    ReadThreadCountersIfDelayElapsed();
+    SampleSystemCountersIfDelayElapsed();
+
+    // Report event statistics even when busy, as this is exactly when they
+    // matter.
+    ReportStatsIfTimerElapsed();
+
+    // Also when busy, as a function called too often is what keeps us busy.
+    DisableFrequentlyCalledFunctionsIfWindowElapsed();
+
     if (!last_iteration_saw_events) {
       // Check for updates of thread names and in case notify the listener_.
       UpdateThreadNamesIfDelayElapsed();
 
-      // Periodically print event statistics.
-      PrintStatsIfTimerElapsed();
-
       // Sleep if there was no new event in the last iteration so that we are
       // not constantly polling. Don't sleep so long that ring buffers overflow.
       // TODO: Refine this sleeping pattern, possibly using exponential backoff.
@@ -457,13 +838,26 @@ void TracerThread::Run(
 
     last_iteration_saw_events = false;
 
+    // The ring buffers of the Orbit API are small and written to without
+    // waiting for us, so read them at every iteration.
+    if (ReadManualInstrumentationEvents()) {
+      last_iteration_saw_events = true;
+    }
+    if (ReadUserSpaceFunctionCalls()) {
+      last_iteration_saw_events = true;
+    }
+
     // Read and process events from all ring buffers. In order to ensure that no
     // buffer is read constantly while others overflow, we schedule the reading
     // using round-robin like scheduling.
-    for (PerfEventRingBuffer& ring_buffer : ring_buffers_) {
+    for (size_t ring_buffer_index = 0; ring_buffer_index < ring_buffers_.size();
+         ++ring_buffer_index) {
       if (*exit_requested) {
         break;
       }
+      PerfEventRingBuffer& ring_buffer = ring_buffers_[ring_buffer_index];
+      uint64_t& last_record_timestamp_ns =
+          ring_buffers_last_record_timestamps_[ring_buffer_index];
 
       // Read up to ROUND_ROBIN_POLLING_BATCH_SIZE (5) new events.
       // TODO: Some event types (e.g., stack samples) have a much longer
@@ -482,6 +876,8 @@ void TracerThread::Run(
         last_iteration_saw_events = true;
         perf_event_header header;
         ring_buffer.ReadHeader(&header);
+        uint64_t previous_record_timestamp_ns = last_record_timestamp_ns;
+        last_record_timestamp_ns = ReadRecordTimestamp(&ring_buffer, header);
 
         // perf_event_header::type contains the type of record, e.g.,
         // PERF_RECORD_SAMPLE, PERF_RECORD_MMAP, etc., defined in enum
@@ -511,7 +907,8 @@ void TracerThread::Run(
             ProcessSampleEvent(header, &ring_buffer);
             break;
           case PERF_RECORD_LOST:
-            ProcessLostEvent(header, &ring_buffer);
+            ProcessLostEvent(header, &ring_buffer,
+                             previous_record_timestamp_ns);
             break;
           case PERF_RECORD_THROTTLE:
             // We don't use throttle/unthrottle events, but log them separately
@@ -539,14 +936,29 @@ void TracerThread::Run(
   stop_deferred_thread_ = true;
   deferred_events_thread.join();
   uprobes_event_processor_->ProcessAllEvents();
+  if (syscall_event_processor_ != nullptr) {
+    syscall_event_processor_->ProcessAllEvents();
+  }
+  if (futex_event_processor_ != nullptr) {
+    futex_event_processor_->ProcessAllEvents();
+  }
+  if (cpu_frequency_event_processor_ != nullptr) {
+    cpu_frequency_event_processor_->ProcessAllEvents();
+  }
 
   // Stop recording.
   for (int fd : tracing_fds_) {
     perf_event_disable(fd);
   }
+  thread_counters_manager_.reset();
+  system_counters_sampler_.reset();
+  ReadManualInstrumentationEvents();
+  manual_instrumentation_reader_.reset();
+  UninstrumentFunctionsInUserSpace();
 
   // Close the ring buffers.
   ring_buffers_.clear();
+  ring_buffers_last_record_timestamps_.clear();
 
   // Close the file descriptors.
   for (int fd : tracing_fds_) {
@@ -587,12 +999,23 @@ void TracerThread::ProcessForkEvent(const perf_event_header& header,
   ForkPerfEvent event;
   ring_buffer->ConsumeRecord(header, &event.ring_buffer_record);
 
+  // A new process inherits the maps of its parent, so it won't necessarily
+  // cause any PERF_RECORD_MMAP before being sampled.
+  if (IsTracedPid(event.GetPid()) && event.GetPid() == event.GetTid()) {
+    auto maps_event = std::make_unique<MapsPerfEvent>(
+        MonotonicTimestampNs(), event.GetPid(), ReadMaps(event.GetPid()));
+    maps_event->SetOriginFileDescriptor(ring_buffer->GetFileDescriptor());
+    DeferEvent(std::move(maps_event));
+  }
+
   if (event.GetPid() != pid_) {
     return;
   }
 
   // A new thread of the sampled process was spawned.
-  // Nothing to do for now.
+  if (thread_counters_manager_ != nullptr) {
+    thread_counters_manager_->OpenAndEnable(event.GetTid());
+  }
 }
 
 void TracerThread::ProcessExitEvent(const perf_event_header& header,
@@ -600,11 +1023,22 @@ void TracerThread::ProcessExitEvent(const perf_event_header& header,
   ExitPerfEvent event;
   ring_buffer->ConsumeRecord(header, &event.ring_buffer_record);
 
+  // When the main thread exits, the process is gone: forget its maps, which
+  // matters with system-wide captures.
+  if (IsTracedPid(event.GetPid()) && event.GetPid() == event.GetTid()) {
+    auto maps_event = std::make_unique<MapsPerfEvent>(MonotonicTimestampNs(),
+                                                      event.GetPid(), "");
+    maps_event->SetOriginFileDescriptor(ring_buffer->GetFileDescriptor());
+    DeferEvent(std::move(maps_event));
+  }
+
   if (event.GetPid() != pid_) {
     return;
   }
 
-  // Nothing to do for now.
+  if (thread_counters_manager_ != nullptr) {
+    thread_counters_manager_->Close(event.GetTid());
+  }
 }
 
 void TracerThread::ProcessMmapEvent(const perf_event_header& header,
@@ -612,14 +1046,14 @@ void TracerThread::ProcessMmapEvent(const perf_event_header& header,
   pid_t pid = ReadMmapRecordPid(ring_buffer);
   ring_buffer->SkipRecord(header);
 
-  if (pid != pid_) {
+  if (!IsTracedPid(pid)) {
     return;
   }
 
   // There was a call to mmap with PROT_EXEC, hence refresh the maps.
   // This should happen rarely.
-  auto event =
-      std::make_unique<MapsPerfEvent>(MonotonicTimestampNs(), ReadMaps(pid_));
+  auto event = std::make_unique<MapsPerfEvent>(MonotonicTimestampNs(), pid,
+                                               ReadMaps(pid));
   event->SetOriginFileDescriptor(ring_buffer->GetFileDescriptor());
   DeferEvent(std::move(event));
 }
@@ -628,12 +1062,20 @@ void TracerThread::ProcessSampleEvent(const perf_event_header& header,
                                       PerfEventRingBuffer* ring_buffer) {
   uint64_t stream_id = ReadSampleRecordStreamId(ring_buffer);
   bool is_uprobe = uprobes_ids_.contains(stream_id);
+  bool is_uprobe_with_stack = uprobes_with_stack_ids_.contains(stream_id);
   bool is_uretprobe = uretprobes_ids_.contains(stream_id);
   bool is_stack_sample = stack_sampling_ids_.contains(stream_id);
   bool is_gpu_event = gpu_tracing_ids_.contains(stream_id);
   bool is_callchain_sample = callchain_sampling_ids_.contains(stream_id);
-  CHECK(is_uprobe + is_uretprobe + is_stack_sample + is_gpu_event +
-            is_callchain_sample <=
+  bool is_syscall_enter = syscall_enter_ids_.contains(stream_id);
+  bool is_syscall_exit = syscall_exit_ids_.contains(stream_id);
+  bool is_futex_enter = futex_enter_ids_.contains(stream_id);
+  bool is_futex_exit = futex_exit_ids_.contains(stream_id);
+  bool is_cpu_frequency = cpu_frequency_ids_.contains(stream_id);
+  CHECK(is_uprobe + is_uprobe_with_stack + is_uretprobe + is_stack_sample +
+            is_gpu_event + is_callchain_sample + is_syscall_enter +
+            is_syscall_exit + is_futex_enter + is_futex_exit +
+            is_cpu_frequency <=
         1);
 
   int fd = ring_buffer->GetFileDescriptor();
@@ -643,13 +1085,61 @@ void TracerThread::ProcessSampleEvent(const perf_event_header& header,
     ring_buffer->ConsumeRecord(header, &event->ring_buffer_record);
     constexpr size_t size_of_uprobes = sizeof(perf_event_sp_ip_8bytes_sample);
     CHECK(header.size == size_of_uprobes);
-    if (event->GetPid() != pid_) {
+    if (!IsTracedPid(event->GetPid())) {
+      return;
+    }
+
+    event->SetFunction(
+        uprobes_uretprobes_ids_to_function_.at(event->GetStreamId()));
+    event->SetOriginFileDescriptor(fd);
+    CountFunctionCall(event->GetFunction());
+    DeferEvent(std::move(event));
+    ++stats_.uprobes_count;
+
+  } else if (is_uprobe_with_stack) {
+    pid_t pid = ReadSampleRecordPid(ring_buffer);
+    if (!IsTracedPid(pid)) {
+      ring_buffer->SkipRecord(header);
       return;
     }
 
+    size_t size_of_uprobes_with_stack = sizeof(perf_event_stack_sample) -
+                                        SAMPLE_STACK_USER_SIZE +
+                                        entry_callstack_stack_dump_size_;
+    if (header.size != size_of_uprobes_with_stack) {
+      // As for stack samples below, these normally have no registers and no
+      // stack. The call is still processed, as its uretprobe will be, only
+      // without the entry callstack. If even the sp, the ip or the return
+      // address are missing, the open calls of this ring buffer are reset as
+      // for lost records, instead of being matched with the wrong uretprobes.
+      perf_event_sample_id_tid_time_streamid_cpu sample_id;
+      ring_buffer->ReadValueAtOffset(
+          &sample_id, offsetof(perf_event_stack_sample, sample_id));
+      std::unique_ptr<UprobesPerfEvent> event =
+          ConsumeUprobesPerfEventWithoutStack(ring_buffer, header);
+      if (event == nullptr) {
+        auto lost_event = std::make_unique<LostPerfEvent>();
+        lost_event->ring_buffer_record = {};
+        lost_event->ring_buffer_record.header = header;
+        lost_event->ring_buffer_record.sample_id = sample_id;
+        lost_event->SetOriginFileDescriptor(fd);
+        DeferEvent(std::move(lost_event));
+        return;
+      }
+      event->SetFunction(
+          uprobes_uretprobes_ids_to_function_.at(event->GetStreamId()));
+      event->SetOriginFileDescriptor(fd);
+      CountFunctionCall(event->GetFunction());
+      DeferEvent(std::move(event));
+      ++stats_.uprobes_count;
+      return;
+    }
+
+    auto event = ConsumeUprobesWithStackPerfEvent(ring_buffer, header);
     event->SetFunction(
         uprobes_uretprobes_ids_to_function_.at(event->GetStreamId()));
     event->SetOriginFileDescriptor(fd);
+    CountFunctionCall(event->GetFunction());
     DeferEvent(std::move(event));
     ++stats_.uprobes_count;
 
@@ -658,7 +1148,7 @@ void TracerThread::ProcessSampleEvent(const perf_event_header& header,
     ring_buffer->ConsumeRecord(header, &event->ring_buffer_record);
     constexpr size_t size_of_uretprobes = sizeof(perf_event_ax_sample);
     CHECK(header.size == size_of_uretprobes);
-    if (event->GetPid() != pid_) {
+    if (!IsTracedPid(event->GetPid())) {
       return;
     }
 
@@ -681,7 +1171,7 @@ void TracerThread::ProcessSampleEvent(const perf_event_header& header,
       ring_buffer->SkipRecord(header);
       return;
     }
-    if (pid != pid_) {
+    if (!IsTracedPid(pid)) {
       ring_buffer->SkipRecord(header);
       return;
     }
@@ -704,7 +1194,7 @@ void TracerThread::ProcessSampleEvent(const perf_event_header& header,
 
   } else if (is_callchain_sample) {
     pid_t pid = ReadSampleRecordPid(ring_buffer);
-    if (pid != pid_) {
+    if (!IsTracedPid(pid)) {
       ring_buffer->SkipRecord(header);
       return;
     }
@@ -714,6 +1204,62 @@ void TracerThread::ProcessSampleEvent(const perf_event_header& header,
     DeferEvent(std::move(event));
     ++stats_.sample_count;
 
+  } else if (is_syscall_enter) {
+    pid_t pid = ReadSampleRecordPid(ring_buffer);
+    if (!IsTracedPid(pid)) {
+      ring_buffer->SkipRecord(header);
+      return;
+    }
+
+    auto event =
+        ConsumeTracepointPerfEvent<SyscallEnterPerfEvent>(ring_buffer, header);
+    event->SetOriginFileDescriptor(fd);
+    DeferEvent(std::move(event));
+    ++stats_.syscalls_count;
+
+  } else if (is_syscall_exit) {
+    pid_t pid = ReadSampleRecordPid(ring_buffer);
+    if (!IsTracedPid(pid)) {
+      ring_buffer->SkipRecord(header);
+      return;
+    }
+
+    auto event =
+        ConsumeTracepointPerfEvent<SyscallExitPerfEvent>(ring_buffer, header);
+    event->SetOriginFileDescriptor(fd);
+    DeferEvent(std::move(event));
+
+  } else if (is_futex_enter) {
+    pid_t pid = ReadSampleRecordPid(ring_buffer);
+    if (!IsTracedPid(pid)) {
+      ring_buffer->SkipRecord(header);
+      return;
+    }
+
+    auto event = ConsumeFutexEnterPerfEvent(ring_buffer, header);
+    event->SetOriginFileDescriptor(fd);
+    DeferEvent(std::move(event));
+    ++stats_.futex_count;
+
+  } else if (is_futex_exit) {
+    pid_t pid = ReadSampleRecordPid(ring_buffer);
+    if (!IsTracedPid(pid)) {
+      ring_buffer->SkipRecord(header);
+      return;
+    }
+
+    auto event =
+        ConsumeTracepointPerfEvent<FutexExitPerfEvent>(ring_buffer, header);
+    event->SetOriginFileDescriptor(fd);
+    DeferEvent(std::move(event));
+
+  } else if (is_cpu_frequency) {
+    // This event is system-wide: don't filter by pid.
+    auto event = ConsumeTracepointPerfEvent<CpuFrequencyPerfEvent>(ring_buffer,
+                                                                   header);
+    event->SetOriginFileDescriptor(fd);
+    DeferEvent(std::move(event));
+
   } else {
     ERROR("PERF_EVENT_SAMPLE with unexpected stream_id: %lu", stream_id);
     ring_buffer->SkipRecord(header);
@@ -721,16 +1267,115 @@ void TracerThread::ProcessSampleEvent(const perf_event_header& header,
 }
 
 void TracerThread::ProcessLostEvent(const perf_event_header& header,
-                                    PerfEventRingBuffer* ring_buffer) {
-  LostPerfEvent event;
-  ring_buffer->ConsumeRecord(header, &event.ring_buffer_record);
-  stats_.lost_count += event.GetNumLost();
-  stats_.lost_count_per_buffer[ring_buffer] += event.GetNumLost();
+                                    PerfEventRingBuffer* ring_buffer,
+                                    uint64_t previous_record_timestamp_ns) {
+  auto event = std::make_unique<LostPerfEvent>();
+  ring_buffer->ConsumeRecord(header, &event->ring_buffer_record);
+  stats_.lost_count += event->GetNumLost();
+  stats_.lost_count_per_buffer[ring_buffer] += event->GetNumLost();
+
+  LostEventsGap lost_events_gap;
+  lost_events_gap.set_buffer_name(ring_buffer->GetName());
+  lost_events_gap.set_cpu(event->GetCpu());
+  lost_events_gap.set_begin_timestamp_ns(
+      std::min(previous_record_timestamp_ns, event->GetTimestamp()));
+  lost_events_gap.set_end_timestamp_ns(event->GetTimestamp());
+  lost_events_gap.set_lost_count(event->GetNumLost());
+  listener_->OnLostEventsGap(std::move(lost_events_gap));
+
+  // Lost u(ret)probes would cause the following ones to be matched with the
+  // wrong calls, so the state of the open calls needs to be reset in order
+  // with the other events.
+  if (uprobes_ring_buffer_fds_.contains(ring_buffer->GetFileDescriptor())) {
+    event->SetOriginFileDescriptor(ring_buffer->GetFileDescriptor());
+    DeferEvent(std::move(event));
+  }
+}
+
+void TracerThread::CountFunctionCall(const Function* function) {
+  if (max_function_calls_per_second_ == 0) {
+    return;
+  }
+  ++function_call_counts_[function];
+}
+
+void TracerThread::DisableFrequentlyCalledFunctionsIfWindowElapsed() {
+  if (max_function_calls_per_second_ == 0) {
+    return;
+  }
+  uint64_t timestamp_ns = MonotonicTimestampNs();
+  uint64_t window_ns = timestamp_ns - function_call_counts_begin_ns_;
+  if (window_ns < FUNCTION_CALL_RATES_WINDOW_MS * NS_PER_MILLISECOND) {
+    return;
+  }
+
+  for (const auto& function_call_count : function_call_counts_) {
+    const Function* function = function_call_count.first;
+    uint64_t calls_per_second =
+        function_call_count.second * NS_PER_SECOND / window_ns;
+    // Records of a function that has already been disabled can still be in the
+    // ring buffers.
+    if (calls_per_second <= max_function_calls_per_second_ ||
+        !function_uprobes_fds_.contains(function)) {
+      continue;
+    }
+
+    LOG("Disabling u(ret)probes for function at %#016lx, called %lu times "
+        "per second",
+        function->VirtualAddress(), calls_per_second);
+    DisableUprobes(function);
+
+    // The calls open at this point will never complete, and some of the last
+    // uretprobes might have no matching uprobe: reset the state of the open
+    // calls in order with the other events, as for lost records. The timestamp
+    // is taken after disabling, so that it follows all those records.
+    auto event = std::make_unique<UprobesDisabledPerfEvent>(
+        MonotonicTimestampNs(), function->VirtualAddress(), calls_per_second);
+    DeferEvent(std::move(event));
+  }
+
+  function_call_counts_.clear();
+  function_call_counts_begin_ns_ = timestamp_ns;
+}
+
+void TracerThread::DisableUprobes(const Function* function) {
+  std::vector<int> uprobes_fds = std::move(function_uprobes_fds_.at(function));
+  function_uprobes_fds_.erase(function);
+  std::vector<int> uretprobes_fds =
+      std::move(function_uretprobes_fds_.at(function));
+  function_uretprobes_fds_.erase(function);
+
+  // Disable the uprobes before the uretprobes, the opposite of the order in
+  // which they were enabled.
+  for (int fd : uprobes_fds) {
+    perf_event_disable(fd);
+  }
+  for (int fd : uretprobes_fds) {
+    perf_event_disable(fd);
+  }
+
+  // Closing the file descriptors removes the breakpoints from the target as
+  // soon as no other event uses them. None of them owns a ring buffer, see
+  // OpenUprobes.
+  absl::flat_hash_set<int> fds_to_close;
+  fds_to_close.insert(uprobes_fds.begin(), uprobes_fds.end());
+  fds_to_close.insert(uretprobes_fds.begin(), uretprobes_fds.end());
+  tracing_fds_.erase(
+      std::remove_if(tracing_fds_.begin(), tracing_fds_.end(),
+                     [&fds_to_close](int fd) {
+                       return fds_to_close.contains(fd);
+                     }),
+      tracing_fds_.end());
+  for (int fd : fds_to_close) {
+    close(fd);
+  }
 }
 
 void TracerThread::DeferEvent(std::unique_ptr<PerfEvent> event) {
   std::lock_guard<std::mutex> lock(deferred_events_mutex_);
   deferred_events_.emplace_back(std::move(event));
+  stats_.max_deferred_events_count = std::max<uint64_t>(
+      stats_.max_deferred_events_count, deferred_events_.size());
 }
 
 std::vector<std::unique_ptr<PerfEvent>> TracerThread::ConsumeDeferredEvents() {
@@ -752,12 +1397,42 @@ void TracerThread::ProcessDeferredEvents() {
       // TODO: use a wait/notify mechanism instead of check/sleep.
       usleep(IDLE_TIME_ON_EMPTY_DEFERRED_EVENTS_US);
     } else {
+      uint64_t oldest_event_timestamp_ns = std::numeric_limits<uint64_t>::max();
+      for (const auto& event : events) {
+        oldest_event_timestamp_ns =
+            std::min(oldest_event_timestamp_ns, event->GetTimestamp());
+      }
+      uint64_t current_timestamp_ns = MonotonicTimestampNs();
+      if (current_timestamp_ns > oldest_event_timestamp_ns) {
+        uint64_t lag_ns = current_timestamp_ns - oldest_event_timestamp_ns;
+        if (lag_ns > *stats_.max_processing_lag_ns) {
+          *stats_.max_processing_lag_ns = lag_ns;
+        }
+      }
+
       for (auto& event : events) {
         int fd = event->GetOriginFileDescriptor();
-        uprobes_event_processor_->AddEvent(fd, std::move(event));
+        if (syscall_ring_buffer_fds_.contains(fd)) {
+          syscall_event_processor_->AddEvent(fd, std::move(event));
+        } else if (futex_ring_buffer_fds_.contains(fd)) {
+          futex_event_processor_->AddEvent(fd, std::move(event));
+        } else if (cpu_frequency_ring_buffer_fds_.contains(fd)) {
+          cpu_frequency_event_processor_->AddEvent(fd, std::move(event));
+        } else {
+          uprobes_event_processor_->AddEvent(fd, std::move(event));
+        }
       }
 
       uprobes_event_processor_->ProcessOldEvents();
+      if (syscall_event_processor_ != nullptr) {
+        syscall_event_processor_->ProcessOldEvents();
+      }
+      if (futex_event_processor_ != nullptr) {
+        futex_event_processor_->ProcessOldEvents();
+      }
+      if (cpu_frequency_event_processor_ != nullptr) {
+        cpu_frequency_event_processor_->ProcessOldEvents();
+      }
     }
   }
 }
@@ -767,78 +1442,318 @@ void TracerThread::UpdateThreadNamesIfDelayElapsed() {
   if (last_thread_names_update +
           THREAD_NAMES_UPDATE_DELAY_MS * NS_PER_MILLISECOND <
       timestamp_ns) {
-    for (pid_t tid : ListThreads(pid_)) {
-      std::string name = GetThreadName(tid);
-      if (name.empty()) {
-        continue;
-      }
-
-      auto last_name_it = thread_names_.find(tid);
-      if (last_name_it == thread_names_.end() || name != last_name_it->second) {
-        thread_names_[tid] = name;
+    for (pid_t pid : GetTracedPids()) {
+      for (pid_t tid : ListThreads(pid)) {
+        std::string name = GetThreadName(tid);
+        if (name.empty()) {
+          continue;
+        }
 
-        ThreadName thread_name;
-        thread_name.set_tid(tid);
-        thread_name.set_name(std::move(name));
-        thread_name.set_timestamp_ns(timestamp_ns);
-        listener_->OnThreadName(std::move(thread_name));
+        auto last_name_it = thread_names_.find(tid);
+        if (last_name_it == thread_names_.end() ||
+            name != last_name_it->second) {
+          thread_names_[tid] = name;
+
+          ThreadName thread_name;
+          thread_name.set_pid(pid);
+          thread_name.set_tid(tid);
+          thread_name.set_name(std::move(name));
+          thread_name.set_timestamp_ns(timestamp_ns);
+          listener_->OnThreadName(std::move(thread_name));
+        }
       }
     }
     last_thread_names_update = timestamp_ns;
   }
 }
 
+void TracerThread::OpenThreadCounters() {
+  thread_counters_manager_ = std::make_unique<ThreadCountersManager>(pid_);
+  // Threads spawned after this are added in ProcessForkEvent.
+  bool thread_counters_errors = false;
+  for (pid_t tid : ListThreads(pid_)) {
+    thread_counters_errors |= !thread_counters_manager_->OpenAndEnable(tid);
+  }
+  if (thread_counters_errors) {
+    LOG("There were errors opening thread counters: hardware counters might "
+        "not be available on this machine");
+  }
+}
+
+void TracerThread::ReadThreadCountersIfDelayElapsed() {
+  if (thread_counters_manager_ == nullptr) {
+    return;
+  }
+  uint64_t timestamp_ns = MonotonicTimestampNs();
+  if (last_thread_counters_read +
+          THREAD_COUNTERS_READ_DELAY_MS * NS_PER_MILLISECOND <
+      timestamp_ns) {
+    ORBIT_SCOPE("ReadThreadCounters");
+    for (CounterSample& counter_sample :
+         thread_counters_manager_->ReadAll(timestamp_ns)) {
+      listener_->OnCounterSample(std::move(counter_sample));
+    }
+    last_thread_counters_read = timestamp_ns;
+  }
+}
+
+bool TracerThread::ReadManualInstrumentationEvents() {
+  if (manual_instrumentation_reader_ == nullptr) {
+    return false;
+  }
+  uint64_t timestamp_ns = MonotonicTimestampNs();
+  if (last_manual_instrumentation_update +
+          MANUAL_INSTRUMENTATION_UPDATE_DELAY_MS * NS_PER_MILLISECOND <
+      timestamp_ns) {
+    ORBIT_SCOPE("UpdateManualInstrumentationRingBuffers");
+    manual_instrumentation_reader_->UpdateRingBuffers();
+    last_manual_instrumentation_update = timestamp_ns;
+  }
+  return manual_instrumentation_reader_->ReadEvents(listener_) > 0;
+}
+
+void TracerThread::InstrumentFunctionsInUserSpace() {
+  ORBIT_SCOPE_FUNC;
+  // Calls left in the ring buffers by a previous capture are discarded.
+  uint64_t begin_timestamp_ns = MonotonicTimestampNs();
+  outcome::result<
+      std::unique_ptr<orbit_user_space_instrumentation::InstrumentedProcess>,
+      std::string>
+      instrumented_process =
+          orbit_user_space_instrumentation::InstrumentedProcess::Create(
+              pid_, orbit_user_space_instrumentation::GetPayloadLibraryPath(),
+              functions_to_patch_);
+  if (instrumented_process.has_error()) {
+    ERROR("Instrumenting functions in user space, using uprobes instead: %s",
+          instrumented_process.error());
+    return;
+  }
+  instrumented_process_ = std::move(instrumented_process.value());
+
+  std::vector<uint64_t> patched_addresses =
+      instrumented_process_->GetInstrumentedFunctionAddresses();
+  absl::flat_hash_set<uint64_t> patched_address_set(patched_addresses.begin(),
+                                                    patched_addresses.end());
+  instrumented_functions_.erase(
+      std::remove_if(instrumented_functions_.begin(),
+                     instrumented_functions_.end(),
+                     [&patched_address_set](const Function& function) {
+                       return patched_address_set.contains(
+                           function.VirtualAddress());
+                     }),
+      instrumented_functions_.end());
+  LOG("Patched %u of %u functions, the others use uprobes",
+      patched_addresses.size(), functions_to_patch_.size());
+
+  user_space_instrumentation_reader_ =
+      std::make_unique<UserSpaceInstrumentationReader>(pid_,
+                                                       begin_timestamp_ns);
+}
+
+void TracerThread::UninstrumentFunctionsInUserSpace() {
+  if (instrumented_process_ == nullptr) {
+    return;
+  }
+  outcome::result<void, std::string> result =
+      instrumented_process_->Uninstrument();
+  if (result.has_error()) {
+    ERROR("Uninstrumenting functions in user space: %s", result.error());
+  }
+  // The calls that returned before the functions were restored.
+  ReadUserSpaceFunctionCalls();
+  user_space_instrumentation_reader_.reset();
+  instrumented_process_.reset();
+}
+
+bool TracerThread::ReadUserSpaceFunctionCalls() {
+  if (user_space_instrumentation_reader_ == nullptr) {
+    return false;
+  }
+  uint64_t timestamp_ns = MonotonicTimestampNs();
+  if (last_user_space_instrumentation_update +
+          USER_SPACE_INSTRUMENTATION_UPDATE_DELAY_MS * NS_PER_MILLISECOND <
+      timestamp_ns) {
+    ORBIT_SCOPE("UpdateUserSpaceInstrumentationRingBuffers");
+    user_space_instrumentation_reader_->UpdateRingBuffers();
+    last_user_space_instrumentation_update = timestamp_ns;
+  }
+  return user_space_instrumentation_reader_->ReadFunctionCalls(listener_) > 0;
+}
+
+void TracerThread::SampleSystemCountersIfDelayElapsed() {
+  if (system_counters_sampler_ == nullptr) {
+    return;
+  }
+  uint64_t timestamp_ns = MonotonicTimestampNs();
+  if (last_system_counters_sample +
+          system_counters_sampling_period_ns_.value() <
+      timestamp_ns) {
+    ORBIT_SCOPE("SampleSystemCounters");
+    // All the counters sampled in one round share the same timestamp, so that
+    // their tracks line up in the capture.
+    for (CounterSample& counter_sample :
+         system_counters_sampler_->Sample(timestamp_ns)) {
+      listener_->OnCounterSample(std::move(counter_sample));
+    }
+    last_system_counters_sample = timestamp_ns;
+  }
+}
+
 void TracerThread::Reset() {
   tracing_fds_.clear();
   ring_buffers_.clear();
 
   uprobes_uretprobes_ids_to_function_.clear();
   uprobes_ids_.clear();
+  uprobes_with_stack_ids_.clear();
   uretprobes_ids_.clear();
+  uprobes_ring_buffer_fds_.clear();
+  function_uprobes_fds_.clear();
+  function_uretprobes_fds_.clear();
+  function_call_counts_.clear();
+  function_call_counts_begin_ns_ = 0;
   stack_sampling_ids_.clear();
   gpu_tracing_ids_.clear();
   callchain_sampling_ids_.clear();
+  syscall_enter_ids_.clear();
+  syscall_exit_ids_.clear();
+  syscall_ring_buffer_fds_.clear();
+  syscall_event_processor_.reset();
+  futex_enter_ids_.clear();
+  futex_exit_ids_.clear();
+  futex_ring_buffer_fds_.clear();
+  cpu_frequency_ids_.clear();
+  cpu_frequency_ring_buffer_fds_.clear();
+  cpu_frequency_event_processor_.reset();
+  futex_event_processor_.reset();
 
   deferred_events_.clear();
   stop_deferred_thread_ = false;
 
   thread_names_.clear();
   last_thread_names_update = 0;
+
+  thread_counters_manager_.reset();
+  system_counters_sampler_.reset();
+  manual_instrumentation_reader_.reset();
+  last_thread_counters_read = 0;
+  last_manual_instrumentation_update = 0;
+  last_system_counters_sample = 0;
+
+  user_space_instrumentation_reader_.reset();
+  instrumented_process_.reset();
+  last_user_space_instrumentation_update = 0;
+}
+
+namespace {
+uint64_t CpuClockTimeNs(clockid_t clock_id) {
+  timespec ts;
+  if (clock_gettime(clock_id, &ts) != 0) {
+    return 0;
+  }
+  return 1'000'000'000llu * ts.tv_sec + ts.tv_nsec;
+}
+}  // namespace
+
+void TracerThread::ResetStats() {
+  stats_.Reset();
+  stats_.tracer_thread_cpu_time_begin_ns =
+      CpuClockTimeNs(CLOCK_THREAD_CPUTIME_ID);
+  if (processing_thread_cpu_clock_.has_value()) {
+    stats_.processing_thread_cpu_time_begin_ns =
+        CpuClockTimeNs(processing_thread_cpu_clock_.value());
+  }
 }
 
-void TracerThread::PrintStatsIfTimerElapsed() {
+void TracerThread::ReportStatsIfTimerElapsed() {
   uint64_t timestamp_ns = MonotonicTimestampNs();
-  if (stats_.event_count_begin_ns + EVENT_STATS_WINDOW_S * NS_PER_SECOND <
+  if (stats_.event_count_begin_ns +
+          EVENT_STATS_WINDOW_MS * NS_PER_MILLISECOND >=
       timestamp_ns) {
-    double actual_window_s =
-        static_cast<double>(timestamp_ns - stats_.event_count_begin_ns) /
-        NS_PER_SECOND;
-    LOG("Events per second (last %.1f s):", actual_window_s);
-    LOG("  sched switches: %.0f", stats_.sched_switch_count / actual_window_s);
-    LOG("  samples: %.0f", stats_.sample_count / actual_window_s);
-    LOG("  u(ret)probes: %.0f", stats_.uprobes_count / actual_window_s);
-    LOG("  gpu events: %.0f", stats_.gpu_events_count / actual_window_s);
-
-    if (stats_.lost_count_per_buffer.empty()) {
-      LOG("  lost: %.0f", stats_.lost_count / actual_window_s);
-    } else {
-      LOG("  lost: %.0f, of which:", stats_.lost_count / actual_window_s);
-      for (const auto& lost_from_buffer : stats_.lost_count_per_buffer) {
-        LOG("    from %s: %.0f", lost_from_buffer.first->GetName().c_str(),
-            lost_from_buffer.second / actual_window_s);
-      }
-    }
+    return;
+  }
 
-    uint64_t unwind_error_count = *stats_.unwind_error_count;
-    LOG("  unwind errors: %.0f (%.1f%%)", unwind_error_count / actual_window_s,
-        100.0 * unwind_error_count / stats_.sample_count);
-    uint64_t discarded_samples_in_uretprobes_count =
-        *stats_.discarded_samples_in_uretprobes_count;
-    LOG("  discarded samples in u(ret)probes: %.0f (%.1f%%)",
-        discarded_samples_in_uretprobes_count / actual_window_s,
-        100.0 * discarded_samples_in_uretprobes_count / stats_.sample_count);
-    stats_.Reset();
+  TracerStats tracer_stats;
+  tracer_stats.set_timestamp_ns(timestamp_ns);
+  tracer_stats.set_window_ns(timestamp_ns - stats_.event_count_begin_ns);
+  tracer_stats.set_sched_switch_count(stats_.sched_switch_count);
+  tracer_stats.set_sample_count(stats_.sample_count);
+  tracer_stats.set_uprobes_count(stats_.uprobes_count);
+  tracer_stats.set_gpu_events_count(stats_.gpu_events_count);
+  tracer_stats.set_syscalls_count(stats_.syscalls_count);
+  tracer_stats.set_futex_count(stats_.futex_count);
+  tracer_stats.set_lost_count(stats_.lost_count);
+  for (const auto& lost_from_buffer : stats_.lost_count_per_buffer) {
+    TracerStats::LostRecords* lost_records =
+        tracer_stats.add_lost_per_buffer();
+    lost_records->set_buffer_name(lost_from_buffer.first->GetName());
+    lost_records->set_count(lost_from_buffer.second);
+  }
+  tracer_stats.set_unwind_error_count(*stats_.unwind_error_count);
+  tracer_stats.set_discarded_samples_in_uretprobes_count(
+      *stats_.discarded_samples_in_uretprobes_count);
+  tracer_stats.set_max_deferred_events_count(
+      stats_.max_deferred_events_count);
+  tracer_stats.set_max_processing_lag_ns(*stats_.max_processing_lag_ns);
+  tracer_stats.set_tracer_thread_cpu_time_ns(
+      CpuClockTimeNs(CLOCK_THREAD_CPUTIME_ID) -
+      stats_.tracer_thread_cpu_time_begin_ns);
+  if (processing_thread_cpu_clock_.has_value()) {
+    tracer_stats.set_processing_thread_cpu_time_ns(
+        CpuClockTimeNs(processing_thread_cpu_clock_.value()) -
+        stats_.processing_thread_cpu_time_begin_ns);
   }
+
+  ++stats_window_count_;
+  if (stats_window_count_ % EVENT_STATS_LOG_PERIOD_WINDOWS == 0) {
+    LogStats(tracer_stats);
+  }
+  listener_->OnTracerStats(std::move(tracer_stats));
+
+  ResetStats();
+}
+
+void TracerThread::LogStats(const TracerStats& tracer_stats) {
+  double actual_window_s =
+      static_cast<double>(tracer_stats.window_ns()) / NS_PER_SECOND;
+  LOG("Events per second (last %.1f s):", actual_window_s);
+  LOG("  sched switches: %.0f",
+      tracer_stats.sched_switch_count() / actual_window_s);
+  LOG("  samples: %.0f", tracer_stats.sample_count() / actual_window_s);
+  LOG("  u(ret)probes: %.0f", tracer_stats.uprobes_count() / actual_window_s);
+  LOG("  gpu events: %.0f", tracer_stats.gpu_events_count() / actual_window_s);
+  LOG("  syscalls: %.0f", tracer_stats.syscalls_count() / actual_window_s);
+  LOG("  futex calls: %.0f", tracer_stats.futex_count() / actual_window_s);
+
+  if (tracer_stats.lost_per_buffer().empty()) {
+    LOG("  lost: %.0f", tracer_stats.lost_count() / actual_window_s);
+  } else {
+    LOG("  lost: %.0f, of which:", tracer_stats.lost_count() / actual_window_s);
+    for (const TracerStats::LostRecords& lost_from_buffer :
+         tracer_stats.lost_per_buffer()) {
+      LOG("    from %s: %.0f", lost_from_buffer.buffer_name().c_str(),
+          lost_from_buffer.count() / actual_window_s);
+    }
+  }
+
+  uint64_t unwind_error_count = tracer_stats.unwind_error_count();
+  LOG("  unwind errors: %.0f (%.1f%%)", unwind_error_count / actual_window_s,
+      100.0 * unwind_error_count / tracer_stats.sample_count());
+  uint64_t discarded_samples_in_uretprobes_count =
+      tracer_stats.discarded_samples_in_uretprobes_count();
+  LOG("  discarded samples in u(ret)probes: %.0f (%.1f%%)",
+      discarded_samples_in_uretprobes_count / actual_window_s,
+      100.0 * discarded_samples_in_uretprobes_count /
+          tracer_stats.sample_count());
+  LOG("  max deferred events: %lu, max processing lag: %.0f ms",
+      tracer_stats.max_deferred_events_count(),
+      static_cast<double>(tracer_stats.max_processing_lag_ns()) /
+          NS_PER_MILLISECOND);
+  LOG("  cpu usage: tracer %.1f%%, processing %.1f%%",
+      100.0 * tracer_stats.tracer_thread_cpu_time_ns() /
+          tracer_stats.window_ns(),
+      100.0 * tracer_stats.processing_thread_cpu_time_ns() /
+          tracer_stats.window_ns());
 }
 
 }  // namespace LinuxTracing
@@ -7,6 +7,7 @@
 
 #include <Function.h>
 #include <OrbitLinuxTracing/TracerListener.h>
+#include <OrbitUserSpaceInstrumentation/UserSpaceInstrumentation.h>
 #include <linux/perf_event.h>
 
 #include <atomic>
@@ -18,11 +19,15 @@
 
 #include "ContextSwitchManager.h"
 #include "GpuTracepointEventProcessor.h"
+#include "ManualInstrumentationReader.h"
 #include "PerfEvent.h"
 #include "PerfEventProcessor.h"
 #include "PerfEventProcessor2.h"
 #include "PerfEventReaders.h"
 #include "PerfEventRingBuffer.h"
+#include "SystemCounters.h"
+#include "ThreadCounters.h"
+#include "UserSpaceInstrumentationReader.h"
 #include "Utils.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
@@ -56,8 +61,17 @@ class TracerThread {
     }
   }
 
+  bool IsTracedPid(pid_t pid) const {
+    return system_wide_ || pids_.contains(pid);
+  }
+  std::vector<pid_t> GetTracedPids() const;
+
   bool OpenContextSwitches(const std::vector<int32_t>& cpus);
   void InitUprobesEventProcessor();
+  bool OpenUprobesRingBuffers(
+      const std::vector<int32_t>& cpus, uint64_t size_kb,
+      const char* name_prefix,
+      absl::flat_hash_map<int32_t, int>* ring_buffer_fds_per_cpu);
   bool OpenUprobes(const std::vector<int32_t>& cpus);
   bool OpenMmapTask(const std::vector<int32_t>& cpus);
   bool OpenSampling(const std::vector<int32_t>& cpus);
@@ -69,6 +83,12 @@ class TracerThread {
       std::vector<PerfEventRingBuffer>* gpu_ring_buffers);
   bool OpenGpuTracepoints(const std::vector<int32_t>& cpus);
 
+  void InitSyscallEventProcessor();
+  bool OpenSyscallTracepoints(const std::vector<int32_t>& cpus);
+
+  void InitFutexEventProcessor();
+  bool OpenFutexTracepoints(const std::vector<int32_t>& cpus);
+
   void ProcessContextSwitchCpuWideEvent(const perf_event_header& header,
                                         PerfEventRingBuffer* ring_buffer);
   void ProcessForkEvent(const perf_event_header& header,
@@ -80,7 +100,12 @@ class TracerThread {
   void ProcessSampleEvent(const perf_event_header& header,
                           PerfEventRingBuffer* ring_buffer);
   void ProcessLostEvent(const perf_event_header& header,
-                        PerfEventRingBuffer* ring_buffer);
+                        PerfEventRingBuffer* ring_buffer,
+                        uint64_t previous_record_timestamp_ns);
+
+  void CountFunctionCall(const Function* function);
+  void DisableFrequentlyCalledFunctionsIfWindowElapsed();
+  void DisableUprobes(const Function* function);
 
   void DeferEvent(std::unique_ptr<PerfEvent> event);
   std::vector<std::unique_ptr<PerfEvent>> ConsumeDeferredEvents();
@@ -88,7 +113,26 @@ class TracerThread {
 
   void UpdateThreadNamesIfDelayElapsed();
 
-  void PrintStatsIfTimerElapsed();
+  void OpenThreadCounters();
+  void ReadThreadCountersIfDelayElapsed();
+
+  // Returns whether events were read.
+  bool ReadManualInstrumentationEvents();
+
+  // Patches the functions in functions_to_patch_ in pid_, and removes those
+  // patched from instrumented_functions_ so that they get no uprobes.
+  void InstrumentFunctionsInUserSpace();
+  void UninstrumentFunctionsInUserSpace();
+  // Returns whether calls were read.
+  bool ReadUserSpaceFunctionCalls();
+
+  void InitCpuFrequencyEventProcessor();
+  bool OpenCpuFrequencyTracepoint(const std::vector<int32_t>& cpus);
+  void SampleSystemCountersIfDelayElapsed();
+
+  void ResetStats();
+  void ReportStatsIfTimerElapsed();
+  static void LogStats(const TracerStats& tracer_stats);
 
   void Reset();
 
@@ -98,32 +142,78 @@ class TracerThread {
 
   static constexpr uint64_t CONTEXT_SWITCHES_RING_BUFFER_SIZE_KB = 256;
   static constexpr uint64_t UPROBES_RING_BUFFER_SIZE_KB = 2 * 1024;
+  static constexpr uint64_t UPROBES_WITH_STACK_RING_BUFFER_SIZE_KB = 8 * 1024;
   static constexpr uint64_t MMAP_TASK_RING_BUFFER_SIZE_KB = 64;
   static constexpr uint64_t SAMPLING_RING_BUFFER_SIZE_KB = 8 * 1024;
   static constexpr uint64_t GPU_TRACING_RING_BUFFER_SIZE_KB = 256;
+  static constexpr uint64_t SYSCALLS_RING_BUFFER_SIZE_KB = 2 * 1024;
+  static constexpr uint64_t FUTEX_RING_BUFFER_SIZE_KB = 2 * 1024;
+  static constexpr uint64_t CPU_FREQUENCY_RING_BUFFER_SIZE_KB = 64;
+
+  // Enough to unwind the caller of an instrumented function in most cases.
+  static constexpr uint16_t DEFAULT_ENTRY_CALLSTACK_STACK_DUMP_SIZE = 8 * 1024;
 
   static constexpr uint32_t IDLE_TIME_ON_EMPTY_RING_BUFFERS_US = 100;
   static constexpr uint32_t IDLE_TIME_ON_EMPTY_DEFERRED_EVENTS_US = 1000;
 
   bool trace_context_switches_;
+  // The main process, whose addresses are used for instrumented functions and
+  // for which process and thread counters are sampled.
   pid_t pid_;
+  // All traced processes, including pid_, unless system_wide_.
+  absl::flat_hash_set<pid_t> pids_;
+  bool system_wide_;
   uint64_t sampling_period_ns_;
   CaptureOptions::UnwindingMethod unwinding_method_;
   std::vector<Function> instrumented_functions_;
+  // The instrumented functions to patch with trampolines instead of
+  // instrumenting with uprobes, if possible.
+  std::vector<orbit_user_space_instrumentation::FunctionToInstrument>
+      functions_to_patch_;
+  uint16_t entry_callstack_stack_dump_size_;
   bool trace_gpu_driver_;
+  bool trace_syscalls_;
+  bool trace_lock_contention_;
+  bool sample_thread_counters_;
+  std::optional<uint64_t> system_counters_sampling_period_ns_;
+  // 0 means no limit.
+  uint64_t max_function_calls_per_second_;
+  bool read_orbit_api_ring_buffers_;
 
   TracerListener* listener_ = nullptr;
 
   std::vector<int> tracing_fds_;
   std::vector<PerfEventRingBuffer> ring_buffers_;
+  // Timestamp of the last record read from each of ring_buffers_, which is
+  // where a gap starts if the next record is a PERF_RECORD_LOST.
+  std::vector<uint64_t> ring_buffers_last_record_timestamps_;
 
   absl::flat_hash_map<uint64_t, const Function*>
       uprobes_uretprobes_ids_to_function_;
   absl::flat_hash_set<uint64_t> uprobes_ids_;
+  absl::flat_hash_set<uint64_t> uprobes_with_stack_ids_;
   absl::flat_hash_set<uint64_t> uretprobes_ids_;
+  absl::flat_hash_set<int> uprobes_ring_buffer_fds_;
   absl::flat_hash_set<uint64_t> stack_sampling_ids_;
   absl::flat_hash_set<uint64_t> gpu_tracing_ids_;
   absl::flat_hash_set<uint64_t> callchain_sampling_ids_;
+  absl::flat_hash_set<uint64_t> syscall_enter_ids_;
+  absl::flat_hash_set<uint64_t> syscall_exit_ids_;
+  absl::flat_hash_set<int> syscall_ring_buffer_fds_;
+  absl::flat_hash_set<uint64_t> futex_enter_ids_;
+  absl::flat_hash_set<uint64_t> futex_exit_ids_;
+  absl::flat_hash_set<int> futex_ring_buffer_fds_;
+  absl::flat_hash_set<uint64_t> cpu_frequency_ids_;
+  absl::flat_hash_set<int> cpu_frequency_ring_buffer_fds_;
+
+  // The u(ret)probes file descriptors (one per cpu) of the instrumented
+  // functions that are still enabled.
+  absl::flat_hash_map<const Function*, std::vector<int>> function_uprobes_fds_;
+  absl::flat_hash_map<const Function*, std::vector<int>>
+      function_uretprobes_fds_;
+  static constexpr uint64_t FUNCTION_CALL_RATES_WINDOW_MS = 1000;
+  absl::flat_hash_map<const Function*, uint64_t> function_call_counts_;
+  uint64_t function_call_counts_begin_ns_ = 0;
 
   std::atomic<bool> stop_deferred_thread_ = false;
   std::vector<std::unique_ptr<PerfEvent>> deferred_events_;
@@ -131,28 +221,61 @@ class TracerThread {
   ContextSwitchManager context_switch_manager_;
   std::shared_ptr<PerfEventProcessor2> uprobes_event_processor_;
   std::shared_ptr<GpuTracepointEventProcessor> gpu_event_processor_;
+  std::shared_ptr<PerfEventProcessor2> syscall_event_processor_;
+  std::shared_ptr<PerfEventProcessor2> futex_event_processor_;
+  std::shared_ptr<PerfEventProcessor2> cpu_frequency_event_processor_;
 
   static constexpr uint64_t THREAD_NAMES_UPDATE_DELAY_MS = 1000;
   absl::flat_hash_map<pid_t, std::string> thread_names_;
   uint64_t last_thread_names_update = 0;
 
+  static constexpr uint64_t THREAD_COUNTERS_READ_DELAY_MS = 10;
+  std::unique_ptr<ThreadCountersManager> thread_counters_manager_;
+  uint64_t last_thread_counters_read = 0;
+
+  std::unique_ptr<SystemCountersSampler> system_counters_sampler_;
+  uint64_t last_system_counters_sample = 0;
+
+  static constexpr uint64_t MANUAL_INSTRUMENTATION_UPDATE_DELAY_MS = 1000;
+  std::unique_ptr<ManualInstrumentationReader> manual_instrumentation_reader_;
+  uint64_t last_manual_instrumentation_update = 0;
+
+  // Threads that call a patched function for the first time create their
+  // ring buffer then, so look for new ones as for the Orbit API.
+  static constexpr uint64_t USER_SPACE_INSTRUMENTATION_UPDATE_DELAY_MS = 1000;
+  std::unique_ptr<orbit_user_space_instrumentation::InstrumentedProcess>
+      instrumented_process_;
+  std::unique_ptr<UserSpaceInstrumentationReader>
+      user_space_instrumentation_reader_;
+  uint64_t last_user_space_instrumentation_update = 0;
+
   struct EventStats {
     void Reset() {
       event_count_begin_ns = MonotonicTimestampNs();
+      tracer_thread_cpu_time_begin_ns = 0;
+      processing_thread_cpu_time_begin_ns = 0;
       sched_switch_count = 0;
       sample_count = 0;
       uprobes_count = 0;
+      syscalls_count = 0;
+      futex_count = 0;
       lost_count = 0;
       lost_count_per_buffer.clear();
       *unwind_error_count = 0;
       *discarded_samples_in_uretprobes_count = 0;
+      max_deferred_events_count = 0;
+      *max_processing_lag_ns = 0;
     }
 
     uint64_t event_count_begin_ns = 0;
+    uint64_t tracer_thread_cpu_time_begin_ns = 0;
+    uint64_t processing_thread_cpu_time_begin_ns = 0;
     uint64_t sched_switch_count = 0;
     uint64_t sample_count = 0;
     uint64_t uprobes_count = 0;
     uint64_t gpu_events_count = 0;
+    uint64_t syscalls_count = 0;
+    uint64_t futex_count = 0;
     uint64_t lost_count = 0;
     absl::flat_hash_map<PerfEventRingBuffer*, uint64_t> lost_count_per_buffer{};
     std::shared_ptr<std::atomic<uint64_t>> unwind_error_count =
@@ -160,10 +283,19 @@ class TracerThread {
     std::shared_ptr<std::atomic<uint64_t>>
         discarded_samples_in_uretprobes_count =
             std::make_unique<std::atomic<uint64_t>>(0);
+    uint64_t max_deferred_events_count = 0;
+    // Updated by the thread processing the deferred events.
+    std::shared_ptr<std::atomic<uint64_t>> max_processing_lag_ns =
+        std::make_unique<std::atomic<uint64_t>>(0);
   };
 
-  static constexpr uint64_t EVENT_STATS_WINDOW_S = 5;
+  // Stats are sent to the listener every window, but only logged every
+  // EVENT_STATS_LOG_PERIOD_WINDOWS windows.
+  static constexpr uint64_t EVENT_STATS_WINDOW_MS = 1000;
+  static constexpr uint64_t EVENT_STATS_LOG_PERIOD_WINDOWS = 5;
   EventStats stats_{};
+  uint64_t stats_window_count_ = 0;
+  std::optional<clockid_t> processing_thread_cpu_clock_;
 
   static constexpr uint64_t NS_PER_MILLISECOND = 1'000'000;
   static constexpr uint64_t NS_PER_SECOND = 1'000'000'000;
@@ -7,6 +7,7 @@
 
 #include <OrbitBase/Logging.h>
 
+#include <optional>
 #include <stack>
 
 #include "absl/container/flat_hash_map.h"
@@ -28,9 +29,11 @@ class UprobesFunctionCallManager {
   UprobesFunctionCallManager& operator=(UprobesFunctionCallManager&&) = default;
 
   void ProcessUprobes(pid_t tid, uint64_t function_address,
-                      uint64_t begin_timestamp) {
+                      uint64_t begin_timestamp,
+                      std::optional<Callstack> entry_callstack = std::nullopt) {
     auto& tid_uprobes_stack = tid_uprobes_stacks_[tid];
-    tid_uprobes_stack.emplace(function_address, begin_timestamp);
+    tid_uprobes_stack.emplace(function_address, begin_timestamp,
+                              std::move(entry_callstack));
   }
 
   std::optional<FunctionCall> ProcessUretprobes(pid_t tid,
@@ -53,6 +56,10 @@ class UprobesFunctionCallManager {
     function_call.set_end_timestamp_ns(end_timestamp);
     function_call.set_depth(tid_uprobes_stack.size() - 1);
     function_call.set_return_value(return_value);
+    if (tid_uprobes_stack.top().entry_callstack.has_value()) {
+      *function_call.mutable_entry_callstack() =
+          std::move(tid_uprobes_stack.top().entry_callstack.value());
+    }
 
     tid_uprobes_stack.pop();
     if (tid_uprobes_stack.empty()) {
@@ -61,13 +68,20 @@ class UprobesFunctionCallManager {
     return function_call;
   }
 
+  // Forgets all open uprobes, e.g., because some uretprobes might have been
+  // lost, in which case the next ones would be matched with the wrong uprobes.
+  void Reset() { tid_uprobes_stacks_.clear(); }
+
  private:
   struct OpenUprobes {
-    OpenUprobes(uint64_t function_address, uint64_t begin_timestamp)
+    OpenUprobes(uint64_t function_address, uint64_t begin_timestamp,
+                std::optional<Callstack> entry_callstack)
         : function_address{function_address},
-          begin_timestamp{begin_timestamp} {}
+          begin_timestamp{begin_timestamp},
+          entry_callstack{std::move(entry_callstack)} {}
     uint64_t function_address;
     uint64_t begin_timestamp;
+    std::optional<Callstack> entry_callstack;
   };
 
   // This map keeps the stack of the dynamically-instrumented functions entered.
@@ -103,4 +103,50 @@ TEST(UprobesFunctionCallManager, OnlyUretprobe) {
   ASSERT_FALSE(processed_function_call.has_value());
 }
 
+TEST(UprobesFunctionCallManager, EntryCallstack) {
+  constexpr pid_t tid = 42;
+  std::optional<FunctionCall> processed_function_call;
+  UprobesFunctionCallManager function_call_manager;
+
+  Callstack entry_callstack;
+  entry_callstack.add_pcs(100);
+  entry_callstack.add_pcs(0x1234);
+  function_call_manager.ProcessUprobes(tid, 100, 1, entry_callstack);
+  function_call_manager.ProcessUprobes(tid, 200, 2);
+
+  processed_function_call = function_call_manager.ProcessUretprobes(tid, 3, 4);
+  ASSERT_TRUE(processed_function_call.has_value());
+  EXPECT_EQ(processed_function_call.value().absolute_address(), 200);
+  EXPECT_FALSE(processed_function_call.value().has_entry_callstack());
+
+  processed_function_call = function_call_manager.ProcessUretprobes(tid, 4, 5);
+  ASSERT_TRUE(processed_function_call.has_value());
+  EXPECT_EQ(processed_function_call.value().absolute_address(), 100);
+  ASSERT_TRUE(processed_function_call.value().has_entry_callstack());
+  EXPECT_THAT(processed_function_call.value().entry_callstack().pcs(),
+              testing::ElementsAre(100, 0x1234));
+}
+
+TEST(UprobesFunctionCallManager, Reset) {
+  constexpr pid_t tid1 = 42;
+  constexpr pid_t tid2 = 43;
+  std::optional<FunctionCall> processed_function_call;
+  UprobesFunctionCallManager function_call_manager;
+
+  function_call_manager.ProcessUprobes(tid1, 100, 1);
+  function_call_manager.ProcessUprobes(tid2, 200, 2);
+  function_call_manager.Reset();
+
+  processed_function_call = function_call_manager.ProcessUretprobes(tid1, 3, 4);
+  EXPECT_FALSE(processed_function_call.has_value());
+  processed_function_call = function_call_manager.ProcessUretprobes(tid2, 4, 5);
+  EXPECT_FALSE(processed_function_call.has_value());
+
+  function_call_manager.ProcessUprobes(tid1, 300, 6);
+  processed_function_call = function_call_manager.ProcessUretprobes(tid1, 7, 8);
+  ASSERT_TRUE(processed_function_call.has_value());
+  EXPECT_EQ(processed_function_call.value().absolute_address(), 300);
+  EXPECT_EQ(processed_function_call.value().depth(), 0);
+}
+
 }  // namespace LinuxTracing
@@ -176,6 +176,8 @@ class UprobesReturnAddressManager {
     }
   }
 
+  void Reset() { tid_uprobes_stacks_.clear(); }
+
  private:
   struct OpenUprobes {
     OpenUprobes(uint64_t stack_pointer, uint64_t return_address)
@@ -8,10 +8,33 @@
 
 namespace LinuxTracing {
 
+void UprobesUnwindingVisitor::SetMaps(pid_t pid, const std::string& maps) {
+  if (maps.empty()) {
+    maps_per_pid_.erase(pid);
+    return;
+  }
+  std::unique_ptr<unwindstack::BufferMaps> parsed_maps =
+      LibunwindstackUnwinder::ParseMaps(maps);
+  if (parsed_maps == nullptr) {
+    maps_per_pid_.erase(pid);
+    return;
+  }
+  maps_per_pid_.insert_or_assign(pid, std::move(parsed_maps));
+}
+
+unwindstack::BufferMaps* UprobesUnwindingVisitor::GetMaps(pid_t pid) {
+  auto maps_it = maps_per_pid_.find(pid);
+  if (maps_it == maps_per_pid_.end()) {
+    return nullptr;
+  }
+  return maps_it->second.get();
+}
+
 void UprobesUnwindingVisitor::visit(StackSamplePerfEvent* event) {
   CHECK(listener_ != nullptr);
 
-  if (current_maps_ == nullptr) {
+  unwindstack::BufferMaps* maps = GetMaps(event->GetPid());
+  if (maps == nullptr) {
     return;
   }
 
@@ -20,8 +43,8 @@ void UprobesUnwindingVisitor::visit(StackSamplePerfEvent* event) {
       event->GetStackData(), event->GetStackSize());
 
   const std::vector<unwindstack::FrameData>& libunwindstack_callstack =
-      unwinder_.Unwind(current_maps_.get(), event->GetRegisters(),
-                       event->GetStackData(), event->GetStackSize());
+      unwinder_.Unwind(maps, event->GetRegisters(), event->GetStackData(),
+                       event->GetStackSize());
 
   if (libunwindstack_callstack.empty()) {
     if (unwind_error_counter_ != nullptr) {
@@ -40,10 +63,19 @@ void UprobesUnwindingVisitor::visit(StackSamplePerfEvent* event) {
   }
 
   CallstackSample sample;
+  sample.set_pid(event->GetPid());
   sample.set_tid(event->GetTid());
   sample.set_timestamp_ns(event->GetTimestamp());
+  *sample.mutable_callstack() =
+      CallstackFromFrames(event->GetPid(), libunwindstack_callstack);
 
-  Callstack* callstack = sample.mutable_callstack();
+  listener_->OnCallstackSample(std::move(sample));
+}
+
+Callstack UprobesUnwindingVisitor::CallstackFromFrames(
+    pid_t pid,
+    const std::vector<unwindstack::FrameData>& libunwindstack_callstack) {
+  Callstack callstack;
   for (const unwindstack::FrameData& libunwindstack_frame :
        libunwindstack_callstack) {
     AddressInfo address_info;
@@ -51,24 +83,25 @@ void UprobesUnwindingVisitor::visit(StackSamplePerfEvent* event) {
     address_info.set_function_name(libunwindstack_frame.function_name);
     address_info.set_offset_in_function(libunwindstack_frame.function_offset);
     address_info.set_map_name(libunwindstack_frame.map_name);
+    address_info.set_pid(pid);
     listener_->OnAddressInfo(std::move(address_info));
 
-    callstack->add_pcs(libunwindstack_frame.pc);
+    callstack.add_pcs(libunwindstack_frame.pc);
   }
-
-  listener_->OnCallstackSample(std::move(sample));
+  return callstack;
 }
 
 void UprobesUnwindingVisitor::visit(CallchainSamplePerfEvent* event) {
   CHECK(listener_ != nullptr);
 
-  if (current_maps_ == nullptr) {
+  unwindstack::BufferMaps* maps = GetMaps(event->GetPid());
+  if (maps == nullptr) {
     return;
   }
 
   if (!return_address_manager_.PatchCallchain(
           event->GetTid(), event->GetCallchain(), event->GetCallchainSize(),
-          current_maps_.get())) {
+          maps)) {
     return;
   }
 
@@ -78,7 +111,7 @@ void UprobesUnwindingVisitor::visit(CallchainSamplePerfEvent* event) {
   }
 
   uint64_t top_ip = event->GetCallchain()[1];
-  unwindstack::MapInfo* top_ip_map_info = current_maps_->Find(top_ip);
+  unwindstack::MapInfo* top_ip_map_info = maps->Find(top_ip);
 
   // Some samples can actually fall inside u(ret)probes code. Discard them,
   // as we don't want to show the unnamed uprobes module in the samples.
@@ -90,6 +123,7 @@ void UprobesUnwindingVisitor::visit(CallchainSamplePerfEvent* event) {
   }
 
   CallstackSample sample;
+  sample.set_pid(event->GetPid());
   sample.set_tid(event->GetTid());
   sample.set_timestamp_ns(event->GetTimestamp());
 
@@ -104,9 +138,10 @@ void UprobesUnwindingVisitor::visit(CallchainSamplePerfEvent* event) {
   listener_->OnCallstackSample(std::move(sample));
 }
 
-void UprobesUnwindingVisitor::visit(UprobesPerfEvent* event) {
-  CHECK(listener_ != nullptr);
-
+bool UprobesUnwindingVisitor::ProcessUprobeSpIpCpu(pid_t tid,
+                                                   uint64_t uprobe_sp,
+                                                   uint64_t uprobe_ip,
+                                                   uint32_t uprobe_cpu) {
   // We are seeing that, on thread migration, uprobe events can sometimes be
   // duplicated: the duplicate uprobe event will have the same stack pointer and
   // instruction pointer as the previous uprobe, but different cpu. In that
@@ -117,11 +152,8 @@ void UprobesUnwindingVisitor::visit(UprobesPerfEvent* event) {
   // pointers (the stack grows towards lower addresses).
 
   // Duplicate uprobe detection.
-  uint64_t uprobe_sp = event->GetSp();
-  uint64_t uprobe_ip = event->GetIp();
-  uint32_t uprobe_cpu = event->GetCpu();
   std::vector<std::tuple<uint64_t, uint64_t, uint32_t>>& uprobe_sps_ips_cpus =
-      uprobe_sps_ips_cpus_per_thread_[event->GetTid()];
+      uprobe_sps_ips_cpus_per_thread_[tid];
   if (!uprobe_sps_ips_cpus.empty()) {
     uint64_t last_uprobe_sp = std::get<0>(uprobe_sps_ips_cpus.back());
     uint64_t last_uprobe_ip = std::get<1>(uprobe_sps_ips_cpus.back());
@@ -129,14 +161,24 @@ void UprobesUnwindingVisitor::visit(UprobesPerfEvent* event) {
     uprobe_sps_ips_cpus.pop_back();
     if (uprobe_sp > last_uprobe_sp) {
       ERROR("MISSING URETPROBE OR DUPLICATE UPROBE");
-      return;
+      return false;
     } else if (uprobe_sp == last_uprobe_sp && uprobe_ip == last_uprobe_ip &&
                uprobe_cpu != last_uprobe_cpu) {
       ERROR("Duplicate uprobe on thread migration");
-      return;
+      return false;
     }
   }
   uprobe_sps_ips_cpus.emplace_back(uprobe_sp, uprobe_ip, uprobe_cpu);
+  return true;
+}
+
+void UprobesUnwindingVisitor::visit(UprobesPerfEvent* event) {
+  CHECK(listener_ != nullptr);
+
+  if (!ProcessUprobeSpIpCpu(event->GetTid(), event->GetSp(), event->GetIp(),
+                            event->GetCpu())) {
+    return;
+  }
 
   function_call_manager_.ProcessUprobes(event->GetTid(),
                                         event->GetFunction()->VirtualAddress(),
@@ -146,6 +188,46 @@ void UprobesUnwindingVisitor::visit(UprobesPerfEvent* event) {
                                          event->GetReturnAddress());
 }
 
+void UprobesUnwindingVisitor::visit(UprobesWithStackPerfEvent* event) {
+  CHECK(listener_ != nullptr);
+
+  if (!ProcessUprobeSpIpCpu(event->GetTid(), event->GetSp(), event->GetIp(),
+                            event->GetCpu())) {
+    return;
+  }
+
+  // The return address of this function is read before patching, as it has
+  // not been hijacked yet. The return addresses of the enclosing instrumented
+  // functions have, so restore them before unwinding.
+  uint64_t return_address = event->GetReturnAddress();
+
+  std::optional<Callstack> entry_callstack;
+  unwindstack::BufferMaps* maps = GetMaps(event->GetPid());
+  if (maps != nullptr) {
+    return_address_manager_.PatchSample(
+        event->GetTid(), event->GetRegisters()[PERF_REG_X86_SP],
+        event->GetStackData(), event->GetStackSize());
+
+    const std::vector<unwindstack::FrameData>& libunwindstack_callstack =
+        unwinder_.Unwind(maps, event->GetRegisters(), event->GetStackData(),
+                         event->GetStackSize());
+    if (!libunwindstack_callstack.empty()) {
+      entry_callstack =
+          CallstackFromFrames(event->GetPid(), libunwindstack_callstack);
+    } else if (unwind_error_counter_ != nullptr) {
+      ++(*unwind_error_counter_);
+    }
+  }
+
+  // An unwinding error only loses the callstack, not the function call.
+  function_call_manager_.ProcessUprobes(
+      event->GetTid(), event->GetFunction()->VirtualAddress(),
+      event->GetTimestamp(), std::move(entry_callstack));
+
+  return_address_manager_.ProcessUprobes(event->GetTid(), event->GetSp(),
+                                         return_address);
+}
+
 void UprobesUnwindingVisitor::visit(UretprobesPerfEvent* event) {
   CHECK(listener_ != nullptr);
 
@@ -160,6 +242,7 @@ void UprobesUnwindingVisitor::visit(UretprobesPerfEvent* event) {
       function_call_manager_.ProcessUretprobes(
           event->GetTid(), event->GetTimestamp(), event->GetAx());
   if (function_call.has_value()) {
+    function_call->set_pid(event->GetPid());
     listener_->OnFunctionCall(std::move(function_call.value()));
   }
 
@@ -167,7 +250,31 @@ void UprobesUnwindingVisitor::visit(UretprobesPerfEvent* event) {
 }
 
 void UprobesUnwindingVisitor::visit(MapsPerfEvent* event) {
-  current_maps_ = LibunwindstackUnwinder::ParseMaps(event->GetMaps());
+  SetMaps(event->GetPid(), event->GetMaps());
+}
+
+void UprobesUnwindingVisitor::visit(LostPerfEvent* /*event*/) {
+  // We don't know which threads the lost u(ret)probes belonged to, so start
+  // over for all threads. The calls open at this point will never complete.
+  function_call_manager_.Reset();
+  return_address_manager_.Reset();
+  uprobe_sps_ips_cpus_per_thread_.clear();
+}
+
+void UprobesUnwindingVisitor::visit(UprobesDisabledPerfEvent* event) {
+  // As for lost u(ret)probes, start over for all threads.
+  function_call_manager_.Reset();
+  return_address_manager_.Reset();
+  uprobe_sps_ips_cpus_per_thread_.clear();
+
+  FunctionInstrumentationDisabled function_instrumentation_disabled;
+  function_instrumentation_disabled.set_absolute_address(
+      event->GetFunctionAddress());
+  function_instrumentation_disabled.set_timestamp_ns(event->GetTimestamp());
+  function_instrumentation_disabled.set_calls_per_second(
+      event->GetCallsPerSecond());
+  listener_->OnFunctionInstrumentationDisabled(
+      std::move(function_instrumentation_disabled));
 }
 
 }  // namespace LinuxTracing
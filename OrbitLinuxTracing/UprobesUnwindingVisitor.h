@@ -31,14 +31,19 @@ namespace LinuxTracing {
 // of the return addresses before they are hijacked, and patches them into the
 // time-based stack samples. Such return addresses can be retrieved by getting
 // the eight bytes at the top of the stack on hitting uprobes.
+// Maps are kept for each traced process, as a capture can include several.
 // TODO: Make this more robust to losing uprobes or uretprobes events, if this
 //  is still observed. For example, pass the address of uretprobes and compare
 //  it against the address of uprobes on the stack.
 
 class UprobesUnwindingVisitor : public PerfEventVisitor {
  public:
-  explicit UprobesUnwindingVisitor(const std::string& initial_maps)
-      : current_maps_{LibunwindstackUnwinder::ParseMaps(initial_maps)} {}
+  explicit UprobesUnwindingVisitor(
+      const absl::flat_hash_map<pid_t, std::string>& initial_maps_per_pid) {
+    for (const auto& [pid, initial_maps] : initial_maps_per_pid) {
+      SetMaps(pid, initial_maps);
+    }
+  }
 
   UprobesUnwindingVisitor(const UprobesUnwindingVisitor&) = delete;
   UprobesUnwindingVisitor& operator=(const UprobesUnwindingVisitor&) = delete;
@@ -60,13 +65,29 @@ class UprobesUnwindingVisitor : public PerfEventVisitor {
   void visit(StackSamplePerfEvent* event) override;
   void visit(CallchainSamplePerfEvent* event) override;
   void visit(UprobesPerfEvent* event) override;
+  void visit(UprobesWithStackPerfEvent* event) override;
   void visit(UretprobesPerfEvent* event) override;
   void visit(MapsPerfEvent* event) override;
+  void visit(LostPerfEvent* event) override;
+  void visit(UprobesDisabledPerfEvent* event) override;
 
  private:
+  // Returns false if the uprobe must be discarded, as it is a duplicate or a
+  // uretprobe has been missed.
+  bool ProcessUprobeSpIpCpu(pid_t tid, uint64_t uprobe_sp, uint64_t uprobe_ip,
+                            uint32_t uprobe_cpu);
+  void SetMaps(pid_t pid, const std::string& maps);
+  // Returns nullptr if the maps of pid are not known.
+  unwindstack::BufferMaps* GetMaps(pid_t pid);
+  // Sends the AddressInfo of each frame, in process pid, to the listener.
+  Callstack CallstackFromFrames(
+      pid_t pid,
+      const std::vector<unwindstack::FrameData>& libunwindstack_callstack);
+
   UprobesFunctionCallManager function_call_manager_{};
   UprobesReturnAddressManager return_address_manager_{};
-  std::unique_ptr<unwindstack::BufferMaps> current_maps_;
+  absl::flat_hash_map<pid_t, std::unique_ptr<unwindstack::BufferMaps>>
+      maps_per_pid_;
   LibunwindstackUnwinder unwinder_{};
 
   TracerListener* listener_ = nullptr;
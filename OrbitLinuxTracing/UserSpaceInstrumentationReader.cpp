@@ -0,0 +1,45 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "UserSpaceInstrumentationReader.h"
+
+#include <OrbitBase/Logging.h>
+
+namespace LinuxTracing {
+
+uint64_t UserSpaceInstrumentationReader::ReadFunctionCalls(
+    TracerListener* listener) {
+  uint64_t call_count = 0;
+  ring_buffers_.ReadAll([this, listener, &call_count](
+                            FunctionCallRingBuffers::MappedRingBuffer*
+                                mapped_ring_buffer) {
+    uint64_t dropped_count = mapped_ring_buffer->ring_buffer.GetDroppedCount();
+    if (dropped_count != mapped_ring_buffer->dropped_count) {
+      ERROR("Thread %d dropped %u calls to instrumented functions",
+            mapped_ring_buffer->tid,
+            dropped_count - mapped_ring_buffer->dropped_count);
+      mapped_ring_buffer->dropped_count = dropped_count;
+    }
+
+    orbit_user_space_instrumentation::FunctionCallRecord record;
+    while (mapped_ring_buffer->ring_buffer.TryRead(&record)) {
+      if (record.begin_timestamp_ns < begin_timestamp_ns_) {
+        continue;
+      }
+      ++call_count;
+      FunctionCall function_call;
+      function_call.set_pid(pid_);
+      function_call.set_tid(record.tid);
+      function_call.set_absolute_address(record.function_address);
+      function_call.set_begin_timestamp_ns(record.begin_timestamp_ns);
+      function_call.set_end_timestamp_ns(record.end_timestamp_ns);
+      function_call.set_depth(record.depth);
+      function_call.set_return_value(record.return_value);
+      listener->OnFunctionCall(std::move(function_call));
+    }
+  });
+  return call_count;
+}
+
+}  // namespace LinuxTracing
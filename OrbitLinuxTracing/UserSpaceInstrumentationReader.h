@@ -0,0 +1,56 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_LINUX_TRACING_USER_SPACE_INSTRUMENTATION_READER_H_
+#define ORBIT_LINUX_TRACING_USER_SPACE_INSTRUMENTATION_READER_H_
+
+#include <OrbitLinuxTracing/TracerListener.h>
+#include <OrbitUserSpaceInstrumentation/FunctionCallRecord.h>
+#include <sys/types.h>
+
+#include "MemfdRingBuffers.h"
+
+namespace LinuxTracing {
+
+// Reads the calls to the functions instrumented with trampolines, which the
+// payload of OrbitUserSpaceInstrumentation writes to a ring buffer per thread
+// in the target, and sends them to the listener as FunctionCalls.
+class UserSpaceInstrumentationReader {
+ public:
+  // Calls that began before begin_timestamp_ns, e.g., during a previous
+  // capture, are discarded.
+  UserSpaceInstrumentationReader(pid_t pid, uint64_t begin_timestamp_ns)
+      : pid_{pid},
+        begin_timestamp_ns_{begin_timestamp_ns},
+        ring_buffers_{pid, orbit_user_space_instrumentation::
+                               kFunctionCallRingBufferMemfdPrefix} {}
+
+  UserSpaceInstrumentationReader(const UserSpaceInstrumentationReader&) =
+      delete;
+  UserSpaceInstrumentationReader& operator=(
+      const UserSpaceInstrumentationReader&) = delete;
+  UserSpaceInstrumentationReader(UserSpaceInstrumentationReader&&) = delete;
+  UserSpaceInstrumentationReader& operator=(UserSpaceInstrumentationReader&&) =
+      delete;
+
+  // Maps the ring buffers of the threads that called an instrumented function
+  // for the first time.
+  void UpdateRingBuffers() { ring_buffers_.Update(); }
+
+  // Reads all the available calls and sends them to listener. Returns the
+  // number of calls read.
+  uint64_t ReadFunctionCalls(TracerListener* listener);
+
+ private:
+  using FunctionCallRingBuffers =
+      MemfdRingBuffers<orbit_user_space_instrumentation::FunctionCallRecord>;
+
+  pid_t pid_;
+  uint64_t begin_timestamp_ns_;
+  FunctionCallRingBuffers ring_buffers_;
+};
+
+}  // namespace LinuxTracing
+
+#endif  // ORBIT_LINUX_TRACING_USER_SPACE_INSTRUMENTATION_READER_H_
@@ -9,6 +9,8 @@
 #include <OrbitBase/SafeStrerror.h>
 #include <sys/resource.h>
 
+#include <algorithm>
+#include <filesystem>
 #include <fstream>
 #include <thread>
 
@@ -56,21 +58,32 @@ std::optional<std::string> ExecuteCommand(const std::string& cmd) {
   return result;
 }
 
-std::vector<pid_t> ListThreads(pid_t pid) {
-  std::vector<pid_t> threads;
-  std::optional<std::string> tasks =
-      ExecuteCommand(absl::StrFormat("ls /proc/%d/task", pid));
-  if (!tasks.has_value()) {
-    return {};
+namespace {
+// Returns the sorted numerical entries of directory, e.g., the pids in /proc.
+std::vector<pid_t> ListNumericalDirectoryEntries(const std::string& directory) {
+  std::vector<pid_t> ids;
+  std::error_code error;
+  for (const std::filesystem::directory_entry& entry :
+       std::filesystem::directory_iterator{directory, error}) {
+    pid_t id;
+    if (absl::SimpleAtoi(entry.path().filename().string(), &id)) {
+      ids.push_back(id);
+    }
   }
-
-  std::stringstream ss(tasks.value());
-  std::string line;
-  while (std::getline(ss, line, '\n')) {
-    threads.push_back(std::stol(line));
+  if (error) {
+    ERROR("Listing \"%s\": %s", directory.c_str(), error.message().c_str());
   }
+  std::sort(ids.begin(), ids.end());
+  return ids;
+}
+}  // namespace
+
+std::vector<pid_t> ListThreads(pid_t pid) {
+  return ListNumericalDirectoryEntries(absl::StrFormat("/proc/%d/task", pid));
+}
 
-  return threads;
+std::vector<pid_t> ListProcesses() {
+  return ListNumericalDirectoryEntries("/proc");
 }
 
 std::string GetThreadName(pid_t tid) {
@@ -196,6 +209,20 @@ int GetTracepointId(const char* tracepoint_category,
   return tp_id;
 }
 
+int GetUprobesEventType() {
+  std::optional<std::string> file_content =
+      ReadFile("/sys/bus/event_source/devices/uprobe/type");
+  if (!file_content.has_value()) {
+    return -1;
+  }
+  int type = -1;
+  if (!absl::SimpleAtoi(file_content.value(), &type)) {
+    ERROR("Error parsing uprobes event type");
+    return -1;
+  }
+  return type;
+}
+
 uint64_t GetMaxOpenFilesHardLimit() {
   rlimit limit;
   int ret = getrlimit(RLIMIT_NOFILE, &limit);
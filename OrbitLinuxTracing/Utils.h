@@ -27,6 +27,8 @@ std::string ReadMaps(pid_t pid);
 
 std::vector<pid_t> ListThreads(pid_t pid);
 
+std::vector<pid_t> ListProcesses();
+
 std::string GetThreadName(pid_t tid);
 
 int GetNumCores();
@@ -44,6 +46,10 @@ std::vector<int> GetCpusetCpus(pid_t pid);
 int GetTracepointId(const char* tracepoint_category,
                     const char* tracepoint_name);
 
+// Looks up the perf_event_attr::type of uprobes, which the kernel assigns
+// dynamically. Returns the type or -1 in case of any errors.
+int GetUprobesEventType();
+
 uint64_t GetMaxOpenFilesHardLimit();
 
 bool SetMaxOpenFilesSoftLimit(uint64_t soft_limit);
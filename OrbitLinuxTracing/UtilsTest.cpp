@@ -62,6 +62,13 @@ TEST(ListThreads, OrbitLinuxTracingTestsMainAndAnother) {
   EXPECT_THAT(returned_tids, ::testing::ElementsAreArray(expected_tids));
 }
 
+TEST(ListProcesses, ContainsThisProcessAndInit) {
+  std::vector<pid_t> returned_pids = ListProcesses();
+  EXPECT_THAT(returned_pids, ::testing::Contains(getpid()));
+  EXPECT_THAT(returned_pids, ::testing::Contains(1));
+  EXPECT_TRUE(std::is_sorted(returned_pids.begin(), returned_pids.end()));
+}
+
 TEST(GetThreadName, OrbitLinuxTracingTests) {
   // Thread names have a length limit of 15 characters.
   std::string expected_name =
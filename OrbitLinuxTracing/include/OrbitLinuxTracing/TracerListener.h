@@ -18,6 +18,15 @@ class TracerListener {
   virtual void OnGpuJob(GpuJob gpu_job) = 0;
   virtual void OnThreadName(ThreadName thread_name) = 0;
   virtual void OnAddressInfo(AddressInfo address_info) = 0;
+  virtual void OnSystemCall(SystemCall system_call) = 0;
+  virtual void OnFutexWait(FutexWait futex_wait) = 0;
+  virtual void OnCounterSample(CounterSample counter_sample) = 0;
+  virtual void OnTracerStats(TracerStats tracer_stats) = 0;
+  virtual void OnLostEventsGap(LostEventsGap lost_events_gap) = 0;
+  virtual void OnFunctionInstrumentationDisabled(
+      FunctionInstrumentationDisabled function_instrumentation_disabled) = 0;
+  virtual void OnManualInstrumentationScope(
+      ManualInstrumentationScope manual_instrumentation_scope) = 0;
 };
 
 }  // namespace LinuxTracing
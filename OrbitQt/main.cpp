@@ -60,6 +60,99 @@ ABSL_FLAG(uint16_t, sampling_rate, 1000,
 ABSL_FLAG(bool, frame_pointer_unwinding, false,
           "Use frame pointers for unwinding");
 
+// TODO(b/160549506): Remove this flag once it can be specified in the ui.
+ABSL_FLAG(bool, trace_syscalls, false,
+          "Trace the duration of all syscalls of the target process");
+
+// TODO(b/160549506): Remove this flag once it can be specified in the ui.
+ABSL_FLAG(bool, trace_lock_contention, false,
+          "Trace the time threads of the target process spend waiting on "
+          "locks (futexes)");
+
+// TODO(b/160549506): Remove this flag once it can be specified in the ui.
+ABSL_FLAG(bool, sample_thread_counters, false,
+          "Sample IPC, cache miss rate and cpu migrations of each thread of "
+          "the target process");
+
+// TODO(b/160549506): Remove this flag once it can be specified in the ui.
+ABSL_FLAG(double, system_counters_sampling_rate, 0,
+          "Frequency, in Hz, at which memory usage and page faults of the "
+          "target process and run queue length and cpu frequencies of the "
+          "system are sampled (0 to disable)");
+
+// TODO(b/160549506): Remove these flags once they can be specified in the ui.
+ABSL_FLAG(uint32_t, flight_recorder_window_s, 0,
+          "Keep only the last seconds of the capture on the service and "
+          "receive them when the capture is stopped (0 for no time limit)");
+ABSL_FLAG(uint32_t, flight_recorder_max_mb, 0,
+          "Keep at most this many megabytes of the capture on the service and "
+          "receive them when the capture is stopped (0 for no size limit)");
+
+// TODO(b/160549506): Remove these flags once they can be specified in the ui.
+ABSL_FLAG(uint32_t, trigger_min_duration_ms, 0,
+          "Send the capture when a call to one of the selected functions "
+          "takes at least this long (0 to disable)");
+ABSL_FLAG(std::string, trigger_counter_name, "",
+          "Send the capture when the counter with this name (e.g. \"user cpu "
+          "time (%)\") reaches --trigger_counter_min_value");
+ABSL_FLAG(double, trigger_counter_min_value, 0,
+          "Threshold for --trigger_counter_name");
+ABSL_FLAG(uint32_t, trigger_post_ms, 0,
+          "How long after a trigger the capture is sent");
+
+// TODO(b/160549506): Remove these flags once they can be specified in the ui.
+ABSL_FLAG(std::vector<std::string>, additional_pids, {},
+          "Comma-separated list of other processes to trace together with "
+          "the selected one");
+ABSL_FLAG(bool, system_wide, false,
+          "Trace all processes, not only the selected one");
+
+// TODO(b/160549506): Remove this flag once it can be specified in the ui.
+ABSL_FLAG(uint32_t, sample_aggregation_ms, 0,
+          "Count callstack samples on the service over buckets of this many "
+          "ms and only send the counts (0 to send every sample)");
+
+// TODO(b/160549506): Remove this flag once it can be specified in the ui.
+ABSL_FLAG(uint64_t, max_function_calls_per_second, 100'000,
+          "Stop instrumenting a function when it is called more often than "
+          "this, to limit the overhead on the target (0 for no limit)");
+
+// TODO(b/160549506): Remove this flag once it can be specified in the ui.
+ABSL_FLAG(std::string, capture_compression, "",
+          "Compress the capture data sent by the service with \"gzip\" or "
+          "\"deflate\" (empty for no compression)");
+
+// TODO(b/160549506): Remove these flags once they can be specified in the ui.
+ABSL_FLAG(uint64_t, max_buffered_events, 1'000'000,
+          "Maximum number of events waiting on the service to be sent, to "
+          "bound its memory usage on slow links (0 for no limit)");
+ABSL_FLAG(std::string, buffer_full_policy, "drop_samples",
+          "What the service does when --max_buffered_events is reached: "
+          "\"block\" the tracer, \"drop_samples\" and scheduling slices, or "
+          "\"reduce_sampling\"");
+
+// TODO(b/160549506): Remove this flag once it can be specified in the ui.
+ABSL_FLAG(uint32_t, entry_callstack_stack_dump_size, 0,
+          "Bytes of stack copied at the entry of the functions hooked with "
+          "entry callstacks, from which the callstacks are unwound (0 for the "
+          "default of the service)");
+
+// TODO(b/160549506): Remove this flag once it can be specified in the ui.
+ABSL_FLAG(std::vector<std::string>, separate_streams, {},
+          "Comma-separated list of event categories to receive on their own "
+          "gRPC streams, so that they are processed on other cores: "
+          "\"callstack_samples\", \"function_calls\", \"scheduling_slices\"");
+
+// TODO(b/160549506): Remove this flag once it can be specified in the ui.
+ABSL_FLAG(uint32_t, capture_processing_threads, 4,
+          "Threads converting the capture data received, in addition to the "
+          "ones reading it (0 to convert it on the thread reading it)");
+
+// TODO(b/160549506): Remove this flag once it can be specified in the ui.
+ABSL_FLAG(bool, user_space_instrumentation, false,
+          "Instrument functions by patching them in the target instead of "
+          "with uprobes, which is faster (single-process captures only)");
+
 using ServiceDeployManager = OrbitQt::ServiceDeployManager;
 using DeploymentConfiguration = OrbitQt::DeploymentConfiguration;
 using OrbitStartupWindow = OrbitQt::OrbitStartupWindow;
@@ -146,6 +146,18 @@ OrbitMainWindow::OrbitMainWindow(QApplication* a_App,
   ui->LiveFunctionsList->Initialize(
       data_view_factory->GetOrCreateDataView(DataViewType::LIVE_FUNCTIONS),
       SelectionType::kExtended, FontType::kDefault);
+  ui->SyscallsList->Initialize(
+      data_view_factory->GetOrCreateDataView(DataViewType::SYSCALLS),
+      SelectionType::kDefault, FontType::kDefault);
+  ui->LockContentionList->Initialize(
+      data_view_factory->GetOrCreateDataView(DataViewType::LOCK_CONTENTION),
+      SelectionType::kDefault, FontType::kDefault);
+  ui->CallersList->Initialize(
+      data_view_factory->GetOrCreateDataView(DataViewType::CALLERS),
+      SelectionType::kDefault, FontType::kDefault);
+  ui->TracerHealthList->Initialize(
+      data_view_factory->GetOrCreateDataView(DataViewType::TRACER_HEALTH),
+      SelectionType::kDefault, FontType::kDefault);
   ui->CallStackView->Initialize(
       data_view_factory->GetOrCreateDataView(DataViewType::CALLSTACK),
       SelectionType::kExtended, FontType::kDefault);
@@ -340,6 +352,18 @@ void OrbitMainWindow::UpdatePanel(DataViewType a_Type) {
     case DataViewType::LIVE_FUNCTIONS:
       ui->LiveFunctionsList->Refresh();
       break;
+    case DataViewType::SYSCALLS:
+      ui->SyscallsList->Refresh();
+      break;
+    case DataViewType::LOCK_CONTENTION:
+      ui->LockContentionList->Refresh();
+      break;
+    case DataViewType::CALLERS:
+      ui->CallersList->Refresh();
+      break;
+    case DataViewType::TRACER_HEALTH:
+      ui->TracerHealthList->Refresh();
+      break;
     case DataViewType::TYPES:
       ui->TypesList->Refresh();
       break;
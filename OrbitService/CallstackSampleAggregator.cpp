@@ -0,0 +1,68 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "CallstackSampleAggregator.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "OrbitBase/Logging.h"
+
+CallstackSampleAggregator::CallstackSampleAggregator(
+    uint64_t bucket_duration_ns)
+    : bucket_duration_ns_{bucket_duration_ns} {
+  CHECK(bucket_duration_ns_ > 0);
+}
+
+void CallstackSampleAggregator::AddCallstackSample(
+    const CallstackSample& callstack_sample) {
+  CHECK(callstack_sample.callstack_or_key_case() ==
+        CallstackSample::kCallstackKey);
+  uint64_t timestamp_ns = callstack_sample.timestamp_ns();
+  uint64_t bucket_begin_timestamp_ns =
+      timestamp_ns - timestamp_ns % bucket_duration_ns_;
+  ++buckets_[bucket_begin_timestamp_ns][std::make_tuple(
+      callstack_sample.pid(), callstack_sample.tid(),
+      callstack_sample.callstack_key())];
+}
+
+std::vector<AggregatedCallstackSamples>
+CallstackSampleAggregator::TakeBucketsEndingBefore(uint64_t timestamp_ns) {
+  std::vector<AggregatedCallstackSamples> buckets;
+  while (!buckets_.empty()) {
+    auto bucket_it = buckets_.begin();
+    if (bucket_it->first + bucket_duration_ns_ > timestamp_ns) {
+      break;
+    }
+    buckets.push_back(BuildBucket(bucket_it->first, bucket_it->second));
+    buckets_.erase(bucket_it);
+  }
+  return buckets;
+}
+
+std::vector<AggregatedCallstackSamples>
+CallstackSampleAggregator::TakeAllBuckets() {
+  return TakeBucketsEndingBefore(std::numeric_limits<uint64_t>::max());
+}
+
+AggregatedCallstackSamples CallstackSampleAggregator::BuildBucket(
+    uint64_t begin_timestamp_ns,
+    const absl::flat_hash_map<std::tuple<int32_t, int32_t, uint64_t>,
+                              uint64_t>& counts) const {
+  std::vector<std::pair<std::tuple<int32_t, int32_t, uint64_t>, uint64_t>>
+      sorted_counts{counts.begin(), counts.end()};
+  std::sort(sorted_counts.begin(), sorted_counts.end());
+
+  AggregatedCallstackSamples bucket;
+  bucket.set_begin_timestamp_ns(begin_timestamp_ns);
+  bucket.set_end_timestamp_ns(begin_timestamp_ns + bucket_duration_ns_);
+  for (const auto& [pid_tid_and_key, count] : sorted_counts) {
+    AggregatedCallstackSamples::Count* bucket_count = bucket.add_counts();
+    bucket_count->set_pid(std::get<0>(pid_tid_and_key));
+    bucket_count->set_tid(std::get<1>(pid_tid_and_key));
+    bucket_count->set_callstack_key(std::get<2>(pid_tid_and_key));
+    bucket_count->set_count(count);
+  }
+  return bucket;
+}
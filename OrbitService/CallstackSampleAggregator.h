@@ -0,0 +1,45 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_SERVICE_CALLSTACK_SAMPLE_AGGREGATOR_H_
+#define ORBIT_SERVICE_CALLSTACK_SAMPLE_AGGREGATOR_H_
+
+#include <cstdint>
+#include <map>
+#include <tuple>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "capture.pb.h"
+
+// Counts CallstackSamples per thread and callstack over buckets of fixed
+// duration, so that only the counts need to be sent to the client. Not thread
+// safe.
+class CallstackSampleAggregator {
+ public:
+  explicit CallstackSampleAggregator(uint64_t bucket_duration_ns);
+
+  // The callstack of callstack_sample must already be replaced by its key.
+  void AddCallstackSample(const CallstackSample& callstack_sample);
+
+  // Returns the buckets that end at or before timestamp_ns, oldest first.
+  std::vector<AggregatedCallstackSamples> TakeBucketsEndingBefore(
+      uint64_t timestamp_ns);
+  std::vector<AggregatedCallstackSamples> TakeAllBuckets();
+
+ private:
+  AggregatedCallstackSamples BuildBucket(
+      uint64_t begin_timestamp_ns,
+      const absl::flat_hash_map<std::tuple<int32_t, int32_t, uint64_t>,
+                                uint64_t>& counts) const;
+
+  uint64_t bucket_duration_ns_;
+  // For each bucket begin, the count of each (pid, tid, callstack key).
+  std::map<uint64_t,
+           absl::flat_hash_map<std::tuple<int32_t, int32_t, uint64_t>,
+                               uint64_t>>
+      buckets_;
+};
+
+#endif  // ORBIT_SERVICE_CALLSTACK_SAMPLE_AGGREGATOR_H_
@@ -0,0 +1,67 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+
+#include "CallstackSampleAggregator.h"
+
+namespace {
+
+CallstackSample MakeCallstackSample(int32_t tid, uint64_t callstack_key,
+                                    uint64_t timestamp_ns) {
+  CallstackSample callstack_sample;
+  callstack_sample.set_pid(1);
+  callstack_sample.set_tid(tid);
+  callstack_sample.set_callstack_key(callstack_key);
+  callstack_sample.set_timestamp_ns(timestamp_ns);
+  return callstack_sample;
+}
+
+}  // namespace
+
+TEST(CallstackSampleAggregator, CountsPerThreadAndCallstack) {
+  CallstackSampleAggregator aggregator{100};
+  aggregator.AddCallstackSample(MakeCallstackSample(2, 10, 5));
+  aggregator.AddCallstackSample(MakeCallstackSample(2, 10, 50));
+  aggregator.AddCallstackSample(MakeCallstackSample(2, 11, 60));
+  aggregator.AddCallstackSample(MakeCallstackSample(3, 10, 99));
+
+  std::vector<AggregatedCallstackSamples> buckets =
+      aggregator.TakeAllBuckets();
+  ASSERT_EQ(buckets.size(), 1);
+  EXPECT_EQ(buckets[0].begin_timestamp_ns(), 0);
+  EXPECT_EQ(buckets[0].end_timestamp_ns(), 100);
+  ASSERT_EQ(buckets[0].counts_size(), 3);
+  EXPECT_EQ(buckets[0].counts(0).pid(), 1);
+  EXPECT_EQ(buckets[0].counts(0).tid(), 2);
+  EXPECT_EQ(buckets[0].counts(0).callstack_key(), 10);
+  EXPECT_EQ(buckets[0].counts(0).count(), 2);
+  EXPECT_EQ(buckets[0].counts(1).tid(), 2);
+  EXPECT_EQ(buckets[0].counts(1).callstack_key(), 11);
+  EXPECT_EQ(buckets[0].counts(1).count(), 1);
+  EXPECT_EQ(buckets[0].counts(2).tid(), 3);
+  EXPECT_EQ(buckets[0].counts(2).count(), 1);
+
+  EXPECT_TRUE(aggregator.TakeAllBuckets().empty());
+}
+
+TEST(CallstackSampleAggregator, TakeBucketsEndingBefore) {
+  CallstackSampleAggregator aggregator{100};
+  aggregator.AddCallstackSample(MakeCallstackSample(2, 10, 250));
+  aggregator.AddCallstackSample(MakeCallstackSample(2, 10, 10));
+  aggregator.AddCallstackSample(MakeCallstackSample(2, 10, 150));
+
+  EXPECT_TRUE(aggregator.TakeBucketsEndingBefore(99).empty());
+
+  std::vector<AggregatedCallstackSamples> buckets =
+      aggregator.TakeBucketsEndingBefore(220);
+  ASSERT_EQ(buckets.size(), 2);
+  EXPECT_EQ(buckets[0].begin_timestamp_ns(), 0);
+  EXPECT_EQ(buckets[1].begin_timestamp_ns(), 100);
+
+  buckets = aggregator.TakeAllBuckets();
+  ASSERT_EQ(buckets.size(), 1);
+  EXPECT_EQ(buckets[0].begin_timestamp_ns(), 200);
+  EXPECT_EQ(buckets[0].end_timestamp_ns(), 300);
+}
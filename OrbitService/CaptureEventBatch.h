@@ -0,0 +1,65 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_SERVICE_CAPTURE_EVENT_BATCH_H_
+#define ORBIT_SERVICE_CAPTURE_EVENT_BATCH_H_
+
+#include <google/protobuf/arena.h>
+
+#include <memory>
+
+#include "services.pb.h"
+
+// A CaptureResponse allocated on its own arena, in which events are
+// constructed in place and which can be written to the gRPC stream as is. This
+// avoids allocating every event on the heap and moving it into a response.
+// After Clear, the memory of the first block of the arena is reused.
+class CaptureEventBatch {
+ public:
+  CaptureEventBatch()
+      : initial_block_{new char[kInitialBlockSize]},
+        arena_{CreateArenaOptions(initial_block_.get())},
+        response_{CreateResponse(&arena_)} {}
+
+  CaptureEventBatch(const CaptureEventBatch&) = delete;
+  CaptureEventBatch& operator=(const CaptureEventBatch&) = delete;
+  CaptureEventBatch(CaptureEventBatch&&) = delete;
+  CaptureEventBatch& operator=(CaptureEventBatch&&) = delete;
+
+  [[nodiscard]] CaptureEvent* AddEvent() {
+    return response_->add_capture_events();
+  }
+  [[nodiscard]] int GetEventCount() const {
+    return response_->capture_events_size();
+  }
+  [[nodiscard]] CaptureResponse* GetResponse() { return response_; }
+
+  void Clear() {
+    arena_.Reset();
+    response_ = CreateResponse(&arena_);
+  }
+
+ private:
+  static constexpr size_t kInitialBlockSize = 256 * 1024;
+
+  static google::protobuf::ArenaOptions CreateArenaOptions(
+      char* initial_block) {
+    google::protobuf::ArenaOptions options;
+    options.initial_block = initial_block;
+    options.initial_block_size = kInitialBlockSize;
+    options.start_block_size = kInitialBlockSize;
+    options.max_block_size = 4 * kInitialBlockSize;
+    return options;
+  }
+
+  static CaptureResponse* CreateResponse(google::protobuf::Arena* arena) {
+    return google::protobuf::Arena::CreateMessage<CaptureResponse>(arena);
+  }
+
+  std::unique_ptr<char[]> initial_block_;
+  google::protobuf::Arena arena_;
+  CaptureResponse* response_;
+};
+
+#endif  // ORBIT_SERVICE_CAPTURE_EVENT_BATCH_H_
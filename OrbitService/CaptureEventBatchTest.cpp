@@ -0,0 +1,120 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "CaptureEventBatch.h"
+
+namespace {
+
+FunctionCall CreateFunctionCall(uint64_t i) {
+  FunctionCall function_call;
+  function_call.set_pid(42);
+  function_call.set_tid(43 + i % 4);
+  function_call.set_absolute_address(0x7F0000001000 + 0x100 * (i % 8));
+  function_call.set_begin_timestamp_ns(1'600'000'000'000'000'000 + 1000 * i);
+  function_call.set_end_timestamp_ns(1'600'000'000'000'000'000 + 1000 * i +
+                                     500);
+  return function_call;
+}
+
+CallstackSample CreateCallstackSample(uint64_t i) {
+  CallstackSample callstack_sample;
+  callstack_sample.set_pid(42);
+  callstack_sample.set_tid(43);
+  callstack_sample.set_timestamp_ns(1'600'000'000'000'000'000 + 1000 * i);
+  callstack_sample.set_callstack_key(i);
+  return callstack_sample;
+}
+
+}  // namespace
+
+TEST(CaptureEventBatch, AddsEventsToResponse) {
+  CaptureEventBatch batch;
+  EXPECT_EQ(batch.GetEventCount(), 0);
+  *batch.AddEvent()->mutable_function_call() = CreateFunctionCall(1);
+  *batch.AddEvent()->mutable_callstack_sample() = CreateCallstackSample(2);
+  EXPECT_EQ(batch.GetEventCount(), 2);
+
+  const CaptureResponse& response = *batch.GetResponse();
+  ASSERT_EQ(response.capture_events_size(), 2);
+  EXPECT_EQ(response.capture_events(0).function_call().tid(), 44);
+  EXPECT_EQ(response.capture_events(1).callstack_sample().callstack_key(), 2);
+}
+
+TEST(CaptureEventBatch, ClearAllowsReuse) {
+  CaptureEventBatch batch;
+  for (uint64_t i = 0; i < 10'000; ++i) {
+    *batch.AddEvent()->mutable_function_call() = CreateFunctionCall(i);
+  }
+  batch.Clear();
+  EXPECT_EQ(batch.GetEventCount(), 0);
+
+  *batch.AddEvent()->mutable_function_call() = CreateFunctionCall(3);
+  EXPECT_EQ(batch.GetEventCount(), 1);
+  EXPECT_EQ(batch.GetResponse()->capture_events(0).function_call().tid(), 46);
+}
+
+// Compares building and serializing CaptureResponses from heap-allocated
+// CaptureEvents, as SendBufferedEvents does, with constructing the events in a
+// CaptureEventBatch. Run with --gtest_also_run_disabled_tests.
+TEST(CaptureEventBatch, DISABLED_SerializationBenchmark) {
+  constexpr uint64_t kEventsPerResponse = 1000;
+  constexpr uint64_t kResponseCount = 1000;
+  uint64_t serialized_size = 0;
+
+  auto heap_begin = std::chrono::steady_clock::now();
+  for (uint64_t response_index = 0; response_index < kResponseCount;
+       ++response_index) {
+    std::vector<CaptureEvent> events;
+    for (uint64_t i = 0; i < kEventsPerResponse; ++i) {
+      CaptureEvent event;
+      if (i % 2 == 0) {
+        *event.mutable_function_call() = CreateFunctionCall(i);
+      } else {
+        *event.mutable_callstack_sample() = CreateCallstackSample(i);
+      }
+      events.emplace_back(std::move(event));
+    }
+    CaptureResponse response;
+    for (CaptureEvent& event : events) {
+      response.mutable_capture_events()->Add(std::move(event));
+    }
+    serialized_size += response.SerializeAsString().size();
+  }
+  auto heap_end = std::chrono::steady_clock::now();
+
+  CaptureEventBatch batch;
+  auto arena_begin = std::chrono::steady_clock::now();
+  for (uint64_t response_index = 0; response_index < kResponseCount;
+       ++response_index) {
+    for (uint64_t i = 0; i < kEventsPerResponse; ++i) {
+      if (i % 2 == 0) {
+        *batch.AddEvent()->mutable_function_call() = CreateFunctionCall(i);
+      } else {
+        *batch.AddEvent()->mutable_callstack_sample() =
+            CreateCallstackSample(i);
+      }
+    }
+    serialized_size -= batch.GetResponse()->SerializeAsString().size();
+    batch.Clear();
+  }
+  auto arena_end = std::chrono::steady_clock::now();
+
+  EXPECT_EQ(serialized_size, 0);
+  std::cout << "Heap-allocated events: "
+            << std::chrono::duration<double, std::milli>(heap_end - heap_begin)
+                   .count()
+            << " ms, CaptureEventBatch: "
+            << std::chrono::duration<double, std::milli>(arena_end -
+                                                         arena_begin)
+                   .count()
+            << " ms for " << kResponseCount * kEventsPerResponse << " events"
+            << std::endl;
+}
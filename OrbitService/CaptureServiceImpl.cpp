@@ -8,8 +8,22 @@
 
 #include "LinuxTracingGrpcHandler.h"
 
+namespace {
+grpc_compression_algorithm GetGrpcCompressionAlgorithm(
+    CaptureOptions::CompressionAlgorithm compression_algorithm) {
+  switch (compression_algorithm) {
+    case CaptureOptions::kGzip:
+      return GRPC_COMPRESS_GZIP;
+    case CaptureOptions::kDeflate:
+      return GRPC_COMPRESS_DEFLATE;
+    default:
+      return GRPC_COMPRESS_NONE;
+  }
+}
+}  // namespace
+
 grpc::Status CaptureServiceImpl::Capture(
-    grpc::ServerContext*,
+    grpc::ServerContext* context,
     grpc::ServerReaderWriter<CaptureResponse, CaptureRequest>* reader_writer) {
   pthread_setname_np(pthread_self(), "CSImpl::Capture");
   LinuxTracingGrpcHandler tracing_handler{reader_writer};
@@ -17,16 +31,84 @@ grpc::Status CaptureServiceImpl::Capture(
   CaptureRequest request;
   reader_writer->Read(&request);
   LOG("Read CaptureRequest from Capture's gRPC stream: starting capture");
+  // This applies to all the CaptureResponses, as none has been written yet.
+  context->set_compression_algorithm(GetGrpcCompressionAlgorithm(
+      request.capture_options().compression_algorithm()));
+
+  // The queues are registered before the client learns the capture id, so
+  // that its CaptureEventStream calls find them.
+  uint64_t capture_id = next_capture_id_++;
+  std::vector<std::shared_ptr<EventStreamQueue>> event_stream_queues =
+      tracing_handler.CreateEventStreamQueues(request.capture_options());
+  if (!event_stream_queues.empty()) {
+    {
+      absl::MutexLock lock{&event_stream_queues_mutex_};
+      for (const std::shared_ptr<EventStreamQueue>& queue :
+           event_stream_queues) {
+        event_stream_queues_.emplace(
+            std::make_pair(capture_id, queue->GetCategory()), queue);
+      }
+    }
+    CaptureResponse response;
+    response.set_capture_id(capture_id);
+    reader_writer->Write(response);
+  }
   tracing_handler.Start(std::move(*request.mutable_capture_options()));
 
   // The client asks for the capture to be stopped by calling WritesDone.
   // At that point, this call to Read will return false.
-  // In the meantime, it blocks if no message is received.
+  // In the meantime, it blocks if no message is received. The only other
+  // request is the one asking for a snapshot of a flight-recorder capture.
   while (reader_writer->Read(&request)) {
+    if (request.snapshot()) {
+      tracing_handler.RequestSnapshot();
+    }
   }
   LOG("Client finished writing on Capture's gRPC stream: stopping capture");
   tracing_handler.Stop();
 
+  // The queues are closed: ongoing CaptureEventStream calls finish on their
+  // own, later ones for this capture fail.
+  {
+    absl::MutexLock lock{&event_stream_queues_mutex_};
+    for (const std::shared_ptr<EventStreamQueue>& queue :
+         event_stream_queues) {
+      event_stream_queues_.erase(
+          std::make_pair(capture_id, queue->GetCategory()));
+    }
+  }
+
   LOG("Finished handling gRPC call to Capture: all capture data has been sent");
   return grpc::Status::OK;
 }
+
+grpc::Status CaptureServiceImpl::CaptureEventStream(
+    grpc::ServerContext*, const CaptureEventStreamRequest* request,
+    grpc::ServerWriter<CaptureResponse>* writer) {
+  pthread_setname_np(pthread_self(), "CSImpl::Stream");
+  std::shared_ptr<EventStreamQueue> queue;
+  {
+    absl::MutexLock lock{&event_stream_queues_mutex_};
+    auto queue_it = event_stream_queues_.find(
+        std::make_pair(request->capture_id(), request->category()));
+    if (queue_it == event_stream_queues_.end()) {
+      ERROR("No event stream for %s in capture %lu",
+            CaptureOptions::StreamCategory_Name(request->category()),
+            request->capture_id());
+      return grpc::Status(grpc::StatusCode::NOT_FOUND,
+                          "No such event stream in an ongoing capture");
+    }
+    queue = queue_it->second;
+  }
+
+  LOG("Writing event stream for %s of capture %lu",
+      CaptureOptions::StreamCategory_Name(request->category()),
+      request->capture_id());
+  if (!queue->WriteUntilClosed([writer](const CaptureResponse& response) {
+        return writer->Write(response);
+      })) {
+    return grpc::Status(grpc::StatusCode::UNAVAILABLE,
+                        "Writing on the event stream failed");
+  }
+  return grpc::Status::OK;
+}
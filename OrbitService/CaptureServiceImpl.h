@@ -5,6 +5,13 @@
 #ifndef ORBIT_SERVICE_CAPTURE_SERVICE_IMPL_H_
 #define ORBIT_SERVICE_CAPTURE_SERVICE_IMPL_H_
 
+#include <atomic>
+#include <memory>
+#include <utility>
+
+#include "EventStreamQueue.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
 #include "services.grpc.pb.h"
 
 class CaptureServiceImpl final : public CaptureService::Service {
@@ -12,6 +19,19 @@ class CaptureServiceImpl final : public CaptureService::Service {
   grpc::Status Capture(grpc::ServerContext* context,
                        grpc::ServerReaderWriter<CaptureResponse, CaptureRequest>*
                            reader_writer) override;
+
+  grpc::Status CaptureEventStream(
+      grpc::ServerContext* context, const CaptureEventStreamRequest* request,
+      grpc::ServerWriter<CaptureResponse>* writer) override;
+
+ private:
+  std::atomic<uint64_t> next_capture_id_ = 1;
+  // The EventStreamQueues of the ongoing captures, by capture id and
+  // CaptureOptions::StreamCategory.
+  absl::flat_hash_map<std::pair<uint64_t, int>,
+                      std::shared_ptr<EventStreamQueue>>
+      event_stream_queues_;
+  absl::Mutex event_stream_queues_mutex_;
 };
 
 #endif  // ORBIT_SERVICE_CAPTURE_SERVICE_IMPL_H_
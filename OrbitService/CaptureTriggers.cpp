@@ -0,0 +1,62 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "CaptureTriggers.h"
+
+#include <OrbitBase/Logging.h>
+
+#include <algorithm>
+
+CaptureTriggers::CaptureTriggers(
+    const google::protobuf::RepeatedPtrField<CaptureOptions::Trigger>&
+        triggers) {
+  for (const CaptureOptions::Trigger& trigger : triggers) {
+    switch (trigger.condition_case()) {
+      case CaptureOptions::Trigger::kFunctionDuration: {
+        const CaptureOptions::Trigger::FunctionDuration& function_duration =
+            trigger.function_duration();
+        auto [it, inserted] = min_duration_ns_by_address_.try_emplace(
+            function_duration.absolute_address(),
+            function_duration.min_duration_ns());
+        if (!inserted) {
+          it->second =
+              std::min(it->second, function_duration.min_duration_ns());
+        }
+        break;
+      }
+      case CaptureOptions::Trigger::kCounterThreshold: {
+        const CaptureOptions::Trigger::CounterThreshold& counter_threshold =
+            trigger.counter_threshold();
+        auto [it, inserted] = min_value_by_counter_name_.try_emplace(
+            counter_threshold.name(), counter_threshold.min_value());
+        if (!inserted) {
+          it->second = std::min(it->second, counter_threshold.min_value());
+        }
+        break;
+      }
+      case CaptureOptions::Trigger::CONDITION_NOT_SET:
+        ERROR("Ignoring capture trigger without condition");
+        break;
+    }
+  }
+}
+
+bool CaptureTriggers::IsTriggeredBy(const FunctionCall& function_call) const {
+  auto it = min_duration_ns_by_address_.find(function_call.absolute_address());
+  if (it == min_duration_ns_by_address_.end()) {
+    return false;
+  }
+  return function_call.end_timestamp_ns() -
+             function_call.begin_timestamp_ns() >=
+         it->second;
+}
+
+bool CaptureTriggers::IsTriggeredBy(const CounterSample& counter_sample) const {
+  CHECK(counter_sample.name_or_key_case() == CounterSample::kName);
+  auto it = min_value_by_counter_name_.find(counter_sample.name());
+  if (it == min_value_by_counter_name_.end()) {
+    return false;
+  }
+  return counter_sample.value() >= it->second;
+}
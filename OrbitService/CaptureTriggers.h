@@ -0,0 +1,34 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_SERVICE_CAPTURE_TRIGGERS_H_
+#define ORBIT_SERVICE_CAPTURE_TRIGGERS_H_
+
+#include <cstdint>
+#include <string>
+
+#include "absl/container/flat_hash_map.h"
+#include "capture.pb.h"
+
+// Checks the events produced by the tracer against the
+// CaptureOptions::Triggers of a capture. The conditions are fixed at
+// construction, so the checks can be called concurrently from any thread.
+class CaptureTriggers {
+ public:
+  explicit CaptureTriggers(
+      const google::protobuf::RepeatedPtrField<CaptureOptions::Trigger>&
+          triggers);
+
+  bool IsTriggeredBy(const FunctionCall& function_call) const;
+  // Must be called before the name of counter_sample is replaced by a key.
+  bool IsTriggeredBy(const CounterSample& counter_sample) const;
+
+ private:
+  // When several triggers have the same function or counter, the lowest
+  // threshold is the only one that matters.
+  absl::flat_hash_map<uint64_t, uint64_t> min_duration_ns_by_address_;
+  absl::flat_hash_map<std::string, double> min_value_by_counter_name_;
+};
+
+#endif  // ORBIT_SERVICE_CAPTURE_TRIGGERS_H_
@@ -0,0 +1,79 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+
+#include "CaptureTriggers.h"
+
+namespace {
+FunctionCall CreateFunctionCall(uint64_t absolute_address,
+                                uint64_t duration_ns) {
+  FunctionCall function_call;
+  function_call.set_absolute_address(absolute_address);
+  function_call.set_begin_timestamp_ns(1000);
+  function_call.set_end_timestamp_ns(1000 + duration_ns);
+  return function_call;
+}
+
+CounterSample CreateCounterSample(const std::string& name, double value) {
+  CounterSample counter_sample;
+  counter_sample.set_name(name);
+  counter_sample.set_value(value);
+  return counter_sample;
+}
+}  // namespace
+
+TEST(CaptureTriggers, FunctionDuration) {
+  CaptureOptions capture_options;
+  CaptureOptions::Trigger::FunctionDuration* function_duration =
+      capture_options.add_triggers()->mutable_function_duration();
+  function_duration->set_absolute_address(0x1000);
+  function_duration->set_min_duration_ns(500);
+  CaptureTriggers triggers{capture_options.triggers()};
+
+  EXPECT_FALSE(triggers.IsTriggeredBy(CreateFunctionCall(0x1000, 499)));
+  EXPECT_TRUE(triggers.IsTriggeredBy(CreateFunctionCall(0x1000, 500)));
+  EXPECT_FALSE(triggers.IsTriggeredBy(CreateFunctionCall(0x2000, 1000)));
+}
+
+TEST(CaptureTriggers, AnyCallWithZeroDuration) {
+  CaptureOptions capture_options;
+  capture_options.add_triggers()
+      ->mutable_function_duration()
+      ->set_absolute_address(0x1000);
+  CaptureTriggers triggers{capture_options.triggers()};
+
+  EXPECT_TRUE(triggers.IsTriggeredBy(CreateFunctionCall(0x1000, 0)));
+}
+
+TEST(CaptureTriggers, LowestThresholdWins) {
+  CaptureOptions capture_options;
+  for (uint64_t min_duration_ns : {300, 100, 200}) {
+    CaptureOptions::Trigger::FunctionDuration* function_duration =
+        capture_options.add_triggers()->mutable_function_duration();
+    function_duration->set_absolute_address(0x1000);
+    function_duration->set_min_duration_ns(min_duration_ns);
+  }
+  CaptureTriggers triggers{capture_options.triggers()};
+
+  EXPECT_FALSE(triggers.IsTriggeredBy(CreateFunctionCall(0x1000, 99)));
+  EXPECT_TRUE(triggers.IsTriggeredBy(CreateFunctionCall(0x1000, 100)));
+}
+
+TEST(CaptureTriggers, CounterThreshold) {
+  CaptureOptions capture_options;
+  CaptureOptions::Trigger::CounterThreshold* counter_threshold =
+      capture_options.add_triggers()->mutable_counter_threshold();
+  counter_threshold->set_name("user cpu time (%)");
+  counter_threshold->set_min_value(80);
+  CaptureTriggers triggers{capture_options.triggers()};
+
+  EXPECT_FALSE(
+      triggers.IsTriggeredBy(CreateCounterSample("user cpu time (%)", 79.9)));
+  EXPECT_TRUE(
+      triggers.IsTriggeredBy(CreateCounterSample("user cpu time (%)", 80)));
+  EXPECT_FALSE(
+      triggers.IsTriggeredBy(CreateCounterSample("system cpu time (%)", 90)));
+  EXPECT_FALSE(triggers.IsTriggeredBy(CreateFunctionCall(0x1000, 1000)));
+}
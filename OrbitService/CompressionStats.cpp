@@ -0,0 +1,60 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "CompressionStats.h"
+
+#include <OrbitBase/Logging.h>
+#include <zlib.h>
+
+#include <vector>
+
+#include "Profiling.h"
+#include "absl/strings/str_format.h"
+
+void CompressionStats::AddResponse(const CaptureResponse& response) {
+  uint64_t size = response.ByteSizeLong();
+  total_bytes_ += size;
+  if (response_count_++ % sample_interval_ != 0) {
+    return;
+  }
+
+  uint64_t start_cpu_ns = OrbitTicks(CLOCK_THREAD_CPUTIME_ID);
+  std::string serialized = response.SerializeAsString();
+  uLongf compressed_size = compressBound(serialized.size());
+  std::vector<Bytef> compressed(compressed_size);
+  int result = compress2(compressed.data(), &compressed_size,
+                         reinterpret_cast<const Bytef*>(serialized.data()),
+                         serialized.size(), Z_DEFAULT_COMPRESSION);
+  uint64_t end_cpu_ns = OrbitTicks(CLOCK_THREAD_CPUTIME_ID);
+  if (result != Z_OK) {
+    ERROR("Compressing CaptureResponse: zlib error %d", result);
+    return;
+  }
+  sampled_bytes_ += size;
+  sampled_compressed_bytes_ += compressed_size;
+  sampled_cpu_ns_ += end_cpu_ns - start_cpu_ns;
+}
+
+double CompressionStats::GetCompressionRatio() const {
+  if (sampled_compressed_bytes_ == 0) {
+    return 0.0;
+  }
+  return static_cast<double>(sampled_bytes_) / sampled_compressed_bytes_;
+}
+
+double CompressionStats::GetCpuMsPerMib() const {
+  if (sampled_bytes_ == 0) {
+    return 0.0;
+  }
+  return sampled_cpu_ns_ / 1'000'000.0 /
+         (static_cast<double>(sampled_bytes_) / (1024 * 1024));
+}
+
+std::string CompressionStats::ToString() const {
+  return absl::StrFormat(
+      "%.1f MiB before compression, compression ratio %.2f, %.1f ms of CPU "
+      "per MiB (sampled 1 response in %lu)",
+      static_cast<double>(total_bytes_) / (1024 * 1024), GetCompressionRatio(),
+      GetCpuMsPerMib(), sample_interval_);
+}
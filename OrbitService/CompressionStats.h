@@ -0,0 +1,41 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_SERVICE_COMPRESSION_STATS_H_
+#define ORBIT_SERVICE_COMPRESSION_STATS_H_
+
+#include <cstdint>
+#include <string>
+
+#include "services.pb.h"
+
+// Estimates how well the CaptureResponses of a capture compress and how much
+// CPU time compressing them costs, to help choose
+// CaptureOptions::compression_algorithm for a given link. gRPC compresses
+// messages internally with zlib and does not report either, so one response
+// out of sample_interval is compressed again with zlib here. Not thread safe.
+class CompressionStats {
+ public:
+  explicit CompressionStats(uint64_t sample_interval)
+      : sample_interval_{sample_interval} {}
+
+  void AddResponse(const CaptureResponse& response);
+
+  [[nodiscard]] uint64_t GetTotalBytes() const { return total_bytes_; }
+  // Uncompressed size divided by compressed size, over the sampled responses.
+  [[nodiscard]] double GetCompressionRatio() const;
+  // CPU time spent compressing one MiB, over the sampled responses.
+  [[nodiscard]] double GetCpuMsPerMib() const;
+  [[nodiscard]] std::string ToString() const;
+
+ private:
+  uint64_t sample_interval_;
+  uint64_t response_count_ = 0;
+  uint64_t total_bytes_ = 0;
+  uint64_t sampled_bytes_ = 0;
+  uint64_t sampled_compressed_bytes_ = 0;
+  uint64_t sampled_cpu_ns_ = 0;
+};
+
+#endif  // ORBIT_SERVICE_COMPRESSION_STATS_H_
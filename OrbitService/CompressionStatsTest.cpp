@@ -0,0 +1,59 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+
+#include "CompressionStats.h"
+
+namespace {
+
+CaptureResponse CreateResponse(uint64_t event_count) {
+  CaptureResponse response;
+  for (uint64_t i = 0; i < event_count; ++i) {
+    SchedulingSlice* scheduling_slice =
+        response.add_capture_events()->mutable_scheduling_slice();
+    scheduling_slice->set_pid(42);
+    scheduling_slice->set_tid(43);
+    scheduling_slice->set_core(i % 4);
+    scheduling_slice->set_in_timestamp_ns(1'000'000 + 100 * i);
+    scheduling_slice->set_out_timestamp_ns(1'000'000 + 100 * i + 50);
+  }
+  return response;
+}
+
+}  // namespace
+
+TEST(CompressionStats, NoResponses) {
+  CompressionStats stats{1};
+  EXPECT_EQ(stats.GetTotalBytes(), 0);
+  EXPECT_EQ(stats.GetCompressionRatio(), 0.0);
+  EXPECT_EQ(stats.GetCpuMsPerMib(), 0.0);
+}
+
+TEST(CompressionStats, RepetitiveResponsesCompress) {
+  CompressionStats stats{1};
+  CaptureResponse response = CreateResponse(1000);
+  stats.AddResponse(response);
+  stats.AddResponse(response);
+  EXPECT_EQ(stats.GetTotalBytes(), 2 * response.ByteSizeLong());
+  EXPECT_GT(stats.GetCompressionRatio(), 2.0);
+  EXPECT_GE(stats.GetCpuMsPerMib(), 0.0);
+}
+
+TEST(CompressionStats, CountsAllResponsesButSamplesSome) {
+  CompressionStats stats{3};
+  CaptureResponse small_response = CreateResponse(10);
+  CaptureResponse large_response = CreateResponse(1000);
+  // Only the first response is sampled.
+  stats.AddResponse(small_response);
+  stats.AddResponse(large_response);
+  stats.AddResponse(large_response);
+  EXPECT_EQ(stats.GetTotalBytes(), small_response.ByteSizeLong() +
+                                       2 * large_response.ByteSizeLong());
+  double small_ratio = stats.GetCompressionRatio();
+
+  CompressionStats small_stats{1};
+  small_stats.AddResponse(small_response);
+  EXPECT_DOUBLE_EQ(small_ratio, small_stats.GetCompressionRatio());
+}
@@ -0,0 +1,120 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "EventStreamQueue.h"
+
+#include <OrbitBase/Logging.h>
+
+#include <algorithm>
+#include <iterator>
+
+#include "CompressionStats.h"
+#include "FunctionCallBatch.h"
+
+void EventStreamQueue::Push(std::unique_ptr<CaptureEventBatch> batch) {
+  absl::MutexLock lock{&mutex_};
+  if (batch->GetEventCount() == 0 && !queued_batches_.empty()) {
+    queued_batches_.back()->GetResponse()->set_send_timestamp_ns(
+        batch->GetResponse()->send_timestamp_ns());
+    written_batches_.emplace_back(std::move(batch));
+    return;
+  }
+  mutex_.Await(absl::Condition(
+      +[](EventStreamQueue* self) {
+        return self->queued_batches_.size() < kMaxQueuedBatches ||
+               self->write_failed_ || self->closed_ ||
+               (!self->writing_ && !self->waiting_for_writer_);
+      },
+      this));
+  if (write_failed_ || closed_ ||
+      queued_batches_.size() >= kMaxQueuedBatches) {
+    discarded_event_count_ += batch->GetEventCount();
+    written_batches_.emplace_back(std::move(batch));
+    return;
+  }
+  queued_batches_.emplace_back(std::move(batch));
+}
+
+void EventStreamQueue::StopWaitingForWriter() {
+  absl::MutexLock lock{&mutex_};
+  waiting_for_writer_ = false;
+}
+
+void EventStreamQueue::Close() {
+  absl::MutexLock lock{&mutex_};
+  closed_ = true;
+  if (discarded_event_count_ > 0) {
+    ERROR("Discarded %lu events of the event stream for %s",
+          discarded_event_count_,
+          CaptureOptions::StreamCategory_Name(category_));
+  }
+}
+
+bool EventStreamQueue::WriteUntilClosed(
+    const std::function<bool(const CaptureResponse&)>& write) {
+  {
+    absl::MutexLock lock{&mutex_};
+    if (writing_) {
+      ERROR("Event stream for %s is already being written",
+            CaptureOptions::StreamCategory_Name(category_));
+      return false;
+    }
+    writing_ = true;
+  }
+
+  constexpr uint64_t kCompressionStatsSampleInterval = 64;
+  CompressionStats compression_stats{kCompressionStatsSampleInterval};
+  bool write_succeeded = true;
+  while (true) {
+    std::unique_ptr<CaptureEventBatch> batch;
+    {
+      absl::MutexLock lock{&mutex_};
+      mutex_.Await(absl::Condition(
+          +[](EventStreamQueue* self) {
+            return !self->queued_batches_.empty() || self->closed_;
+          },
+          this));
+      if (queued_batches_.empty()) {
+        break;
+      }
+      batch = std::move(queued_batches_.front());
+      queued_batches_.pop_front();
+    }
+
+    CaptureResponse* response = batch->GetResponse();
+    if (batch_function_calls_) {
+      PackFunctionCalls(response->mutable_capture_events());
+    }
+    compression_stats.AddResponse(*response);
+    write_succeeded = write(*response);
+
+    absl::MutexLock lock{&mutex_};
+    written_batches_.emplace_back(std::move(batch));
+    if (!write_succeeded) {
+      ERROR("Writing on event stream for %s",
+            CaptureOptions::StreamCategory_Name(category_));
+      write_failed_ = true;
+      std::move(queued_batches_.begin(), queued_batches_.end(),
+                std::back_inserter(written_batches_));
+      queued_batches_.clear();
+      break;
+    }
+  }
+
+  absl::MutexLock lock{&mutex_};
+  writing_ = false;
+  LOG("Event stream for %s sent: %s",
+      CaptureOptions::StreamCategory_Name(category_),
+      compression_stats.ToString());
+  return write_succeeded;
+}
+
+std::vector<std::unique_ptr<CaptureEventBatch>>
+EventStreamQueue::TakeWrittenBatches() {
+  absl::MutexLock lock{&mutex_};
+  std::vector<std::unique_ptr<CaptureEventBatch>> written_batches =
+      std::move(written_batches_);
+  written_batches_.clear();
+  return written_batches;
+}
@@ -0,0 +1,73 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_SERVICE_EVENT_STREAM_QUEUE_H_
+#define ORBIT_SERVICE_EVENT_STREAM_QUEUE_H_
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "CaptureEventBatch.h"
+#include "absl/synchronization/mutex.h"
+#include "services.pb.h"
+
+// The batches of events of one of CaptureOptions::separate_stream_categories.
+// The SenderThread of LinuxTracingGrpcHandler pushes them, and the
+// CaptureEventStream call of that category writes them on its own thread, so
+// that serializing them doesn't happen on the SenderThread. Thread safe.
+class EventStreamQueue {
+ public:
+  EventStreamQueue(CaptureOptions::StreamCategory category,
+                   bool batch_function_calls)
+      : category_{category}, batch_function_calls_{batch_function_calls} {}
+
+  EventStreamQueue(const EventStreamQueue&) = delete;
+  EventStreamQueue& operator=(const EventStreamQueue&) = delete;
+
+  [[nodiscard]] CaptureOptions::StreamCategory GetCategory() const {
+    return category_;
+  }
+
+  // Waits while the queue is full, so that a slow link, or a stream that
+  // hasn't been attached yet, holds the SenderThread back as it would with a
+  // single stream. Batches are discarded if writing failed or the queue is
+  // closed. An empty batch only carries its send_timestamp_ns, which is moved
+  // to the last queued batch if that one hasn't been written yet.
+  void Push(std::unique_ptr<CaptureEventBatch> batch);
+  // From then on, Push discards batches instead of waiting while the queue is
+  // full and nothing writes it, as when the capture is being stopped and the
+  // stream was never attached.
+  void StopWaitingForWriter();
+  // No more batches are pushed after this.
+  void Close();
+
+  // Writes the batches with write as they are pushed, until the queue is
+  // closed and empty or write fails. Returns false if write failed.
+  bool WriteUntilClosed(
+      const std::function<bool(const CaptureResponse&)>& write);
+
+  // The batches that were written or discarded, so that their memory is
+  // reused.
+  [[nodiscard]] std::vector<std::unique_ptr<CaptureEventBatch>>
+  TakeWrittenBatches();
+
+ private:
+  static constexpr size_t kMaxQueuedBatches = 64;
+
+  const CaptureOptions::StreamCategory category_;
+  const bool batch_function_calls_;
+
+  absl::Mutex mutex_;
+  std::deque<std::unique_ptr<CaptureEventBatch>> queued_batches_;
+  std::vector<std::unique_ptr<CaptureEventBatch>> written_batches_;
+  bool writing_ = false;
+  bool write_failed_ = false;
+  bool waiting_for_writer_ = true;
+  bool closed_ = false;
+  uint64_t discarded_event_count_ = 0;
+};
+
+#endif  // ORBIT_SERVICE_EVENT_STREAM_QUEUE_H_
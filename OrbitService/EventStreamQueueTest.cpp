@@ -0,0 +1,154 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "EventStreamQueue.h"
+
+namespace {
+
+std::unique_ptr<CaptureEventBatch> CreateBatch(uint64_t send_timestamp_ns) {
+  auto batch = std::make_unique<CaptureEventBatch>();
+  batch->GetResponse()->set_send_timestamp_ns(send_timestamp_ns);
+  CallstackSample* callstack_sample =
+      batch->AddEvent()->mutable_callstack_sample();
+  callstack_sample->set_tid(42);
+  callstack_sample->set_timestamp_ns(send_timestamp_ns);
+  return batch;
+}
+
+}  // namespace
+
+TEST(EventStreamQueue, WritesPushedBatchesInOrder) {
+  EventStreamQueue queue{CaptureOptions::kCallstackSamples, false};
+  EXPECT_EQ(queue.GetCategory(), CaptureOptions::kCallstackSamples);
+  queue.Push(CreateBatch(1));
+  queue.Push(CreateBatch(2));
+  queue.Close();
+
+  std::vector<uint64_t> send_timestamps;
+  EXPECT_TRUE(queue.WriteUntilClosed([&](const CaptureResponse& response) {
+    send_timestamps.push_back(response.send_timestamp_ns());
+    return true;
+  }));
+  EXPECT_EQ(send_timestamps, (std::vector<uint64_t>{1, 2}));
+  EXPECT_EQ(queue.TakeWrittenBatches().size(), 2);
+  EXPECT_TRUE(queue.TakeWrittenBatches().empty());
+}
+
+TEST(EventStreamQueue, PacksFunctionCalls) {
+  EventStreamQueue queue{CaptureOptions::kFunctionCalls, true};
+  auto batch = std::make_unique<CaptureEventBatch>();
+  for (uint64_t i = 0; i < 3; ++i) {
+    FunctionCall* function_call = batch->AddEvent()->mutable_function_call();
+    function_call->set_tid(42);
+    function_call->set_begin_timestamp_ns(100 * i);
+    function_call->set_end_timestamp_ns(100 * i + 50);
+  }
+  queue.Push(std::move(batch));
+  queue.Close();
+
+  std::vector<CaptureResponse> responses;
+  EXPECT_TRUE(queue.WriteUntilClosed([&](const CaptureResponse& response) {
+    responses.push_back(response);
+    return true;
+  }));
+  ASSERT_EQ(responses.size(), 1);
+  ASSERT_EQ(responses[0].capture_events_size(), 1);
+  EXPECT_TRUE(responses[0].capture_events(0).has_function_call_batch());
+}
+
+TEST(EventStreamQueue, DiscardsBatchesAfterWriteFails) {
+  EventStreamQueue queue{CaptureOptions::kSchedulingSlices, false};
+  queue.Push(CreateBatch(1));
+  queue.Push(CreateBatch(2));
+
+  int write_count = 0;
+  EXPECT_FALSE(queue.WriteUntilClosed([&](const CaptureResponse&) {
+    ++write_count;
+    return false;
+  }));
+  EXPECT_EQ(write_count, 1);
+  queue.Push(CreateBatch(3));
+  EXPECT_EQ(queue.TakeWrittenBatches().size(), 3);
+}
+
+TEST(EventStreamQueue, WritesWhilePushing) {
+  constexpr uint64_t kBatchCount = 500;
+  EventStreamQueue queue{CaptureOptions::kCallstackSamples, false};
+  std::vector<uint64_t> send_timestamps;
+  std::thread writer_thread{[&] {
+    queue.WriteUntilClosed([&](const CaptureResponse& response) {
+      send_timestamps.push_back(response.send_timestamp_ns());
+      return true;
+    });
+  }};
+  // Exceeds the capacity of the queue, so pushing also waits for the writer.
+  for (uint64_t i = 0; i < kBatchCount; ++i) {
+    queue.Push(CreateBatch(i));
+  }
+  queue.Close();
+  writer_thread.join();
+
+  ASSERT_EQ(send_timestamps.size(), kBatchCount);
+  for (uint64_t i = 0; i < kBatchCount; ++i) {
+    EXPECT_EQ(send_timestamps[i], i);
+  }
+}
+
+TEST(EventStreamQueue, MovesTimestampOfEmptyBatchToUnwrittenBatch) {
+  EventStreamQueue queue{CaptureOptions::kCallstackSamples, false};
+  // As the SenderThread pushes while the stream isn't written.
+  queue.Push(CreateBatch(1));
+  for (uint64_t i = 2; i <= 100; ++i) {
+    auto empty_batch = std::make_unique<CaptureEventBatch>();
+    empty_batch->GetResponse()->set_send_timestamp_ns(i);
+    queue.Push(std::move(empty_batch));
+  }
+  EXPECT_EQ(queue.TakeWrittenBatches().size(), 99);
+  queue.Close();
+
+  std::vector<CaptureResponse> responses;
+  EXPECT_TRUE(queue.WriteUntilClosed([&](const CaptureResponse& response) {
+    responses.push_back(response);
+    return true;
+  }));
+  ASSERT_EQ(responses.size(), 1);
+  EXPECT_EQ(responses[0].send_timestamp_ns(), 100);
+  EXPECT_EQ(responses[0].capture_events_size(), 1);
+}
+
+TEST(EventStreamQueue, PushWaitsForWriterUntilToldNotTo) {
+  constexpr uint64_t kBatchCount = 100;
+  EventStreamQueue queue{CaptureOptions::kCallstackSamples, false};
+  std::atomic<uint64_t> pushed_count = 0;
+  std::thread pusher_thread{[&] {
+    for (uint64_t i = 0; i < kBatchCount; ++i) {
+      queue.Push(CreateBatch(i));
+      ++pushed_count;
+    }
+  }};
+
+  // Nothing writes the queue, which stays bounded nonetheless.
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  EXPECT_LT(pushed_count, kBatchCount);
+
+  queue.StopWaitingForWriter();
+  pusher_thread.join();
+  queue.Close();
+
+  uint64_t write_count = 0;
+  EXPECT_TRUE(queue.WriteUntilClosed([&](const CaptureResponse&) {
+    ++write_count;
+    return true;
+  }));
+  EXPECT_GT(write_count, 0);
+  EXPECT_LT(write_count, kBatchCount);
+  EXPECT_EQ(queue.TakeWrittenBatches().size(), kBatchCount);
+}
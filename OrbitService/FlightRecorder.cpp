@@ -0,0 +1,292 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "FlightRecorder.h"
+
+#include <OrbitBase/Logging.h>
+
+#include <algorithm>
+
+#include "xxhash.h"
+
+namespace {
+uint64_t GetEventTimestampNs(const CaptureEvent& event) {
+  switch (event.event_case()) {
+    case CaptureEvent::kSchedulingSlice:
+      return event.scheduling_slice().out_timestamp_ns();
+    case CaptureEvent::kCallstackSample:
+      return event.callstack_sample().timestamp_ns();
+    case CaptureEvent::kFunctionCall:
+      return event.function_call().end_timestamp_ns();
+    case CaptureEvent::kGpuJob:
+      return event.gpu_job().dma_fence_signaled_time_ns();
+    case CaptureEvent::kThreadName:
+      return event.thread_name().timestamp_ns();
+    case CaptureEvent::kSystemCall:
+      return event.system_call().end_timestamp_ns();
+    case CaptureEvent::kFutexWait:
+      return event.futex_wait().end_timestamp_ns();
+    case CaptureEvent::kCounterSample:
+      return event.counter_sample().timestamp_ns();
+    case CaptureEvent::kTracerStats:
+      return event.tracer_stats().timestamp_ns();
+    case CaptureEvent::kLostEventsGap:
+      return event.lost_events_gap().end_timestamp_ns();
+    case CaptureEvent::kAggregatedCallstackSamples:
+      return event.aggregated_callstack_samples().end_timestamp_ns();
+    case CaptureEvent::kFunctionInstrumentationDisabled:
+      return event.function_instrumentation_disabled().timestamp_ns();
+    case CaptureEvent::kManualInstrumentationScope:
+      return event.manual_instrumentation_scope().end_timestamp_ns();
+    case CaptureEvent::kInternedCallstack:
+    case CaptureEvent::kInternedString:
+    case CaptureEvent::kAddressInfo:
+    // FunctionCalls are only packed into batches when sent, after recording.
+    case CaptureEvent::kFunctionCallBatch:
+    case CaptureEvent::EVENT_NOT_SET:
+      return 0;
+  }
+  return 0;
+}
+
+// The key of a value is derived from one hash, and its fingerprint from
+// another, so that two different values that get the same key almost surely
+// have different fingerprints.
+constexpr uint64_t kKeySeed = 0;
+constexpr uint64_t kFingerprintSeed = 0x9E3779B97F4A7C15;
+
+uint64_t Hash(const Callstack& callstack, uint64_t seed) {
+  return XXH64(callstack.pcs().data(), callstack.pcs_size() * sizeof(uint64_t),
+               seed);
+}
+
+uint64_t Hash(const std::string& str, uint64_t seed) {
+  return XXH64(str.data(), str.size(), seed);
+}
+
+bool Equals(const Callstack& lhs, const Callstack& rhs) {
+  return std::equal(lhs.pcs().begin(), lhs.pcs().end(), rhs.pcs().begin(),
+                    rhs.pcs().end());
+}
+
+bool Equals(const std::string& lhs, const std::string& rhs) {
+  return lhs == rhs;
+}
+
+uint64_t GetInternedByteSize(const Callstack& callstack) {
+  return callstack.ByteSizeLong();
+}
+
+uint64_t GetInternedByteSize(const std::string& str) { return str.size(); }
+}  // namespace
+
+uint64_t FlightRecorder::InternCallstack(Callstack callstack) {
+  absl::MutexLock lock{&mutex_};
+  return Intern(std::move(callstack), &callstacks_,
+                callstack_fingerprints_sent_);
+}
+
+uint64_t FlightRecorder::InternString(std::string str) {
+  absl::MutexLock lock{&mutex_};
+  return Intern(std::move(str), &strings_, string_fingerprints_sent_);
+}
+
+template <typename T>
+uint64_t FlightRecorder::Intern(
+    T value, absl::flat_hash_map<uint64_t, Interned<T>>* interned_values,
+    const absl::flat_hash_map<uint64_t, uint64_t>& fingerprints_sent) {
+  uint64_t key = Hash(value, kKeySeed);
+  uint64_t fingerprint = Hash(value, kFingerprintSeed);
+  // On a collision, probe the next keys. A key sent in a previous snapshot
+  // stays taken even after its value was dropped, as the client still maps it
+  // to that value, unless the same value comes back.
+  while (true) {
+    auto it = interned_values->find(key);
+    if (it != interned_values->end()) {
+      if (Equals(it->second.value, value)) {
+        ++it->second.ref_count;
+        return key;
+      }
+    } else {
+      auto sent_it = fingerprints_sent.find(key);
+      if (sent_it == fingerprints_sent.end() ||
+          sent_it->second == fingerprint) {
+        Interned<T>& interned = (*interned_values)[key];
+        interned.byte_size = GetInternedByteSize(value);
+        interned.value = std::move(value);
+        interned.fingerprint = fingerprint;
+        interned.ref_count = 1;
+        byte_size_ += interned.byte_size;
+        return key;
+      }
+    }
+    ++key;
+  }
+}
+
+void FlightRecorder::AddEvents(std::vector<CaptureEvent>&& events) {
+  absl::MutexLock lock{&mutex_};
+  for (CaptureEvent& event : events) {
+    AddEvent(std::move(event));
+  }
+
+  while (!events_.empty() &&
+         ((max_bytes_ > 0 && byte_size_ > max_bytes_) ||
+          (window_ns_ > 0 &&
+           events_.front().timestamp_ns + window_ns_ < newest_timestamp_ns_))) {
+    PopOldestEvent();
+  }
+}
+
+void FlightRecorder::AddEvent(CaptureEvent&& event) {
+  uint64_t byte_size = event.ByteSizeLong();
+  byte_size_ += byte_size;
+
+  switch (event.event_case()) {
+    case CaptureEvent::kAddressInfo:
+      address_infos_.emplace_back(std::move(event));
+      return;
+    case CaptureEvent::kThreadName: {
+      int32_t tid = event.thread_name().tid();
+      thread_names_to_send_.insert(tid);
+      auto thread_name_it = thread_names_.find(tid);
+      if (thread_name_it != thread_names_.end()) {
+        byte_size_ -= thread_name_it->second.ByteSizeLong();
+        thread_name_it->second = std::move(event);
+      } else {
+        thread_names_.emplace(tid, std::move(event));
+      }
+      return;
+    }
+    case CaptureEvent::kInternedCallstack:
+    case CaptureEvent::kInternedString:
+      FATAL("Interned values must be passed to InternCallstack/InternString");
+    default:
+      break;
+  }
+
+  uint64_t timestamp_ns = GetEventTimestampNs(event);
+  newest_timestamp_ns_ = std::max(newest_timestamp_ns_, timestamp_ns);
+  events_.push_back({std::move(event), timestamp_ns, byte_size});
+}
+
+CaptureEvent FlightRecorder::PopOldestEvent() {
+  CaptureEvent event = std::move(events_.front().event);
+  switch (event.event_case()) {
+    case CaptureEvent::kCallstackSample:
+      if (event.callstack_sample().callstack_or_key_case() ==
+          CallstackSample::kCallstackKey) {
+        ReleaseCallstack(event.callstack_sample().callstack_key());
+      }
+      break;
+    case CaptureEvent::kFunctionCall:
+      if (event.function_call().entry_callstack_or_key_case() ==
+          FunctionCall::kEntryCallstackKey) {
+        ReleaseCallstack(event.function_call().entry_callstack_key());
+      }
+      break;
+    case CaptureEvent::kGpuJob:
+      if (event.gpu_job().timeline_or_key_case() == GpuJob::kTimelineKey) {
+        ReleaseString(event.gpu_job().timeline_key());
+      }
+      break;
+    case CaptureEvent::kFutexWait:
+      if (event.futex_wait().callstack_or_key_case() ==
+          FutexWait::kCallstackKey) {
+        ReleaseCallstack(event.futex_wait().callstack_key());
+      }
+      if (event.futex_wait().waker_callstack_or_key_case() ==
+          FutexWait::kWakerCallstackKey) {
+        ReleaseCallstack(event.futex_wait().waker_callstack_key());
+      }
+      break;
+    case CaptureEvent::kCounterSample:
+      if (event.counter_sample().name_or_key_case() ==
+          CounterSample::kNameKey) {
+        ReleaseString(event.counter_sample().name_key());
+      }
+      break;
+    case CaptureEvent::kManualInstrumentationScope:
+      if (event.manual_instrumentation_scope().name_or_key_case() ==
+          ManualInstrumentationScope::kNameKey) {
+        ReleaseString(event.manual_instrumentation_scope().name_key());
+      }
+      break;
+    default:
+      break;
+  }
+
+  byte_size_ -= events_.front().byte_size;
+  events_.pop_front();
+  return event;
+}
+
+void FlightRecorder::ReleaseCallstack(uint64_t key) {
+  auto it = callstacks_.find(key);
+  CHECK(it != callstacks_.end());
+  CHECK(it->second.ref_count > 0);
+  if (--it->second.ref_count == 0) {
+    byte_size_ -= it->second.byte_size;
+    callstacks_.erase(it);
+  }
+}
+
+void FlightRecorder::ReleaseString(uint64_t key) {
+  auto it = strings_.find(key);
+  CHECK(it != strings_.end());
+  CHECK(it->second.ref_count > 0);
+  if (--it->second.ref_count == 0) {
+    byte_size_ -= it->second.byte_size;
+    strings_.erase(it);
+  }
+}
+
+std::vector<CaptureEvent> FlightRecorder::GetSnapshot() {
+  absl::MutexLock lock{&mutex_};
+  std::vector<CaptureEvent> snapshot;
+
+  for (const auto& [key, interned] : strings_) {
+    if (!string_fingerprints_sent_.emplace(key, interned.fingerprint).second) {
+      continue;
+    }
+    CaptureEvent& event = snapshot.emplace_back();
+    event.mutable_interned_string()->set_key(key);
+    event.mutable_interned_string()->set_intern(interned.value);
+  }
+  for (const auto& [key, interned] : callstacks_) {
+    if (!callstack_fingerprints_sent_.emplace(key, interned.fingerprint)
+             .second) {
+      continue;
+    }
+    CaptureEvent& event = snapshot.emplace_back();
+    event.mutable_interned_callstack()->set_key(key);
+    *event.mutable_interned_callstack()->mutable_intern() = interned.value;
+  }
+  snapshot.insert(snapshot.end(),
+                  address_infos_.begin() + address_infos_sent_count_,
+                  address_infos_.end());
+  address_infos_sent_count_ = address_infos_.size();
+  for (int32_t tid : thread_names_to_send_) {
+    snapshot.push_back(thread_names_.at(tid));
+  }
+  thread_names_to_send_.clear();
+
+  // This releases the interned values referenced by the events, which have
+  // already been added to the snapshot if needed.
+  snapshot.reserve(snapshot.size() + events_.size());
+  while (!events_.empty()) {
+    snapshot.emplace_back(PopOldestEvent());
+  }
+  return snapshot;
+}
+
+size_t FlightRecorder::GetEventCount() {
+  absl::MutexLock lock{&mutex_};
+  return events_.size();
+}
+
+uint64_t FlightRecorder::GetByteSize() {
+  absl::MutexLock lock{&mutex_};
+  return byte_size_;
+}
@@ -0,0 +1,97 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_SERVICE_FLIGHT_RECORDER_H_
+#define ORBIT_SERVICE_FLIGHT_RECORDER_H_
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/synchronization/mutex.h"
+#include "capture.pb.h"
+
+// Keeps the most recent CaptureEvents of a capture in memory, bounded by a
+// time window and/or a byte budget, so that they can be sent all at once when
+// a snapshot is requested instead of being streamed continuously.
+// Interned callstacks and strings are reference-counted: InternCallstack and
+// InternString are called once for every reference from an event (before the
+// event is added), and the interned value is dropped when the last event
+// referencing it is evicted. The recorder assigns the keys itself, so that no
+// table of all the values ever interned is needed during a long capture.
+// AddressInfos and ThreadNames are never evicted, as any event in a snapshot
+// could need them.
+class FlightRecorder {
+ public:
+  FlightRecorder(uint64_t window_ns, uint64_t max_bytes)
+      : window_ns_{window_ns}, max_bytes_{max_bytes} {}
+
+  FlightRecorder(const FlightRecorder&) = delete;
+  FlightRecorder& operator=(const FlightRecorder&) = delete;
+
+  // Return the key with which events reference the value.
+  uint64_t InternCallstack(Callstack callstack);
+  uint64_t InternString(std::string str);
+
+  // Events must already reference callstacks and strings by key.
+  void AddEvents(std::vector<CaptureEvent>&& events);
+
+  // Returns the interned callstacks and strings, AddressInfos and ThreadNames
+  // not sent in a previous snapshot, followed by the recorded events.
+  // The events are removed from the recorder, so that consecutive snapshots
+  // don't overlap, and recording continues.
+  std::vector<CaptureEvent> GetSnapshot();
+
+  size_t GetEventCount();
+  uint64_t GetByteSize();
+
+ private:
+  struct RecordedEvent {
+    CaptureEvent event;
+    uint64_t timestamp_ns;
+    uint64_t byte_size;
+  };
+
+  template <typename T>
+  struct Interned {
+    T value;
+    uint64_t fingerprint = 0;
+    uint64_t byte_size = 0;
+    uint64_t ref_count = 0;
+  };
+
+  // These require mutex_ to be held.
+  template <typename T>
+  uint64_t Intern(
+      T value, absl::flat_hash_map<uint64_t, Interned<T>>* interned_values,
+      const absl::flat_hash_map<uint64_t, uint64_t>& fingerprints_sent);
+  void AddEvent(CaptureEvent&& event);
+  CaptureEvent PopOldestEvent();
+  void ReleaseCallstack(uint64_t key);
+  void ReleaseString(uint64_t key);
+
+  const uint64_t window_ns_;
+  const uint64_t max_bytes_;
+
+  absl::Mutex mutex_;
+  std::deque<RecordedEvent> events_;
+  uint64_t newest_timestamp_ns_ = 0;
+  uint64_t byte_size_ = 0;
+  absl::flat_hash_map<uint64_t, Interned<Callstack>> callstacks_;
+  absl::flat_hash_map<uint64_t, Interned<std::string>> strings_;
+  // Keys already sent in a snapshot, which the client still knows, mapped to
+  // the fingerprint of their value. Only the fingerprint is kept once the
+  // value is dropped, to tell whether the same value is interned again.
+  absl::flat_hash_map<uint64_t, uint64_t> callstack_fingerprints_sent_;
+  absl::flat_hash_map<uint64_t, uint64_t> string_fingerprints_sent_;
+  std::vector<CaptureEvent> address_infos_;
+  size_t address_infos_sent_count_ = 0;
+  absl::flat_hash_map<int32_t, CaptureEvent> thread_names_;
+  absl::flat_hash_set<int32_t> thread_names_to_send_;
+};
+
+#endif  // ORBIT_SERVICE_FLIGHT_RECORDER_H_
@@ -0,0 +1,202 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+
+#include "FlightRecorder.h"
+#include "absl/container/flat_hash_map.h"
+
+namespace {
+CaptureEvent CreateSchedulingSlice(uint64_t out_timestamp_ns) {
+  CaptureEvent event;
+  event.mutable_scheduling_slice()->set_in_timestamp_ns(out_timestamp_ns - 1);
+  event.mutable_scheduling_slice()->set_out_timestamp_ns(out_timestamp_ns);
+  return event;
+}
+
+CaptureEvent CreateCallstackSample(uint64_t timestamp_ns,
+                                   uint64_t callstack_key) {
+  CaptureEvent event;
+  event.mutable_callstack_sample()->set_timestamp_ns(timestamp_ns);
+  event.mutable_callstack_sample()->set_callstack_key(callstack_key);
+  return event;
+}
+
+Callstack CreateCallstack(uint64_t pc) {
+  Callstack callstack;
+  callstack.add_pcs(pc);
+  return callstack;
+}
+
+std::vector<CaptureEvent> MakeVector(CaptureEvent event) {
+  std::vector<CaptureEvent> events;
+  events.emplace_back(std::move(event));
+  return events;
+}
+}  // namespace
+
+TEST(FlightRecorder, EvictsEventsOutsideWindow) {
+  FlightRecorder flight_recorder{100, 0};
+
+  flight_recorder.AddEvents(MakeVector(CreateSchedulingSlice(1000)));
+  flight_recorder.AddEvents(MakeVector(CreateSchedulingSlice(1050)));
+  flight_recorder.AddEvents(MakeVector(CreateSchedulingSlice(1100)));
+  EXPECT_EQ(flight_recorder.GetEventCount(), 3);
+
+  flight_recorder.AddEvents(MakeVector(CreateSchedulingSlice(1101)));
+  EXPECT_EQ(flight_recorder.GetEventCount(), 3);
+
+  std::vector<CaptureEvent> snapshot = flight_recorder.GetSnapshot();
+  ASSERT_EQ(snapshot.size(), 3);
+  EXPECT_EQ(snapshot[0].scheduling_slice().out_timestamp_ns(), 1050);
+  EXPECT_EQ(snapshot[2].scheduling_slice().out_timestamp_ns(), 1101);
+}
+
+TEST(FlightRecorder, EvictsEventsOverByteBudget) {
+  uint64_t event_size = CreateSchedulingSlice(1000).ByteSizeLong();
+  FlightRecorder flight_recorder{0, 2 * event_size};
+
+  flight_recorder.AddEvents(MakeVector(CreateSchedulingSlice(1000)));
+  flight_recorder.AddEvents(MakeVector(CreateSchedulingSlice(1001)));
+  EXPECT_EQ(flight_recorder.GetEventCount(), 2);
+  EXPECT_EQ(flight_recorder.GetByteSize(), 2 * event_size);
+
+  flight_recorder.AddEvents(MakeVector(CreateSchedulingSlice(1002)));
+  EXPECT_EQ(flight_recorder.GetEventCount(), 2);
+  EXPECT_EQ(flight_recorder.GetByteSize(), 2 * event_size);
+
+  std::vector<CaptureEvent> snapshot = flight_recorder.GetSnapshot();
+  ASSERT_EQ(snapshot.size(), 2);
+  EXPECT_EQ(snapshot[0].scheduling_slice().out_timestamp_ns(), 1001);
+}
+
+TEST(FlightRecorder, DropsCallstackWhenLastReferenceIsEvicted) {
+  FlightRecorder flight_recorder{100, 0};
+
+  uint64_t key_a = flight_recorder.InternCallstack(CreateCallstack(0xA));
+  flight_recorder.AddEvents(MakeVector(CreateCallstackSample(1000, key_a)));
+  uint64_t key_b = flight_recorder.InternCallstack(CreateCallstack(0xB));
+  flight_recorder.AddEvents(MakeVector(CreateCallstackSample(1050, key_b)));
+  EXPECT_EQ(flight_recorder.InternCallstack(CreateCallstack(0xA)), key_a);
+  flight_recorder.AddEvents(MakeVector(CreateCallstackSample(1160, key_a)));
+
+  // The first two samples were evicted, but callstack A is still referenced.
+  std::vector<CaptureEvent> snapshot = flight_recorder.GetSnapshot();
+  ASSERT_EQ(snapshot.size(), 2);
+  EXPECT_EQ(snapshot[0].event_case(), CaptureEvent::kInternedCallstack);
+  EXPECT_EQ(snapshot[0].interned_callstack().key(), key_a);
+  EXPECT_EQ(snapshot[0].interned_callstack().intern().pcs(0), 0xA);
+  EXPECT_EQ(snapshot[1].callstack_sample().timestamp_ns(), 1160);
+
+  // Draining the last reference dropped the callstack as well.
+  EXPECT_EQ(flight_recorder.GetByteSize(), 0);
+}
+
+TEST(FlightRecorder, ConsecutiveSnapshotsDontOverlap) {
+  FlightRecorder flight_recorder{100, 0};
+
+  uint64_t key_a = flight_recorder.InternCallstack(CreateCallstack(0xA));
+  flight_recorder.AddEvents(MakeVector(CreateCallstackSample(1000, key_a)));
+  std::vector<CaptureEvent> snapshot = flight_recorder.GetSnapshot();
+  ASSERT_EQ(snapshot.size(), 2);
+  EXPECT_EQ(flight_recorder.GetEventCount(), 0);
+
+  // The client already knows callstack A from the first snapshot, even though
+  // the recorder dropped it in the meantime.
+  EXPECT_EQ(flight_recorder.InternCallstack(CreateCallstack(0xA)), key_a);
+  flight_recorder.AddEvents(MakeVector(CreateCallstackSample(1010, key_a)));
+  uint64_t key_b = flight_recorder.InternCallstack(CreateCallstack(0xB));
+  flight_recorder.AddEvents(MakeVector(CreateCallstackSample(1020, key_b)));
+  snapshot = flight_recorder.GetSnapshot();
+  ASSERT_EQ(snapshot.size(), 3);
+  EXPECT_EQ(snapshot[0].interned_callstack().key(), key_b);
+  EXPECT_EQ(snapshot[1].callstack_sample().timestamp_ns(), 1010);
+  EXPECT_EQ(snapshot[2].callstack_sample().timestamp_ns(), 1020);
+
+  EXPECT_TRUE(flight_recorder.GetSnapshot().empty());
+}
+
+TEST(FlightRecorder, LongCaptureStaysWithinByteBudget) {
+  constexpr uint64_t kMaxBytes = 64 * 1024;
+  FlightRecorder flight_recorder{0, kMaxBytes};
+
+  // Every sample has a callstack never seen before, as with a long capture of
+  // a program that keeps running new code.
+  constexpr uint64_t kSampleCount = 200'000;
+  absl::flat_hash_map<uint64_t, uint64_t> pcs_by_key;
+  for (uint64_t i = 0; i < kSampleCount; ++i) {
+    uint64_t key = flight_recorder.InternCallstack(CreateCallstack(i));
+    flight_recorder.AddEvents(MakeVector(CreateCallstackSample(i, key)));
+    ASSERT_LE(flight_recorder.GetByteSize(), kMaxBytes);
+    if (i % 10'000 == 0) {
+      // Keys of dropped callstacks can't be reused for a different callstack
+      // once they were sent.
+      for (const CaptureEvent& event : flight_recorder.GetSnapshot()) {
+        if (event.event_case() != CaptureEvent::kInternedCallstack) {
+          continue;
+        }
+        EXPECT_TRUE(pcs_by_key
+                        .emplace(event.interned_callstack().key(),
+                                 event.interned_callstack().intern().pcs(0))
+                        .second);
+      }
+    }
+  }
+
+  // Only the most recent samples and their callstacks are kept, and each
+  // sample refers to its own callstack.
+  std::vector<CaptureEvent> snapshot = flight_recorder.GetSnapshot();
+  EXPECT_LT(snapshot.size(), kSampleCount / 10);
+  for (const CaptureEvent& event : snapshot) {
+    if (event.event_case() == CaptureEvent::kInternedCallstack) {
+      EXPECT_TRUE(pcs_by_key
+                      .emplace(event.interned_callstack().key(),
+                               event.interned_callstack().intern().pcs(0))
+                      .second);
+      continue;
+    }
+    ASSERT_EQ(event.event_case(), CaptureEvent::kCallstackSample);
+    auto it = pcs_by_key.find(event.callstack_sample().callstack_key());
+    ASSERT_NE(it, pcs_by_key.end());
+    EXPECT_EQ(it->second, event.callstack_sample().timestamp_ns());
+  }
+  EXPECT_EQ(flight_recorder.GetByteSize(), 0);
+}
+
+TEST(FlightRecorder, KeepsAddressInfosAndLatestThreadNames) {
+  FlightRecorder flight_recorder{100, 0};
+
+  CaptureEvent address_info;
+  address_info.mutable_address_info()->set_absolute_address(0x1000);
+  address_info.mutable_address_info()->set_function_name_key(
+      flight_recorder.InternString("function"));
+  address_info.mutable_address_info()->set_map_name_key(
+      flight_recorder.InternString("module"));
+  flight_recorder.AddEvents(MakeVector(address_info));
+
+  CaptureEvent thread_name;
+  thread_name.mutable_thread_name()->set_tid(42);
+  thread_name.mutable_thread_name()->set_name("old");
+  flight_recorder.AddEvents(MakeVector(thread_name));
+  thread_name.mutable_thread_name()->set_name("new");
+  flight_recorder.AddEvents(MakeVector(thread_name));
+
+  flight_recorder.AddEvents(MakeVector(CreateSchedulingSlice(1000)));
+  flight_recorder.AddEvents(MakeVector(CreateSchedulingSlice(2000)));
+  EXPECT_EQ(flight_recorder.GetEventCount(), 1);
+
+  std::vector<CaptureEvent> snapshot = flight_recorder.GetSnapshot();
+  ASSERT_EQ(snapshot.size(), 5);
+  EXPECT_EQ(snapshot[0].event_case(), CaptureEvent::kInternedString);
+  EXPECT_EQ(snapshot[1].event_case(), CaptureEvent::kInternedString);
+  EXPECT_EQ(snapshot[2].address_info().absolute_address(), 0x1000);
+  EXPECT_EQ(snapshot[3].thread_name().name(), "new");
+  EXPECT_EQ(snapshot[4].scheduling_slice().out_timestamp_ns(), 2000);
+
+  thread_name.mutable_thread_name()->set_tid(43);
+  flight_recorder.AddEvents(MakeVector(thread_name));
+  snapshot = flight_recorder.GetSnapshot();
+  ASSERT_EQ(snapshot.size(), 1);
+  EXPECT_EQ(snapshot[0].thread_name().tid(), 43);
+}
@@ -0,0 +1,95 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_SERVICE_INTERN_TABLE_H_
+#define ORBIT_SERVICE_INTERN_TABLE_H_
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <utility>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+#include "capture.pb.h"
+#include "xxhash.h"
+
+// Assigns to each distinct value a key that no other value gets, so that
+// values can be sent once and then referred to by key. The key is derived from
+// a hash of the value, but values are compared in full: when two values have
+// the same hash, the second one gets the next free key instead of silently
+// sharing the key of the first.
+//
+// Thread safe. The table is split in shards, each with its own mutex, and the
+// shard of a value only depends on its hash, so that concurrent callers rarely
+// wait for each other.
+template <typename T, typename Hash, typename Eq>
+class InternTable {
+ public:
+  InternTable() = default;
+
+  InternTable(const InternTable&) = delete;
+  InternTable& operator=(const InternTable&) = delete;
+  InternTable(InternTable&&) = delete;
+  InternTable& operator=(InternTable&&) = delete;
+
+  // Returns the key of value, and whether value was added to the table by
+  // this call, i.e., whether the caller is the first to intern it.
+  std::pair<uint64_t, bool> Intern(const T& value) {
+    // As the shard is chosen by key modulo kShardCount, probing in steps of
+    // kShardCount stays in the same shard.
+    uint64_t key = Hash{}(value);
+    Shard& shard = shards_[key % kShardCount];
+    absl::MutexLock lock{&shard.mutex};
+    while (true) {
+      auto [it, inserted] = shard.values.try_emplace(key, value);
+      if (inserted) {
+        return {key, true};
+      }
+      if (Eq{}(it->second, value)) {
+        return {key, false};
+      }
+      key += kShardCount;
+    }
+  }
+
+ private:
+  static constexpr uint64_t kShardCount = 64;
+
+  struct Shard {
+    absl::Mutex mutex;
+    absl::flat_hash_map<uint64_t, T> values ABSL_GUARDED_BY(mutex);
+  };
+  std::array<Shard, kShardCount> shards_;
+};
+
+struct CallstackInternHash {
+  uint64_t operator()(const Callstack& callstack) const {
+    return XXH64(callstack.pcs().data(),
+                 callstack.pcs_size() * sizeof(uint64_t), 0);
+  }
+};
+
+struct CallstackInternEq {
+  bool operator()(const Callstack& lhs, const Callstack& rhs) const {
+    return std::equal(lhs.pcs().begin(), lhs.pcs().end(), rhs.pcs().begin(),
+                      rhs.pcs().end());
+  }
+};
+
+struct StringInternHash {
+  uint64_t operator()(const std::string& str) const {
+    return XXH64(str.data(), str.size(), 0);
+  }
+};
+
+using CallstackInternTable =
+    InternTable<Callstack, CallstackInternHash, CallstackInternEq>;
+using StringInternTable =
+    InternTable<std::string, StringInternHash, std::equal_to<std::string>>;
+
+#endif  // ORBIT_SERVICE_INTERN_TABLE_H_
@@ -0,0 +1,94 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "InternTable.h"
+#include "absl/container/flat_hash_map.h"
+
+namespace {
+
+Callstack CreateCallstack(const std::vector<uint64_t>& pcs) {
+  Callstack callstack;
+  for (uint64_t pc : pcs) {
+    callstack.add_pcs(pc);
+  }
+  return callstack;
+}
+
+struct ConstantHash {
+  uint64_t operator()(const std::string& /*str*/) const { return 42; }
+};
+
+}  // namespace
+
+TEST(InternTable, SameValueGetsSameKey) {
+  CallstackInternTable table;
+  auto [first_key, first_inserted] = table.Intern(CreateCallstack({1, 2, 3}));
+  EXPECT_TRUE(first_inserted);
+  auto [second_key, second_inserted] =
+      table.Intern(CreateCallstack({1, 2, 3}));
+  EXPECT_FALSE(second_inserted);
+  EXPECT_EQ(first_key, second_key);
+}
+
+TEST(InternTable, DifferentValuesGetDifferentKeys) {
+  CallstackInternTable table;
+  auto [first_key, first_inserted] = table.Intern(CreateCallstack({1, 2, 3}));
+  auto [second_key, second_inserted] = table.Intern(CreateCallstack({1, 2}));
+  EXPECT_TRUE(first_inserted);
+  EXPECT_TRUE(second_inserted);
+  EXPECT_NE(first_key, second_key);
+}
+
+TEST(InternTable, CollidingValuesGetDifferentKeys) {
+  InternTable<std::string, ConstantHash, std::equal_to<std::string>> table;
+  uint64_t foo_key = table.Intern("foo").first;
+  uint64_t bar_key = table.Intern("bar").first;
+  uint64_t baz_key = table.Intern("baz").first;
+  EXPECT_NE(foo_key, bar_key);
+  EXPECT_NE(foo_key, baz_key);
+  EXPECT_NE(bar_key, baz_key);
+
+  EXPECT_EQ(table.Intern("foo"), std::make_pair(foo_key, false));
+  EXPECT_EQ(table.Intern("bar"), std::make_pair(bar_key, false));
+  EXPECT_EQ(table.Intern("baz"), std::make_pair(baz_key, false));
+}
+
+TEST(InternTable, ConcurrentProducers) {
+  constexpr uint64_t kThreadCount = 8;
+  constexpr uint64_t kValueCount = 10'000;
+  StringInternTable table;
+  std::atomic<uint64_t> inserted_count = 0;
+  std::vector<absl::flat_hash_map<std::string, uint64_t>> keys(kThreadCount);
+
+  std::vector<std::thread> threads;
+  for (uint64_t thread_index = 0; thread_index < kThreadCount;
+       ++thread_index) {
+    threads.emplace_back([&, thread_index] {
+      for (uint64_t i = 0; i < kValueCount; ++i) {
+        std::string value = std::to_string(i);
+        auto [key, inserted] = table.Intern(value);
+        keys[thread_index].emplace(value, key);
+        if (inserted) {
+          ++inserted_count;
+        }
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  // Each value was inserted exactly once, and all threads got the same key.
+  EXPECT_EQ(inserted_count, kValueCount);
+  for (uint64_t thread_index = 1; thread_index < kThreadCount;
+       ++thread_index) {
+    EXPECT_EQ(keys[thread_index], keys[0]);
+  }
+}
@@ -4,8 +4,44 @@
 
 #include "LinuxTracingGrpcHandler.h"
 
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+#include "FunctionCallBatch.h"
+#include "Profiling.h"
+#include "absl/strings/str_format.h"
 #include "llvm/Demangle/Demangle.h"
 
+std::vector<std::shared_ptr<EventStreamQueue>>
+LinuxTracingGrpcHandler::CreateEventStreamQueues(
+    const CaptureOptions& capture_options) {
+  CHECK(tracer_ == nullptr);
+  CHECK(event_stream_queues_.empty());
+  if (capture_options.separate_stream_categories().empty()) {
+    return {};
+  }
+  if (capture_options.has_flight_recorder() ||
+      !capture_options.triggers().empty()) {
+    ERROR("Ignoring separate streams for flight-recorder capture");
+    return {};
+  }
+  for (int i = 0; i < capture_options.separate_stream_categories_size(); ++i) {
+    CaptureOptions::StreamCategory category =
+        capture_options.separate_stream_categories(i);
+    if (category == CaptureOptions::kOtherEvents ||
+        stream_indices_[category] != 0) {
+      continue;
+    }
+    stream_indices_[category] = GetStreamCount();
+    event_stream_queues_.emplace_back(std::make_shared<EventStreamQueue>(
+        category, capture_options.batch_function_calls()));
+    LOG("Sending %s on a separate stream",
+        CaptureOptions::StreamCategory_Name(category));
+  }
+  return event_stream_queues_;
+}
+
 void LinuxTracingGrpcHandler::Start(CaptureOptions capture_options) {
   CHECK(tracer_ == nullptr);
   CHECK(!sender_thread_.joinable());
@@ -14,6 +50,41 @@ void LinuxTracingGrpcHandler::Start(CaptureOptions capture_options) {
     // Protect tracer_ with event_buffer_mutex_ so that we can use tracer_ in
     // Conditions for Await/LockWhen (specifically, in SenderThread).
     absl::MutexLock lock{&event_buffer_mutex_};
+    if (!capture_options.triggers().empty()) {
+      triggers_ = std::make_unique<CaptureTriggers>(capture_options.triggers());
+      post_trigger_delay_ =
+          absl::Nanoseconds(capture_options.post_trigger_ns());
+    }
+    if (capture_options.has_flight_recorder() || triggers_ != nullptr) {
+      constexpr uint64_t kDefaultFlightRecorderMaxBytes = 256 * 1024 * 1024;
+      const CaptureOptions::FlightRecorderOptions& options =
+          capture_options.flight_recorder();
+      uint64_t max_bytes = options.max_bytes();
+      if (options.window_ns() == 0 && max_bytes == 0) {
+        max_bytes = kDefaultFlightRecorderMaxBytes;
+      }
+      flight_recorder_ =
+          std::make_unique<FlightRecorder>(options.window_ns(), max_bytes);
+      LOG("Flight-recorder capture: window %lu ns, at most %lu bytes",
+          options.window_ns(), max_bytes);
+    }
+    if (capture_options.sample_aggregation_bucket_ns() > 0) {
+      if (flight_recorder_ != nullptr) {
+        ERROR("Ignoring sample aggregation for flight-recorder capture");
+      } else {
+        callstack_sample_aggregator_ =
+            std::make_unique<CallstackSampleAggregator>(
+                capture_options.sample_aggregation_bucket_ns());
+        LOG("Aggregating callstack samples over %lu ns",
+            capture_options.sample_aggregation_bucket_ns());
+      }
+    }
+    batch_function_calls_ = capture_options.batch_function_calls();
+    full_batches_.resize(GetStreamCount());
+    if (flight_recorder_ == nullptr) {
+      max_buffered_events_ = capture_options.max_buffered_events();
+      buffer_full_policy_ = capture_options.buffer_full_policy();
+    }
     tracer_ =
         std::make_unique<LinuxTracing::Tracer>(std::move(capture_options));
   }
@@ -27,6 +98,11 @@ void LinuxTracingGrpcHandler::Stop() {
   CHECK(tracer_ != nullptr);
   CHECK(sender_thread_.joinable());
 
+  // Otherwise, the SenderThread would wait forever on the queue of a stream
+  // that was never attached, and the Tracer on the SenderThread.
+  for (const std::shared_ptr<EventStreamQueue>& queue : event_stream_queues_) {
+    queue->StopWaitingForWriter();
+  }
   tracer_->Stop();
   {
     absl::MutexLock lock{&event_buffer_mutex_};
@@ -36,38 +112,75 @@ void LinuxTracingGrpcHandler::Stop() {
   sender_thread_.join();
 }
 
+void LinuxTracingGrpcHandler::RequestSnapshot() {
+  absl::MutexLock lock{&event_buffer_mutex_};
+  if (flight_recorder_ == nullptr) {
+    ERROR("Snapshot requested but this is not a flight-recorder capture");
+    return;
+  }
+  snapshot_requested_ = true;
+}
+
+void LinuxTracingGrpcHandler::OnTriggered(const std::string& description) {
+  if (trigger_pending_.exchange(true)) {
+    return;
+  }
+  absl::MutexLock lock{&event_buffer_mutex_};
+  LOG("Capture triggered by %s", description);
+  trigger_snapshot_time_ = absl::Now() + post_trigger_delay_;
+}
+
 void LinuxTracingGrpcHandler::OnSchedulingSlice(
     SchedulingSlice scheduling_slice) {
-  CaptureEvent event;
-  *event.mutable_scheduling_slice() = std::move(scheduling_slice);
-  {
-    absl::MutexLock lock{&event_buffer_mutex_};
-    event_buffer_.emplace_back(std::move(event));
+  if (ShouldDropLowPriorityEvent(/*is_callstack_sample=*/false)) {
+    return;
   }
+  BufferEvent(CaptureOptions::kSchedulingSlices, [&](CaptureEvent* event) {
+    *event->mutable_scheduling_slice() = std::move(scheduling_slice);
+  });
 }
 
 void LinuxTracingGrpcHandler::OnCallstackSample(
     CallstackSample callstack_sample) {
   CHECK(callstack_sample.callstack_or_key_case() ==
         CallstackSample::kCallstack);
+  // callstack_sample_aggregator_ is only set in Start, before the Tracer is
+  // started. Aggregated samples don't fill the buffer.
+  if (callstack_sample_aggregator_ == nullptr &&
+      ShouldDropLowPriorityEvent(/*is_callstack_sample=*/true)) {
+    return;
+  }
   callstack_sample.set_callstack_key(
       InternCallstackIfNecessaryAndGetKey(callstack_sample.callstack()));
 
-  CaptureEvent event;
-  *event.mutable_callstack_sample() = std::move(callstack_sample);
-  {
+  if (callstack_sample_aggregator_ != nullptr) {
     absl::MutexLock lock{&event_buffer_mutex_};
-    event_buffer_.emplace_back(std::move(event));
+    callstack_sample_aggregator_->AddCallstackSample(callstack_sample);
+    return;
   }
+  BufferEvent(CaptureOptions::kCallstackSamples, [&](CaptureEvent* event) {
+    *event->mutable_callstack_sample() = std::move(callstack_sample);
+  });
 }
 
 void LinuxTracingGrpcHandler::OnFunctionCall(FunctionCall function_call) {
-  CaptureEvent event;
-  *event.mutable_function_call() = std::move(function_call);
-  {
-    absl::MutexLock lock{&event_buffer_mutex_};
-    event_buffer_.emplace_back(std::move(event));
+  // triggers_ is only set in Start, before the Tracer is started.
+  if (triggers_ != nullptr && !trigger_pending_ &&
+      triggers_->IsTriggeredBy(function_call)) {
+    OnTriggered(absl::StrFormat(
+        "call to %#llx of %lu ns", function_call.absolute_address(),
+        function_call.end_timestamp_ns() - function_call.begin_timestamp_ns()));
   }
+
+  if (function_call.entry_callstack_or_key_case() ==
+      FunctionCall::kEntryCallstack) {
+    function_call.set_entry_callstack_key(InternCallstackIfNecessaryAndGetKey(
+        std::move(*function_call.mutable_entry_callstack())));
+  }
+
+  BufferEvent(CaptureOptions::kFunctionCalls, [&](CaptureEvent* event) {
+    *event->mutable_function_call() = std::move(function_call);
+  });
 }
 
 void LinuxTracingGrpcHandler::OnGpuJob(GpuJob gpu_job) {
@@ -75,30 +188,25 @@ void LinuxTracingGrpcHandler::OnGpuJob(GpuJob gpu_job) {
   gpu_job.set_timeline_key(
       InternStringIfNecessaryAndGetKey(std::move(*gpu_job.mutable_timeline())));
 
-  CaptureEvent event;
-  *event.mutable_gpu_job() = std::move(gpu_job);
-  {
-    absl::MutexLock lock{&event_buffer_mutex_};
-    event_buffer_.emplace_back(std::move(event));
-  }
+  BufferEvent(CaptureOptions::kOtherEvents, [&](CaptureEvent* event) {
+    *event->mutable_gpu_job() = std::move(gpu_job);
+  });
 }
 
 void LinuxTracingGrpcHandler::OnThreadName(ThreadName thread_name) {
-  CaptureEvent event;
-  *event.mutable_thread_name() = std::move(thread_name);
-  {
-    absl::MutexLock lock{&event_buffer_mutex_};
-    event_buffer_.emplace_back(std::move(event));
-  }
+  BufferEvent(CaptureOptions::kOtherEvents, [&](CaptureEvent* event) {
+    *event->mutable_thread_name() = std::move(thread_name);
+  });
 }
 
 void LinuxTracingGrpcHandler::OnAddressInfo(AddressInfo address_info) {
   {
     absl::MutexLock lock{&addresses_seen_mutex_};
-    if (addresses_seen_.contains(address_info.absolute_address())) {
+    if (!addresses_seen_
+             .emplace(address_info.pid(), address_info.absolute_address())
+             .second) {
       return;
     }
-    addresses_seen_.emplace(address_info.absolute_address());
   }
 
   CHECK(address_info.function_name_or_key_case() == AddressInfo::kFunctionName);
@@ -108,66 +216,265 @@ void LinuxTracingGrpcHandler::OnAddressInfo(AddressInfo address_info) {
   address_info.set_map_name_key(InternStringIfNecessaryAndGetKey(
       std::move(*address_info.mutable_map_name())));
 
-  CaptureEvent event;
-  *event.mutable_address_info() = std::move(address_info);
+  BufferEvent(CaptureOptions::kOtherEvents, [&](CaptureEvent* event) {
+    *event->mutable_address_info() = std::move(address_info);
+  });
+}
+
+void LinuxTracingGrpcHandler::OnSystemCall(SystemCall system_call) {
+  BufferEvent(CaptureOptions::kOtherEvents, [&](CaptureEvent* event) {
+    *event->mutable_system_call() = std::move(system_call);
+  });
+}
+
+void LinuxTracingGrpcHandler::OnFutexWait(FutexWait futex_wait) {
+  CHECK(futex_wait.callstack_or_key_case() == FutexWait::kCallstack);
+  futex_wait.set_callstack_key(
+      InternCallstackIfNecessaryAndGetKey(futex_wait.callstack()));
+  if (futex_wait.waker_callstack_or_key_case() ==
+      FutexWait::kWakerCallstack) {
+    futex_wait.set_waker_callstack_key(
+        InternCallstackIfNecessaryAndGetKey(futex_wait.waker_callstack()));
+  }
+
+  BufferEvent(CaptureOptions::kOtherEvents, [&](CaptureEvent* event) {
+    *event->mutable_futex_wait() = std::move(futex_wait);
+  });
+}
+
+void LinuxTracingGrpcHandler::OnCounterSample(CounterSample counter_sample) {
+  CHECK(counter_sample.name_or_key_case() == CounterSample::kName);
+  if (triggers_ != nullptr && !trigger_pending_ &&
+      triggers_->IsTriggeredBy(counter_sample)) {
+    OnTriggered(absl::StrFormat("\"%s\" at %f", counter_sample.name(),
+                                counter_sample.value()));
+  }
+  counter_sample.set_name_key(InternStringIfNecessaryAndGetKey(
+      std::move(*counter_sample.mutable_name())));
+
+  BufferEvent(CaptureOptions::kOtherEvents, [&](CaptureEvent* event) {
+    *event->mutable_counter_sample() = std::move(counter_sample);
+  });
+}
+
+void LinuxTracingGrpcHandler::OnTracerStats(TracerStats tracer_stats) {
+  tracer_stats.set_sender_dropped_count(
+      unreported_dropped_event_count_.exchange(0));
+  BufferEvent(CaptureOptions::kOtherEvents, [&](CaptureEvent* event) {
+    *event->mutable_tracer_stats() = std::move(tracer_stats);
+  });
+}
+
+void LinuxTracingGrpcHandler::OnLostEventsGap(LostEventsGap lost_events_gap) {
+  BufferEvent(CaptureOptions::kOtherEvents, [&](CaptureEvent* event) {
+    *event->mutable_lost_events_gap() = std::move(lost_events_gap);
+  });
+}
+
+void LinuxTracingGrpcHandler::OnFunctionInstrumentationDisabled(
+    FunctionInstrumentationDisabled function_instrumentation_disabled) {
+  BufferEvent(CaptureOptions::kOtherEvents, [&](CaptureEvent* event) {
+    *event->mutable_function_instrumentation_disabled() =
+        std::move(function_instrumentation_disabled);
+  });
+}
+
+void LinuxTracingGrpcHandler::OnManualInstrumentationScope(
+    ManualInstrumentationScope manual_instrumentation_scope) {
+  CHECK(manual_instrumentation_scope.name_or_key_case() ==
+        ManualInstrumentationScope::kName);
+  manual_instrumentation_scope.set_name_key(InternStringIfNecessaryAndGetKey(
+      std::move(*manual_instrumentation_scope.mutable_name())));
+
+  BufferEvent(CaptureOptions::kOtherEvents, [&](CaptureEvent* event) {
+    *event->mutable_manual_instrumentation_scope() =
+        std::move(manual_instrumentation_scope);
+  });
+}
+
+std::atomic<uint64_t> LinuxTracingGrpcHandler::next_id_ = 1;
+
+LinuxTracingGrpcHandler::ProducerBuffer*
+LinuxTracingGrpcHandler::GetProducerBuffer() {
+  // The buffer of the calling thread for the last handler it produced events
+  // for. Handler ids are never reused.
+  thread_local uint64_t producer_buffer_handler_id = 0;
+  thread_local ProducerBuffer* producer_buffer = nullptr;
+  if (producer_buffer_handler_id != id_) {
+    absl::MutexLock lock{&producer_buffers_mutex_};
+    producer_buffer =
+        producer_buffers_.emplace_back(std::make_unique<ProducerBuffer>())
+            .get();
+    for (size_t i = 0; i < GetStreamCount(); ++i) {
+      producer_buffer->batches.emplace_back(
+          std::make_unique<CaptureEventBatch>());
+    }
+    producer_buffer_handler_id = id_;
+  }
+  return producer_buffer;
+}
+
+template <typename SetEvent>
+void LinuxTracingGrpcHandler::BufferEvent(
+    CaptureOptions::StreamCategory category, SetEvent set_event) {
+  // stream_indices_ is only set before the Tracer is started.
+  size_t stream_index = stream_indices_[category];
+  ProducerBuffer* producer_buffer = GetProducerBuffer();
+  std::unique_ptr<CaptureEventBatch> full_batch;
   {
-    absl::MutexLock lock{&event_buffer_mutex_};
-    event_buffer_.emplace_back(std::move(event));
+    // Only contended when the SenderThread takes the batches.
+    absl::MutexLock lock{&producer_buffer->mutex};
+    std::unique_ptr<CaptureEventBatch>& batch =
+        producer_buffer->batches[stream_index];
+    set_event(batch->AddEvent());
+    if (batch->GetEventCount() < kProducerBatchSize) {
+      return;
+    }
+    full_batch = std::exchange(batch, GetSpareBatch());
   }
+  // Not holding the producer's mutex, as this might wait for the SenderThread.
+  absl::MutexLock lock{&event_buffer_mutex_};
+  WaitForBufferSpace();
+  buffered_event_count_ += full_batch->GetEventCount();
+  full_batches_[stream_index].emplace_back(std::move(full_batch));
 }
 
-uint64_t LinuxTracingGrpcHandler::ComputeCallstackKey(
-    const Callstack& callstack) {
-  uint64_t key = 17;
-  for (uint64_t pc : callstack.pcs()) {
-    key = 31 * key + pc;
+void LinuxTracingGrpcHandler::BufferEventNow(CaptureEvent&& event) {
+  absl::MutexLock lock{&event_buffer_mutex_};
+  WaitForBufferSpace();
+  event_buffer_.emplace_back(std::move(event));
+  ++buffered_event_count_;
+}
+
+LinuxTracingGrpcHandler::StreamBatches
+LinuxTracingGrpcHandler::TakeProducerBatches() {
+  StreamBatches batches(GetStreamCount());
+  absl::MutexLock producer_buffers_lock{&producer_buffers_mutex_};
+  for (const std::unique_ptr<ProducerBuffer>& producer_buffer :
+       producer_buffers_) {
+    absl::MutexLock lock{&producer_buffer->mutex};
+    for (size_t i = 0; i < batches.size(); ++i) {
+      if (producer_buffer->batches[i]->GetEventCount() == 0) {
+        continue;
+      }
+      batches[i].emplace_back(
+          std::exchange(producer_buffer->batches[i], GetSpareBatch()));
+    }
   }
-  return key;
+  return batches;
+}
+
+std::unique_ptr<CaptureEventBatch> LinuxTracingGrpcHandler::GetSpareBatch() {
+  absl::MutexLock lock{&spare_batches_mutex_};
+  if (spare_batches_.empty()) {
+    return std::make_unique<CaptureEventBatch>();
+  }
+  std::unique_ptr<CaptureEventBatch> batch = std::move(spare_batches_.back());
+  spare_batches_.pop_back();
+  return batch;
+}
+
+void LinuxTracingGrpcHandler::RecycleBatches(
+    std::vector<std::unique_ptr<CaptureEventBatch>>&& batches) {
+  absl::MutexLock lock{&spare_batches_mutex_};
+  for (std::unique_ptr<CaptureEventBatch>& batch : batches) {
+    if (spare_batches_.size() == kMaxSpareBatches) {
+      break;
+    }
+    batch->Clear();
+    spare_batches_.emplace_back(std::move(batch));
+  }
+}
+
+void LinuxTracingGrpcHandler::WaitForBufferSpace() {
+  // max_buffered_events_ is only set in Start, before the Tracer is started.
+  if (max_buffered_events_ == 0) {
+    return;
+  }
+  event_buffer_mutex_.Await(absl::Condition(
+      +[](LinuxTracingGrpcHandler* self) {
+        return self->buffered_event_count_ < self->max_buffered_events_;
+      },
+      this));
+}
+
+bool LinuxTracingGrpcHandler::ShouldDropLowPriorityEvent(
+    bool is_callstack_sample) {
+  if (max_buffered_events_ == 0) {
+    return false;
+  }
+  bool drop = false;
+  switch (buffer_full_policy_) {
+    case CaptureOptions::kDropLowPriorityEvents:
+      drop = buffered_event_count_ >= max_buffered_events_;
+      break;
+    case CaptureOptions::kReduceSamplingRate:
+      drop = is_callstack_sample &&
+             callstack_sample_count_++ % callstack_sample_keep_interval_ != 0;
+      break;
+    default:
+      break;
+  }
+  if (drop) {
+    ++dropped_event_count_;
+    ++unreported_dropped_event_count_;
+  }
+  return drop;
+}
+
+void LinuxTracingGrpcHandler::UpdateCallstackSampleKeepInterval() {
+  if (max_buffered_events_ == 0 ||
+      buffer_full_policy_ != CaptureOptions::kReduceSamplingRate) {
+    return;
+  }
+  // The buffer fills up while the SenderThread is blocked writing, which is
+  // when the link can't keep up.
+  uint64_t keep_interval = callstack_sample_keep_interval_;
+  if (buffered_event_count_ >= max_buffered_events_ / 2) {
+    keep_interval =
+        std::min(2 * keep_interval, kMaxCallstackSampleKeepInterval);
+  } else if (buffered_event_count_ < max_buffered_events_ / 8) {
+    keep_interval = std::max<uint64_t>(keep_interval / 2, 1);
+  }
+  callstack_sample_keep_interval_ = keep_interval;
 }
 
 uint64_t LinuxTracingGrpcHandler::InternCallstackIfNecessaryAndGetKey(
     Callstack callstack) {
-  uint64_t key = ComputeCallstackKey(callstack);
-  {
-    absl::MutexLock lock{&callstack_keys_sent_mutex_};
-    if (callstack_keys_sent_.contains(key)) {
-      return key;
-    }
-    callstack_keys_sent_.emplace(key);
+  // flight_recorder_ is only set in Start, before the Tracer is started.
+  // The FlightRecorder assigns the keys itself, as it drops the callstacks no
+  // longer referenced while the intern table never does.
+  if (flight_recorder_ != nullptr) {
+    return flight_recorder_->InternCallstack(std::move(callstack));
+  }
+  auto [key, inserted] = callstack_intern_table_.Intern(callstack);
+  if (!inserted) {
+    return key;
   }
 
   CaptureEvent event;
   event.mutable_interned_callstack()->set_key(key);
   *event.mutable_interned_callstack()->mutable_intern() = std::move(callstack);
-  {
-    absl::MutexLock lock{&event_buffer_mutex_};
-    event_buffer_.emplace_back(std::move(event));
-  }
+  // Not through the producer buffer, see SenderThread.
+  BufferEventNow(std::move(event));
   return key;
 }
 
-uint64_t LinuxTracingGrpcHandler::ComputeStringKey(const std::string& str) {
-  return std::hash<std::string>{}(str);
-}
-
 uint64_t LinuxTracingGrpcHandler::InternStringIfNecessaryAndGetKey(
     std::string str) {
-  uint64_t key = ComputeStringKey(str);
-  {
-    absl::MutexLock lock{&string_keys_sent_mutex_};
-    if (string_keys_sent_.contains(key)) {
-      return key;
-    }
-    string_keys_sent_.emplace(key);
+  if (flight_recorder_ != nullptr) {
+    return flight_recorder_->InternString(std::move(str));
+  }
+  auto [key, inserted] = string_intern_table_.Intern(str);
+  if (!inserted) {
+    return key;
   }
 
   CaptureEvent event;
   event.mutable_interned_string()->set_key(key);
   event.mutable_interned_string()->set_intern(std::move(str));
-  {
-    absl::MutexLock lock{&event_buffer_mutex_};
-    event_buffer_.emplace_back(std::move(event));
-  }
+  // Not through the producer buffer, see SenderThread.
+  BufferEventNow(std::move(event));
   return key;
 }
 
@@ -178,42 +485,173 @@ void LinuxTracingGrpcHandler::SenderThread() {
   // a few more events are likely to arrive after the condition becomes true.
   constexpr uint64_t kSendEventCountInterval = 5000;
 
+  auto append_batches = [](StreamBatches* batches,
+                           StreamBatches&& more_batches) {
+    for (size_t i = 0; i < batches->size(); ++i) {
+      (*batches)[i].insert((*batches)[i].end(),
+                           std::make_move_iterator(more_batches[i].begin()),
+                           std::make_move_iterator(more_batches[i].end()));
+    }
+  };
+
   bool stopped = false;
   while (!stopped) {
+    // The batches of the producers are taken before event_buffer_, so that
+    // the InternedCallstacks and InternedStrings their events refer to, which
+    // are added to event_buffer_ directly, are taken too.
+    StreamBatches producer_batches = TakeProducerBatches();
     event_buffer_mutex_.LockWhenWithTimeout(
         absl::Condition(
             +[](LinuxTracingGrpcHandler* self) {
-              return self->event_buffer_.size() >= kSendEventCountInterval ||
-                     self->tracer_ == nullptr;
+              return self->buffered_event_count_ >= kSendEventCountInterval ||
+                     self->tracer_ == nullptr || self->snapshot_requested_;
             },
             this),
         kSendTimeInterval);
     if (tracer_ == nullptr) {
       stopped = true;
     }
+    if (callstack_sample_aggregator_ != nullptr) {
+      std::vector<AggregatedCallstackSamples> buckets =
+          stopped ? callstack_sample_aggregator_->TakeAllBuckets()
+                  : callstack_sample_aggregator_->TakeBucketsEndingBefore(
+                        OrbitTicks(CLOCK_MONOTONIC) -
+                        kAggregatedBucketSendDelayNs);
+      for (AggregatedCallstackSamples& bucket : buckets) {
+        CaptureEvent event;
+        *event.mutable_aggregated_callstack_samples() = std::move(bucket);
+        event_buffer_.emplace_back(std::move(event));
+      }
+    }
+    UpdateCallstackSampleKeepInterval();
     std::vector<CaptureEvent> buffered_events = std::move(event_buffer_);
     event_buffer_.clear();
+    StreamBatches batches = std::move(full_batches_);
+    full_batches_ = StreamBatches(GetStreamCount());
+    buffered_event_count_ = 0;
+    if (trigger_snapshot_time_.has_value() &&
+        absl::Now() >= trigger_snapshot_time_.value()) {
+      snapshot_requested_ = true;
+      trigger_snapshot_time_.reset();
+      trigger_pending_ = false;
+    }
+    bool snapshot_requested = snapshot_requested_;
+    snapshot_requested_ = false;
     event_buffer_mutex_.Unlock();
-    SendBufferedEvents(std::move(buffered_events));
+
+    append_batches(&batches, std::move(producer_batches));
+    if (stopped) {
+      // The Tracer is stopped: these are the last events of the producers.
+      append_batches(&batches, TakeProducerBatches());
+    }
+
+    if (flight_recorder_ == nullptr) {
+      // With separate streams, every stream gets a response, even if empty, so
+      // that the client knows when it has received all the responses sent
+      // before send_timestamp_ns.
+      uint64_t send_timestamp_ns =
+          event_stream_queues_.empty() ? 0 : OrbitTicks(CLOCK_MONOTONIC);
+      bool sent =
+          SendBufferedEvents(std::move(buffered_events), send_timestamp_ns);
+      for (const std::unique_ptr<CaptureEventBatch>& batch : batches[0]) {
+        sent = SendBatch(batch.get(), send_timestamp_ns) || sent;
+      }
+      if (!sent && send_timestamp_ns != 0) {
+        CaptureResponse response;
+        response.set_send_timestamp_ns(send_timestamp_ns);
+        reader_writer_->Write(response);
+      }
+      RecycleBatches(std::move(batches[0]));
+      for (size_t i = 0; i < event_stream_queues_.size(); ++i) {
+        std::vector<std::unique_ptr<CaptureEventBatch>>& stream_batches =
+            batches[i + 1];
+        if (stream_batches.empty()) {
+          stream_batches.emplace_back(GetSpareBatch());
+        }
+        for (std::unique_ptr<CaptureEventBatch>& batch : stream_batches) {
+          batch->GetResponse()->set_send_timestamp_ns(send_timestamp_ns);
+          event_stream_queues_[i]->Push(std::move(batch));
+        }
+        RecycleBatches(event_stream_queues_[i]->TakeWrittenBatches());
+      }
+      continue;
+    }
+    // The flight recorder keeps events for a long time, so they are copied
+    // out of the batches. There are no separate streams.
+    for (const std::unique_ptr<CaptureEventBatch>& batch : batches[0]) {
+      for (CaptureEvent& event :
+           *batch->GetResponse()->mutable_capture_events()) {
+        buffered_events.emplace_back(std::move(event));
+      }
+    }
+    RecycleBatches(std::move(batches[0]));
+    flight_recorder_->AddEvents(std::move(buffered_events));
+    if (snapshot_requested) {
+      SendBufferedEvents(flight_recorder_->GetSnapshot(),
+                         /*send_timestamp_ns=*/0);
+    }
+  }
+  for (const std::shared_ptr<EventStreamQueue>& queue : event_stream_queues_) {
+    queue->Close();
+  }
+  LOG("Capture sent: %s", compression_stats_.ToString());
+  if (dropped_event_count_ > 0) {
+    LOG("Dropped %lu events because the buffer was full",
+        dropped_event_count_.load());
   }
 }
 
-void LinuxTracingGrpcHandler::SendBufferedEvents(
-    std::vector<CaptureEvent>&& buffered_events) {
+bool LinuxTracingGrpcHandler::SendBufferedEvents(
+    std::vector<CaptureEvent>&& buffered_events, uint64_t send_timestamp_ns) {
   if (buffered_events.empty()) {
-    return;
+    return false;
   }
   constexpr uint64_t kMaxEventsPerResponse = 10'000;
   CaptureResponse response;
+  response.set_send_timestamp_ns(send_timestamp_ns);
+  uint64_t response_event_count = 0;
+  // The batch goes last in the response, after the InternedCallstacks its
+  // calls might refer to.
+  FunctionCallBatchBuilder function_call_batch_builder;
+  auto write_response = [&] {
+    if (!function_call_batch_builder.IsEmpty()) {
+      *response.add_capture_events()->mutable_function_call_batch() =
+          function_call_batch_builder.Build();
+    }
+    compression_stats_.AddResponse(response);
+    reader_writer_->Write(response);
+    response.clear_capture_events();
+    response_event_count = 0;
+  };
   for (CaptureEvent& event : buffered_events) {
     // We buffer to avoid sending countless tiny messages, but we also want to
     // avoid huge messages, which would cause the capture on the client to jump
     // forward in time in few big steps and not look live anymore.
-    if (response.capture_events_size() == kMaxEventsPerResponse) {
-      reader_writer_->Write(response);
-      response.clear_capture_events();
+    if (response_event_count == kMaxEventsPerResponse) {
+      write_response();
+    }
+    ++response_event_count;
+    if (batch_function_calls_ && event.has_function_call()) {
+      function_call_batch_builder.AddFunctionCall(event.function_call());
+      continue;
     }
     response.mutable_capture_events()->Add(std::move(event));
   }
-  reader_writer_->Write(response);
+  write_response();
+  return true;
+}
+
+bool LinuxTracingGrpcHandler::SendBatch(CaptureEventBatch* batch,
+                                        uint64_t send_timestamp_ns) {
+  CaptureResponse* response = batch->GetResponse();
+  if (response->capture_events().empty()) {
+    return false;
+  }
+  response->set_send_timestamp_ns(send_timestamp_ns);
+  if (batch_function_calls_) {
+    PackFunctionCalls(response->mutable_capture_events());
+  }
+  compression_stats_.AddResponse(*response);
+  reader_writer_->Write(*response);
+  return true;
 }
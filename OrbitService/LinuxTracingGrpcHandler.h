@@ -9,8 +9,23 @@
 #include <OrbitLinuxTracing/Tracer.h>
 #include <OrbitLinuxTracing/TracerListener.h>
 
+#include <array>
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "CallstackSampleAggregator.h"
+#include "CaptureEventBatch.h"
+#include "CaptureTriggers.h"
+#include "CompressionStats.h"
+#include "EventStreamQueue.h"
+#include "FlightRecorder.h"
+#include "InternTable.h"
 #include "absl/container/flat_hash_set.h"
 #include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
 #include "services.grpc.pb.h"
 
 class LinuxTracingGrpcHandler : public LinuxTracing::TracerListener {
@@ -25,8 +40,16 @@ class LinuxTracingGrpcHandler : public LinuxTracing::TracerListener {
   LinuxTracingGrpcHandler(LinuxTracingGrpcHandler&&) = delete;
   LinuxTracingGrpcHandler& operator=(LinuxTracingGrpcHandler&&) = delete;
 
+  // Must be called before Start. Returns the queues of the
+  // CaptureOptions::separate_stream_categories of the capture, which the
+  // CaptureEventStream calls write. None for flight-recorder captures.
+  std::vector<std::shared_ptr<EventStreamQueue>> CreateEventStreamQueues(
+      const CaptureOptions& capture_options);
   void Start(CaptureOptions capture_options);
   void Stop();
+  // Only meaningful for flight-recorder captures: sends all the events
+  // currently recorded.
+  void RequestSnapshot();
 
   void OnSchedulingSlice(SchedulingSlice scheduling_slice) override;
   void OnCallstackSample(CallstackSample callstack_sample) override;
@@ -34,29 +57,141 @@ class LinuxTracingGrpcHandler : public LinuxTracing::TracerListener {
   void OnGpuJob(GpuJob gpu_job) override;
   void OnThreadName(ThreadName thread_name) override;
   void OnAddressInfo(AddressInfo address_info) override;
+  void OnSystemCall(SystemCall system_call) override;
+  void OnFutexWait(FutexWait futex_wait) override;
+  void OnCounterSample(CounterSample counter_sample) override;
+  void OnTracerStats(TracerStats tracer_stats) override;
+  void OnLostEventsGap(LostEventsGap lost_events_gap) override;
+  void OnFunctionInstrumentationDisabled(
+      FunctionInstrumentationDisabled function_instrumentation_disabled)
+      override;
+  void OnManualInstrumentationScope(
+      ManualInstrumentationScope manual_instrumentation_scope) override;
 
  private:
   grpc::ServerReaderWriter<CaptureResponse, CaptureRequest>* reader_writer_;
   std::unique_ptr<LinuxTracing::Tracer> tracer_;
 
-  static uint64_t ComputeCallstackKey(const Callstack& callstack);
   uint64_t InternCallstackIfNecessaryAndGetKey(Callstack callstack);
-  static uint64_t ComputeStringKey(const std::string& str);
   uint64_t InternStringIfNecessaryAndGetKey(std::string str);
 
-  absl::flat_hash_set<uint64_t> addresses_seen_;
+  // Keyed by pid and absolute address.
+  absl::flat_hash_set<std::pair<int32_t, uint64_t>> addresses_seen_;
   absl::Mutex addresses_seen_mutex_;
-  absl::flat_hash_set<uint64_t> callstack_keys_sent_;
-  absl::Mutex callstack_keys_sent_mutex_;
-  absl::flat_hash_set<uint64_t> string_keys_sent_;
-  absl::Mutex string_keys_sent_mutex_;
+  CallstackInternTable callstack_intern_table_;
+  StringInternTable string_intern_table_;
 
   void SenderThread();
-  void SendBufferedEvents(std::vector<CaptureEvent>&& buffered_events);
+  // send_timestamp_ns is only set with event_stream_queues_. Return whether a
+  // response was written.
+  bool SendBufferedEvents(std::vector<CaptureEvent>&& buffered_events,
+                          uint64_t send_timestamp_ns);
+  bool SendBatch(CaptureEventBatch* batch, uint64_t send_timestamp_ns);
+  // Only set in Start, before the SenderThread is started.
+  bool batch_function_calls_ = false;
+  // Only used by the SenderThread.
+  static constexpr uint64_t kCompressionStatsSampleInterval = 64;
+  CompressionStats compression_stats_{kCompressionStatsSampleInterval};
 
   std::vector<CaptureEvent> event_buffer_;
   absl::Mutex event_buffer_mutex_;
   std::thread sender_thread_;
+
+  // Stream 0 is the Capture call, stream i > 0 is written from
+  // event_stream_queues_[i - 1]. Only set before the Tracer is started.
+  std::vector<std::shared_ptr<EventStreamQueue>> event_stream_queues_;
+  std::array<size_t, CaptureOptions::StreamCategory_ARRAYSIZE>
+      stream_indices_{};
+  [[nodiscard]] size_t GetStreamCount() const {
+    return 1 + event_stream_queues_.size();
+  }
+  using StreamBatches =
+      std::vector<std::vector<std::unique_ptr<CaptureEventBatch>>>;
+
+  // Each thread producing events constructs them in the CaptureEventBatches of
+  // its own ProducerBuffer, one per stream. Full batches are moved to
+  // full_batches_, so that event_buffer_mutex_ is taken once per batch rather
+  // than once per event, and replaced with spare ones. The SenderThread also
+  // takes the partial batches of all the producers every time it sends.
+  // Batches that were sent are cleared and kept as spare, so that their memory
+  // is reused.
+  struct ProducerBuffer {
+    absl::Mutex mutex;
+    std::vector<std::unique_ptr<CaptureEventBatch>> batches;
+  };
+  ProducerBuffer* GetProducerBuffer();
+  StreamBatches TakeProducerBatches();
+  std::unique_ptr<CaptureEventBatch> GetSpareBatch();
+  void RecycleBatches(
+      std::vector<std::unique_ptr<CaptureEventBatch>>&& batches);
+  std::vector<std::unique_ptr<ProducerBuffer>> producer_buffers_;
+  absl::Mutex producer_buffers_mutex_;
+  static constexpr int kProducerBatchSize = 1000;
+  // Indexed by stream. Protected by event_buffer_mutex_.
+  StreamBatches full_batches_;
+  // Protected by spare_batches_mutex_.
+  std::vector<std::unique_ptr<CaptureEventBatch>> spare_batches_;
+  absl::Mutex spare_batches_mutex_;
+  static constexpr size_t kMaxSpareBatches = 4;
+  // Identifies the handler in the thread-local cache of GetProducerBuffer.
+  static std::atomic<uint64_t> next_id_;
+  const uint64_t id_ = next_id_++;
+  // The events in event_buffer_ and full_batches_, readable without
+  // event_buffer_mutex_.
+  std::atomic<uint64_t> buffered_event_count_ = 0;
+
+  // Constructs an event with set_event in the batch of the calling thread for
+  // the stream of category.
+  template <typename SetEvent>
+  void BufferEvent(CaptureOptions::StreamCategory category,
+                   SetEvent set_event);
+  // Adds event to event_buffer_ directly, first waiting for it to have room.
+  void BufferEventNow(CaptureEvent&& event);
+  // Requires event_buffer_mutex_ to be held.
+  void WaitForBufferSpace();
+  // For CallstackSamples and SchedulingSlices, which buffer_full_policy_ can
+  // drop to bound event_buffer_ without blocking the tracer.
+  bool ShouldDropLowPriorityEvent(bool is_callstack_sample);
+  // Requires event_buffer_mutex_ to be held.
+  void UpdateCallstackSampleKeepInterval();
+
+  // 0 for an unbounded event_buffer_. Only set in Start, before the Tracer is
+  // started.
+  uint64_t max_buffered_events_ = 0;
+  CaptureOptions::BufferFullPolicy buffer_full_policy_ =
+      CaptureOptions::kBlockProducers;
+  std::atomic<uint64_t> dropped_event_count_ = 0;
+  // Since the last TracerStats.
+  std::atomic<uint64_t> unreported_dropped_event_count_ = 0;
+  std::atomic<uint64_t> callstack_sample_count_ = 0;
+  // With kReduceSamplingRate, one CallstackSample out of this many is kept.
+  std::atomic<uint64_t> callstack_sample_keep_interval_ = 1;
+  static constexpr uint64_t kMaxCallstackSampleKeepInterval = 64;
+
+  // Set for flight-recorder captures, in which events are only sent when a
+  // snapshot is requested. Protected by event_buffer_mutex_ like tracer_.
+  std::unique_ptr<FlightRecorder> flight_recorder_;
+  bool snapshot_requested_ = false;
+
+  // Set when CaptureOptions::triggers is not empty, which also enables the
+  // flight recorder.
+  std::unique_ptr<CaptureTriggers> triggers_;
+  absl::Duration post_trigger_delay_;
+  // When the snapshot caused by the last trigger is due. Protected by
+  // event_buffer_mutex_.
+  std::optional<absl::Time> trigger_snapshot_time_;
+  // Set by the first trigger until its snapshot is requested. Further
+  // triggers are ignored until then, without taking event_buffer_mutex_, as
+  // with a low threshold every call to a function can be one.
+  std::atomic<bool> trigger_pending_ = false;
+  void OnTriggered(const std::string& description);
+
+  // Set when CaptureOptions::sample_aggregation_bucket_ns is not 0, except for
+  // flight-recorder captures. Protected by event_buffer_mutex_.
+  std::unique_ptr<CallstackSampleAggregator> callstack_sample_aggregator_;
+  // Samples reach the handler after a delay, so a bucket is only sent when
+  // this much time has passed since its end.
+  static constexpr uint64_t kAggregatedBucketSendDelayNs = 1'000'000'000;
 };
 
 #endif  // ORBIT_SERVICE_LINUX_TRACING_GRPC_HANDLER_H_
@@ -4,7 +4,10 @@
 
 #include "LinuxTracingHandler.h"
 
+#include <OrbitBase/Logging.h>
+
 #include "Callstack.h"
+#include "absl/base/casts.h"
 #include "absl/flags/flag.h"
 #include "llvm/Demangle/Demangle.h"
 
@@ -45,6 +48,7 @@ void LinuxTracingHandler::OnSchedulingSlice(SchedulingSlice scheduling_slice) {
 void LinuxTracingHandler::OnCallstackSample(CallstackSample callstack_sample) {
   CallStack cs;
   cs.m_ThreadId = callstack_sample.tid();
+  cs.m_ProcessId = callstack_sample.pid();
   CHECK(callstack_sample.callstack_or_key_case() ==
         CallstackSample::kCallstack);
   for (const auto& frame : callstack_sample.callstack().pcs()) {
@@ -68,6 +72,7 @@ void LinuxTracingHandler::OnCallstackSample(CallstackSample callstack_sample) {
 }
 
 void LinuxTracingHandler::OnFunctionCall(FunctionCall function_call) {
+  // Entry callstacks are only supported by LinuxTracingGrpcHandler.
   Timer timer;
   timer.m_TID = function_call.tid();
   timer.m_Start = function_call.begin_timestamp_ns();
@@ -149,12 +154,95 @@ void LinuxTracingHandler::OnAddressInfo(AddressInfo address_info) {
   // was able to extract from the binary while unwinding. The client can use it
   // to assign function/map names and to aggregate IPs by function for addresses
   // belonging to modules for which symbols haven't been loaded.
-  if (!addresses_seen_.contains(address_info.absolute_address())) {
+  if (addresses_seen_
+          .emplace(address_info.pid(), address_info.absolute_address())
+          .second) {
     LinuxAddressInfo linux_address_info{
         address_info.absolute_address(), address_info.map_name(),
         llvm::demangle(address_info.function_name()),
-        address_info.offset_in_function()};
+        address_info.offset_in_function(), address_info.pid()};
     tracing_buffer_->RecordAddressInfo(std::move(linux_address_info));
-    addresses_seen_.insert(address_info.absolute_address());
   }
 }
+
+void LinuxTracingHandler::OnSystemCall(SystemCall system_call) {
+  Timer timer;
+  timer.m_PID = system_call.pid();
+  timer.m_TID = system_call.tid();
+  timer.m_Start = system_call.begin_timestamp_ns();
+  timer.m_End = system_call.end_timestamp_ns();
+  timer.m_UserData[0] = system_call.syscall_number();
+  timer.m_UserData[1] = system_call.return_value();
+  timer.m_Type = Timer::SYSCALL;
+
+  tracing_buffer_->RecordTimer(std::move(timer));
+}
+
+void LinuxTracingHandler::OnFutexWait(FutexWait futex_wait) {
+  // The callstacks of the waiter and of the waker are only supported by
+  // LinuxTracingGrpcHandler, here we only record the wait itself.
+  Timer timer;
+  timer.m_PID = futex_wait.pid();
+  timer.m_TID = futex_wait.tid();
+  timer.m_Start = futex_wait.begin_timestamp_ns();
+  timer.m_End = futex_wait.end_timestamp_ns();
+  timer.m_UserData[0] = futex_wait.futex_address();
+  timer.m_Type = Timer::LOCK_WAIT;
+
+  tracing_buffer_->RecordTimer(std::move(timer));
+}
+
+void LinuxTracingHandler::OnCounterSample(CounterSample counter_sample) {
+  Timer timer;
+  timer.m_PID = counter_sample.pid();
+  timer.m_TID = counter_sample.tid();
+  timer.m_Start = counter_sample.timestamp_ns();
+  timer.m_End = counter_sample.timestamp_ns();
+  timer.m_UserData[0] = absl::bit_cast<uint64_t>(counter_sample.value());
+  CHECK(counter_sample.name_or_key_case() == CounterSample::kName);
+  timer.m_UserData[1] = ProcessStringAndGetKey(counter_sample.name());
+  timer.m_Type = Timer::COUNTER;
+
+  tracing_buffer_->RecordTimer(std::move(timer));
+}
+
+void LinuxTracingHandler::OnTracerStats(TracerStats /*tracer_stats*/) {
+  // Tracer statistics are only streamed to the client by
+  // LinuxTracingGrpcHandler. The tracer also logs them periodically.
+}
+
+void LinuxTracingHandler::OnLostEventsGap(LostEventsGap lost_events_gap) {
+  Timer timer;
+  timer.m_Start = lost_events_gap.begin_timestamp_ns();
+  timer.m_End = lost_events_gap.end_timestamp_ns();
+  timer.m_Processor = static_cast<int8_t>(lost_events_gap.cpu());
+  timer.m_UserData[0] = lost_events_gap.lost_count();
+  timer.m_UserData[1] = ProcessStringAndGetKey(lost_events_gap.buffer_name());
+  timer.m_Type = Timer::LOST_EVENTS;
+
+  tracing_buffer_->RecordTimer(std::move(timer));
+}
+
+void LinuxTracingHandler::OnFunctionInstrumentationDisabled(
+    FunctionInstrumentationDisabled function_instrumentation_disabled) {
+  // Only streamed to the client by LinuxTracingGrpcHandler.
+  LOG("Instrumentation of function at %#lx disabled: called %lu times per "
+      "second",
+      function_instrumentation_disabled.absolute_address(),
+      function_instrumentation_disabled.calls_per_second());
+}
+
+void LinuxTracingHandler::OnManualInstrumentationScope(
+    ManualInstrumentationScope manual_instrumentation_scope) {
+  Timer timer;
+  timer.m_PID = manual_instrumentation_scope.pid();
+  timer.m_TID = manual_instrumentation_scope.tid();
+  timer.m_Start = manual_instrumentation_scope.begin_timestamp_ns();
+  timer.m_End = manual_instrumentation_scope.end_timestamp_ns();
+  timer.m_Depth = static_cast<uint8_t>(manual_instrumentation_scope.depth());
+  timer.m_UserData[0] =
+      ProcessStringAndGetKey(manual_instrumentation_scope.name());
+  timer.m_Type = Timer::ZONE;
+
+  tracing_buffer_->RecordTimer(std::move(timer));
+}
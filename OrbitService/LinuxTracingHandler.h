@@ -39,6 +39,16 @@ class LinuxTracingHandler : public LinuxTracing::TracerListener {
   void OnGpuJob(GpuJob gpu_job) override;
   void OnThreadName(ThreadName thread_name) override;
   void OnAddressInfo(AddressInfo address_info) override;
+  void OnSystemCall(SystemCall system_call) override;
+  void OnFutexWait(FutexWait futex_wait) override;
+  void OnCounterSample(CounterSample counter_sample) override;
+  void OnTracerStats(TracerStats tracer_stats) override;
+  void OnLostEventsGap(LostEventsGap lost_events_gap) override;
+  void OnFunctionInstrumentationDisabled(
+      FunctionInstrumentationDisabled function_instrumentation_disabled)
+      override;
+  void OnManualInstrumentationScope(
+      ManualInstrumentationScope manual_instrumentation_scope) override;
 
  private:
   uint64_t ProcessStringAndGetKey(const std::string& string);
@@ -46,7 +56,8 @@ class LinuxTracingHandler : public LinuxTracing::TracerListener {
   LinuxTracingBuffer* tracing_buffer_;
   std::unique_ptr<LinuxTracing::Tracer> tracer_;
 
-  absl::flat_hash_set<uint64_t> addresses_seen_;
+  // Keyed by pid and absolute address.
+  absl::flat_hash_set<std::pair<int32_t, uint64_t>> addresses_seen_;
   absl::Mutex addresses_seen_mutex_;
   absl::flat_hash_set<uint64_t> callstack_hashes_seen_;
   absl::Mutex callstack_hashes_seen_mutex_;
@@ -20,7 +20,8 @@ namespace {
 
 class OrbitGrpcServerImpl final : public OrbitGrpcServer {
  public:
-  OrbitGrpcServerImpl() = default;
+  explicit OrbitGrpcServerImpl(const ProfileStore* profile_store)
+      : process_service_{profile_store} {}
   OrbitGrpcServerImpl(const OrbitGrpcServerImpl&) = delete;
   OrbitGrpcServerImpl& operator=(OrbitGrpcServerImpl&) = delete;
 
@@ -62,9 +63,9 @@ void OrbitGrpcServerImpl::Wait() { server_->Wait(); }
 }  // namespace
 
 std::unique_ptr<OrbitGrpcServer> OrbitGrpcServer::Create(
-    std::string_view server_address) {
+    std::string_view server_address, const ProfileStore* profile_store) {
   std::unique_ptr<OrbitGrpcServerImpl> server_impl =
-      std::make_unique<OrbitGrpcServerImpl>();
+      std::make_unique<OrbitGrpcServerImpl>(profile_store);
 
   server_impl->Init(server_address);
 
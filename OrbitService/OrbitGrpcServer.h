@@ -8,11 +8,13 @@
 #include <memory>
 #include <string>
 
+#include "ProfileStore.h"
+
 // Wrapper around GRPC server. This class takes care of registering
 // all GRPC services.
 //
 // Usage example:
-//   auto server = OrbitGrpcServer::Create("localhost:44744");
+//   auto server = OrbitGrpcServer::Create("localhost:44744", &profile_store);
 //   server->Wait();
 class OrbitGrpcServer {
  public:
@@ -24,9 +26,9 @@ class OrbitGrpcServer {
   virtual void Wait() = 0;
 
   // Creates a server listening specified address and registers all
-  // necessary services.
+  // necessary services. profile_store must outlive the server.
   static std::unique_ptr<OrbitGrpcServer> Create(
-      std::string_view server_address);
+      std::string_view server_address, const ProfileStore* profile_store);
 };
 
 #endif  // ORBIT_SERVICE_ORBIT_GRPC_SERVER_H_
@@ -13,6 +13,7 @@
 
 #include "OrbitBase/Logging.h"
 #include "OrbitGrpcServer.h"
+#include "ProfilingDaemon.h"
 
 static std::string ReadStdIn() {
   int tmp = fgetc(stdin);
@@ -39,7 +40,15 @@ void OrbitService::Run(std::atomic<bool>* exit_requested) {
   std::string grpc_address = absl::StrFormat("127.0.0.1:%d", grpc_port_);
   LOG("Starting GRPC server at %s", grpc_address);
   std::unique_ptr<OrbitGrpcServer> grpc_server;
-  grpc_server = OrbitGrpcServer::Create(grpc_address);
+  grpc_server = OrbitGrpcServer::Create(grpc_address, &profile_store_);
+
+  std::unique_ptr<ProfilingDaemon> profiling_daemon;
+  if (profiling_daemon_options_.has_value()) {
+    profiling_daemon = std::make_unique<ProfilingDaemon>(
+        profiling_daemon_options_->capture_options,
+        profiling_daemon_options_->bucket_duration, &profile_store_);
+    profiling_daemon->Start();
+  }
 
   // Make stdin non-blocking.
   fcntl(STDIN_FILENO, F_SETFL, O_NONBLOCK);
@@ -65,6 +74,10 @@ void OrbitService::Run(std::atomic<bool>* exit_requested) {
     std::this_thread::sleep_for(std::chrono::seconds{1});
   }
 
+  if (profiling_daemon != nullptr) {
+    profiling_daemon->Stop();
+  }
+
   grpc_server->Shutdown();
   grpc_server->Wait();
 }
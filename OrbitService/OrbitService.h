@@ -11,11 +11,24 @@
 #include <string>
 #include <utility>
 
+#include "ProfileStore.h"
+#include "absl/time/time.h"
 #include "capture.pb.h"
 
 class OrbitService {
  public:
-  explicit OrbitService(uint16_t grpc_port) : grpc_port_{grpc_port} {}
+  // Options of the continuous profiling daemon, which samples the processes in
+  // capture_options for as long as the service runs.
+  struct ProfilingDaemonOptions {
+    CaptureOptions capture_options;
+    absl::Duration bucket_duration;
+  };
+
+  OrbitService(uint16_t grpc_port, ProfileStore profile_store,
+               std::optional<ProfilingDaemonOptions> profiling_daemon_options)
+      : grpc_port_{grpc_port},
+        profile_store_{std::move(profile_store)},
+        profiling_daemon_options_{std::move(profiling_daemon_options)} {}
 
   void Run(std::atomic<bool>* exit_requested);
 
@@ -23,6 +36,8 @@ class OrbitService {
   bool IsSshWatchdogActive() { return last_stdin_message_ != std::nullopt; }
 
   uint16_t grpc_port_;
+  ProfileStore profile_store_;
+  std::optional<ProfilingDaemonOptions> profiling_daemon_options_;
 
   std::optional<std::chrono::time_point<std::chrono::steady_clock>>
       last_stdin_message_ = std::nullopt;
@@ -7,6 +7,8 @@
 #include <absl/strings/ascii.h>
 #include <absl/strings/numbers.h>
 #include <absl/strings/str_format.h>
+#include <google/protobuf/util/message_differencer.h>
+#include <unistd.h>
 
 #include <filesystem>
 #include <unordered_map>
@@ -15,17 +17,32 @@
 #include "OrbitBase/Logging.h"
 #include "Utils.h"
 
+namespace {
+
+double TicksToSeconds(uint64_t ticks) {
+  static const double kTicksPerSecond = sysconf(_SC_CLK_TCK);
+  return ticks / kTicksPerSecond;
+}
+
+// In percent of one core.
+double ComputeCpuUsage(uint64_t cpu_time_ticks, double elapsed_seconds) {
+  if (elapsed_seconds <= 0) return 0;
+  return 100 * TicksToSeconds(cpu_time_ticks) / elapsed_seconds;
+}
+
+}  // namespace
+
 outcome::result<void, std::string> ProcessList::Refresh() {
-  const auto cpu_result = LinuxUtils::GetCpuUtilization();
-  if (!cpu_result) {
+  const auto uptime_result = LinuxUtils::GetUptimeSeconds();
+  if (!uptime_result) {
     return outcome::failure(
-        absl::StrFormat("Unable to retrieve cpu usage of processes, error: %s",
-                        cpu_result.error().message()));
+        absl::StrFormat("Unable to retrieve uptime, error: %s",
+                        uptime_result.error().message()));
   }
-  std::unordered_map<int32_t, double> cpu_usage_map =
-      std::move(cpu_result.value());
+  const double uptime_seconds = uptime_result.value();
 
   std::vector<ProcessInfo> updated_processes;
+  std::vector<LinuxUtils::ProcessTimes> updated_process_times;
 
   for (const auto& directory_entry :
        std::filesystem::directory_iterator("/proc")) {
@@ -37,11 +54,20 @@ outcome::result<void, std::string> ProcessList::Refresh() {
     uint32_t pid;
     if (!absl::SimpleAtoi(folder_name, &pid)) continue;
 
-    auto iter = processes_map_.find(pid);
-    if (iter != processes_map_.end()) {
-      ProcessInfo& process(*(iter->second));
-      process.set_cpu_usage(cpu_usage_map[process.pid()]);
-      updated_processes.push_back(process);
+    // Fails when the process has exited in the meantime.
+    const auto times_result = LinuxUtils::GetProcessTimes(pid);
+    if (!times_result) continue;
+    const LinuxUtils::ProcessTimes& times = times_result.value();
+
+    auto iter = known_processes_.find(pid);
+    if (iter != known_processes_.end() &&
+        iter->second.start_time_ticks == times.start_time_ticks) {
+      ProcessInfo process = *iter->second.process;
+      process.set_cpu_usage(ComputeCpuUsage(
+          times.cpu_time_ticks - iter->second.cpu_time_ticks,
+          uptime_seconds - last_refresh_uptime_seconds_));
+      updated_processes.push_back(std::move(process));
+      updated_process_times.push_back(times);
       continue;
     }
 
@@ -60,7 +86,9 @@ outcome::result<void, std::string> ProcessList::Refresh() {
     ProcessInfo process;
     process.set_pid(pid);
     process.set_name(name);
-    process.set_cpu_usage(cpu_usage_map[pid]);
+    process.set_cpu_usage(ComputeCpuUsage(
+        times.cpu_time_ticks,
+        uptime_seconds - TicksToSeconds(times.start_time_ticks)));
 
     // "The command-line arguments appear [...] as a set of strings
     // separated by null bytes ('\0')".
@@ -79,22 +107,50 @@ outcome::result<void, std::string> ProcessList::Refresh() {
     std::replace(cmdline.begin(), cmdline.end(), '\0', ' ');
     process.set_command_line(cmdline);
 
-    const auto& is_64_bit_result = LinuxUtils::Is64Bit(pid);
-    if (!is_64_bit_result) {
-      ERROR("Failed to get if process \"%s\" (pid %d) is 64 bit, error: %s",
-            name.c_str(), pid, is_64_bit_result.error().message().c_str());
-      continue;
-    }
-    process.set_is_64_bit(is_64_bit_result.value());
+    // Kernel threads have no executable, and those of processes of other users
+    // can't be read without privileges: they are listed as 32 bit, as before.
+    const auto is_64_bit_result = LinuxUtils::Is64Bit(pid);
+    process.set_is_64_bit(is_64_bit_result && is_64_bit_result.value());
 
-    updated_processes.push_back(process);
+    updated_processes.push_back(std::move(process));
+    updated_process_times.push_back(times);
   }
 
   processes_ = std::move(updated_processes);
-  processes_map_.clear();
-  for (auto& process : processes_) {
-    processes_map_[process.pid()] = &process;
+  known_processes_.clear();
+  for (size_t i = 0; i < processes_.size(); ++i) {
+    known_processes_[processes_[i].pid()] = {
+        updated_process_times[i].start_time_ticks,
+        updated_process_times[i].cpu_time_ticks, &processes_[i]};
   }
+  last_refresh_uptime_seconds_ = uptime_seconds;
 
   return outcome::success();
 }
+
+WatchProcessListResponse DiffProcessLists(
+    const std::vector<ProcessInfo>& previous_processes,
+    const std::vector<ProcessInfo>& processes) {
+  std::unordered_map<int32_t, const ProcessInfo*> previous_processes_by_pid;
+  for (const ProcessInfo& process : previous_processes) {
+    previous_processes_by_pid[process.pid()] = &process;
+  }
+
+  WatchProcessListResponse response;
+  for (const ProcessInfo& process : processes) {
+    auto iter = previous_processes_by_pid.find(process.pid());
+    if (iter != previous_processes_by_pid.end()) {
+      bool unchanged = google::protobuf::util::MessageDifferencer::Equals(
+          *iter->second, process);
+      previous_processes_by_pid.erase(iter);
+      if (unchanged) continue;
+    }
+    *response.add_updated_processes() = process;
+  }
+  for (const ProcessInfo& process : previous_processes) {
+    if (previous_processes_by_pid.count(process.pid()) > 0) {
+      response.add_removed_pids(process.pid());
+    }
+  }
+  return response;
+}
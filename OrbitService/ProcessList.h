@@ -6,18 +6,40 @@
 #define ORBIT_SERVICE_PROCESS_LIST_
 
 #include <outcome.hpp>
+#include <unordered_map>
 #include <vector>
 
 #include "process.pb.h"
+#include "services.pb.h"
 
+// The processes of the system, read from /proc. The cpu usage of a process is
+// the time it ran since the previous refresh, or since it started if it was
+// not known then, in percent of one core, like top shows it. What doesn't
+// change during the lifetime of a process is only read the first time it is
+// seen, a process being identified by its pid and start time, as pids are
+// reused.
 class ProcessList {
  public:
   outcome::result<void, std::string> Refresh();
   const std::vector<ProcessInfo>& GetProcesses() { return processes_; }
 
  private:
+  struct KnownProcess {
+    uint64_t start_time_ticks;
+    uint64_t cpu_time_ticks;
+    const ProcessInfo* process;
+  };
+
   std::vector<ProcessInfo> processes_;
-  std::unordered_map<int32_t, ProcessInfo*> processes_map_;
+  std::unordered_map<int32_t, KnownProcess> known_processes_;
+  double last_refresh_uptime_seconds_ = 0;
 };
 
+// The update of ProcessService::WatchProcessList from previous_processes to
+// processes: the processes that are new or changed, and the pids of those that
+// are gone.
+WatchProcessListResponse DiffProcessLists(
+    const std::vector<ProcessInfo>& previous_processes,
+    const std::vector<ProcessInfo>& processes);
+
 #endif  // ORBIT_SERVICE_PROCESS_LIST_
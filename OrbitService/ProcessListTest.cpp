@@ -0,0 +1,67 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "ProcessList.h"
+
+namespace {
+
+ProcessInfo CreateProcess(int32_t pid, const std::string& name,
+                          double cpu_usage) {
+  ProcessInfo process;
+  process.set_pid(pid);
+  process.set_name(name);
+  process.set_cpu_usage(cpu_usage);
+  return process;
+}
+
+}  // namespace
+
+TEST(ProcessList, RefreshFindsSelf) {
+  ProcessList process_list;
+  for (int i = 0; i < 2; ++i) {
+    ASSERT_TRUE(process_list.Refresh());
+    const std::vector<ProcessInfo>& processes = process_list.GetProcesses();
+    auto self = std::find_if(
+        processes.begin(), processes.end(),
+        [](const ProcessInfo& process) { return process.pid() == getpid(); });
+    ASSERT_NE(self, processes.end());
+    EXPECT_FALSE(self->name().empty());
+    EXPECT_GE(self->cpu_usage(), 0);
+    EXPECT_EQ(self->is_64_bit(), sizeof(void*) == 8);
+  }
+}
+
+TEST(ProcessList, DiffFromEmptyContainsAllProcesses) {
+  std::vector<ProcessInfo> processes = {CreateProcess(1, "init", 0),
+                                        CreateProcess(2, "kthreadd", 0)};
+  WatchProcessListResponse response = DiffProcessLists({}, processes);
+  ASSERT_EQ(response.updated_processes_size(), 2);
+  EXPECT_EQ(response.updated_processes(0).pid(), 1);
+  EXPECT_EQ(response.updated_processes(1).pid(), 2);
+  EXPECT_EQ(response.removed_pids_size(), 0);
+}
+
+TEST(ProcessList, DiffContainsOnlyChanges) {
+  std::vector<ProcessInfo> previous_processes = {
+      CreateProcess(1, "init", 0), CreateProcess(2, "bash", 1),
+      CreateProcess(3, "gone", 0), CreateProcess(4, "old", 0)};
+  std::vector<ProcessInfo> processes = {
+      CreateProcess(1, "init", 0), CreateProcess(2, "bash", 5),
+      CreateProcess(4, "reused", 0), CreateProcess(5, "new", 0)};
+  WatchProcessListResponse response =
+      DiffProcessLists(previous_processes, processes);
+  ASSERT_EQ(response.updated_processes_size(), 3);
+  EXPECT_EQ(response.updated_processes(0).pid(), 2);
+  EXPECT_EQ(response.updated_processes(0).cpu_usage(), 5);
+  EXPECT_EQ(response.updated_processes(1).name(), "reused");
+  EXPECT_EQ(response.updated_processes(2).name(), "new");
+  ASSERT_EQ(response.removed_pids_size(), 1);
+  EXPECT_EQ(response.removed_pids(0), 3);
+}
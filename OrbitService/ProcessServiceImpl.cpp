@@ -4,12 +4,14 @@
 
 #include "ProcessServiceImpl.h"
 
+#include <algorithm>
 #include <memory>
 
 #include "LinuxUtils.h"
 #include "OrbitBase/Logging.h"
 #include "SymbolHelper.h"
 #include "Utils.h"
+#include "absl/time/clock.h"
 #include "symbol.pb.h"
 
 using grpc::ServerContext;
@@ -40,6 +42,50 @@ Status ProcessServiceImpl::GetProcessList(ServerContext*,
   return Status::OK;
 }
 
+Status ProcessServiceImpl::WatchProcessList(
+    ServerContext* context, const WatchProcessListRequest* request,
+    grpc::ServerWriter<WatchProcessListResponse>* writer) {
+  uint64_t refresh_interval_ms = request->refresh_interval_ms() == 0
+                                     ? kDefaultWatchProcessListIntervalMs
+                                     : request->refresh_interval_ms();
+  refresh_interval_ms =
+      std::max(refresh_interval_ms, kMinWatchProcessListIntervalMs);
+
+  // Not process_list_, so that the cpu usage is over the interval of this
+  // stream.
+  ProcessList process_list;
+  std::vector<ProcessInfo> previous_processes;
+  bool first_update = true;
+  while (!context->IsCancelled()) {
+    const auto refresh_result = process_list.Refresh();
+    if (!refresh_result) {
+      return Status(StatusCode::INTERNAL, refresh_result.error());
+    }
+
+    WatchProcessListResponse response =
+        DiffProcessLists(previous_processes, process_list.GetProcesses());
+    previous_processes = process_list.GetProcesses();
+    if (first_update || response.updated_processes_size() > 0 ||
+        response.removed_pids_size() > 0) {
+      if (!writer->Write(response)) {
+        break;
+      }
+      first_update = false;
+    }
+
+    // Sleep in small steps to notice when the client cancels.
+    const absl::Time next_refresh_time =
+        absl::Now() + absl::Milliseconds(refresh_interval_ms);
+    const absl::Duration max_sleep =
+        absl::Milliseconds(kMinWatchProcessListIntervalMs);
+    while (absl::Now() < next_refresh_time && !context->IsCancelled()) {
+      absl::SleepFor(std::min(next_refresh_time - absl::Now(), max_sleep));
+    }
+  }
+
+  return Status::OK;
+}
+
 Status ProcessServiceImpl::GetModuleList(ServerContext*,
                                          const GetModuleListRequest* request,
                                          GetModuleListResponse* response) {
@@ -99,3 +145,34 @@ Status ProcessServiceImpl::GetSymbols(ServerContext*,
 
   return Status::OK;
 }
+
+Status ProcessServiceImpl::ListProfiles(ServerContext*,
+                                        const ListProfilesRequest*,
+                                        ListProfilesResponse* response) {
+  auto profiles = profile_store_->List();
+  if (!profiles) {
+    return Status(StatusCode::INTERNAL, profiles.error());
+  }
+
+  for (ProfileInfo& profile : profiles.value()) {
+    *(response->add_profiles()) = std::move(profile);
+  }
+
+  return Status::OK;
+}
+
+Status ProcessServiceImpl::GetProfile(ServerContext*,
+                                      const GetProfileRequest* request,
+                                      GetProfileResponse* response) {
+  auto profile = profile_store_->Read(request->name());
+  if (!profile) {
+    return Status(StatusCode::NOT_FOUND, profile.error());
+  }
+
+  *response->mutable_profile() = std::move(profile.value());
+
+  LOG("Sending profile %s (size: %d bytes)", request->name(),
+      response->ByteSize());
+
+  return Status::OK;
+}
@@ -11,13 +11,22 @@
 #include <string>
 
 #include "ProcessList.h"
+#include "ProfileStore.h"
 #include "services.grpc.pb.h"
 
 class ProcessServiceImpl final : public ProcessService::Service {
  public:
+  // profile_store gives access to the profiles of the continuous profiling
+  // daemon and must outlive this object.
+  explicit ProcessServiceImpl(const ProfileStore* profile_store)
+      : profile_store_{profile_store} {}
+
   grpc::Status GetProcessList(grpc::ServerContext* context,
                               const GetProcessListRequest* request,
                               GetProcessListResponse* response) override;
+  grpc::Status WatchProcessList(
+      grpc::ServerContext* context, const WatchProcessListRequest* request,
+      grpc::ServerWriter<WatchProcessListResponse>* writer) override;
   grpc::Status GetSymbols(grpc::ServerContext* context,
                           const GetSymbolsRequest* request,
                           GetSymbolsResponse* response) override;
@@ -30,11 +39,22 @@ class ProcessServiceImpl final : public ProcessService::Service {
                                 const GetProcessMemoryRequest* request,
                                 GetProcessMemoryResponse* response) override;
 
+  grpc::Status ListProfiles(grpc::ServerContext* context,
+                            const ListProfilesRequest* request,
+                            ListProfilesResponse* response) override;
+
+  grpc::Status GetProfile(grpc::ServerContext* context,
+                          const GetProfileRequest* request,
+                          GetProfileResponse* response) override;
+
  private:
+  const ProfileStore* profile_store_;
   absl::Mutex mutex_;
   ProcessList process_list_;
 
   static constexpr size_t kMaxGetProcessMemoryResponseSize = 8 * 1024 * 1024;
+  static constexpr uint64_t kDefaultWatchProcessListIntervalMs = 1000;
+  static constexpr uint64_t kMinWatchProcessListIntervalMs = 100;
 };
 
 #endif  // ORBIT_SERVICE_PROCESS_SERVICE_IMPL_H_
@@ -0,0 +1,174 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ProfileStore.h"
+
+#include <algorithm>
+#include <fstream>
+
+#include "OrbitBase/Logging.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/string_view.h"
+#include "absl/strings/strip.h"
+
+namespace {
+constexpr absl::string_view kFileNamePrefix = "profile_";
+constexpr absl::string_view kFileNameSuffix = ".pb";
+}  // namespace
+
+std::string ProfileStore::GetFileName(uint64_t begin_unix_time_ns,
+                                      uint64_t end_unix_time_ns) {
+  return absl::StrFormat("%s%u_%u%s", kFileNamePrefix, begin_unix_time_ns,
+                         end_unix_time_ns, kFileNameSuffix);
+}
+
+std::optional<std::pair<uint64_t, uint64_t>> ProfileStore::ParseFileName(
+    const std::string& name) {
+  absl::string_view times = name;
+  if (!absl::ConsumePrefix(&times, kFileNamePrefix) ||
+      !absl::ConsumeSuffix(&times, kFileNameSuffix)) {
+    return std::nullopt;
+  }
+  std::vector<absl::string_view> begin_and_end = absl::StrSplit(times, '_');
+  uint64_t begin_unix_time_ns;
+  uint64_t end_unix_time_ns;
+  if (begin_and_end.size() != 2 ||
+      !absl::SimpleAtoi(begin_and_end[0], &begin_unix_time_ns) ||
+      !absl::SimpleAtoi(begin_and_end[1], &end_unix_time_ns)) {
+    return std::nullopt;
+  }
+  return std::make_pair(begin_unix_time_ns, end_unix_time_ns);
+}
+
+outcome::result<void, std::string> ProfileStore::Write(
+    const ProfileBucket& bucket) {
+  std::error_code error;
+  std::filesystem::create_directories(directory_, error);
+  if (error) {
+    return outcome::failure(
+        absl::StrFormat("Unable to create directory \"%s\": %s",
+                        directory_.string(), error.message()));
+  }
+
+  std::filesystem::path path =
+      directory_ / GetFileName(bucket.begin_unix_time_ns(),
+                               bucket.end_unix_time_ns());
+  // Write to a temporary file first, so that a profile that is being written
+  // is never listed or read.
+  std::filesystem::path temporary_path = path;
+  temporary_path += ".tmp";
+  {
+    std::ofstream file(temporary_path, std::ios::binary);
+    if (file.fail() || !bucket.SerializeToOstream(&file)) {
+      std::filesystem::remove(temporary_path, error);
+      return outcome::failure(absl::StrFormat(
+          "Unable to write profile \"%s\"", temporary_path.string()));
+    }
+  }
+  std::filesystem::rename(temporary_path, path, error);
+  if (error) {
+    return outcome::failure(absl::StrFormat("Unable to rename \"%s\": %s",
+                                            temporary_path.string(),
+                                            error.message()));
+  }
+
+  DeleteOldestProfilesOverBudget();
+  return outcome::success();
+}
+
+outcome::result<std::vector<ProfileInfo>, std::string> ProfileStore::List()
+    const {
+  std::vector<ProfileInfo> profiles;
+  std::error_code error;
+  if (!std::filesystem::exists(directory_, error)) {
+    return profiles;
+  }
+
+  std::filesystem::directory_iterator it(directory_, error);
+  if (error) {
+    return outcome::failure(
+        absl::StrFormat("Unable to list directory \"%s\": %s",
+                        directory_.string(), error.message()));
+  }
+  for (const std::filesystem::directory_entry& entry : it) {
+    std::string name = entry.path().filename().string();
+    std::optional<std::pair<uint64_t, uint64_t>> time_range =
+        ParseFileName(name);
+    if (!time_range.has_value() || !entry.is_regular_file(error)) {
+      continue;
+    }
+    uint64_t size = entry.file_size(error);
+    if (error) {
+      // The file might have been deleted in the meantime.
+      continue;
+    }
+
+    ProfileInfo profile;
+    profile.set_name(std::move(name));
+    profile.set_begin_unix_time_ns(time_range->first);
+    profile.set_end_unix_time_ns(time_range->second);
+    profile.set_size_bytes(size);
+    profiles.push_back(std::move(profile));
+  }
+
+  std::sort(profiles.begin(), profiles.end(),
+            [](const ProfileInfo& lhs, const ProfileInfo& rhs) {
+              return lhs.begin_unix_time_ns() < rhs.begin_unix_time_ns();
+            });
+  return profiles;
+}
+
+outcome::result<ProfileBucket, std::string> ProfileStore::Read(
+    const std::string& name) const {
+  // This also rejects names containing a path separator.
+  if (!ParseFileName(name).has_value()) {
+    return outcome::failure(
+        absl::StrFormat("\"%s\" is not a profile name", name));
+  }
+
+  std::filesystem::path path = directory_ / name;
+  std::ifstream file(path, std::ios::binary);
+  if (file.fail()) {
+    return outcome::failure(
+        absl::StrFormat("Unable to open profile \"%s\"", path.string()));
+  }
+  ProfileBucket bucket;
+  if (!bucket.ParseFromIstream(&file)) {
+    return outcome::failure(
+        absl::StrFormat("Unable to parse profile \"%s\"", path.string()));
+  }
+  return bucket;
+}
+
+void ProfileStore::DeleteOldestProfilesOverBudget() {
+  if (max_bytes_ == 0) {
+    return;
+  }
+  auto profiles = List();
+  if (!profiles) {
+    ERROR("%s", profiles.error());
+    return;
+  }
+
+  uint64_t total_bytes = 0;
+  for (const ProfileInfo& profile : profiles.value()) {
+    total_bytes += profile.size_bytes();
+  }
+  // The most recent profile is always kept, even if it alone exceeds the
+  // budget.
+  for (size_t i = 0;
+       i + 1 < profiles.value().size() && total_bytes > max_bytes_; ++i) {
+    const ProfileInfo& profile = profiles.value()[i];
+    std::error_code error;
+    std::filesystem::remove(directory_ / profile.name(), error);
+    if (error) {
+      ERROR("Unable to delete profile \"%s\": %s", profile.name(),
+            error.message());
+      continue;
+    }
+    total_bytes -= profile.size_bytes();
+  }
+}
@@ -0,0 +1,49 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_SERVICE_PROFILE_STORE_H_
+#define ORBIT_SERVICE_PROFILE_STORE_H_
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "outcome.hpp"
+#include "profile.pb.h"
+
+// Stores the ProfileBuckets of the continuous profiling daemon as one file per
+// bucket in a directory. The file name encodes the time range of the bucket,
+// so that the profiles can be listed without reading them. When the total size
+// of the files exceeds max_bytes, the oldest ones are deleted.
+class ProfileStore {
+ public:
+  // A max_bytes of 0 disables the disk budget.
+  explicit ProfileStore(std::filesystem::path directory, uint64_t max_bytes = 0)
+      : directory_{std::move(directory)}, max_bytes_{max_bytes} {}
+
+  outcome::result<void, std::string> Write(const ProfileBucket& bucket);
+  // Returns the stored profiles sorted by begin time.
+  [[nodiscard]] outcome::result<std::vector<ProfileInfo>, std::string> List()
+      const;
+  // name is as returned by List. Names that do not designate a profile file
+  // are rejected.
+  [[nodiscard]] outcome::result<ProfileBucket, std::string> Read(
+      const std::string& name) const;
+
+  [[nodiscard]] static std::string GetFileName(uint64_t begin_unix_time_ns,
+                                               uint64_t end_unix_time_ns);
+  // Returns the time range encoded in a file name created by GetFileName.
+  [[nodiscard]] static std::optional<std::pair<uint64_t, uint64_t>>
+  ParseFileName(const std::string& name);
+
+ private:
+  void DeleteOldestProfilesOverBudget();
+
+  std::filesystem::path directory_;
+  uint64_t max_bytes_;
+};
+
+#endif  // ORBIT_SERVICE_PROFILE_STORE_H_
@@ -0,0 +1,109 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <filesystem>
+#include <fstream>
+
+#include "ProfileStore.h"
+#include "absl/strings/str_format.h"
+
+namespace {
+
+class ProfileStoreTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    directory_ = std::filesystem::temp_directory_path() /
+                 absl::StrFormat("ProfileStoreTest_%d", getpid());
+    std::filesystem::remove_all(directory_);
+  }
+
+  void TearDown() override { std::filesystem::remove_all(directory_); }
+
+  static ProfileBucket MakeBucket(uint64_t begin_unix_time_ns,
+                                  uint64_t end_unix_time_ns, uint64_t count) {
+    ProfileBucket bucket;
+    bucket.set_begin_unix_time_ns(begin_unix_time_ns);
+    bucket.set_end_unix_time_ns(end_unix_time_ns);
+    ProfileBucket::CallstackCount* callstack_count =
+        bucket.add_callstack_counts();
+    callstack_count->set_pid(42);
+    callstack_count->mutable_callstack()->add_pcs(0x10);
+    callstack_count->set_count(count);
+    return bucket;
+  }
+
+  std::filesystem::path directory_;
+};
+
+}  // namespace
+
+TEST(ProfileStore, ParseFileName) {
+  std::string name = ProfileStore::GetFileName(100, 200);
+  auto time_range = ProfileStore::ParseFileName(name);
+  ASSERT_TRUE(time_range.has_value());
+  EXPECT_EQ(time_range->first, 100);
+  EXPECT_EQ(time_range->second, 200);
+
+  EXPECT_FALSE(ProfileStore::ParseFileName("profile_100.pb").has_value());
+  EXPECT_FALSE(ProfileStore::ParseFileName("profile_1_2.pb.tmp").has_value());
+  EXPECT_FALSE(ProfileStore::ParseFileName("../profile_1_2.pb").has_value());
+}
+
+TEST_F(ProfileStoreTest, WriteListAndRead) {
+  ProfileStore store{directory_};
+  ASSERT_TRUE(store.List());
+  EXPECT_TRUE(store.List().value().empty());
+
+  ASSERT_TRUE(store.Write(MakeBucket(300, 400, 2)));
+  ASSERT_TRUE(store.Write(MakeBucket(100, 200, 1)));
+  // Files that are not profiles are ignored.
+  std::ofstream(directory_ / "other.txt") << "other";
+
+  auto profiles = store.List();
+  ASSERT_TRUE(profiles);
+  ASSERT_EQ(profiles.value().size(), 2);
+  EXPECT_EQ(profiles.value()[0].begin_unix_time_ns(), 100);
+  EXPECT_EQ(profiles.value()[0].end_unix_time_ns(), 200);
+  EXPECT_GT(profiles.value()[0].size_bytes(), 0);
+  EXPECT_EQ(profiles.value()[1].begin_unix_time_ns(), 300);
+
+  auto bucket = store.Read(profiles.value()[1].name());
+  ASSERT_TRUE(bucket);
+  EXPECT_EQ(bucket.value().begin_unix_time_ns(), 300);
+  ASSERT_EQ(bucket.value().callstack_counts_size(), 1);
+  EXPECT_EQ(bucket.value().callstack_counts(0).count(), 2);
+
+  EXPECT_FALSE(store.Read("other.txt"));
+  EXPECT_FALSE(store.Read(ProfileStore::GetFileName(500, 600)));
+}
+
+TEST_F(ProfileStoreTest, DeletesOldestProfilesOverBudget) {
+  uint64_t bucket_size = MakeBucket(1000, 2000, 1).ByteSizeLong();
+  ProfileStore store{directory_, 2 * bucket_size};
+
+  ASSERT_TRUE(store.Write(MakeBucket(1000, 2000, 1)));
+  ASSERT_TRUE(store.Write(MakeBucket(2000, 3000, 1)));
+  ASSERT_TRUE(store.Write(MakeBucket(3000, 4000, 1)));
+
+  auto profiles = store.List();
+  ASSERT_TRUE(profiles);
+  ASSERT_EQ(profiles.value().size(), 2);
+  EXPECT_EQ(profiles.value()[0].begin_unix_time_ns(), 2000);
+  EXPECT_EQ(profiles.value()[1].begin_unix_time_ns(), 3000);
+}
+
+TEST_F(ProfileStoreTest, KeepsLatestProfileOverBudget) {
+  ProfileStore store{directory_, 1};
+
+  ASSERT_TRUE(store.Write(MakeBucket(100, 200, 1)));
+  ASSERT_TRUE(store.Write(MakeBucket(200, 300, 1)));
+
+  auto profiles = store.List();
+  ASSERT_TRUE(profiles);
+  ASSERT_EQ(profiles.value().size(), 1);
+  EXPECT_EQ(profiles.value()[0].begin_unix_time_ns(), 200);
+}
@@ -0,0 +1,120 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ProfilingDaemon.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "OrbitBase/Logging.h"
+#include "Profiling.h"
+
+void ProfilingDaemon::Start() {
+  CHECK(tracer_ == nullptr);
+  CHECK(bucket_duration_ns_ > 0);
+  LOG("Starting continuous profiling with buckets of %lu s",
+      bucket_duration_ns_ / 1'000'000'000);
+
+  unix_time_minus_monotonic_ns_ =
+      absl::ToUnixNanos(absl::Now()) - OrbitTicks(CLOCK_MONOTONIC);
+  {
+    absl::MutexLock lock(&stop_mutex_);
+    stop_requested_ = false;
+  }
+  writer_thread_ = std::thread{[this] { WriterThread(); }};
+
+  tracer_ = std::make_unique<LinuxTracing::Tracer>(capture_options_);
+  tracer_->SetListener(this);
+  tracer_->Start();
+}
+
+void ProfilingDaemon::Stop() {
+  if (tracer_ == nullptr) {
+    return;
+  }
+  tracer_->Stop();
+  tracer_.reset();
+
+  {
+    absl::MutexLock lock(&stop_mutex_);
+    stop_requested_ = true;
+  }
+  writer_thread_.join();
+
+  WriteBucketsEndingBefore(std::numeric_limits<uint64_t>::max());
+  LOG("Stopped continuous profiling");
+}
+
+void ProfilingDaemon::OnCallstackSample(CallstackSample callstack_sample) {
+  CHECK(callstack_sample.callstack_or_key_case() ==
+        CallstackSample::kCallstack);
+  uint64_t unix_time_ns =
+      callstack_sample.timestamp_ns() + unix_time_minus_monotonic_ns_;
+  uint64_t bucket_begin_unix_time_ns =
+      unix_time_ns - unix_time_ns % bucket_duration_ns_;
+
+  absl::MutexLock lock(&mutex_);
+  ProfileBucketBuilder& bucket = buckets_[bucket_begin_unix_time_ns];
+  bucket.AddCallstackSamples(callstack_sample.pid(),
+                             callstack_sample.callstack(), 1);
+  for (uint64_t pc : callstack_sample.callstack().pcs()) {
+    auto address_info_it =
+        address_infos_.find(std::make_pair(callstack_sample.pid(), pc));
+    if (address_info_it != address_infos_.end()) {
+      bucket.AddAddressInfo(address_info_it->second);
+    }
+  }
+}
+
+void ProfilingDaemon::OnAddressInfo(AddressInfo address_info) {
+  absl::MutexLock lock(&mutex_);
+  std::pair<int32_t, uint64_t> pid_and_address =
+      std::make_pair(address_info.pid(), address_info.absolute_address());
+  address_infos_.try_emplace(pid_and_address, std::move(address_info));
+}
+
+void ProfilingDaemon::WriterThread() {
+  while (true) {
+    if (stop_mutex_.LockWhenWithTimeout(
+            absl::Condition(&stop_requested_), kWritePeriod)) {
+      stop_mutex_.Unlock();
+      return;
+    }
+    stop_mutex_.Unlock();
+
+    WriteBucketsEndingBefore(absl::ToUnixNanos(absl::Now() - kWriteDelay));
+  }
+}
+
+void ProfilingDaemon::WriteBucketsEndingBefore(uint64_t end_unix_time_ns) {
+  // The bucket that is still being aggregated when stopping ends now, so that
+  // it does not overwrite the file of the same bucket after a restart.
+  uint64_t now_unix_time_ns = absl::ToUnixNanos(absl::Now());
+  std::vector<ProfileBucket> buckets_to_write;
+  {
+    absl::MutexLock lock(&mutex_);
+    while (!buckets_.empty()) {
+      auto bucket_it = buckets_.begin();
+      uint64_t bucket_begin_unix_time_ns = bucket_it->first;
+      uint64_t bucket_end_unix_time_ns =
+          bucket_begin_unix_time_ns + bucket_duration_ns_;
+      if (bucket_end_unix_time_ns > end_unix_time_ns) {
+        break;
+      }
+      buckets_to_write.push_back(bucket_it->second.Build(
+          bucket_begin_unix_time_ns,
+          std::min(bucket_end_unix_time_ns, now_unix_time_ns)));
+      buckets_.erase(bucket_it);
+    }
+  }
+
+  // Writing can take a while, so it happens outside of mutex_ to not block
+  // the tracer.
+  for (const ProfileBucket& bucket : buckets_to_write) {
+    auto result = profile_store_->Write(bucket);
+    if (!result) {
+      ERROR("Writing profile: %s", result.error());
+    }
+  }
+}
@@ -0,0 +1,94 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_SERVICE_PROFILING_DAEMON_H_
+#define ORBIT_SERVICE_PROFILING_DAEMON_H_
+
+#include <OrbitLinuxTracing/Tracer.h>
+#include <OrbitLinuxTracing/TracerListener.h>
+
+#include <map>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "ProfileBucketBuilder.h"
+#include "ProfileStore.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "capture.pb.h"
+
+// Samples the callstacks of the processes in capture_options, with no client
+// attached, and aggregates the samples into buckets of bucket_duration aligned
+// on wall-clock time. Each bucket is written to profile_store once it is
+// complete, so that a client can fetch the profiles later through
+// ProcessService. Only callstack samples and their address infos are used.
+class ProfilingDaemon : public LinuxTracing::TracerListener {
+ public:
+  ProfilingDaemon(CaptureOptions capture_options,
+                  absl::Duration bucket_duration, ProfileStore* profile_store)
+      : capture_options_{std::move(capture_options)},
+        bucket_duration_ns_{static_cast<uint64_t>(
+            absl::ToInt64Nanoseconds(bucket_duration))},
+        profile_store_{profile_store} {}
+
+  ~ProfilingDaemon() override { Stop(); }
+  ProfilingDaemon(const ProfilingDaemon&) = delete;
+  ProfilingDaemon& operator=(const ProfilingDaemon&) = delete;
+  ProfilingDaemon(ProfilingDaemon&&) = delete;
+  ProfilingDaemon& operator=(ProfilingDaemon&&) = delete;
+
+  void Start();
+  // Also writes the incomplete bucket that was being aggregated, with the
+  // current time as end.
+  void Stop();
+
+  void OnSchedulingSlice(SchedulingSlice) override {}
+  void OnCallstackSample(CallstackSample callstack_sample) override;
+  void OnFunctionCall(FunctionCall) override {}
+  void OnGpuJob(GpuJob) override {}
+  void OnThreadName(ThreadName) override {}
+  void OnAddressInfo(AddressInfo address_info) override;
+  void OnSystemCall(SystemCall) override {}
+  void OnFutexWait(FutexWait) override {}
+  void OnCounterSample(CounterSample) override {}
+  void OnTracerStats(TracerStats) override {}
+  void OnLostEventsGap(LostEventsGap) override {}
+  void OnFunctionInstrumentationDisabled(
+      FunctionInstrumentationDisabled) override {}
+  void OnManualInstrumentationScope(ManualInstrumentationScope) override {}
+
+ private:
+  void WriterThread();
+  // Writes the buckets that end before end_unix_time_ns.
+  void WriteBucketsEndingBefore(uint64_t end_unix_time_ns);
+
+  CaptureOptions capture_options_;
+  uint64_t bucket_duration_ns_;
+  ProfileStore* profile_store_;
+  std::unique_ptr<LinuxTracing::Tracer> tracer_;
+
+  // Converts the CLOCK_MONOTONIC timestamps of the samples to wall-clock time.
+  uint64_t unix_time_minus_monotonic_ns_ = 0;
+
+  absl::Mutex mutex_;
+  // Keyed by the wall-clock begin time of each bucket.
+  std::map<uint64_t, ProfileBucketBuilder> buckets_;
+  // Keyed by pid and absolute address.
+  absl::flat_hash_map<std::pair<int32_t, uint64_t>, AddressInfo>
+      address_infos_;
+
+  absl::Mutex stop_mutex_;
+  bool stop_requested_ = false;
+  std::thread writer_thread_;
+
+  // Samples reach the listener after a delay, so a bucket is only written when
+  // this much time has passed since its end.
+  static constexpr absl::Duration kWriteDelay = absl::Seconds(5);
+  static constexpr absl::Duration kWritePeriod = absl::Seconds(1);
+};
+
+#endif  // ORBIT_SERVICE_PROFILING_DAEMON_H_
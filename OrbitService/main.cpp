@@ -2,8 +2,12 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include <algorithm>
 #include <csignal>
 #include <iostream>
+#include <optional>
+#include <string>
+#include <vector>
 
 #include "OrbitBase/Logging.h"
 #include "OrbitService.h"
@@ -11,11 +15,31 @@
 #include "absl/flags/flag.h"
 #include "absl/flags/parse.h"
 #include "absl/flags/usage.h"
+#include "absl/strings/numbers.h"
+#include "absl/time/time.h"
+#include "capture.pb.h"
 
 ABSL_FLAG(uint64_t, grpc_port, 44765, "Grpc server port");
 
 ABSL_FLAG(bool, devmode, false, "Enable developer mode");
 
+ABSL_FLAG(std::vector<std::string>, profile_pids, {},
+          "Comma-separated pids of processes to continuously profile, with "
+          "no client attached");
+ABSL_FLAG(bool, profile_system_wide, false,
+          "Continuously profile all processes, with no client attached");
+ABSL_FLAG(double, profile_sampling_rate, 10.0,
+          "Frequency of callstack sampling in samples per second for "
+          "continuous profiling");
+ABSL_FLAG(uint32_t, profile_bucket_s, 60,
+          "Duration in seconds of the time buckets samples are aggregated into "
+          "for continuous profiling");
+ABSL_FLAG(std::string, profile_dir, "/var/lib/OrbitService/profiles",
+          "Directory the continuous profiling profiles are written to");
+ABSL_FLAG(uint32_t, profile_max_mb, 256,
+          "Disk budget in MB of the continuous profiling profiles, beyond "
+          "which the oldest ones are deleted");
+
 namespace {
 std::atomic<bool> exit_requested;
 
@@ -33,6 +57,42 @@ void install_sigint_handler() {
   act.sa_restorer = nullptr;
   sigaction(SIGINT, &act, nullptr);
 }
+
+std::optional<OrbitService::ProfilingDaemonOptions>
+GetProfilingDaemonOptions() {
+  CaptureOptions capture_options;
+  bool system_wide = absl::GetFlag(FLAGS_profile_system_wide);
+  capture_options.set_system_wide(system_wide);
+  bool has_pid = false;
+  for (const std::string& pid_str : absl::GetFlag(FLAGS_profile_pids)) {
+    int32_t pid;
+    if (!absl::SimpleAtoi(pid_str, &pid)) {
+      ERROR("Invalid pid in --profile_pids: \"%s\"", pid_str);
+      continue;
+    }
+    if (!has_pid) {
+      capture_options.set_pid(pid);
+      has_pid = true;
+    } else {
+      capture_options.add_additional_pids(pid);
+    }
+  }
+  if (!has_pid && !system_wide) {
+    return std::nullopt;
+  }
+
+  // DWARF unwinding is used as it also provides the function names.
+  capture_options.set_sampling_rate(
+      absl::GetFlag(FLAGS_profile_sampling_rate));
+  capture_options.set_unwinding_method(CaptureOptions::kDwarf);
+
+  OrbitService::ProfilingDaemonOptions options;
+  options.capture_options = std::move(capture_options);
+  uint32_t bucket_s =
+      std::max<uint32_t>(absl::GetFlag(FLAGS_profile_bucket_s), 1);
+  options.bucket_duration = absl::Seconds(bucket_s);
+  return options;
+}
 }  // namespace
 
 int main(int argc, char** argv) {
@@ -47,6 +107,10 @@ int main(int argc, char** argv) {
   uint16_t grpc_port = absl::GetFlag(FLAGS_grpc_port);
 
   exit_requested = false;
-  OrbitService service{grpc_port};
+  ProfileStore profile_store{
+      absl::GetFlag(FLAGS_profile_dir),
+      uint64_t{absl::GetFlag(FLAGS_profile_max_mb)} * 1024 * 1024};
+  OrbitService service{grpc_port, std::move(profile_store),
+                       GetProfilingDaemonOptions()};
   service.Run(&exit_requested);
 }
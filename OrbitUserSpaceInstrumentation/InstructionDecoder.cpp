@@ -0,0 +1,648 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "InstructionDecoder.h"
+
+#include <cstring>
+#include <limits>
+
+namespace orbit_user_space_instrumentation {
+
+namespace {
+
+// The architectural limit.
+constexpr size_t kMaxInstructionLength = 15;
+
+bool IsLegacyPrefix(uint8_t byte) {
+  switch (byte) {
+    case 0x26:
+    case 0x2E:
+    case 0x36:
+    case 0x3E:
+    case 0x64:
+    case 0x65:
+    case 0x66:
+    case 0x67:
+    case 0xF0:
+    case 0xF2:
+    case 0xF3:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// The layout of an instruction after its opcode.
+struct Operands {
+  bool has_modrm = false;
+  size_t immediate_size = 0;
+  // For F6 and F7 (test), which have an immediate only with /0 and /1.
+  size_t immediate_size_if_test = 0;
+};
+
+struct Prefixes {
+  bool operand_size = false;
+  bool address_size = false;
+  bool repne = false;
+  bool rex = false;
+  bool rex_w = false;
+};
+
+// Instructions that have a 16-bit or a 32-bit immediate, but never a 64-bit
+// one, depending on the operand size.
+size_t GetImmediateSizeWordOrDword(const Prefixes& prefixes) {
+  return prefixes.operand_size ? 2 : 4;
+}
+
+std::optional<Operands> DecodeOneByteOpcode(uint8_t opcode,
+                                            const Prefixes& prefixes,
+                                            Instruction* instruction) {
+  Operands operands;
+  if (opcode < 0x40) {
+    // The arithmetic instructions: add, or, adc, sbb, and, sub, xor, cmp.
+    switch (opcode & 0x07) {
+      case 0:
+      case 1:
+      case 2:
+      case 3:
+        operands.has_modrm = true;
+        return operands;
+      case 4:
+        operands.immediate_size = 1;
+        return operands;
+      case 5:
+        operands.immediate_size = GetImmediateSizeWordOrDword(prefixes);
+        return operands;
+      default:
+        // Prefixes, the escape byte, or invalid in 64-bit mode.
+        return std::nullopt;
+    }
+  }
+
+  if (opcode >= 0x50 && opcode <= 0x5F) {
+    return operands;
+  }
+  if (opcode >= 0x70 && opcode <= 0x7F) {
+    instruction->type = Instruction::Type::kConditionalJump;
+    instruction->condition = opcode & 0x0F;
+    instruction->displacement_size = 1;
+    return operands;
+  }
+  if (opcode >= 0x84 && opcode <= 0x8F) {
+    operands.has_modrm = true;
+    return operands;
+  }
+  if ((opcode >= 0x90 && opcode <= 0x99) ||
+      (opcode >= 0x9B && opcode <= 0x9F)) {
+    return operands;
+  }
+  if (opcode >= 0xB0 && opcode <= 0xB7) {
+    operands.immediate_size = 1;
+    return operands;
+  }
+  if (opcode >= 0xB8 && opcode <= 0xBF) {
+    // mov with a full-size immediate, the only one that can be 64-bit.
+    operands.immediate_size =
+        prefixes.rex_w ? 8 : GetImmediateSizeWordOrDword(prefixes);
+    return operands;
+  }
+  if ((opcode >= 0xD0 && opcode <= 0xD3) ||
+      (opcode >= 0xD8 && opcode <= 0xDF)) {
+    operands.has_modrm = true;
+    return operands;
+  }
+
+  switch (opcode) {
+    case 0x63:
+      operands.has_modrm = true;
+      return operands;
+    case 0x68:
+      operands.immediate_size = GetImmediateSizeWordOrDword(prefixes);
+      return operands;
+    case 0x69:
+      operands.has_modrm = true;
+      operands.immediate_size = GetImmediateSizeWordOrDword(prefixes);
+      return operands;
+    case 0x6A:
+      operands.immediate_size = 1;
+      return operands;
+    case 0x6B:
+      operands.has_modrm = true;
+      operands.immediate_size = 1;
+      return operands;
+    case 0x6C:
+    case 0x6D:
+    case 0x6E:
+    case 0x6F:
+      return operands;
+    case 0x80:
+    case 0x83:
+    case 0xC0:
+    case 0xC1:
+    case 0xC6:
+      operands.has_modrm = true;
+      operands.immediate_size = 1;
+      return operands;
+    case 0x81:
+    case 0xC7:
+      operands.has_modrm = true;
+      operands.immediate_size = GetImmediateSizeWordOrDword(prefixes);
+      return operands;
+    case 0xA0:
+    case 0xA1:
+    case 0xA2:
+    case 0xA3:
+      // mov with an absolute address.
+      operands.immediate_size = prefixes.address_size ? 4 : 8;
+      return operands;
+    case 0xA4:
+    case 0xA5:
+    case 0xA6:
+    case 0xA7:
+    case 0xAA:
+    case 0xAB:
+    case 0xAC:
+    case 0xAD:
+    case 0xAE:
+    case 0xAF:
+      return operands;
+    case 0xA8:
+      operands.immediate_size = 1;
+      return operands;
+    case 0xA9:
+      operands.immediate_size = GetImmediateSizeWordOrDword(prefixes);
+      return operands;
+    case 0xC2:
+    case 0xCA:
+      operands.immediate_size = 2;
+      return operands;
+    case 0xC3:
+    case 0xC9:
+    case 0xCB:
+    case 0xCC:
+    case 0xCF:
+    case 0xD7:
+    case 0xEC:
+    case 0xED:
+    case 0xEE:
+    case 0xEF:
+    case 0xF1:
+    case 0xF4:
+    case 0xF5:
+    case 0xF8:
+    case 0xF9:
+    case 0xFA:
+    case 0xFB:
+    case 0xFC:
+    case 0xFD:
+      return operands;
+    case 0xC8:
+      // enter.
+      operands.immediate_size = 3;
+      return operands;
+    case 0xCD:
+    case 0xE4:
+    case 0xE5:
+    case 0xE6:
+    case 0xE7:
+      operands.immediate_size = 1;
+      return operands;
+    case 0xE0:
+    case 0xE1:
+    case 0xE2:
+    case 0xE3:
+      // loopne, loope, loop, jrcxz.
+      instruction->type = Instruction::Type::kUnrelocatableBranch;
+      instruction->displacement_size = 1;
+      return operands;
+    case 0xE8:
+      instruction->type = Instruction::Type::kCall;
+      instruction->displacement_size = 4;
+      return operands;
+    case 0xE9:
+      instruction->type = Instruction::Type::kJump;
+      instruction->displacement_size = 4;
+      return operands;
+    case 0xEB:
+      instruction->type = Instruction::Type::kJump;
+      instruction->displacement_size = 1;
+      return operands;
+    case 0xF6:
+      operands.has_modrm = true;
+      operands.immediate_size_if_test = 1;
+      return operands;
+    case 0xF7:
+      operands.has_modrm = true;
+      operands.immediate_size_if_test = GetImmediateSizeWordOrDword(prefixes);
+      return operands;
+    case 0xFE:
+    case 0xFF:
+      operands.has_modrm = true;
+      return operands;
+    default:
+      // Invalid in 64-bit mode, or prefixes.
+      return std::nullopt;
+  }
+}
+
+std::optional<Operands> DecodeTwoByteOpcode(uint8_t opcode,
+                                            const Prefixes& prefixes,
+                                            Instruction* instruction) {
+  Operands operands;
+  if ((opcode >= 0x10 && opcode <= 0x1F) ||
+      (opcode >= 0x28 && opcode <= 0x2F) ||
+      (opcode >= 0x40 && opcode <= 0x6F) ||
+      (opcode >= 0x74 && opcode <= 0x76) ||
+      (opcode >= 0x7C && opcode <= 0x7F) ||
+      (opcode >= 0x90 && opcode <= 0x9F) ||
+      (opcode >= 0xB0 && opcode <= 0xB9) ||
+      (opcode >= 0xBB && opcode <= 0xBF) || opcode >= 0xD0) {
+    operands.has_modrm = true;
+    return operands;
+  }
+  if (opcode >= 0x80 && opcode <= 0x8F) {
+    instruction->type = Instruction::Type::kConditionalJump;
+    instruction->condition = opcode & 0x0F;
+    instruction->displacement_size = 4;
+    return operands;
+  }
+  if (opcode >= 0xC8 && opcode <= 0xCF) {
+    // bswap.
+    return operands;
+  }
+
+  switch (opcode) {
+    case 0x00:
+    case 0x01:
+    case 0x02:
+    case 0x03:
+    case 0x0D:
+    case 0x20:
+    case 0x21:
+    case 0x22:
+    case 0x23:
+    case 0xA3:
+    case 0xA5:
+    case 0xAB:
+    case 0xAD:
+    case 0xAE:
+    case 0xAF:
+    case 0xC0:
+    case 0xC1:
+    case 0xC3:
+    case 0xC7:
+      operands.has_modrm = true;
+      return operands;
+    case 0x05:
+    case 0x06:
+    case 0x07:
+    case 0x08:
+    case 0x09:
+    case 0x0B:
+    case 0x0E:
+    case 0x30:
+    case 0x31:
+    case 0x32:
+    case 0x33:
+    case 0x34:
+    case 0x35:
+    case 0x37:
+    case 0x77:
+    case 0xA0:
+    case 0xA1:
+    case 0xA2:
+    case 0xA8:
+    case 0xA9:
+    case 0xAA:
+      return operands;
+    case 0x70:
+    case 0x71:
+    case 0x72:
+    case 0x73:
+    case 0xA4:
+    case 0xAC:
+    case 0xBA:
+    case 0xC2:
+    case 0xC4:
+    case 0xC5:
+    case 0xC6:
+      operands.has_modrm = true;
+      operands.immediate_size = 1;
+      return operands;
+    case 0x78:
+    case 0x79:
+      // vmread and vmwrite. With these prefixes, the AMD-only extrq and
+      // insertq, which have immediates in a different layout.
+      if (prefixes.operand_size || prefixes.repne) {
+        return std::nullopt;
+      }
+      operands.has_modrm = true;
+      return operands;
+    default:
+      // Invalid, or 3DNow! (0F 0F).
+      return std::nullopt;
+  }
+}
+
+// The maps of VEX and EVEX instructions, which all have a ModR/M byte but
+// vzeroupper and vzeroall.
+std::optional<Operands> DecodeVexOpcode(uint8_t map, uint8_t opcode) {
+  Operands operands;
+  switch (map) {
+    case 1:
+      operands.has_modrm = opcode != 0x77;
+      if ((opcode >= 0x70 && opcode <= 0x73) || opcode == 0xC2 ||
+          (opcode >= 0xC4 && opcode <= 0xC6)) {
+        operands.immediate_size = 1;
+      }
+      return operands;
+    case 2:
+      operands.has_modrm = true;
+      return operands;
+    case 3:
+      operands.has_modrm = true;
+      operands.immediate_size = 1;
+      return operands;
+    default:
+      return std::nullopt;
+  }
+}
+
+void AppendBytes(const void* bytes, size_t size, std::vector<uint8_t>* code) {
+  const auto* begin = static_cast<const uint8_t*>(bytes);
+  code->insert(code->end(), begin, begin + size);
+}
+
+bool FitsInInt32(int64_t value) {
+  return value >= std::numeric_limits<int32_t>::min() &&
+         value <= std::numeric_limits<int32_t>::max();
+}
+
+void AppendAbsoluteAddress(uint64_t address, std::vector<uint8_t>* code) {
+  AppendBytes(&address, sizeof(address), code);
+}
+
+void AppendRel32(int64_t displacement, std::vector<uint8_t>* code) {
+  auto displacement32 = static_cast<int32_t>(displacement);
+  AppendBytes(&displacement32, sizeof(displacement32), code);
+}
+
+// jmp [rip+0] followed by the target, for targets out of reach of rel32.
+constexpr uint8_t kJumpToAbsoluteAddress[] = {0xFF, 0x25, 0x00, 0x00, 0x00,
+                                              0x00};
+
+}  // namespace
+
+int64_t Instruction::GetDisplacement(const uint8_t* code) const {
+  switch (displacement_size) {
+    case 1:
+      return static_cast<int8_t>(code[displacement_offset]);
+    case 2: {
+      int16_t displacement;
+      std::memcpy(&displacement, code + displacement_offset,
+                  sizeof(displacement));
+      return displacement;
+    }
+    case 4: {
+      int32_t displacement;
+      std::memcpy(&displacement, code + displacement_offset,
+                  sizeof(displacement));
+      return displacement;
+    }
+    default:
+      return 0;
+  }
+}
+
+std::optional<Instruction> DecodeInstruction(const uint8_t* code,
+                                             size_t size) {
+  if (size > kMaxInstructionLength) {
+    size = kMaxInstructionLength;
+  }
+  size_t offset = 0;
+  Prefixes prefixes;
+  bool has_mandatory_prefix = false;
+  while (offset < size && IsLegacyPrefix(code[offset])) {
+    switch (code[offset]) {
+      case 0x66:
+        prefixes.operand_size = true;
+        has_mandatory_prefix = true;
+        break;
+      case 0x67:
+        prefixes.address_size = true;
+        break;
+      case 0xF2:
+        prefixes.repne = true;
+        has_mandatory_prefix = true;
+        break;
+      case 0xF3:
+        has_mandatory_prefix = true;
+        break;
+      default:
+        break;
+    }
+    ++offset;
+  }
+  if (offset < size && (code[offset] & 0xF0) == 0x40) {
+    prefixes.rex = true;
+    prefixes.rex_w = (code[offset] & 0x08) != 0;
+    ++offset;
+  }
+  if (offset >= size) {
+    return std::nullopt;
+  }
+
+  Instruction instruction;
+  std::optional<Operands> operands;
+  uint8_t opcode = code[offset++];
+  bool is_xbegin = false;
+  if (opcode == 0xC4 || opcode == 0xC5 || opcode == 0x62) {
+    // VEX and EVEX, which can't follow a REX or a mandatory prefix.
+    if (prefixes.rex || has_mandatory_prefix) {
+      return std::nullopt;
+    }
+    size_t payload_size = opcode == 0xC5 ? 1 : opcode == 0xC4 ? 2 : 3;
+    if (offset + payload_size >= size) {
+      return std::nullopt;
+    }
+    uint8_t map = opcode == 0xC5   ? 1
+                  : opcode == 0xC4 ? code[offset] & 0x1F
+                                   : code[offset] & 0x07;
+    if (opcode == 0x62 && (code[offset + 1] & 0x04) == 0) {
+      return std::nullopt;
+    }
+    offset += payload_size;
+    operands = DecodeVexOpcode(map, code[offset++]);
+  } else if (opcode == 0x0F) {
+    if (offset >= size) {
+      return std::nullopt;
+    }
+    uint8_t second_opcode = code[offset++];
+    if (second_opcode == 0x38 || second_opcode == 0x3A) {
+      if (offset >= size) {
+        return std::nullopt;
+      }
+      ++offset;
+      operands = Operands{true, second_opcode == 0x3A ? 1u : 0u, 0};
+    } else {
+      operands = DecodeTwoByteOpcode(second_opcode, prefixes, &instruction);
+    }
+  } else {
+    if (opcode == 0x8F && offset < size && (code[offset] & 0x38) != 0) {
+      // XOP.
+      return std::nullopt;
+    }
+    is_xbegin = opcode == 0xC7 && offset < size && code[offset] == 0xF8;
+    operands = DecodeOneByteOpcode(opcode, prefixes, &instruction);
+  }
+  if (!operands.has_value()) {
+    return std::nullopt;
+  }
+
+  if (operands->has_modrm) {
+    if (offset >= size) {
+      return std::nullopt;
+    }
+    uint8_t modrm = code[offset++];
+    uint8_t mod = modrm >> 6;
+    uint8_t reg = (modrm >> 3) & 0x07;
+    uint8_t rm = modrm & 0x07;
+    size_t displacement_size = 0;
+    if (mod != 3) {
+      if (rm == 4) {
+        if (offset >= size) {
+          return std::nullopt;
+        }
+        uint8_t sib = code[offset++];
+        if (mod == 0 && (sib & 0x07) == 5) {
+          displacement_size = 4;
+        }
+      } else if (mod == 0 && rm == 5) {
+        // With an address-size prefix, this is relative to eip instead.
+        if (prefixes.address_size) {
+          return std::nullopt;
+        }
+        instruction.type = Instruction::Type::kRipRelative;
+        instruction.displacement_offset = offset;
+        instruction.displacement_size = 4;
+        displacement_size = 4;
+      }
+      if (mod == 1) {
+        displacement_size = 1;
+      } else if (mod == 2) {
+        displacement_size = 4;
+      }
+    }
+    offset += displacement_size;
+    if (reg <= 1) {
+      offset += operands->immediate_size_if_test;
+    }
+  }
+
+  if (is_xbegin) {
+    instruction.type = Instruction::Type::kUnrelocatableBranch;
+    instruction.displacement_offset = offset;
+    instruction.displacement_size = operands->immediate_size;
+  } else if (instruction.type != Instruction::Type::kPositionIndependent &&
+             instruction.type != Instruction::Type::kRipRelative) {
+    // The operand-size prefix changes relative branches differently on Intel
+    // and on AMD, unless REX.W overrides it, as in the padding of calls to
+    // __tls_get_addr.
+    if (prefixes.operand_size && !prefixes.rex_w) {
+      return std::nullopt;
+    }
+    instruction.displacement_offset = offset;
+    offset += instruction.displacement_size;
+  }
+  offset += operands->immediate_size;
+
+  if (offset > size) {
+    return std::nullopt;
+  }
+  instruction.length = offset;
+  return instruction;
+}
+
+bool RelocateInstruction(const uint8_t* code, const Instruction& instruction,
+                         uint64_t original_address, uint64_t relocated_address,
+                         std::vector<uint8_t>* relocated) {
+  switch (instruction.type) {
+    case Instruction::Type::kPositionIndependent:
+      AppendBytes(code, instruction.length, relocated);
+      return true;
+
+    case Instruction::Type::kRipRelative: {
+      int64_t displacement =
+          static_cast<int64_t>(instruction.GetTarget(code, original_address) -
+                               (relocated_address + instruction.length));
+      if (!FitsInInt32(displacement)) {
+        return false;
+      }
+      size_t begin = relocated->size();
+      AppendBytes(code, instruction.length, relocated);
+      auto displacement32 = static_cast<int32_t>(displacement);
+      std::memcpy(relocated->data() + begin + instruction.displacement_offset,
+                  &displacement32, sizeof(displacement32));
+      return true;
+    }
+
+    case Instruction::Type::kJump: {
+      uint64_t target = instruction.GetTarget(code, original_address);
+      int64_t displacement =
+          static_cast<int64_t>(target - (relocated_address + 5));
+      if (FitsInInt32(displacement)) {
+        relocated->push_back(0xE9);
+        AppendRel32(displacement, relocated);
+      } else {
+        AppendBytes(kJumpToAbsoluteAddress, sizeof(kJumpToAbsoluteAddress),
+                    relocated);
+        AppendAbsoluteAddress(target, relocated);
+      }
+      return true;
+    }
+
+    case Instruction::Type::kConditionalJump: {
+      uint64_t target = instruction.GetTarget(code, original_address);
+      int64_t displacement =
+          static_cast<int64_t>(target - (relocated_address + 6));
+      if (FitsInInt32(displacement)) {
+        relocated->push_back(0x0F);
+        relocated->push_back(0x80 | instruction.condition);
+        AppendRel32(displacement, relocated);
+      } else {
+        // The opposite condition jumps over the absolute jump.
+        relocated->push_back(0x70 | (instruction.condition ^ 1));
+        relocated->push_back(sizeof(kJumpToAbsoluteAddress) + sizeof(target));
+        AppendBytes(kJumpToAbsoluteAddress, sizeof(kJumpToAbsoluteAddress),
+                    relocated);
+        AppendAbsoluteAddress(target, relocated);
+      }
+      return true;
+    }
+
+    case Instruction::Type::kCall: {
+      uint64_t target = instruction.GetTarget(code, original_address);
+      int64_t displacement =
+          static_cast<int64_t>(target - (relocated_address + 5));
+      if (FitsInInt32(displacement)) {
+        relocated->push_back(0xE8);
+        AppendRel32(displacement, relocated);
+      } else {
+        // call [rip+2], then jump over the target on return.
+        constexpr uint8_t kCallAbsoluteAddress[] = {0xFF, 0x15, 0x02, 0x00,
+                                                    0x00, 0x00, 0xEB, 0x08};
+        AppendBytes(kCallAbsoluteAddress, sizeof(kCallAbsoluteAddress),
+                    relocated);
+        AppendAbsoluteAddress(target, relocated);
+      }
+      return true;
+    }
+
+    case Instruction::Type::kUnrelocatableBranch:
+      return false;
+  }
+  return false;
+}
+
+}  // namespace orbit_user_space_instrumentation
@@ -0,0 +1,65 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_USER_SPACE_INSTRUMENTATION_INSTRUCTION_DECODER_H_
+#define ORBIT_USER_SPACE_INSTRUMENTATION_INSTRUCTION_DECODER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace orbit_user_space_instrumentation {
+
+// What the relocation of the first instructions of a function into a
+// trampoline needs to know about an x86-64 instruction: its length, and
+// whether it refers to the address it is at.
+struct Instruction {
+  enum class Type {
+    // Behaves the same at any address.
+    kPositionIndependent,
+    // Has a memory operand relative to rip, with a 4-byte displacement.
+    kRipRelative,
+    // jmp rel8 or jmp rel32.
+    kJump,
+    // jcc rel8 or jcc rel32. condition is the low nibble of the opcode.
+    kConditionalJump,
+    // call rel32.
+    kCall,
+    // A relative branch with no longer form, i.e., loop, loope, loopne,
+    // jrcxz, or xbegin, which can't be moved.
+    kUnrelocatableBranch,
+  };
+
+  Type type = Type::kPositionIndependent;
+  size_t length = 0;
+  // For all types but kPositionIndependent, the offset and the size in bytes
+  // of the displacement relative to the end of the instruction.
+  size_t displacement_offset = 0;
+  size_t displacement_size = 0;
+  uint8_t condition = 0;
+
+  int64_t GetDisplacement(const uint8_t* code) const;
+  // The address the displacement refers to, for an instruction at address.
+  uint64_t GetTarget(const uint8_t* code, uint64_t address) const {
+    return address + length + GetDisplacement(code);
+  }
+};
+
+// Decodes the instruction at the beginning of code, in 64-bit mode. Returns
+// nullopt if code is too short, if the instruction is invalid, or if it is
+// one this decoder doesn't know, e.g., from the AMD-only XOP and 3DNow! sets.
+std::optional<Instruction> DecodeInstruction(const uint8_t* code, size_t size);
+
+// Appends to relocated code that does the same as the instruction at
+// original_address when it is at relocated_address, i.e., rip-relative
+// displacements are adjusted and relative branches are rewritten to reach the
+// same targets. Returns false if the instruction can't be relocated.
+bool RelocateInstruction(const uint8_t* code, const Instruction& instruction,
+                         uint64_t original_address, uint64_t relocated_address,
+                         std::vector<uint8_t>* relocated);
+
+}  // namespace orbit_user_space_instrumentation
+
+#endif  // ORBIT_USER_SPACE_INSTRUMENTATION_INSTRUCTION_DECODER_H_
@@ -0,0 +1,177 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+
+#include "InstructionDecoder.h"
+
+namespace orbit_user_space_instrumentation {
+
+namespace {
+
+std::optional<Instruction> Decode(const std::vector<uint8_t>& code) {
+  return DecodeInstruction(code.data(), code.size());
+}
+
+size_t DecodeLength(const std::vector<uint8_t>& code) {
+  std::optional<Instruction> instruction = Decode(code);
+  return instruction.has_value() ? instruction->length : 0;
+}
+
+}  // namespace
+
+TEST(InstructionDecoder, Lengths) {
+  // push rbp.
+  EXPECT_EQ(DecodeLength({0x55}), 1);
+  // mov rbp, rsp.
+  EXPECT_EQ(DecodeLength({0x48, 0x89, 0xE5}), 3);
+  // sub rsp, 0x20.
+  EXPECT_EQ(DecodeLength({0x48, 0x83, 0xEC, 0x20}), 4);
+  // mov rax, imm64.
+  EXPECT_EQ(DecodeLength({0x48, 0xB8, 1, 2, 3, 4, 5, 6, 7, 8}), 10);
+  // mov eax, imm32.
+  EXPECT_EQ(DecodeLength({0xB8, 1, 2, 3, 4}), 5);
+  // mov qword ptr [rsp+8], imm32.
+  EXPECT_EQ(DecodeLength({0x48, 0xC7, 0x44, 0x24, 0x08, 1, 2, 3, 4}), 9);
+  // test byte ptr [rdi], imm8.
+  EXPECT_EQ(DecodeLength({0xF6, 0x07, 0x01}), 3);
+  // endbr64.
+  EXPECT_EQ(DecodeLength({0xF3, 0x0F, 0x1E, 0xFA}), 4);
+  // nop word ptr cs:[rax+rax*1+0].
+  EXPECT_EQ(DecodeLength({0x66, 0x2E, 0x0F, 0x1F, 0x84, 0x00, 0x00, 0x00, 0x00,
+                          0x00}),
+            10);
+  // vmovdqu ymm0, [rsi].
+  EXPECT_EQ(DecodeLength({0xC5, 0xFE, 0x6F, 0x06}), 4);
+  // vpbroadcastb ymm0, xmm0.
+  EXPECT_EQ(DecodeLength({0xC4, 0xE2, 0x7D, 0x78, 0xC0}), 5);
+  // vmovdqu64 zmm16, [rsi].
+  EXPECT_EQ(DecodeLength({0x62, 0xE1, 0xFE, 0x48, 0x6F, 0x06}), 6);
+  // pshufb xmm0, xmm1.
+  EXPECT_EQ(DecodeLength({0x66, 0x0F, 0x38, 0x00, 0xC1}), 5);
+  // palignr xmm0, xmm1, 8.
+  EXPECT_EQ(DecodeLength({0x66, 0x0F, 0x3A, 0x0F, 0xC1, 0x08}), 6);
+  // ret.
+  EXPECT_EQ(DecodeLength({0xC3}), 1);
+}
+
+TEST(InstructionDecoder, RejectsTruncatedAndUnknownInstructions) {
+  EXPECT_EQ(Decode({}), std::nullopt);
+  EXPECT_EQ(Decode({0x48, 0xB8, 1, 2, 3}), std::nullopt);
+  EXPECT_EQ(Decode({0x48, 0x89}), std::nullopt);
+  // 3DNow!
+  EXPECT_EQ(Decode({0x0F, 0x0F, 0xC1, 0x9E}), std::nullopt);
+}
+
+TEST(InstructionDecoder, RipRelative) {
+  // mov rax, [rip+0x12345678].
+  std::vector<uint8_t> code{0x48, 0x8B, 0x05, 0x78, 0x56, 0x34, 0x12};
+  std::optional<Instruction> instruction = Decode(code);
+  ASSERT_TRUE(instruction.has_value());
+  EXPECT_EQ(instruction->type, Instruction::Type::kRipRelative);
+  EXPECT_EQ(instruction->length, 7);
+  EXPECT_EQ(instruction->displacement_offset, 3);
+  EXPECT_EQ(instruction->GetTarget(code.data(), 0x1000),
+            0x1000 + 7 + 0x12345678);
+
+  // cmp byte ptr [rip-0x10], 0, where the displacement is not last.
+  code = {0x80, 0x3D, 0xF0, 0xFF, 0xFF, 0xFF, 0x00};
+  instruction = Decode(code);
+  ASSERT_TRUE(instruction.has_value());
+  EXPECT_EQ(instruction->type, Instruction::Type::kRipRelative);
+  EXPECT_EQ(instruction->length, 7);
+  EXPECT_EQ(instruction->GetTarget(code.data(), 0x1000), 0x1000 + 7 - 0x10);
+}
+
+TEST(InstructionDecoder, Branches) {
+  std::vector<uint8_t> code{0xEB, 0x10};
+  std::optional<Instruction> instruction = Decode(code);
+  ASSERT_TRUE(instruction.has_value());
+  EXPECT_EQ(instruction->type, Instruction::Type::kJump);
+  EXPECT_EQ(instruction->GetTarget(code.data(), 0x1000), 0x1012);
+
+  code = {0x0F, 0x84, 0x00, 0x01, 0x00, 0x00};
+  instruction = Decode(code);
+  ASSERT_TRUE(instruction.has_value());
+  EXPECT_EQ(instruction->type, Instruction::Type::kConditionalJump);
+  EXPECT_EQ(instruction->condition, 0x4);
+  EXPECT_EQ(instruction->GetTarget(code.data(), 0x1000), 0x1106);
+
+  code = {0xE8, 0xFB, 0xFF, 0xFF, 0xFF};
+  instruction = Decode(code);
+  ASSERT_TRUE(instruction.has_value());
+  EXPECT_EQ(instruction->type, Instruction::Type::kCall);
+  EXPECT_EQ(instruction->GetTarget(code.data(), 0x1000), 0x1000);
+
+  // loop.
+  code = {0xE2, 0xFE};
+  instruction = Decode(code);
+  ASSERT_TRUE(instruction.has_value());
+  EXPECT_EQ(instruction->type, Instruction::Type::kUnrelocatableBranch);
+
+  // data16 data16 rex.W call, the padding of calls to __tls_get_addr.
+  code = {0x66, 0x66, 0x48, 0xE8, 0x00, 0x00, 0x00, 0x00};
+  instruction = Decode(code);
+  ASSERT_TRUE(instruction.has_value());
+  EXPECT_EQ(instruction->type, Instruction::Type::kCall);
+  EXPECT_EQ(instruction->length, 8);
+}
+
+TEST(InstructionDecoder, RelocateRipRelative) {
+  std::vector<uint8_t> code{0x48, 0x8B, 0x05, 0x00, 0x10, 0x00, 0x00};
+  std::optional<Instruction> instruction = Decode(code);
+  ASSERT_TRUE(instruction.has_value());
+  std::vector<uint8_t> relocated;
+  ASSERT_TRUE(
+      RelocateInstruction(code.data(), instruction.value(), 0x10000, 0x20000,
+                          &relocated));
+  std::vector<uint8_t> expected{0x48, 0x8B, 0x05, 0x00, 0x10, 0xFF, 0xFF};
+  EXPECT_EQ(relocated, expected);
+
+  relocated.clear();
+  EXPECT_FALSE(RelocateInstruction(code.data(), instruction.value(), 0x10000,
+                                   0x1'0000'0000, &relocated));
+}
+
+TEST(InstructionDecoder, RelocateBranches) {
+  // jmp rel8 becomes jmp rel32.
+  std::vector<uint8_t> code{0xEB, 0x10};
+  std::optional<Instruction> instruction = Decode(code);
+  ASSERT_TRUE(instruction.has_value());
+  std::vector<uint8_t> relocated;
+  ASSERT_TRUE(RelocateInstruction(code.data(), instruction.value(), 0x10000,
+                                  0x20000, &relocated));
+  std::vector<uint8_t> expected{0xE9, 0x0D, 0x00, 0xFF, 0xFF};
+  EXPECT_EQ(relocated, expected);
+
+  // jne rel8 becomes jne rel32.
+  code = {0x75, 0x10};
+  instruction = Decode(code);
+  ASSERT_TRUE(instruction.has_value());
+  relocated.clear();
+  ASSERT_TRUE(RelocateInstruction(code.data(), instruction.value(), 0x10000,
+                                  0x20000, &relocated));
+  expected = {0x0F, 0x85, 0x0C, 0x00, 0xFF, 0xFF};
+  EXPECT_EQ(relocated, expected);
+
+  // A call out of reach becomes an indirect call.
+  code = {0xE8, 0x00, 0x00, 0x00, 0x00};
+  instruction = Decode(code);
+  ASSERT_TRUE(instruction.has_value());
+  relocated.clear();
+  ASSERT_TRUE(RelocateInstruction(code.data(), instruction.value(), 0x10000,
+                                  0x1'0000'0000, &relocated));
+  expected = {0xFF, 0x15, 0x02, 0x00, 0x00, 0x00, 0xEB, 0x08,
+              0x05, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00};
+  EXPECT_EQ(relocated, expected);
+
+  code = {0xE2, 0xFE};
+  instruction = Decode(code);
+  ASSERT_TRUE(instruction.has_value());
+  relocated.clear();
+  EXPECT_FALSE(RelocateInstruction(code.data(), instruction.value(), 0x10000,
+                                   0x20000, &relocated));
+}
+
+}  // namespace orbit_user_space_instrumentation
@@ -0,0 +1,201 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// The library that OrbitService loads into the target with dlopen, and that
+// the trampolines of the instrumented functions call. On entry, the return
+// address of the function is replaced with the return trampoline and pushed on
+// a shadow stack; on exit, the call is written to the shared-memory ring buffer
+// of the thread and the original return address is returned to the return
+// trampoline, which jumps to it.
+//
+// The functions can run in the middle of any function of the target, e.g.,
+// malloc, so they don't allocate and don't take locks. The state of a thread
+// is reached through an initial-exec TLS pointer, as the dynamic TLS of a
+// dlopen'ed library can allocate on first access. A thread that is already in
+// the payload (e.g., because an instrumented function is called by the
+// payload itself) is not recorded.
+
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <new>
+#include <optional>
+
+#include "OrbitBase/SharedMemoryRingBuffer.h"
+#include "OrbitUserSpaceInstrumentation/FunctionCallRecord.h"
+
+namespace orbit_user_space_instrumentation {
+
+namespace {
+
+using FunctionCallRingBuffer =
+    OrbitBase::SharedMemoryRingBuffer<FunctionCallRecord>;
+
+// Deeper calls are executed but not recorded.
+constexpr size_t kMaxShadowStackDepth = 1024;
+
+struct ShadowStackEntry {
+  uint64_t function_address;
+  uint64_t return_address;
+  uint64_t begin_timestamp_ns;
+};
+
+struct ThreadState {
+  int32_t tid;
+  int fd;
+  void* memory;
+  size_t memory_size;
+  std::optional<FunctionCallRingBuffer> ring_buffer;
+  size_t depth;
+  ShadowStackEntry shadow_stack[kMaxShadowStackDepth];
+};
+
+__thread ThreadState* thread_state __attribute__((tls_model("initial-exec"))) =
+    nullptr;
+__thread bool in_payload __attribute__((tls_model("initial-exec"))) = false;
+
+pthread_key_t thread_state_key;
+pthread_once_t thread_state_key_once = PTHREAD_ONCE_INIT;
+
+uint64_t MonotonicTimestampNs() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return 1'000'000'000llu * ts.tv_sec + ts.tv_nsec;
+}
+
+// The memfd name, without std::string, as it allocates.
+void FormatMemfdName(int32_t tid, char* name, size_t size) {
+  size_t length = 0;
+  for (const char* c = kFunctionCallRingBufferMemfdPrefix;
+       *c != '\0' && length + 1 < size; ++c) {
+    name[length++] = *c;
+  }
+  char digits[16];
+  size_t digit_count = 0;
+  uint32_t value = static_cast<uint32_t>(tid);
+  do {
+    digits[digit_count++] = static_cast<char>('0' + value % 10);
+    value /= 10;
+  } while (value != 0 && digit_count < sizeof(digits));
+  while (digit_count > 0 && length + 1 < size) {
+    name[length++] = digits[--digit_count];
+  }
+  name[length] = '\0';
+}
+
+// Called when the thread exits. Closing the memfd tells OrbitService that it
+// can unmap the ring buffer once it has read it. The shadow stack is kept if
+// calls are still pending, e.g., on pthread_exit, in case they return.
+void DestroyThreadState(void* state_pointer) {
+  auto* state = static_cast<ThreadState*>(state_pointer);
+  state->ring_buffer.reset();
+  if (state->memory != nullptr) {
+    munmap(state->memory, state->memory_size);
+    state->memory = nullptr;
+  }
+  if (state->fd >= 0) {
+    close(state->fd);
+    state->fd = -1;
+  }
+  if (state->depth == 0) {
+    thread_state = nullptr;
+    munmap(state, sizeof(ThreadState));
+  }
+}
+
+void CreateThreadStateKey() {
+  pthread_key_create(&thread_state_key, &DestroyThreadState);
+}
+
+ThreadState* CreateThreadState() {
+  void* state_memory = mmap(nullptr, sizeof(ThreadState),
+                            PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (state_memory == MAP_FAILED) {
+    return nullptr;
+  }
+  auto* state = new (state_memory) ThreadState{};
+  state->tid = static_cast<int32_t>(syscall(SYS_gettid));
+  state->fd = -1;
+
+  char name[64];
+  FormatMemfdName(state->tid, name, sizeof(name));
+  int fd = memfd_create(name, MFD_CLOEXEC);
+  size_t size =
+      FunctionCallRingBuffer::ComputeSize(kFunctionCallRingBufferCapacity);
+  if (fd >= 0 && ftruncate(fd, size) == 0) {
+    void* memory =
+        mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (memory != MAP_FAILED) {
+      // Keep the file descriptor open: OrbitService finds the ring buffer
+      // through it.
+      state->fd = fd;
+      state->memory = memory;
+      state->memory_size = size;
+      state->ring_buffer = FunctionCallRingBuffer::Create(
+          memory, size, kFunctionCallRingBufferCapacity);
+    }
+  }
+  if (state->fd < 0 && fd >= 0) {
+    close(fd);
+  }
+
+  pthread_once(&thread_state_key_once, &CreateThreadStateKey);
+  pthread_setspecific(thread_state_key, state);
+  return state;
+}
+
+}  // namespace
+
+}  // namespace orbit_user_space_instrumentation
+
+using orbit_user_space_instrumentation::in_payload;
+using orbit_user_space_instrumentation::thread_state;
+
+extern "C" __attribute__((visibility("default"))) void
+OrbitUserSpaceInstrumentationEntry(uint64_t function_address,
+                                   uint64_t* return_address,
+                                   uint64_t return_trampoline_address) {
+  if (in_payload) {
+    return;
+  }
+  in_payload = true;
+  if (thread_state == nullptr) {
+    thread_state = orbit_user_space_instrumentation::CreateThreadState();
+  }
+  orbit_user_space_instrumentation::ThreadState* state = thread_state;
+  if (state != nullptr &&
+      state->depth < orbit_user_space_instrumentation::kMaxShadowStackDepth) {
+    state->shadow_stack[state->depth++] = {
+        function_address, *return_address,
+        orbit_user_space_instrumentation::MonotonicTimestampNs()};
+    *return_address = return_trampoline_address;
+  }
+  in_payload = false;
+}
+
+// Only called through the return trampoline, for calls whose return address
+// was replaced by the entry function, so the shadow stack is never empty.
+extern "C" __attribute__((visibility("default"))) uint64_t
+OrbitUserSpaceInstrumentationExit(uint64_t return_value) {
+  bool was_in_payload = in_payload;
+  in_payload = true;
+  uint64_t end_timestamp_ns =
+      orbit_user_space_instrumentation::MonotonicTimestampNs();
+  orbit_user_space_instrumentation::ThreadState* state = thread_state;
+  const orbit_user_space_instrumentation::ShadowStackEntry& entry =
+      state->shadow_stack[--state->depth];
+  if (state->ring_buffer.has_value()) {
+    state->ring_buffer->TryWrite({entry.function_address,
+                                  entry.begin_timestamp_ns, end_timestamp_ns,
+                                  return_value, state->tid,
+                                  static_cast<int32_t>(state->depth)});
+  }
+  in_payload = was_in_payload;
+  return entry.return_address;
+}
@@ -0,0 +1,142 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ProcessMaps.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#include "absl/strings/str_format.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/strip.h"
+
+namespace orbit_user_space_instrumentation {
+
+namespace {
+
+constexpr uint64_t kPageSize = 4096;
+// Below vm.mmap_min_addr, which is at most 64 KiB, mmap fails.
+constexpr uint64_t kMinUserAddress = 0x10000;
+// The end of the lower half of the 48-bit address space.
+constexpr uint64_t kMaxUserAddress = 0x7FFF'FFFF'F000;
+
+uint64_t AlignDown(uint64_t address) { return address & ~(kPageSize - 1); }
+uint64_t AlignUp(uint64_t address) {
+  return AlignDown(address + kPageSize - 1);
+}
+
+}  // namespace
+
+std::vector<ProcessMap> ParseProcessMaps(std::string_view maps_content) {
+  std::vector<ProcessMap> maps;
+  for (absl::string_view line :
+       absl::StrSplit(absl::string_view{maps_content.data(),
+                                        maps_content.size()},
+                      '\n', absl::SkipEmpty())) {
+    std::string line_string{line};
+    uint64_t start = 0;
+    uint64_t end = 0;
+    char permissions[5] = {};
+    uint64_t offset = 0;
+    uint64_t inode = 0;
+    int path_position = 0;
+    if (sscanf(line_string.c_str(),
+               "%" SCNx64 "-%" SCNx64 " %4s %" SCNx64 " %*x:%*x %" SCNu64
+               " %n",
+               &start, &end, permissions, &offset, &inode,
+               &path_position) != 5 ||
+        path_position == 0) {
+      continue;
+    }
+    maps.push_back({start, end, permissions[2] == 'x', offset,
+                    static_cast<ino_t>(inode),
+                    std::string{absl::StripAsciiWhitespace(
+                        line.substr(path_position))}});
+  }
+  std::sort(maps.begin(), maps.end(),
+            [](const ProcessMap& lhs, const ProcessMap& rhs) {
+              return lhs.start < rhs.start;
+            });
+  return maps;
+}
+
+outcome::result<std::vector<ProcessMap>, std::string> ReadProcessMaps(
+    pid_t pid) {
+  std::string maps_path = absl::StrFormat("/proc/%d/maps", pid);
+  std::ifstream maps_file{maps_path};
+  if (!maps_file.is_open()) {
+    return outcome::failure(absl::StrFormat("Opening \"%s\"", maps_path));
+  }
+  std::stringstream maps_content;
+  maps_content << maps_file.rdbuf();
+  return ParseProcessMaps(maps_content.str());
+}
+
+std::optional<uint64_t> TranslateAddress(
+    const std::vector<ProcessMap>& source_maps,
+    const std::vector<ProcessMap>& target_maps, uint64_t address) {
+  auto source_map = std::find_if(
+      source_maps.begin(), source_maps.end(), [address](const ProcessMap& map) {
+        return address >= map.start && address < map.end;
+      });
+  if (source_map == source_maps.end() || source_map->inode == 0) {
+    return std::nullopt;
+  }
+  uint64_t file_offset = address - source_map->start + source_map->offset;
+  for (const ProcessMap& target_map : target_maps) {
+    if (target_map.inode == source_map->inode &&
+        target_map.path == source_map->path &&
+        target_map.is_executable == source_map->is_executable &&
+        file_offset >= target_map.offset &&
+        file_offset < target_map.offset + (target_map.end - target_map.start)) {
+      return target_map.start + (file_offset - target_map.offset);
+    }
+  }
+  return std::nullopt;
+}
+
+std::optional<uint64_t> FindFreeRangeNear(const std::vector<ProcessMap>& maps,
+                                          uint64_t begin, uint64_t end,
+                                          uint64_t size,
+                                          uint64_t max_distance) {
+  uint64_t lower_bound = std::max(
+      kMinUserAddress, end > max_distance ? end - max_distance : uint64_t{0});
+  uint64_t upper_bound = std::min(kMaxUserAddress, begin + max_distance);
+
+  std::optional<uint64_t> best_address;
+  uint64_t best_distance = UINT64_MAX;
+  uint64_t gap_start = 0;
+  for (size_t i = 0; i <= maps.size(); ++i) {
+    uint64_t gap_end = i < maps.size() ? maps[i].start : kMaxUserAddress;
+    uint64_t low = AlignUp(std::max(gap_start, lower_bound));
+    uint64_t high = std::min(gap_end, upper_bound);
+    if (i < maps.size()) {
+      gap_start = std::max(gap_start, maps[i].end);
+    }
+    if (high < low || high - low < size) {
+      continue;
+    }
+    // Take the end of the gap closest to the functions.
+    uint64_t address = low >= end ? low : AlignDown(high - size);
+    if (address < low) {
+      continue;
+    }
+    uint64_t distance = 0;
+    if (address >= end) {
+      distance = address + size - end;
+    } else if (address + size <= begin) {
+      distance = begin - address;
+    }
+    if (distance < best_distance) {
+      best_distance = distance;
+      best_address = address;
+    }
+  }
+  return best_address;
+}
+
+}  // namespace orbit_user_space_instrumentation
@@ -0,0 +1,53 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_USER_SPACE_INSTRUMENTATION_PROCESS_MAPS_H_
+#define ORBIT_USER_SPACE_INSTRUMENTATION_PROCESS_MAPS_H_
+
+#include <sys/types.h>
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "outcome.hpp"
+
+namespace orbit_user_space_instrumentation {
+
+// A line of /proc/<pid>/maps.
+struct ProcessMap {
+  uint64_t start;
+  uint64_t end;
+  bool is_executable;
+  uint64_t offset;
+  ino_t inode;
+  std::string path;
+};
+
+// The maps sorted by address. Malformed lines are skipped.
+std::vector<ProcessMap> ParseProcessMaps(std::string_view maps_content);
+outcome::result<std::vector<ProcessMap>, std::string> ReadProcessMaps(
+    pid_t pid);
+
+// The address in the process of target_maps of the code or data at address
+// in the process of source_maps, if the same file is mapped in both. Used to
+// find functions of shared libraries like libc in the target from their
+// addresses in OrbitService.
+std::optional<uint64_t> TranslateAddress(
+    const std::vector<ProcessMap>& source_maps,
+    const std::vector<ProcessMap>& target_maps, uint64_t address);
+
+// The start of a free, page-aligned range of size bytes all of which is within
+// max_distance of all of [begin, end), if any. The closest such range to the
+// functions is preferred, so that it can be reached with rel32 jumps.
+std::optional<uint64_t> FindFreeRangeNear(const std::vector<ProcessMap>& maps,
+                                          uint64_t begin, uint64_t end,
+                                          uint64_t size,
+                                          uint64_t max_distance);
+
+}  // namespace orbit_user_space_instrumentation
+
+#endif  // ORBIT_USER_SPACE_INSTRUMENTATION_PROCESS_MAPS_H_
@@ -0,0 +1,105 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include "ProcessMaps.h"
+
+namespace orbit_user_space_instrumentation {
+
+namespace {
+constexpr uint64_t kTwoGigabytes = 0x8000'0000;
+}  // namespace
+
+TEST(ProcessMaps, ParseProcessMaps) {
+  std::vector<ProcessMap> maps = ParseProcessMaps(
+      "7f0000001000-7f0000003000 r-xp 00001000 fe:01 1234    "
+      "/usr/lib/with space.so\n"
+      "55d000000000-55d000001000 r--p 00000000 00:00 0 \n"
+      "malformed\n"
+      "7f0000000000-7f0000001000 r--p 00000000 fe:01 1234    "
+      "/usr/lib/with space.so\n");
+  ASSERT_EQ(maps.size(), 3);
+  EXPECT_EQ(maps[0].start, 0x55d000000000);
+  EXPECT_EQ(maps[0].end, 0x55d000001000);
+  EXPECT_FALSE(maps[0].is_executable);
+  EXPECT_EQ(maps[0].inode, 0);
+  EXPECT_EQ(maps[0].path, "");
+  EXPECT_EQ(maps[1].start, 0x7f0000000000);
+  EXPECT_EQ(maps[2].start, 0x7f0000001000);
+  EXPECT_TRUE(maps[2].is_executable);
+  EXPECT_EQ(maps[2].offset, 0x1000);
+  EXPECT_EQ(maps[2].inode, 1234);
+  EXPECT_EQ(maps[2].path, "/usr/lib/with space.so");
+}
+
+TEST(ProcessMaps, ReadProcessMapsOfThisProcess) {
+  outcome::result<std::vector<ProcessMap>, std::string> maps =
+      ReadProcessMaps(getpid());
+  ASSERT_TRUE(maps.has_value()) << maps.error();
+  auto code_address = reinterpret_cast<uint64_t>(&ParseProcessMaps);
+  bool code_found = false;
+  for (const ProcessMap& map : maps.value()) {
+    if (code_address >= map.start && code_address < map.end) {
+      code_found = map.is_executable;
+    }
+  }
+  EXPECT_TRUE(code_found);
+}
+
+TEST(ProcessMaps, TranslateAddress) {
+  std::vector<ProcessMap> source_maps = ParseProcessMaps(
+      "7f0000000000-7f0000001000 r--p 00000000 fe:01 1234 /lib/libc.so\n"
+      "7f0000001000-7f0000003000 r-xp 00001000 fe:01 1234 /lib/libc.so\n"
+      "7f0000010000-7f0000011000 rw-p 00000000 00:00 0\n");
+  std::vector<ProcessMap> target_maps = ParseProcessMaps(
+      "7e0000000000-7e0000001000 r--p 00000000 fe:01 1234 /lib/libc.so\n"
+      "7e0000001000-7e0000003000 r-xp 00001000 fe:01 1234 /lib/libc.so\n"
+      "7e0000010000-7e0000011000 rw-p 00000000 00:00 0\n");
+  EXPECT_EQ(TranslateAddress(source_maps, target_maps, 0x7f0000002345),
+            0x7e0000002345);
+  // Anonymous memory is not the same in both processes.
+  EXPECT_EQ(TranslateAddress(source_maps, target_maps, 0x7f0000010010),
+            std::nullopt);
+  EXPECT_EQ(TranslateAddress(source_maps, target_maps, 0x7f0000020000),
+            std::nullopt);
+
+  // Another file, e.g., a different libc in a container.
+  std::vector<ProcessMap> other_target_maps = ParseProcessMaps(
+      "7e0000001000-7e0000003000 r-xp 00001000 fe:01 5678 /lib/libc.so\n");
+  EXPECT_EQ(TranslateAddress(source_maps, other_target_maps, 0x7f0000002345),
+            std::nullopt);
+}
+
+TEST(ProcessMaps, FindFreeRangeNearPrefersClosestGap) {
+  std::vector<ProcessMap> maps = ParseProcessMaps(
+      "100000000-100010000 r-xp 00000000 fe:01 1 /a\n"
+      "100020000-100030000 r-xp 00000000 fe:01 2 /b\n"
+      "100040000-100100000 r-xp 00000000 fe:01 3 /c\n");
+  // Between the two first mappings.
+  EXPECT_EQ(FindFreeRangeNear(maps, 0x100020100, 0x100020200, 0x1000,
+                              kTwoGigabytes),
+            0x10001F000);
+  // Right after the last mapping.
+  EXPECT_EQ(FindFreeRangeNear(maps, 0x1000FF000, 0x1000FF100, 0x20000,
+                              kTwoGigabytes),
+            0x100100000);
+}
+
+TEST(ProcessMaps, FindFreeRangeNearRespectsMaxDistance) {
+  std::vector<ProcessMap> maps = ParseProcessMaps(
+      "000010000-100000000 r--p 00000000 00:00 0\n"
+      "100000000-100010000 r-xp 00000000 fe:01 1 /a\n"
+      "100010000-200000000 r--p 00000000 00:00 0\n");
+  EXPECT_EQ(FindFreeRangeNear(maps, 0x100000000, 0x100010000, 0x1000,
+                              kTwoGigabytes),
+            std::nullopt);
+  std::optional<uint64_t> address = FindFreeRangeNear(
+      maps, 0x100000000, 0x100010000, 0x1000, 0x200000000);
+  ASSERT_TRUE(address.has_value());
+  EXPECT_EQ(address.value(), 0x200000000);
+}
+
+}  // namespace orbit_user_space_instrumentation
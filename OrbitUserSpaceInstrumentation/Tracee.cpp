@@ -0,0 +1,325 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "Tracee.h"
+
+#include <OrbitBase/Logging.h>
+#include <OrbitBase/SafeStrerror.h>
+#include <elf.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/ptrace.h>
+#include <sys/uio.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <thread>
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_format.h"
+
+namespace orbit_user_space_instrumentation {
+
+namespace {
+
+// Enough for the XSAVE area of all current processors, including AMX.
+constexpr size_t kMaxExtendedStateSize = 16 * 1024;
+// The red zone below the stack pointer that functions can use without
+// moving it, which calls from us must not overwrite.
+constexpr uint64_t kRedZoneSize = 128;
+constexpr uint64_t kDirectionFlag = 0x400;
+
+void SetArgumentRegisters(const std::vector<uint64_t>& arguments,
+                          bool is_syscall, user_regs_struct* registers) {
+  // System calls take their fourth argument in r10 instead of rcx.
+  unsigned long long* argument_registers[] = {
+      &registers->rdi,
+      &registers->rsi,
+      &registers->rdx,
+      is_syscall ? &registers->r10 : &registers->rcx,
+      &registers->r8,
+      &registers->r9};
+  for (size_t i = 0; i < arguments.size() && i < 6; ++i) {
+    *argument_registers[i] = arguments[i];
+  }
+}
+
+bool ThreadExists(pid_t pid, pid_t tid) {
+  std::error_code error;
+  return std::filesystem::exists(absl::StrFormat("/proc/%d/task/%d", pid, tid),
+                                 error);
+}
+
+outcome::result<int, std::string> OpenProcessMemory(pid_t pid, int flags) {
+  std::string path = absl::StrFormat("/proc/%d/mem", pid);
+  int fd = open(path.c_str(), flags | O_CLOEXEC);
+  if (fd < 0) {
+    return outcome::failure(
+        absl::StrFormat("Opening \"%s\": %s", path, SafeStrerror(errno)));
+  }
+  return fd;
+}
+
+}  // namespace
+
+outcome::result<StoppedThread, std::string> StoppedThread::Stop(pid_t tid) {
+  if (ptrace(PTRACE_SEIZE, tid, nullptr, nullptr) != 0) {
+    return outcome::failure(absl::StrFormat("Attaching to thread %d: %s", tid,
+                                            SafeStrerror(errno)));
+  }
+  StoppedThread thread{tid};
+  if (ptrace(PTRACE_INTERRUPT, tid, nullptr, nullptr) != 0) {
+    thread.stopped_ = false;
+    ptrace(PTRACE_DETACH, tid, nullptr, nullptr);
+    return outcome::failure(absl::StrFormat("Interrupting thread %d: %s", tid,
+                                            SafeStrerror(errno)));
+  }
+  while (true) {
+    int status = 0;
+    if (waitpid(tid, &status, __WALL) != tid || !WIFSTOPPED(status)) {
+      thread.stopped_ = false;
+      return outcome::failure(
+          absl::StrFormat("Thread %d exited while being stopped", tid));
+    }
+    if (status >> 16 == PTRACE_EVENT_STOP) {
+      break;
+    }
+    // A signal arrived first. The interrupt is still pending.
+    thread.pending_signal_ = WSTOPSIG(status);
+    ptrace(PTRACE_CONT, tid, nullptr, nullptr);
+  }
+
+  if (ptrace(PTRACE_GETREGS, tid, nullptr, &thread.registers_) != 0) {
+    return outcome::failure(absl::StrFormat(
+        "Reading registers of thread %d: %s", tid, SafeStrerror(errno)));
+  }
+  thread.extended_state_.resize(kMaxExtendedStateSize);
+  for (int type : {NT_X86_XSTATE, NT_PRFPREG}) {
+    iovec iov{thread.extended_state_.data(), thread.extended_state_.size()};
+    if (ptrace(PTRACE_GETREGSET, tid, type, &iov) == 0) {
+      thread.extended_state_.resize(iov.iov_len);
+      thread.extended_state_type_ = type;
+      return thread;
+    }
+  }
+  return outcome::failure(absl::StrFormat(
+      "Reading vector registers of thread %d: %s", tid, SafeStrerror(errno)));
+}
+
+StoppedThread::StoppedThread(StoppedThread&& other)
+    : tid_{other.tid_},
+      registers_{other.registers_},
+      extended_state_{std::move(other.extended_state_)},
+      extended_state_type_{other.extended_state_type_},
+      pending_signal_{other.pending_signal_},
+      stopped_{other.stopped_} {
+  other.stopped_ = false;
+}
+
+StoppedThread& StoppedThread::operator=(StoppedThread&& other) {
+  if (this != &other) {
+    Resume();
+    tid_ = other.tid_;
+    registers_ = other.registers_;
+    extended_state_ = std::move(other.extended_state_);
+    extended_state_type_ = other.extended_state_type_;
+    pending_signal_ = other.pending_signal_;
+    stopped_ = other.stopped_;
+    other.stopped_ = false;
+  }
+  return *this;
+}
+
+StoppedThread::~StoppedThread() { Resume(); }
+
+outcome::result<void, std::string> StoppedThread::SetInstructionPointer(
+    uint64_t address) {
+  registers_.rip = address;
+  return outcome::success();
+}
+
+outcome::result<uint64_t, std::string> StoppedThread::ExecuteSyscall(
+    uint64_t syscall_address, uint64_t number,
+    const std::vector<uint64_t>& arguments) {
+  user_regs_struct registers = registers_;
+  registers.rip = syscall_address;
+  registers.rax = number;
+  SetArgumentRegisters(arguments, true, &registers);
+  OUTCOME_TRY(result_registers,
+              RunUntilTrap(registers, /*single_step=*/true, 1000));
+  if (result_registers.rip != syscall_address + 2) {
+    return outcome::failure(absl::StrFormat(
+        "Thread %d stopped at %#x instead of after the system call at %#x",
+        tid_, result_registers.rip, syscall_address));
+  }
+  return result_registers.rax;
+}
+
+outcome::result<uint64_t, std::string> StoppedThread::CallFunction(
+    uint64_t function_address, const std::vector<uint64_t>& arguments,
+    uint64_t int3_address, uint32_t timeout_ms) {
+  user_regs_struct registers = registers_;
+  // As after a call instruction, the return address is at a stack pointer
+  // that is 8 bytes off the 16-byte alignment.
+  uint64_t stack_pointer = ((registers_.rsp - kRedZoneSize) & ~0xFULL) - 8;
+  std::vector<uint8_t> return_address(sizeof(int3_address));
+  std::memcpy(return_address.data(), &int3_address, sizeof(int3_address));
+  OUTCOME_TRY(WriteProcessMemory(tid_, stack_pointer, return_address));
+  registers.rsp = stack_pointer;
+  registers.rip = function_address;
+  registers.rax = 0;
+  registers.eflags &= ~kDirectionFlag;
+  SetArgumentRegisters(arguments, false, &registers);
+  OUTCOME_TRY(result_registers,
+              RunUntilTrap(registers, /*single_step=*/false, timeout_ms));
+  if (result_registers.rip != int3_address + 1) {
+    return outcome::failure(absl::StrFormat(
+        "Thread %d trapped at %#x instead of returning from %#x", tid_,
+        result_registers.rip, function_address));
+  }
+  return result_registers.rax;
+}
+
+outcome::result<user_regs_struct, std::string> StoppedThread::RunUntilTrap(
+    const user_regs_struct& registers, bool single_step,
+    uint32_t timeout_ms) {
+  const __ptrace_request ptrace_request =
+      single_step ? PTRACE_SINGLESTEP : PTRACE_CONT;
+  user_regs_struct run_registers = registers;
+  // The thread might have been stopped in a system call: don't let the kernel
+  // restart it at our instruction pointer.
+  run_registers.orig_rax = -1;
+  if (ptrace(PTRACE_SETREGS, tid_, nullptr, &run_registers) != 0) {
+    return outcome::failure(absl::StrFormat(
+        "Writing registers of thread %d: %s", tid_, SafeStrerror(errno)));
+  }
+  auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+  if (ptrace(ptrace_request, tid_, nullptr, nullptr) != 0) {
+    return outcome::failure(absl::StrFormat("Resuming thread %d: %s", tid_,
+                                            SafeStrerror(errno)));
+  }
+  while (true) {
+    int status = 0;
+    pid_t result = waitpid(tid_, &status, __WALL | WNOHANG);
+    if (result == 0) {
+      if (std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+        continue;
+      }
+      ptrace(PTRACE_INTERRUPT, tid_, nullptr, nullptr);
+      while (waitpid(tid_, &status, __WALL) == tid_ && WIFSTOPPED(status) &&
+             status >> 16 != PTRACE_EVENT_STOP) {
+        ptrace(PTRACE_CONT, tid_, nullptr, nullptr);
+      }
+      return outcome::failure(absl::StrFormat(
+          "Thread %d didn't trap within %u ms", tid_, timeout_ms));
+    }
+    if (result != tid_ || !WIFSTOPPED(status)) {
+      stopped_ = false;
+      return outcome::failure(absl::StrFormat(
+          "Thread %d exited while running injected code", tid_));
+    }
+    int signal = WSTOPSIG(status);
+    if (signal == SIGTRAP && status >> 16 == 0) {
+      break;
+    }
+    // Keep other signals for when the thread resumes its own code.
+    if (status >> 16 == 0 && pending_signal_ == 0) {
+      pending_signal_ = signal;
+    }
+    ptrace(ptrace_request, tid_, nullptr, nullptr);
+  }
+  user_regs_struct result_registers;
+  if (ptrace(PTRACE_GETREGS, tid_, nullptr, &result_registers) != 0) {
+    return outcome::failure(absl::StrFormat(
+        "Reading registers of thread %d: %s", tid_, SafeStrerror(errno)));
+  }
+  return result_registers;
+}
+
+void StoppedThread::Resume() {
+  if (!stopped_) {
+    return;
+  }
+  stopped_ = false;
+  if (ptrace(PTRACE_SETREGS, tid_, nullptr, &registers_) != 0) {
+    ERROR("Restoring registers of thread %d: %s", tid_, SafeStrerror(errno));
+  }
+  iovec iov{extended_state_.data(), extended_state_.size()};
+  if (ptrace(PTRACE_SETREGSET, tid_, extended_state_type_, &iov) != 0) {
+    ERROR("Restoring vector registers of thread %d: %s", tid_,
+          SafeStrerror(errno));
+  }
+  if (ptrace(PTRACE_DETACH, tid_, nullptr, pending_signal_) != 0) {
+    ERROR("Detaching from thread %d: %s", tid_, SafeStrerror(errno));
+  }
+}
+
+outcome::result<std::vector<StoppedThread>, std::string> StopProcess(
+    pid_t pid) {
+  std::vector<StoppedThread> threads;
+  absl::flat_hash_set<pid_t> tids_seen;
+  std::string task_directory = absl::StrFormat("/proc/%d/task", pid);
+  bool new_thread_found = true;
+  while (new_thread_found) {
+    new_thread_found = false;
+    std::error_code error;
+    for (const std::filesystem::directory_entry& entry :
+         std::filesystem::directory_iterator{task_directory, error}) {
+      pid_t tid;
+      if (!absl::SimpleAtoi(entry.path().filename().string(), &tid) ||
+          !tids_seen.insert(tid).second) {
+        continue;
+      }
+      new_thread_found = true;
+      outcome::result<StoppedThread, std::string> thread =
+          StoppedThread::Stop(tid);
+      if (thread.has_value()) {
+        threads.push_back(std::move(thread.value()));
+      } else if (ThreadExists(pid, tid)) {
+        return outcome::failure(thread.error());
+      }
+    }
+    if (error) {
+      return outcome::failure(absl::StrFormat("Listing \"%s\": %s",
+                                              task_directory, error.message()));
+    }
+  }
+  if (threads.empty()) {
+    return outcome::failure(absl::StrFormat("Process %d has no threads", pid));
+  }
+  return threads;
+}
+
+outcome::result<std::vector<uint8_t>, std::string> ReadProcessMemory(
+    pid_t pid, uint64_t address, uint64_t size) {
+  OUTCOME_TRY(fd, OpenProcessMemory(pid, O_RDONLY));
+  std::vector<uint8_t> bytes(size);
+  ssize_t read_size = pread(fd, bytes.data(), size, address);
+  close(fd);
+  if (read_size < 0 || static_cast<uint64_t>(read_size) != size) {
+    return outcome::failure(absl::StrFormat(
+        "Reading %u bytes at %#x in process %d", size, address, pid));
+  }
+  return bytes;
+}
+
+outcome::result<void, std::string> WriteProcessMemory(
+    pid_t pid, uint64_t address, const std::vector<uint8_t>& bytes) {
+  OUTCOME_TRY(fd, OpenProcessMemory(pid, O_WRONLY));
+  ssize_t written_size = pwrite(fd, bytes.data(), bytes.size(), address);
+  close(fd);
+  if (written_size < 0 || static_cast<size_t>(written_size) != bytes.size()) {
+    return outcome::failure(absl::StrFormat(
+        "Writing %u bytes at %#x in process %d", bytes.size(), address, pid));
+  }
+  return outcome::success();
+}
+
+}  // namespace orbit_user_space_instrumentation
@@ -0,0 +1,92 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_USER_SPACE_INSTRUMENTATION_TRACEE_H_
+#define ORBIT_USER_SPACE_INSTRUMENTATION_TRACEE_H_
+
+#include <sys/types.h>
+#include <sys/user.h>
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "outcome.hpp"
+
+namespace orbit_user_space_instrumentation {
+
+// A thread of another process stopped with ptrace. The registers it had when
+// it was stopped are restored when it is resumed, so that code can be
+// executed on it in between without it noticing.
+class StoppedThread {
+ public:
+  // Attaches to thread tid and waits until it is stopped.
+  static outcome::result<StoppedThread, std::string> Stop(pid_t tid);
+
+  StoppedThread(StoppedThread&& other);
+  StoppedThread& operator=(StoppedThread&& other);
+  StoppedThread(const StoppedThread&) = delete;
+  StoppedThread& operator=(const StoppedThread&) = delete;
+  // Resumes the thread, if it wasn't yet.
+  ~StoppedThread();
+
+  pid_t GetTid() const { return tid_; }
+  uint64_t GetInstructionPointer() const { return registers_.rip; }
+  // Where the thread continues when it is resumed.
+  outcome::result<void, std::string> SetInstructionPointer(uint64_t address);
+
+  // Executes the system call number with up to six arguments, by executing
+  // the syscall instruction at syscall_address. Returns rax, which is a
+  // negative errno on failure.
+  outcome::result<uint64_t, std::string> ExecuteSyscall(
+      uint64_t syscall_address, uint64_t number,
+      const std::vector<uint64_t>& arguments);
+
+  // Calls the function with up to six integer arguments, with a return
+  // address at which there is an int3. Returns rax. If the function doesn't
+  // return within timeout_ms, e.g., because it waits on a lock held by the
+  // stopped code of this thread, the thread is interrupted and the call is
+  // abandoned.
+  outcome::result<uint64_t, std::string> CallFunction(
+      uint64_t function_address, const std::vector<uint64_t>& arguments,
+      uint64_t int3_address, uint32_t timeout_ms);
+
+  // Restores the registers and detaches.
+  void Resume();
+
+ private:
+  explicit StoppedThread(pid_t tid) : tid_{tid} {}
+
+  // Runs the thread with registers, or single-steps it, until it traps.
+  // Returns the registers then.
+  outcome::result<user_regs_struct, std::string> RunUntilTrap(
+      const user_regs_struct& registers, bool single_step,
+      uint32_t timeout_ms);
+
+  pid_t tid_ = -1;
+  user_regs_struct registers_{};
+  // The x87, SSE and AVX registers, as an XSAVE area (NT_X86_XSTATE) or, if
+  // the kernel doesn't provide one, as an FXSAVE area (NT_PRFPREG).
+  std::vector<uint8_t> extended_state_;
+  int extended_state_type_ = 0;
+  // A signal that arrived while stopping the thread, delivered on resume.
+  int pending_signal_ = 0;
+  bool stopped_ = true;
+};
+
+// Stops all the threads of process pid, including the ones created while
+// doing so.
+outcome::result<std::vector<StoppedThread>, std::string> StopProcess(pid_t pid);
+
+// The memory of a process, through /proc/<pid>/mem, which also writes to
+// read-only mappings.
+outcome::result<std::vector<uint8_t>, std::string> ReadProcessMemory(
+    pid_t pid, uint64_t address, uint64_t size);
+outcome::result<void, std::string> WriteProcessMemory(
+    pid_t pid, uint64_t address, const std::vector<uint8_t>& bytes);
+
+}  // namespace orbit_user_space_instrumentation
+
+#endif  // ORBIT_USER_SPACE_INSTRUMENTATION_TRACEE_H_
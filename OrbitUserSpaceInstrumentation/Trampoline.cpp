@@ -0,0 +1,218 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "Trampoline.h"
+
+#include <limits>
+#include <optional>
+
+#include "InstructionDecoder.h"
+#include "absl/strings/str_format.h"
+
+namespace orbit_user_space_instrumentation {
+
+namespace {
+
+void AppendBytes(std::initializer_list<uint8_t> bytes,
+                 std::vector<uint8_t>* code) {
+  code->insert(code->end(), bytes.begin(), bytes.end());
+}
+
+void AppendUint64(uint64_t value, std::vector<uint8_t>* code) {
+  const auto* bytes = reinterpret_cast<const uint8_t*>(&value);
+  code->insert(code->end(), bytes, bytes + sizeof(value));
+}
+
+std::optional<int32_t> ComputeRel32(uint64_t from_address,
+                                    uint64_t to_address) {
+  auto displacement = static_cast<int64_t>(to_address - from_address);
+  if (displacement < std::numeric_limits<int32_t>::min() ||
+      displacement > std::numeric_limits<int32_t>::max()) {
+    return std::nullopt;
+  }
+  return static_cast<int32_t>(displacement);
+}
+
+void AppendJump(uint64_t jump_address, uint64_t target_address,
+                std::vector<uint8_t>* code) {
+  std::optional<int32_t> rel32 = ComputeRel32(jump_address + 5, target_address);
+  if (rel32.has_value()) {
+    code->push_back(0xE9);
+    const auto* bytes = reinterpret_cast<const uint8_t*>(&rel32.value());
+    code->insert(code->end(), bytes, bytes + sizeof(int32_t));
+  } else {
+    // jmp [rip+0].
+    AppendBytes({0xFF, 0x25, 0x00, 0x00, 0x00, 0x00}, code);
+    AppendUint64(target_address, code);
+  }
+}
+
+// movdqu [rsp+16*index], xmm<index>.
+void AppendSaveXmm(uint8_t index, std::vector<uint8_t>* code) {
+  AppendBytes({0xF3, 0x0F, 0x7F, static_cast<uint8_t>(0x44 | (index << 3)),
+               0x24, static_cast<uint8_t>(16 * index)},
+              code);
+}
+
+// movdqu xmm<index>, [rsp+16*index].
+void AppendRestoreXmm(uint8_t index, std::vector<uint8_t>* code) {
+  AppendBytes({0xF3, 0x0F, 0x6F, static_cast<uint8_t>(0x44 | (index << 3)),
+               0x24, static_cast<uint8_t>(16 * index)},
+              code);
+}
+
+// The registers that pass integer arguments, and al, the number of vector
+// registers used by a variadic function, and r10, the static chain pointer.
+constexpr uint8_t kArgumentRegisterCount = 8;
+// The vector registers that pass arguments.
+constexpr uint8_t kArgumentXmmRegisterCount = 8;
+
+void AppendCallToPayloadEntry(uint64_t function_address,
+                              uint64_t payload_entry_address,
+                              uint64_t return_trampoline_address,
+                              std::vector<uint8_t>* code) {
+  // push rbp; mov rbp, rsp.
+  AppendBytes({0x55, 0x48, 0x89, 0xE5}, code);
+  // push rdi; push rsi; push rdx; push rcx; push r8; push r9; push rax;
+  // push r10.
+  AppendBytes({0x57, 0x56, 0x52, 0x51, 0x41, 0x50, 0x41, 0x51, 0x50, 0x41,
+               0x52},
+              code);
+  // The stack is not necessarily aligned, e.g., in hand-written assembly:
+  // and rsp, -16; sub rsp, 16*8.
+  AppendBytes({0x48, 0x83, 0xE4, 0xF0, 0x48, 0x81, 0xEC,
+               16 * kArgumentXmmRegisterCount, 0x00, 0x00, 0x00},
+              code);
+  for (uint8_t i = 0; i < kArgumentXmmRegisterCount; ++i) {
+    AppendSaveXmm(i, code);
+  }
+  // mov rdi, function_address.
+  AppendBytes({0x48, 0xBF}, code);
+  AppendUint64(function_address, code);
+  // lea rsi, [rbp+8], the return address.
+  AppendBytes({0x48, 0x8D, 0x75, 0x08}, code);
+  // mov rdx, return_trampoline_address.
+  AppendBytes({0x48, 0xBA}, code);
+  AppendUint64(return_trampoline_address, code);
+  // mov rax, payload_entry_address; call rax.
+  AppendBytes({0x48, 0xB8}, code);
+  AppendUint64(payload_entry_address, code);
+  AppendBytes({0xFF, 0xD0}, code);
+  for (uint8_t i = 0; i < kArgumentXmmRegisterCount; ++i) {
+    AppendRestoreXmm(i, code);
+  }
+  // lea rsp, [rbp-8*8].
+  AppendBytes({0x48, 0x8D, 0x65,
+               static_cast<uint8_t>(-8 * kArgumentRegisterCount)},
+              code);
+  // pop r10; pop rax; pop r9; pop r8; pop rcx; pop rdx; pop rsi; pop rdi;
+  // pop rbp.
+  AppendBytes({0x41, 0x5A, 0x58, 0x41, 0x59, 0x41, 0x58, 0x59, 0x5A, 0x5E,
+               0x5F, 0x5D},
+              code);
+}
+
+}  // namespace
+
+outcome::result<EntryTrampoline, std::string> CreateEntryTrampoline(
+    uint64_t function_address, const std::vector<uint8_t>& function_code,
+    uint64_t trampoline_address, uint64_t payload_entry_address,
+    uint64_t return_trampoline_address) {
+  if (function_code.size() < kFunctionPatchSize) {
+    return outcome::failure(absl::StrFormat(
+        "Function at %#x is too small to be patched", function_address));
+  }
+
+  // Check that the whole function can be decoded, and that no branch in it
+  // targets what the patch overwrites, other than the entry itself.
+  std::vector<Instruction> overwritten_instructions;
+  size_t overwritten_size = 0;
+  std::vector<uint64_t> branch_targets;
+  for (size_t offset = 0; offset < function_code.size();) {
+    std::optional<Instruction> instruction = DecodeInstruction(
+        function_code.data() + offset, function_code.size() - offset);
+    if (!instruction.has_value()) {
+      return outcome::failure(absl::StrFormat(
+          "Unknown instruction at %#x", function_address + offset));
+    }
+    if (offset < kFunctionPatchSize) {
+      overwritten_instructions.push_back(instruction.value());
+      overwritten_size = offset + instruction->length;
+    }
+    if (instruction->type != Instruction::Type::kPositionIndependent &&
+        instruction->type != Instruction::Type::kRipRelative) {
+      branch_targets.push_back(instruction->GetTarget(
+          function_code.data() + offset, function_address + offset));
+    }
+    offset += instruction->length;
+  }
+  for (uint64_t target : branch_targets) {
+    if (target > function_address &&
+        target < function_address + overwritten_size) {
+      return outcome::failure(absl::StrFormat(
+          "Branch to %#x, in the first instructions of the function", target));
+    }
+  }
+
+  EntryTrampoline trampoline;
+  trampoline.overwritten_size = overwritten_size;
+  AppendCallToPayloadEntry(function_address, payload_entry_address,
+                           return_trampoline_address, &trampoline.code);
+  size_t offset = 0;
+  for (const Instruction& instruction : overwritten_instructions) {
+    uint64_t relocated_address = trampoline_address + trampoline.code.size();
+    if (offset > 0) {
+      trampoline.relocated_instruction_addresses.emplace_back(
+          function_address + offset, relocated_address);
+    }
+    if (!RelocateInstruction(function_code.data() + offset, instruction,
+                             function_address + offset, relocated_address,
+                             &trampoline.code)) {
+      return outcome::failure(absl::StrFormat(
+          "Can't relocate instruction at %#x", function_address + offset));
+    }
+    offset += instruction.length;
+  }
+  AppendJump(trampoline_address + trampoline.code.size(),
+             function_address + overwritten_size, &trampoline.code);
+  if (trampoline.code.size() > kMaxEntryTrampolineSize) {
+    return outcome::failure(absl::StrFormat(
+        "Trampoline of function at %#x is too large", function_address));
+  }
+  return trampoline;
+}
+
+std::vector<uint8_t> CreateReturnTrampoline(uint64_t payload_exit_address) {
+  std::vector<uint8_t> code;
+  // sub rsp, 8, for the original return address; push rbp; mov rbp, rsp;
+  // push rax; push rdx.
+  AppendBytes({0x48, 0x83, 0xEC, 0x08, 0x55, 0x48, 0x89, 0xE5, 0x50, 0x52},
+              &code);
+  // and rsp, -16; sub rsp, 32.
+  AppendBytes({0x48, 0x83, 0xE4, 0xF0, 0x48, 0x83, 0xEC, 0x20}, &code);
+  AppendSaveXmm(0, &code);
+  AppendSaveXmm(1, &code);
+  // mov rdi, rax.
+  AppendBytes({0x48, 0x89, 0xC7}, &code);
+  // mov rax, payload_exit_address; call rax.
+  AppendBytes({0x48, 0xB8}, &code);
+  AppendUint64(payload_exit_address, &code);
+  AppendBytes({0xFF, 0xD0}, &code);
+  // mov [rbp+8], rax.
+  AppendBytes({0x48, 0x89, 0x45, 0x08}, &code);
+  AppendRestoreXmm(0, &code);
+  AppendRestoreXmm(1, &code);
+  // lea rsp, [rbp-16]; pop rdx; pop rax; pop rbp; ret.
+  AppendBytes({0x48, 0x8D, 0x65, 0xF0, 0x5A, 0x58, 0x5D, 0xC3}, &code);
+  return code;
+}
+
+std::vector<uint8_t> CreateFunctionPatch(uint64_t function_address,
+                                         uint64_t trampoline_address) {
+  std::vector<uint8_t> code;
+  AppendJump(function_address, trampoline_address, &code);
+  return code;
+}
+
+}  // namespace orbit_user_space_instrumentation
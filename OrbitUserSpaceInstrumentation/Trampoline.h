@@ -0,0 +1,60 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_USER_SPACE_INSTRUMENTATION_TRAMPOLINE_H_
+#define ORBIT_USER_SPACE_INSTRUMENTATION_TRAMPOLINE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "outcome.hpp"
+
+namespace orbit_user_space_instrumentation {
+
+// The size of the jmp rel32 that replaces the first instructions of an
+// instrumented function.
+constexpr size_t kFunctionPatchSize = 5;
+
+// The code that an instrumented function jumps to on entry. It calls the entry
+// function of the payload with the address of the function, the address of
+// the return address on the stack, and the address of the return trampoline,
+// then executes the instructions overwritten by the jump and jumps back to the
+// function. All the registers that pass arguments are preserved.
+struct EntryTrampoline {
+  std::vector<uint8_t> code;
+  // The size of the whole instructions that the jump overwrites.
+  size_t overwritten_size = 0;
+  // The address of each of these instructions but the first, with the address
+  // of its copy in the trampoline, where a thread stopped on it is moved.
+  std::vector<std::pair<uint64_t, uint64_t>> relocated_instruction_addresses;
+};
+
+// function_code is the whole function, to check that no branch in it targets
+// the overwritten instructions. Fails if an instruction can't be decoded or
+// relocated, e.g., a rip-relative operand out of reach from the trampoline.
+outcome::result<EntryTrampoline, std::string> CreateEntryTrampoline(
+    uint64_t function_address, const std::vector<uint8_t>& function_code,
+    uint64_t trampoline_address, uint64_t payload_entry_address,
+    uint64_t return_trampoline_address);
+
+// The code that instrumented functions return to. It calls the exit function
+// of the payload with the return value, and jumps to the original return
+// address that it returns. The registers that hold return values are
+// preserved.
+std::vector<uint8_t> CreateReturnTrampoline(uint64_t payload_exit_address);
+
+// The jmp rel32 from the entry of a function to its trampoline, which must be
+// in reach.
+std::vector<uint8_t> CreateFunctionPatch(uint64_t function_address,
+                                         uint64_t trampoline_address);
+
+// The largest size of an entry trampoline, for allocating memory for them.
+constexpr size_t kMaxEntryTrampolineSize = 256;
+
+}  // namespace orbit_user_space_instrumentation
+
+#endif  // ORBIT_USER_SPACE_INSTRUMENTATION_TRAMPOLINE_H_
@@ -0,0 +1,133 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+#include <sys/mman.h>
+
+#include <cstring>
+
+#include "Trampoline.h"
+
+namespace orbit_user_space_instrumentation {
+
+namespace {
+
+// push rbp; mov rbp, rsp; lea eax, [rdi+1]; pop rbp; ret.
+const std::vector<uint8_t> kIncrementCode{0x55, 0x48, 0x89, 0xE5, 0x8D,
+                                          0x47, 0x01, 0x5D, 0xC3};
+
+// Stand-ins for the functions of the payload.
+uint64_t entry_function_address = 0;
+uint64_t entry_return_address = 0;
+uint64_t exit_return_value = 0;
+
+void FakePayloadEntry(uint64_t function_address, uint64_t* return_address,
+                      uint64_t return_trampoline_address) {
+  entry_function_address = function_address;
+  entry_return_address = *return_address;
+  *return_address = return_trampoline_address;
+}
+
+uint64_t FakePayloadExit(uint64_t return_value) {
+  exit_return_value = return_value;
+  return entry_return_address;
+}
+
+}  // namespace
+
+TEST(Trampoline, CreateEntryTrampolineRelocatesOverwrittenInstructions) {
+  constexpr uint64_t kFunctionAddress = 0x10000;
+  constexpr uint64_t kTrampolineAddress = 0x20000;
+  outcome::result<EntryTrampoline, std::string> trampoline =
+      CreateEntryTrampoline(kFunctionAddress, kIncrementCode,
+                            kTrampolineAddress, 0x30000, 0x40000);
+  ASSERT_TRUE(trampoline.has_value()) << trampoline.error();
+  // push rbp, mov rbp, rsp and lea eax, [rdi+1].
+  EXPECT_EQ(trampoline.value().overwritten_size, 7);
+  ASSERT_EQ(trampoline.value().relocated_instruction_addresses.size(), 2);
+  EXPECT_EQ(trampoline.value().relocated_instruction_addresses[0].first,
+            kFunctionAddress + 1);
+  EXPECT_EQ(trampoline.value().relocated_instruction_addresses[1].first,
+            kFunctionAddress + 4);
+
+  // The relocated instructions are followed by the jump back after them.
+  const std::vector<uint8_t>& code = trampoline.value().code;
+  ASSERT_GE(code.size(), 12);
+  uint64_t relocated_offset =
+      trampoline.value().relocated_instruction_addresses[0].second -
+      kTrampolineAddress - 1;
+  EXPECT_EQ(std::vector<uint8_t>(code.begin() + relocated_offset,
+                                 code.begin() + relocated_offset + 7),
+            std::vector<uint8_t>(kIncrementCode.begin(),
+                                 kIncrementCode.begin() + 7));
+  EXPECT_EQ(code[code.size() - 5], 0xE9);
+  int32_t jump_displacement;
+  std::memcpy(&jump_displacement, code.data() + code.size() - 4,
+              sizeof(jump_displacement));
+  EXPECT_EQ(kTrampolineAddress + code.size() + jump_displacement,
+            kFunctionAddress + 7);
+}
+
+TEST(Trampoline, CreateEntryTrampolineRejectsUnsafeFunctions) {
+  // Too small.
+  EXPECT_FALSE(CreateEntryTrampoline(0x10000, {0x31, 0xC0, 0xC3}, 0x20000,
+                                     0x30000, 0x40000)
+                   .has_value());
+  // push rbp; mov rbp, rsp; jmp to the mov, which the patch overwrites.
+  EXPECT_FALSE(CreateEntryTrampoline(0x10000,
+                                     {0x55, 0x48, 0x89, 0xE5, 0xEB, 0xFB},
+                                     0x20000, 0x30000, 0x40000)
+                   .has_value());
+  // loop, which has no rel32 form.
+  EXPECT_FALSE(CreateEntryTrampoline(0x10000,
+                                     {0x55, 0xE2, 0xFD, 0x90, 0x90, 0xC3},
+                                     0x20000, 0x30000, 0x40000)
+                   .has_value());
+  // 3DNow!
+  EXPECT_FALSE(CreateEntryTrampoline(0x10000,
+                                     {0x0F, 0x0F, 0xC1, 0x9E, 0x90, 0xC3},
+                                     0x20000, 0x30000, 0x40000)
+                   .has_value());
+}
+
+TEST(Trampoline, InstrumentedFunctionCallsPayload) {
+  constexpr size_t kPageSize = 4096;
+  void* memory = mmap(nullptr, 2 * kPageSize,
+                      PROT_READ | PROT_WRITE | PROT_EXEC,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  ASSERT_NE(memory, MAP_FAILED);
+  auto* function = static_cast<uint8_t*>(memory);
+  uint8_t* trampolines = function + kPageSize;
+  auto function_address = reinterpret_cast<uint64_t>(function);
+  auto trampoline_address = reinterpret_cast<uint64_t>(trampolines);
+  std::memcpy(function, kIncrementCode.data(), kIncrementCode.size());
+
+  std::vector<uint8_t> return_trampoline = CreateReturnTrampoline(
+      reinterpret_cast<uint64_t>(&FakePayloadExit));
+  uint64_t return_trampoline_address =
+      trampoline_address + kMaxEntryTrampolineSize;
+  std::memcpy(trampolines + kMaxEntryTrampolineSize, return_trampoline.data(),
+              return_trampoline.size());
+  outcome::result<EntryTrampoline, std::string> entry_trampoline =
+      CreateEntryTrampoline(function_address, kIncrementCode,
+                            trampoline_address,
+                            reinterpret_cast<uint64_t>(&FakePayloadEntry),
+                            return_trampoline_address);
+  ASSERT_TRUE(entry_trampoline.has_value()) << entry_trampoline.error();
+  std::memcpy(trampolines, entry_trampoline.value().code.data(),
+              entry_trampoline.value().code.size());
+  std::vector<uint8_t> patch =
+      CreateFunctionPatch(function_address, trampoline_address);
+  ASSERT_EQ(patch.size(), kFunctionPatchSize);
+  std::memcpy(function, patch.data(), patch.size());
+
+  auto* increment = reinterpret_cast<int (*)(int)>(function);
+  EXPECT_EQ(increment(41), 42);
+  EXPECT_EQ(entry_function_address, function_address);
+  EXPECT_EQ(exit_return_value, 42);
+
+  munmap(memory, 2 * kPageSize);
+}
+
+}  // namespace orbit_user_space_instrumentation
@@ -0,0 +1,435 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "OrbitUserSpaceInstrumentation/UserSpaceInstrumentation.h"
+
+#include <OrbitBase/Logging.h>
+#include <OrbitBase/SafeStrerror.h>
+#include <dlfcn.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <optional>
+
+#include "OrbitUserSpaceInstrumentation/FunctionCallRecord.h"
+#include "ProcessMaps.h"
+#include "Tracee.h"
+#include "Trampoline.h"
+#include "absl/strings/str_format.h"
+
+namespace orbit_user_space_instrumentation {
+
+namespace {
+
+constexpr const char* kPayloadLibraryName =
+    "libOrbitUserSpaceInstrumentationPayload.so";
+constexpr uint64_t kPageSize = 4096;
+// Loading the payload runs its constructors and those of its dependencies.
+constexpr uint32_t kCallTimeoutMs = 5000;
+// Trampolines are placed within this distance of all the functions that jump
+// to them, for the jumps to fit in a rel32, and functions further apart than
+// kMaxClusterSize get separate trampolines.
+constexpr uint64_t kMaxTrampolineDistance = 0x7FFF'0000;
+constexpr uint64_t kMaxClusterSize = 1ULL << 30;
+
+uint64_t AlignUp(uint64_t size) {
+  return (size + kPageSize - 1) & ~(kPageSize - 1);
+}
+
+bool IsSyscallError(uint64_t result) { return result > -4096ULL; }
+
+// The dynamic loader functions of the target, found through those of this
+// process, as the same libraries are mapped in both.
+struct TargetFunctions {
+  uint64_t syscall_instruction;
+  uint64_t dlopen;
+  uint64_t dlsym;
+};
+
+outcome::result<uint64_t, std::string> FindInTarget(
+    const std::vector<ProcessMap>& own_maps,
+    const std::vector<ProcessMap>& target_maps, pid_t pid, void* handle,
+    const char* symbol) {
+  void* own_address = dlsym(handle, symbol);
+  if (own_address == nullptr) {
+    return outcome::failure(absl::StrFormat("Symbol \"%s\" not found", symbol));
+  }
+  std::optional<uint64_t> address = TranslateAddress(
+      own_maps, target_maps, reinterpret_cast<uint64_t>(own_address));
+  if (!address.has_value()) {
+    return outcome::failure(absl::StrFormat(
+        "The library defining \"%s\" is not loaded in process %d", symbol,
+        pid));
+  }
+  return address.value();
+}
+
+outcome::result<TargetFunctions, std::string> FindTargetFunctions(pid_t pid) {
+  OUTCOME_TRY(own_maps, ReadProcessMaps(getpid()));
+  OUTCOME_TRY(target_maps, ReadProcessMaps(pid));
+  TargetFunctions functions{};
+
+  // The symbols of libc are looked up in libc itself, as those this
+  // executable takes the address of resolve to its PLT if it isn't position
+  // independent. libc is never unloaded, so the handle needs no dlclose.
+  void* libc_handle = dlopen("libc.so.6", RTLD_LAZY | RTLD_NOLOAD);
+  if (libc_handle == nullptr) {
+    return outcome::failure(absl::StrFormat("Finding libc: %s", dlerror()));
+  }
+
+  // Executing the syscall instruction of the syscall function of libc saves
+  // writing one to the target while its other threads run.
+  const auto* syscall_code =
+      static_cast<const uint8_t*>(dlsym(libc_handle, "syscall"));
+  constexpr size_t kMaxSyscallInstructionOffset = 64;
+  size_t offset = 0;
+  while (syscall_code != nullptr && offset < kMaxSyscallInstructionOffset &&
+         !(syscall_code[offset] == 0x0F && syscall_code[offset + 1] == 0x05)) {
+    ++offset;
+  }
+  std::optional<uint64_t> syscall_instruction;
+  if (syscall_code != nullptr && offset < kMaxSyscallInstructionOffset) {
+    syscall_instruction =
+        TranslateAddress(own_maps, target_maps,
+                         reinterpret_cast<uint64_t>(syscall_code + offset));
+  }
+  if (!syscall_instruction.has_value()) {
+    return outcome::failure(absl::StrFormat(
+        "No syscall instruction found in the libc of process %d", pid));
+  }
+  functions.syscall_instruction = syscall_instruction.value();
+
+  // Before glibc 2.34, dlopen is in libdl, which the target might not load,
+  // but libc has its own versions of it.
+  outcome::result<uint64_t, std::string> dlopen_address =
+      FindInTarget(own_maps, target_maps, pid, RTLD_DEFAULT, "dlopen");
+  outcome::result<uint64_t, std::string> dlsym_address =
+      FindInTarget(own_maps, target_maps, pid, RTLD_DEFAULT, "dlsym");
+  if (!dlopen_address.has_value() || !dlsym_address.has_value()) {
+    OUTCOME_TRY(libc_dlopen_address,
+                FindInTarget(own_maps, target_maps, pid, libc_handle,
+                             "__libc_dlopen_mode"));
+    OUTCOME_TRY(libc_dlsym_address,
+                FindInTarget(own_maps, target_maps, pid, libc_handle,
+                             "__libc_dlsym"));
+    dlopen_address = libc_dlopen_address;
+    dlsym_address = libc_dlsym_address;
+  }
+  functions.dlopen = dlopen_address.value();
+  functions.dlsym = dlsym_address.value();
+  return functions;
+}
+
+outcome::result<uint64_t, std::string> AllocateExecutableMemory(
+    StoppedThread* thread, uint64_t syscall_instruction, uint64_t address,
+    uint64_t size) {
+  uint64_t flags = MAP_PRIVATE | MAP_ANONYMOUS;
+  if (address != 0) {
+    flags |= MAP_FIXED_NOREPLACE;
+  }
+  OUTCOME_TRY(result, thread->ExecuteSyscall(
+                          syscall_instruction, SYS_mmap,
+                          {address, size, PROT_READ | PROT_EXEC, flags,
+                           static_cast<uint64_t>(-1), 0}));
+  if (IsSyscallError(result)) {
+    return outcome::failure(
+        absl::StrFormat("Allocating %u bytes at %#x in thread %d: %s", size,
+                        address, thread->GetTid(), SafeStrerror(-result)));
+  }
+  // Before Linux 4.17, MAP_FIXED_NOREPLACE is ignored and the address is only
+  // a hint.
+  if (address != 0 && result != address) {
+    (void)thread->ExecuteSyscall(syscall_instruction, SYS_munmap,
+                                 {result, size});
+    return outcome::failure(absl::StrFormat(
+        "Allocating %u bytes at %#x in thread %d: got %#x instead", size,
+        address, thread->GetTid(), result));
+  }
+  return result;
+}
+
+// The addresses of the entry and exit functions of the payload after loading
+// it into the process of thread.
+struct PayloadFunctions {
+  uint64_t entry;
+  uint64_t exit;
+};
+
+outcome::result<PayloadFunctions, std::string> LoadPayload(
+    StoppedThread* thread, const TargetFunctions& target_functions,
+    const std::string& payload_library_path) {
+  // An int3 for the injected calls to return to, followed by their string
+  // arguments.
+  std::vector<uint8_t> scratch{0xCC};
+  auto append_string = [&scratch](const std::string& string) {
+    uint64_t offset = scratch.size();
+    scratch.insert(scratch.end(), string.begin(), string.end());
+    scratch.push_back('\0');
+    return offset;
+  };
+  uint64_t path_offset = append_string(payload_library_path);
+  uint64_t entry_name_offset = append_string(kPayloadEntryFunctionName);
+  uint64_t exit_name_offset = append_string(kPayloadExitFunctionName);
+  uint64_t scratch_size = AlignUp(scratch.size());
+
+  OUTCOME_TRY(scratch_address,
+              AllocateExecutableMemory(
+                  thread, target_functions.syscall_instruction, 0,
+                  scratch_size));
+  outcome::result<void, std::string> write_result =
+      WriteProcessMemory(thread->GetTid(), scratch_address, scratch);
+  outcome::result<uint64_t, std::string> handle =
+      write_result.has_value()
+          ? thread->CallFunction(target_functions.dlopen,
+                                 {scratch_address + path_offset, RTLD_NOW},
+                                 scratch_address, kCallTimeoutMs)
+          : outcome::failure(write_result.error());
+  std::optional<PayloadFunctions> payload_functions;
+  std::string error;
+  if (!handle.has_value()) {
+    error = handle.error();
+  } else if (handle.value() == 0) {
+    error = absl::StrFormat("Loading \"%s\" into thread %d failed",
+                            payload_library_path, thread->GetTid());
+  } else {
+    outcome::result<uint64_t, std::string> entry = thread->CallFunction(
+        target_functions.dlsym,
+        {handle.value(), scratch_address + entry_name_offset}, scratch_address,
+        kCallTimeoutMs);
+    outcome::result<uint64_t, std::string> exit = thread->CallFunction(
+        target_functions.dlsym,
+        {handle.value(), scratch_address + exit_name_offset}, scratch_address,
+        kCallTimeoutMs);
+    if (!entry.has_value() || !exit.has_value() || entry.value() == 0 ||
+        exit.value() == 0) {
+      error = absl::StrFormat("The functions of \"%s\" were not found",
+                              payload_library_path);
+    } else {
+      payload_functions = PayloadFunctions{entry.value(), exit.value()};
+    }
+  }
+  (void)thread->ExecuteSyscall(target_functions.syscall_instruction,
+                               SYS_munmap, {scratch_address, scratch_size});
+  if (!payload_functions.has_value()) {
+    return outcome::failure(error);
+  }
+  return payload_functions.value();
+}
+
+// An instrumented function, before it is patched.
+struct FunctionPatch {
+  uint64_t address;
+  std::vector<uint8_t> patch;
+  std::vector<uint8_t> original_code;
+  size_t overwritten_size;
+  std::vector<std::pair<uint64_t, uint64_t>> relocated_instruction_addresses;
+};
+
+// Writes the entry trampolines of the functions, which are close to each
+// other, to memory allocated near them, and returns their patches.
+std::vector<FunctionPatch> CreateEntryTrampolines(
+    StoppedThread* thread, const TargetFunctions& target_functions,
+    const PayloadFunctions& payload_functions,
+    uint64_t return_trampoline_address,
+    const std::vector<FunctionToInstrument>& functions,
+    std::vector<ProcessMap>* maps) {
+  pid_t pid = thread->GetTid();
+  uint64_t begin = functions.front().address;
+  uint64_t end = functions.back().address + functions.back().size;
+  uint64_t size = AlignUp(functions.size() * kMaxEntryTrampolineSize);
+  std::optional<uint64_t> address =
+      FindFreeRangeNear(*maps, begin, end, size, kMaxTrampolineDistance);
+  if (!address.has_value()) {
+    ERROR("No memory free near functions at %#x to %#x in process %d", begin,
+          end, pid);
+    return {};
+  }
+  outcome::result<uint64_t, std::string> trampolines_address =
+      AllocateExecutableMemory(thread, target_functions.syscall_instruction,
+                               address.value(), size);
+  if (!trampolines_address.has_value()) {
+    ERROR("%s", trampolines_address.error());
+    return {};
+  }
+  maps->push_back({address.value(), address.value() + size, true, 0, 0, ""});
+  std::sort(maps->begin(), maps->end(),
+            [](const ProcessMap& lhs, const ProcessMap& rhs) {
+              return lhs.start < rhs.start;
+            });
+
+  std::vector<uint8_t> trampolines;
+  std::vector<FunctionPatch> patches;
+  for (const FunctionToInstrument& function : functions) {
+    outcome::result<std::vector<uint8_t>, std::string> code =
+        ReadProcessMemory(pid, function.address, function.size);
+    if (!code.has_value()) {
+      ERROR("%s", code.error());
+      continue;
+    }
+    uint64_t trampoline_address = address.value() + trampolines.size();
+    outcome::result<EntryTrampoline, std::string> trampoline =
+        CreateEntryTrampoline(function.address, code.value(),
+                              trampoline_address, payload_functions.entry,
+                              return_trampoline_address);
+    if (!trampoline.has_value()) {
+      ERROR("Instrumenting function at %#x: %s", function.address,
+            trampoline.error());
+      continue;
+    }
+    trampolines.insert(trampolines.end(), trampoline.value().code.begin(),
+                       trampoline.value().code.end());
+    patches.push_back(
+        {function.address,
+         CreateFunctionPatch(function.address, trampoline_address),
+         std::vector<uint8_t>(code.value().begin(),
+                              code.value().begin() + kFunctionPatchSize),
+         trampoline.value().overwritten_size,
+         std::move(trampoline.value().relocated_instruction_addresses)});
+  }
+  outcome::result<void, std::string> write_result =
+      WriteProcessMemory(pid, address.value(), trampolines);
+  if (!write_result.has_value()) {
+    ERROR("%s", write_result.error());
+    return {};
+  }
+  return patches;
+}
+
+// Loads the payload with the main thread of process pid and writes the
+// trampolines of the functions. The other threads keep running, so that the
+// dynamic loader doesn't wait on a lock held by a stopped thread.
+outcome::result<std::vector<FunctionPatch>, std::string> PrepareTrampolines(
+    pid_t pid, const std::string& payload_library_path,
+    std::vector<FunctionToInstrument> functions) {
+  OUTCOME_TRY(target_functions, FindTargetFunctions(pid));
+  OUTCOME_TRY(maps, ReadProcessMaps(pid));
+  OUTCOME_TRY(thread, StoppedThread::Stop(pid));
+  OUTCOME_TRY(payload_functions,
+              LoadPayload(&thread, target_functions, payload_library_path));
+
+  std::vector<uint8_t> return_trampoline =
+      CreateReturnTrampoline(payload_functions.exit);
+  OUTCOME_TRY(return_trampoline_address,
+              AllocateExecutableMemory(&thread,
+                                       target_functions.syscall_instruction, 0,
+                                       AlignUp(return_trampoline.size())));
+  OUTCOME_TRY(
+      WriteProcessMemory(pid, return_trampoline_address, return_trampoline));
+
+  std::sort(functions.begin(), functions.end(),
+            [](const FunctionToInstrument& lhs,
+               const FunctionToInstrument& rhs) {
+              return lhs.address < rhs.address;
+            });
+  std::vector<FunctionPatch> patches;
+  std::vector<FunctionToInstrument> cluster;
+  for (size_t i = 0; i <= functions.size(); ++i) {
+    if (i == functions.size() ||
+        (!cluster.empty() && functions[i].address + functions[i].size -
+                                     cluster.front().address >
+                                 kMaxClusterSize)) {
+      std::vector<FunctionPatch> cluster_patches = CreateEntryTrampolines(
+          &thread, target_functions, payload_functions,
+          return_trampoline_address, cluster, &maps);
+      std::move(cluster_patches.begin(), cluster_patches.end(),
+                std::back_inserter(patches));
+      cluster.clear();
+    }
+    if (i < functions.size()) {
+      cluster.push_back(functions[i]);
+    }
+  }
+  return patches;
+}
+
+}  // namespace
+
+outcome::result<std::unique_ptr<InstrumentedProcess>, std::string>
+InstrumentedProcess::Create(
+    pid_t pid, const std::string& payload_library_path,
+    const std::vector<FunctionToInstrument>& functions) {
+  std::unique_ptr<InstrumentedProcess> process{new InstrumentedProcess{pid}};
+  if (functions.empty()) {
+    return process;
+  }
+  OUTCOME_TRY(patches,
+              PrepareTrampolines(pid, payload_library_path, functions));
+
+  OUTCOME_TRY(threads, StopProcess(pid));
+  for (FunctionPatch& patch : patches) {
+    outcome::result<void, std::string> write_result =
+        WriteProcessMemory(pid, patch.address, patch.patch);
+    if (!write_result.has_value()) {
+      ERROR("%s", write_result.error());
+      continue;
+    }
+    // A thread stopped after the first of the overwritten instructions
+    // continues at its copy in the trampoline.
+    for (StoppedThread& thread : threads) {
+      for (const auto& [address, relocated_address] :
+           patch.relocated_instruction_addresses) {
+        if (thread.GetInstructionPointer() == address) {
+          (void)thread.SetInstructionPointer(relocated_address);
+        }
+      }
+    }
+    process->original_code_.emplace(patch.address,
+                                    std::move(patch.original_code));
+  }
+  return process;
+}
+
+InstrumentedProcess::~InstrumentedProcess() {
+  outcome::result<void, std::string> result = Uninstrument();
+  if (!result.has_value()) {
+    ERROR("Uninstrumenting process %d: %s", pid_, result.error());
+  }
+}
+
+std::vector<uint64_t> InstrumentedProcess::GetInstrumentedFunctionAddresses()
+    const {
+  std::vector<uint64_t> addresses;
+  addresses.reserve(original_code_.size());
+  for (const auto& [address, original_code] : original_code_) {
+    addresses.push_back(address);
+  }
+  return addresses;
+}
+
+outcome::result<void, std::string> InstrumentedProcess::Uninstrument() {
+  if (original_code_.empty()) {
+    return outcome::success();
+  }
+  // The threads are resumed when they go out of scope.
+  outcome::result<std::vector<StoppedThread>, std::string> threads =
+      StopProcess(pid_);
+  if (!threads.has_value()) {
+    return outcome::failure(threads.error());
+  }
+  for (const auto& [address, original_code] : original_code_) {
+    OUTCOME_TRY(WriteProcessMemory(pid_, address, original_code));
+  }
+  original_code_.clear();
+  return outcome::success();
+}
+
+std::string GetPayloadLibraryPath() {
+  std::error_code error;
+  std::filesystem::path executable_path =
+      std::filesystem::read_symlink("/proc/self/exe", error);
+  if (!error) {
+    std::filesystem::path library_path =
+        executable_path.parent_path() / kPayloadLibraryName;
+    if (std::filesystem::exists(library_path, error)) {
+      return library_path.string();
+    }
+  }
+  return kPayloadLibraryName;
+}
+
+}  // namespace orbit_user_space_instrumentation
@@ -0,0 +1,196 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <OrbitBase/SharedMemoryRingBuffer.h>
+#include <fcntl.h>
+#include <gtest/gtest.h>
+#include <link.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <thread>
+
+#include "ElfUtils/ElfFile.h"
+#include "OrbitTest.h"
+#include "OrbitUserSpaceInstrumentation/FunctionCallRecord.h"
+#include "OrbitUserSpaceInstrumentation/UserSpaceInstrumentation.h"
+#include "Tracee.h"
+#include "Trampoline.h"
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+
+namespace orbit_user_space_instrumentation {
+
+namespace {
+
+// The address and the size of a function of this executable, which is the
+// same in a forked child.
+std::optional<FunctionToInstrument> FindFunction(const std::string& name) {
+  std::unique_ptr<ElfUtils::ElfFile> elf_file =
+      ElfUtils::ElfFile::Create("/proc/self/exe");
+  if (elf_file == nullptr) {
+    return std::nullopt;
+  }
+  outcome::result<ModuleSymbols, std::string> symbols =
+      elf_file->LoadSymbols();
+  if (!symbols.has_value()) {
+    return std::nullopt;
+  }
+  uint64_t load_bias = 0;
+  dl_iterate_phdr(
+      [](dl_phdr_info* info, size_t /*size*/, void* data) {
+        // The first object is the executable.
+        *static_cast<uint64_t*>(data) = info->dlpi_addr;
+        return 1;
+      },
+      &load_bias);
+  for (const SymbolInfo& symbol : symbols.value().symbol_infos()) {
+    if (symbol.name() == name) {
+      return FunctionToInstrument{load_bias + symbol.address(), symbol.size()};
+    }
+  }
+  return std::nullopt;
+}
+
+// Runs OrbitTest in a child process, until destroyed.
+class OrbitTestProcess {
+ public:
+  OrbitTestProcess() {
+    pid_ = fork();
+    if (pid_ == 0) {
+      OrbitTest test{/*num_threads=*/2, /*recurse_depth=*/2,
+                     /*sleep_us=*/1000};
+      test.Start();
+      while (true) {
+        pause();
+      }
+    }
+  }
+  ~OrbitTestProcess() {
+    if (pid_ > 0) {
+      kill(pid_, SIGKILL);
+      waitpid(pid_, nullptr, 0);
+    }
+  }
+
+  pid_t GetPid() const { return pid_; }
+
+ private:
+  pid_t pid_;
+};
+
+// Reads the records of all the ring buffers of process pid.
+std::vector<FunctionCallRecord> ReadFunctionCallRecords(pid_t pid) {
+  using RingBuffer = OrbitBase::SharedMemoryRingBuffer<FunctionCallRecord>;
+  std::vector<FunctionCallRecord> records;
+  std::string link_prefix =
+      absl::StrCat("/memfd:", kFunctionCallRingBufferMemfdPrefix);
+  std::error_code error;
+  for (const std::filesystem::directory_entry& entry :
+       std::filesystem::directory_iterator{absl::StrCat("/proc/", pid, "/fd"),
+                                           error}) {
+    std::error_code link_error;
+    std::string link =
+        std::filesystem::read_symlink(entry.path(), link_error).string();
+    if (link_error || !absl::StartsWith(link, link_prefix)) {
+      continue;
+    }
+    int fd = open(entry.path().c_str(), O_RDWR | O_CLOEXEC);
+    struct stat file_stat {};
+    if (fd < 0 || fstat(fd, &file_stat) != 0) {
+      continue;
+    }
+    size_t size = file_stat.st_size;
+    void* memory =
+        mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED) {
+      continue;
+    }
+    std::optional<RingBuffer> ring_buffer = RingBuffer::Attach(memory, size);
+    FunctionCallRecord record;
+    while (ring_buffer.has_value() && ring_buffer->TryRead(&record)) {
+      records.push_back(record);
+    }
+    munmap(memory, size);
+  }
+  return records;
+}
+
+}  // namespace
+
+TEST(UserSpaceInstrumentation, InstrumentOrbitTestFunction) {
+  std::optional<FunctionToInstrument> test_func =
+      FindFunction("_ZN9OrbitTest8TestFuncEj");
+  ASSERT_TRUE(test_func.has_value());
+
+  OrbitTestProcess orbit_test;
+  ASSERT_GT(orbit_test.GetPid(), 0);
+  // Let the threads start, so that some of them are stopped in TestFunc.
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+  outcome::result<std::unique_ptr<InstrumentedProcess>, std::string> process =
+      InstrumentedProcess::Create(orbit_test.GetPid(), GetPayloadLibraryPath(),
+                                  {test_func.value()});
+  ASSERT_TRUE(process.has_value()) << process.error();
+  EXPECT_EQ(process.value()->GetInstrumentedFunctionAddresses(),
+            std::vector<uint64_t>{test_func->address});
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  std::vector<FunctionCallRecord> records =
+      ReadFunctionCallRecords(orbit_test.GetPid());
+  ASSERT_FALSE(records.empty());
+  int32_t max_depth = 0;
+  for (const FunctionCallRecord& record : records) {
+    EXPECT_EQ(record.function_address, test_func->address);
+    EXPECT_LE(record.begin_timestamp_ns, record.end_timestamp_ns);
+    EXPECT_NE(record.tid, orbit_test.GetPid());
+    max_depth = std::max(max_depth, record.depth);
+  }
+  // TestFunc calls itself down to recurse_depth.
+  EXPECT_EQ(max_depth, 2);
+
+  outcome::result<void, std::string> result =
+      process.value()->Uninstrument();
+  ASSERT_TRUE(result.has_value()) << result.error();
+  outcome::result<std::vector<uint8_t>, std::string> code = ReadProcessMemory(
+      orbit_test.GetPid(), test_func->address, kFunctionPatchSize);
+  ASSERT_TRUE(code.has_value()) << code.error();
+  const auto* original_code =
+      reinterpret_cast<const uint8_t*>(test_func->address);
+  EXPECT_EQ(code.value(),
+            std::vector<uint8_t>(original_code,
+                                 original_code + kFunctionPatchSize));
+
+  // The process keeps running with the payload loaded.
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_EQ(waitpid(orbit_test.GetPid(), nullptr, WNOHANG), 0);
+}
+
+TEST(UserSpaceInstrumentation, CreateFailsForMissingPayload) {
+  std::optional<FunctionToInstrument> test_func =
+      FindFunction("_ZN9OrbitTest8TestFuncEj");
+  ASSERT_TRUE(test_func.has_value());
+  OrbitTestProcess orbit_test;
+  ASSERT_GT(orbit_test.GetPid(), 0);
+
+  outcome::result<std::unique_ptr<InstrumentedProcess>, std::string> process =
+      InstrumentedProcess::Create(orbit_test.GetPid(),
+                                  "/nonexistent/libPayload.so",
+                                  {test_func.value()});
+  EXPECT_FALSE(process.has_value());
+
+  // The failed load left the process running, and uninstrumented.
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_EQ(waitpid(orbit_test.GetPid(), nullptr, WNOHANG), 0);
+  EXPECT_TRUE(ReadFunctionCallRecords(orbit_test.GetPid()).empty());
+}
+
+}  // namespace orbit_user_space_instrumentation
@@ -0,0 +1,45 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_USER_SPACE_INSTRUMENTATION_FUNCTION_CALL_RECORD_H_
+#define ORBIT_USER_SPACE_INSTRUMENTATION_FUNCTION_CALL_RECORD_H_
+
+#include <cstdint>
+
+namespace orbit_user_space_instrumentation {
+
+// A call to a function instrumented with a trampoline, as written by the
+// payload to the shared-memory ring buffer of the calling thread when the
+// function returns.
+struct FunctionCallRecord {
+  // The address of the function in the target process.
+  uint64_t function_address;
+  // CLOCK_MONOTONIC, as for perf_event_open records.
+  uint64_t begin_timestamp_ns;
+  uint64_t end_timestamp_ns;
+  // The content of rax on return.
+  uint64_t return_value;
+  int32_t tid;
+  // The number of calls to instrumented functions the call is nested in.
+  int32_t depth;
+};
+
+// Each thread that calls an instrumented function creates a memfd with this
+// prefix followed by its tid, which OrbitService finds in /proc/<pid>/fd.
+constexpr const char* kFunctionCallRingBufferMemfdPrefix = "orbit_usi_";
+constexpr uint64_t kFunctionCallRingBufferCapacity = 64 * 1024;
+
+// The functions of the payload library that the trampolines call, which are
+// found with dlsym in the target after loading the payload there.
+//   void OrbitUserSpaceInstrumentationEntry(uint64_t function_address,
+//       uint64_t* return_address, uint64_t return_trampoline_address);
+//   uint64_t OrbitUserSpaceInstrumentationExit(uint64_t return_value);
+constexpr const char* kPayloadEntryFunctionName =
+    "OrbitUserSpaceInstrumentationEntry";
+constexpr const char* kPayloadExitFunctionName =
+    "OrbitUserSpaceInstrumentationExit";
+
+}  // namespace orbit_user_space_instrumentation
+
+#endif  // ORBIT_USER_SPACE_INSTRUMENTATION_FUNCTION_CALL_RECORD_H_
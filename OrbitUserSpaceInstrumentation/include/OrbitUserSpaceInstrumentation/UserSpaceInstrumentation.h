@@ -0,0 +1,75 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_USER_SPACE_INSTRUMENTATION_USER_SPACE_INSTRUMENTATION_H_
+#define ORBIT_USER_SPACE_INSTRUMENTATION_USER_SPACE_INSTRUMENTATION_H_
+
+#include <sys/types.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "outcome.hpp"
+
+namespace orbit_user_space_instrumentation {
+
+struct FunctionToInstrument {
+  // The address of the function in the target process.
+  uint64_t address;
+  uint64_t size;
+};
+
+// Dynamic instrumentation without uprobes: the payload library is loaded into
+// the target with ptrace, and the entry of each function is replaced with a
+// jump to a trampoline that calls into the payload, which writes a
+// FunctionCallRecord per call to a shared-memory ring buffer per thread. This
+// avoids the two traps to the kernel per call of uprobes and uretprobes.
+//
+// Like with uretprobes, the return address of an instrumented function is
+// replaced while it runs, which unwinders and exceptions thrown through it
+// don't expect. Only the registers that pass arguments and return values are
+// preserved across the payload, which must not touch the upper halves of the
+// AVX registers.
+class InstrumentedProcess {
+ public:
+  // Loads the payload into process pid and instruments the functions. Those
+  // that can't be instrumented, e.g., because their first instructions can't
+  // be relocated or are the target of a branch, are logged and skipped: the
+  // caller can instrument them in another way.
+  static outcome::result<std::unique_ptr<InstrumentedProcess>, std::string>
+  Create(pid_t pid, const std::string& payload_library_path,
+         const std::vector<FunctionToInstrument>& functions);
+
+  InstrumentedProcess(const InstrumentedProcess&) = delete;
+  InstrumentedProcess& operator=(const InstrumentedProcess&) = delete;
+  // Uninstruments the functions, if they still are.
+  ~InstrumentedProcess();
+
+  pid_t GetPid() const { return pid_; }
+  std::vector<uint64_t> GetInstrumentedFunctionAddresses() const;
+
+  // Restores the original code of the functions. The payload and the
+  // trampolines stay in the target, as threads might still be in them or
+  // return to them.
+  outcome::result<void, std::string> Uninstrument();
+
+ private:
+  explicit InstrumentedProcess(pid_t pid) : pid_{pid} {}
+
+  pid_t pid_;
+  // The bytes that the jump to the trampoline replaced, by function address.
+  absl::flat_hash_map<uint64_t, std::vector<uint8_t>> original_code_;
+};
+
+// The payload library next to the executable of this process, or only its
+// file name, for the dynamic loader of the target to find it in its library
+// path.
+std::string GetPayloadLibraryPath();
+
+}  // namespace orbit_user_space_instrumentation
+
+#endif  // ORBIT_USER_SPACE_INSTRUMENTATION_USER_SPACE_INSTRUMENTATION_H_